@@ -45,12 +45,32 @@ extern hal_i2c_t   i2c1_instance;
 
 static bool accelerometer_irq1_state = false;
 
+/* FIFO stream mode: the INT1 pin is shared by the motion and the watermark */
+static bool accelerometer_fifo_enabled = false;
+static volatile bool accelerometer_irq1_pending = false;
+static bool accelerometer_moved = false;
+
+static acc_sample_t acc_fifo_samples[ACC_FIFO_DEPTH];
+static uint8_t acc_fifo_nb_samples = 0;
+static acc_fifo_stats_t acc_fifo_stats;
+
 static uint8_t who_am_i;
 axis3bit16_t data_raw_acceleration;
 float acceleration_mg[3];
 
+/* Sub-address MSB set: the register address is incremented on each byte read */
+#define LIS2DE12_AUTO_INCREMENT       0x80U
+/* OUT_X_L to OUT_Z_H, the address rolls back to OUT_X_L in FIFO mode */
+#define LIS2DE12_FIFO_SAMPLE_SIZE     6
+
 static void accelerometer_irq1_init( void );
 
+static void accelerometer_int1_route_set( bool motion );
+
+static uint8_t acc_fifo_read( lis2de12_fifo_src_reg_t fifo_src );
+
+static void acc_transfer_read( hal_i2c_transfer_t* transfer, uint8_t reg, uint8_t* data, uint16_t len );
+
 /*!
  * \brief INT1 interrupt callback
  */
@@ -118,8 +138,18 @@ uint8_t accelerometer_init( uint8_t irq_active )
     /* Enable Block Data Update */
     lis2de12_block_data_update_set(PROPERTY_DISABLE);
     
-    /* Enable Fifo mode */
-    lis2de12_fifo_mode_set(LIS2DE12_BYPASS_MODE);
+    /* Fifo mode: stream mode, the oldest samples are overwritten when full */
+    if( irq_active & INT_1_FIFO )
+    {
+      lis2de12_fifo_watermark_set(ACC_FIFO_WATERMARK - 1); /* WTM is set when the level exceeds FTH */
+      lis2de12_fifo_mode_set(LIS2DE12_DYNAMIC_STREAM_MODE);
+      lis2de12_fifo_set(PROPERTY_ENABLE);
+      accelerometer_fifo_enabled = true;
+    }
+    else
+    {
+      lis2de12_fifo_mode_set(LIS2DE12_BYPASS_MODE);
+    }
     
     /* Set full scale to 2g */ 
     lis2de12_full_scale_set(LIS2DE12_2g);
@@ -139,7 +169,7 @@ uint8_t accelerometer_init( uint8_t irq_active )
     ctrl_reg3.i1_ia2 = 0;
     ctrl_reg3.i1_click = 0;
     ctrl_reg3.i1_overrun = 0;
-    ctrl_reg3.i1_wtm = 0;
+    ctrl_reg3.i1_wtm = ( accelerometer_fifo_enabled == true ) ? 1 : 0;
     ctrl_reg3.not_used_01 = 0;
     ctrl_reg3.not_used_02 = 0;
     lis2de12_pin_int1_config_set(&ctrl_reg3);
@@ -155,7 +185,7 @@ uint8_t accelerometer_init( uint8_t irq_active )
 
     lis2de12_int1_gen_duration_set(3);
 
-    if( irq_active & 0x01)
+    if( irq_active & ( INT_1 | INT_1_FIFO ) )
     {
         accelerometer_irq1_init( );
     }
@@ -169,15 +199,145 @@ uint8_t is_accelerometer_detected_moved(void)
     
     lis2de12_int1_gen_source_get(&int1_gen_source);
     
-    if((int1_gen_source.xh == 1) || (int1_gen_source.yh == 1) || (int1_gen_source.zh == 1))
+    if((int1_gen_source.xh == 1) || (int1_gen_source.yh == 1) || (int1_gen_source.zh == 1) ||
+       (accelerometer_moved == true))
     {
         accelerometer_irq1_state = false;
+
+        if( accelerometer_moved == true )
+        {
+            /* Motion consumed, route it back on INT1 for the next cycle */
+            accelerometer_moved = false;
+            accelerometer_int1_route_set( true );
+        }
         
         return 1;
     }
     return 0;
 }
 
+/*!
+ * \brief Service the INT1 interrupt in task context when the FIFO is enabled
+ *
+ * The latched motion is read and cleared so that the INT1 line falls and the next watermark raises an edge. The
+ * motion is kept for is_accelerometer_detected_moved and unrouted from INT1 until then, one wake-up per cycle as
+ * without the FIFO. The FIFO is drained on a watermark or an overrun.
+ *
+ * \retval Events mask, ACC_IRQ1_MOTION and/or ACC_IRQ1_WATERMARK
+ */
+uint8_t acc_irq1_service( void )
+{
+    lis2de12_int1_src_t int1_gen_source;
+    lis2de12_fifo_src_reg_t fifo_src;
+    hal_i2c_transfer_t transfers[2];
+    uint8_t events = ACC_IRQ1_NONE;
+
+    if( ( accelerometer_fifo_enabled == false ) || ( accelerometer_irq1_pending == false ) )
+    {
+        return ACC_IRQ1_NONE;
+    }
+    accelerometer_irq1_pending = false;
+    acc_fifo_stats.nb_irq++;
+
+    /* Both sources in one transaction */
+    acc_transfer_read( &transfers[0], LIS2DE12_INT1_SRC, (uint8_t*)&int1_gen_source, 1 );
+    acc_transfer_read( &transfers[1], LIS2DE12_FIFO_SRC_REG, (uint8_t*)&fifo_src, 1 );
+    if( hal_i2c_transact( 1, transfers, 2 ) == FAIL )
+    {
+        return ACC_IRQ1_NONE;
+    }
+
+    if((int1_gen_source.xh == 1) || (int1_gen_source.yh == 1) || (int1_gen_source.zh == 1))
+    {
+        accelerometer_moved = true;
+        accelerometer_irq1_state = true;
+        accelerometer_int1_route_set( false );
+        events |= ACC_IRQ1_MOTION;
+    }
+
+    if( ( fifo_src.wtm == 1 ) || ( fifo_src.ovrn_fifo == 1 ) )
+    {
+        acc_fifo_read( fifo_src );
+        events |= ACC_IRQ1_WATERMARK;
+    }
+
+    return events;
+}
+
+/*!
+ * \brief Read all the samples of the FIFO in one burst I2C transaction
+ *
+ * \retval Number of samples read, available with acc_fifo_get_samples until the next drain
+ */
+uint8_t acc_fifo_drain( void )
+{
+    lis2de12_fifo_src_reg_t fifo_src;
+
+    if( lis2de12_fifo_status_get(&fifo_src) != 0 )
+    {
+        return 0;
+    }
+    return acc_fifo_read( fifo_src );
+}
+
+/*!
+ * \brief Read the sensors of a data collection: the newest acceleration and the temperature
+ *
+ * In FIFO mode the FIFO status and the temperature are read in one transaction, then the FIFO in one burst.
+ *
+ * \param [out] temperature Raw temperature
+ */
+void acc_read_sensors( int16_t* temperature )
+{
+    lis2de12_fifo_src_reg_t fifo_src;
+    uint8_t temperature_raw[2];
+    hal_i2c_transfer_t transfers[2];
+
+    if( accelerometer_fifo_enabled == false )
+    {
+        acc_read_raw_data( );
+        *temperature = acc_get_temperature( );
+        return;
+    }
+
+    acc_transfer_read( &transfers[0], LIS2DE12_FIFO_SRC_REG, (uint8_t*)&fifo_src, 1 );
+    acc_transfer_read( &transfers[1], LIS2DE12_OUT_TEMP_L, temperature_raw, 2 );
+    if( hal_i2c_transact( 1, transfers, 2 ) == SUCCESS )
+    {
+        *temperature = (int16_t)( temperature_raw[0] | ( temperature_raw[1] << 8 ) );
+        acc_fifo_read( fifo_src );
+    }
+    else
+    {
+        *temperature = acc_get_temperature( );
+    }
+
+    /* No sample drained since the init, wait for the first one */
+    if( acc_fifo_stats.nb_drains == 0 )
+    {
+        acc_read_raw_data( );
+    }
+}
+
+/*!
+ * \brief Get the samples of the last drain, oldest first
+ */
+uint8_t acc_fifo_get_samples( const acc_sample_t** samples )
+{
+    *samples = acc_fifo_samples;
+    return acc_fifo_nb_samples;
+}
+
+bool is_accelerometer_fifo_enabled( void )
+{
+    return accelerometer_fifo_enabled;
+}
+
+void acc_fifo_get_stats( acc_fifo_stats_t* stats )
+{
+    *stats = acc_fifo_stats;
+}
+
 /*!
  * \brief Get the accelerometer IRQ state
  */
@@ -203,6 +363,16 @@ void acc_read_raw_data( void )
 {
     lis2de12_reg_t reg;
     bool DataRead=false;
+
+    if( accelerometer_fifo_enabled == true )
+    {
+        /* Reading the output registers pops the oldest sample, drain the FIFO to get the newest one. The FIFO may
+         * have been drained by the watermark just before, the previous newest sample is then recent enough. */
+        while( ( acc_fifo_drain( ) == 0 ) && ( acc_fifo_stats.nb_drains == 0 ) )
+        {
+        }
+        return;
+    }
     
     while(DataRead == false)
     {
@@ -243,15 +413,13 @@ int16_t acc_get_raw_z( void )
 
 int16_t acc_get_temperature( void )
 {
-    uint16_t temperature;
-    uint8_t is_ready = 0;
-
-    lis2de12_temp_data_ready_get(&is_ready);
+    uint8_t temperature_raw[2] = { 0 };
 
-    lis2de12_temperature_raw_get( &temperature );
+    /* OUT_TEMP_L and OUT_TEMP_H in one burst */
+    lis2de12_read_reg(LIS2DE12_OUT_TEMP_L | LIS2DE12_AUTO_INCREMENT, temperature_raw, 2);
 
     /* Build the raw tmp */
-    return (int16_t)temperature;
+    return (int16_t)( temperature_raw[0] | ( temperature_raw[1] << 8 ) );
 }
 
 /**
@@ -2475,9 +2643,83 @@ static void accelerometer_irq1_init( void )
     hal_gpio_init_in( lis2de12_int1.pin, HAL_GPIO_PULL_MODE_NONE, HAL_GPIO_IRQ_MODE_RISING, &lis2de12_int1 );
 }
 
+static uint8_t acc_fifo_read( lis2de12_fifo_src_reg_t fifo_src )
+{
+    uint8_t buffer[ACC_FIFO_DEPTH * LIS2DE12_FIFO_SAMPLE_SIZE];
+    hal_i2c_transfer_t transfer;
+    uint8_t nb_samples;
+
+    if( fifo_src.empty == 1 )
+    {
+        return 0;
+    }
+    /* FSS is 5 bits wide, the overrun flag tells a full FIFO */
+    nb_samples = ( fifo_src.ovrn_fifo == 1 ) ? ACC_FIFO_DEPTH : fifo_src.fss;
+    if( nb_samples == 0 )
+    {
+        return 0;
+    }
+
+    /* One burst with the DMA, the core sleeps meanwhile */
+    acc_transfer_read( &transfer, LIS2DE12_FIFO_READ_START, buffer, nb_samples * LIS2DE12_FIFO_SAMPLE_SIZE );
+    if( hal_i2c_transact( 1, &transfer, 1 ) == FAIL )
+    {
+        return 0;
+    }
+
+    for( uint8_t i = 0; i < nb_samples; i++ )
+    {
+        /* The low bytes are not used on the LIS2DE12, 8-bit output */
+        acc_fifo_samples[i].x = ( int8_t ) buffer[i * LIS2DE12_FIFO_SAMPLE_SIZE + 1];
+        acc_fifo_samples[i].y = ( int8_t ) buffer[i * LIS2DE12_FIFO_SAMPLE_SIZE + 3];
+        acc_fifo_samples[i].z = ( int8_t ) buffer[i * LIS2DE12_FIFO_SAMPLE_SIZE + 5];
+    }
+    acc_fifo_nb_samples = nb_samples;
+
+    /* The newest sample is the current acceleration */
+    acceleration_mg[0] = lis2de12_from_fs2_to_mg( ( int16_t )( acc_fifo_samples[nb_samples - 1].x * 256 ) );
+    acceleration_mg[1] = lis2de12_from_fs2_to_mg( ( int16_t )( acc_fifo_samples[nb_samples - 1].y * 256 ) );
+    acceleration_mg[2] = lis2de12_from_fs2_to_mg( ( int16_t )( acc_fifo_samples[nb_samples - 1].z * 256 ) );
+
+    acc_fifo_stats.nb_drains++;
+    acc_fifo_stats.nb_samples += nb_samples;
+    if( fifo_src.ovrn_fifo == 1 )
+    {
+        acc_fifo_stats.nb_overruns++;
+    }
+
+    return nb_samples;
+}
+
+static void acc_transfer_read( hal_i2c_transfer_t* transfer, uint8_t reg, uint8_t* data, uint16_t len )
+{
+    transfer->device_addr = LIS2DE12_I2C_ADD_H;
+    transfer->addr        = ( len > 1 ) ? ( reg | LIS2DE12_AUTO_INCREMENT ) : reg;
+    transfer->buffer      = data;
+    transfer->size        = len;
+    transfer->is_read     = true;
+}
+
+static void accelerometer_int1_route_set( bool motion )
+{
+    lis2de12_ctrl_reg3_t ctrl_reg3;
+
+    lis2de12_pin_int1_config_get(&ctrl_reg3);
+    ctrl_reg3.i1_ia1 = ( motion == true ) ? 1 : 0;
+    lis2de12_pin_int1_config_set(&ctrl_reg3);
+}
+
 void lis2de12_int1_irq_handler( void* obj )
 {
-    accelerometer_irq1_state = true;
+    if( accelerometer_fifo_enabled == true )
+    {
+        /* Motion or watermark, told apart by acc_irq1_service over I2C */
+        accelerometer_irq1_pending = true;
+    }
+    else
+    {
+        accelerometer_irq1_state = true;
+    }
 }
 
 
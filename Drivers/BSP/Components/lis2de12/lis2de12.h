@@ -50,6 +50,14 @@
 
 #define INT_NONE    0x00
 #define INT_1       0x01
+#define INT_1_FIFO  0x02    /* FIFO in stream mode, watermark routed on INT1 */
+
+#define ACC_FIFO_DEPTH          32
+#define ACC_FIFO_WATERMARK      24    /* samples per watermark interrupt, 2.4 s at 10Hz, 0.8 s left before an overrun */
+
+#define ACC_IRQ1_NONE           0x00
+#define ACC_IRQ1_MOTION         0x01
+#define ACC_IRQ1_WATERMARK      0x02
 
 /** @addtogroup LIS2DE12
   * @{
@@ -479,6 +487,37 @@ int16_t acc_get_raw_z( void );
 
 int16_t acc_get_temperature( void );
 
+/*!
+ * \brief Acceleration sample read from the FIFO, 8-bit high part of each axis (16 mg/digit at 2g)
+ */
+typedef struct {
+  int8_t x;
+  int8_t y;
+  int8_t z;
+} acc_sample_t;
+
+/*!
+ * \brief FIFO statistics since the init
+ */
+typedef struct {
+  uint32_t nb_irq;          /* INT1 interrupts serviced */
+  uint32_t nb_drains;       /* burst reads of the FIFO */
+  uint32_t nb_samples;      /* samples read from the FIFO */
+  uint32_t nb_overruns;     /* drains which found the FIFO full, older samples lost */
+} acc_fifo_stats_t;
+
+uint8_t acc_irq1_service( void );
+
+uint8_t acc_fifo_drain( void );
+
+void acc_read_sensors( int16_t* temperature );
+
+uint8_t acc_fifo_get_samples( const acc_sample_t** samples );
+
+bool is_accelerometer_fifo_enabled( void );
+
+void acc_fifo_get_stats( acc_fifo_stats_t* stats );
+
 int32_t lis2de12_read_reg(uint8_t reg, uint8_t* data,
                           uint16_t len);
 int32_t lis2de12_write_reg(uint8_t reg, uint8_t* data,
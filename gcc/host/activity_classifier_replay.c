@@ -0,0 +1,305 @@
+/*
+ * Replay of labelled accelerometer FIFO batches through activity_classifier_update (activity_classifier.c) on the
+ * host, as the motion task feeds it: a watermark of samples at 10 Hz, 8-bit outputs of 16 mg at 2 g.
+ *
+ * The batches are synthesized from seeded models of the three activities, each with a hard case: a desk with some
+ * typing, a slow stroll with the tracker in a bag, a car stopped in traffic. A trace chains segments of the models so
+ * that the confirmation of the activity changes is replayed too.
+ *
+ * The confusion matrices of the window classes and of the confirmed activity against the labels are printed, with
+ * the cost of a window in host cycles. The replay fails when less than SIM_MIN_ACCURACY_PERCENT of the windows of an
+ * activity get its confirmed class, or less than SIM_MIN_HARD_ACCURACY_PERCENT of the windows of its hard case.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+
+#include "activity_classifier.h"
+
+#define SIM_WINDOW ACC_FIFO_WATERMARK
+#define SIM_ODR_HZ 10.0
+#define SIM_GRAVITY_LSB 62.5
+#define SIM_MAX_WINDOWS 4096
+#define SIM_NB_TIMED_RUNS 200
+#define SIM_MIN_ACCURACY_PERCENT 90
+#define SIM_MIN_HARD_ACCURACY_PERCENT 70
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef enum sim_model_e
+{
+    SIM_DESK,
+    SIM_DESK_TYPING,  // Hard case
+    SIM_WALK,
+    SIM_WALK_SLOW_BAG,  // Hard case
+    SIM_CAR,
+    SIM_CAR_STOPPED,  // Hard case
+    SIM_NB_MODELS,
+} sim_model_t;
+
+typedef struct sim_segment_s
+{
+    sim_model_t model;
+    uint16_t    nb_windows;
+} sim_segment_t;
+
+typedef struct sim_window_s
+{
+    acc_sample_t samples[SIM_WINDOW];
+    activity_t   label;
+    bool         hard;
+} sim_window_t;
+
+static const activity_t sim_model_labels[SIM_NB_MODELS] = {
+    ACTIVITY_STATIONARY, ACTIVITY_STATIONARY, ACTIVITY_WALKING, ACTIVITY_WALKING, ACTIVITY_VEHICLE, ACTIVITY_VEHICLE,
+};
+
+static const sim_segment_t sim_trace[] = {
+    { SIM_DESK, 200 },         { SIM_WALK, 120 }, { SIM_CAR, 300 },         { SIM_CAR_STOPPED, 20 },
+    { SIM_CAR, 200 },          { SIM_WALK, 60 },  { SIM_DESK_TYPING, 100 }, { SIM_DESK, 150 },
+    { SIM_WALK_SLOW_BAG, 60 }, { SIM_WALK, 100 }, { SIM_CAR, 150 },         { SIM_CAR_STOPPED, 15 },
+    { SIM_CAR, 100 },          { SIM_WALK, 80 },  { SIM_DESK, 300 },
+};
+
+#define NB_SIM_SEGMENTS ( sizeof( sim_trace ) / sizeof( sim_trace[0] ) )
+
+static sim_window_t sim_windows[SIM_MAX_WINDOWS];
+static uint16_t     sim_nb_windows;
+static uint32_t     sim_seed = 1;
+
+static uint32_t sim_random( void )
+{
+    sim_seed ^= sim_seed << 13;
+    sim_seed ^= sim_seed >> 17;
+    sim_seed ^= sim_seed << 5;
+    return sim_seed;
+}
+
+static double sim_uniform( double min, double max )
+{
+    return min + ( ( max - min ) * ( sim_random( ) & 0xFFFF ) / 65536.0 );
+}
+
+/*
+ * Gaussian noise, sum of 12 uniforms
+ */
+static double sim_noise( double sigma )
+{
+    double sum = 0;
+
+    for( uint8_t i = 0; i < 12; i++ )
+    {
+        sum += sim_uniform( 0, 1 );
+    }
+    return ( sum - 6 ) * sigma;
+}
+
+static int8_t sim_quantize( double value )
+{
+    value = floor( value + 0.5 );
+    return ( int8_t )( ( value > 127 ) ? 127 : ( ( value < -128 ) ? -128 : value ) );
+}
+
+/*
+ * Synthesizes a FIFO batch: gravity along a tilted axis, plus the motion of the model on the vertical and the
+ * horizontal axes, plus the noise of the sensor and of the mounting
+ */
+static void sim_synthesize( sim_model_t model, double* phase, sim_window_t* window )
+{
+    double tilt       = sim_uniform( 0, 0.5 );
+    double step_hz    = 0;
+    double step_lsb   = 0;
+    double noise_lsb  = 0.3;
+    double vibration  = 0;
+    double drift_lsb  = 0;
+    double bump_ratio = 0;
+
+    switch( model )
+    {
+    case SIM_DESK:
+        break;
+    case SIM_DESK_TYPING:
+        bump_ratio = 0.05;
+        break;
+    case SIM_WALK:
+        step_hz  = sim_uniform( 1.6, 2.2 );
+        step_lsb = sim_uniform( 9, 19 );  // 150 mg to 300 mg
+        break;
+    case SIM_WALK_SLOW_BAG:
+        step_hz  = sim_uniform( 1.2, 1.5 );
+        step_lsb = sim_uniform( 4, 7 );
+        break;
+    case SIM_CAR:
+        vibration = sim_uniform( 1.5, 4 );  // 25 mg to 65 mg RMS, wide band
+        drift_lsb = sim_uniform( 0, 6 );    // Accelerations and turns
+        break;
+    case SIM_CAR_STOPPED:
+        vibration = sim_uniform( 0.4, 0.9 );  // Idling engine
+        break;
+    default:
+        break;
+    }
+
+    window->label = sim_model_labels[model];
+    window->hard  = ( model == SIM_DESK_TYPING ) || ( model == SIM_WALK_SLOW_BAG ) || ( model == SIM_CAR_STOPPED );
+    for( uint8_t i = 0; i < SIM_WINDOW; i++ )
+    {
+        double t        = i / SIM_ODR_HZ;
+        double vertical = 0;
+        double sway     = 0;
+        double drift    = drift_lsb * sin( 2 * M_PI * 0.05 * t );
+        double bump     = ( sim_uniform( 0, 1 ) < bump_ratio ) ? sim_noise( 3 ) : 0;
+
+        if( step_hz != 0 )
+        {
+            vertical = step_lsb * ( sin( *phase ) + ( 0.3 * sin( 2 * *phase ) ) );
+            sway     = 0.3 * step_lsb * sin( *phase / 2 );
+            *phase += 2 * M_PI * step_hz / SIM_ODR_HZ;
+        }
+
+        window->samples[i].x = sim_quantize( SIM_GRAVITY_LSB * sin( tilt ) + sway + drift +
+                                             sim_noise( noise_lsb + vibration ) );
+        window->samples[i].y = sim_quantize( sim_noise( noise_lsb + vibration ) + bump );
+        window->samples[i].z = sim_quantize( SIM_GRAVITY_LSB * cos( tilt ) + vertical +
+                                             sim_noise( noise_lsb + vibration ) );
+    }
+}
+
+static void sim_build_trace( void )
+{
+    double phase = 0;
+
+    sim_nb_windows = 0;
+    for( uint8_t i = 0; i < NB_SIM_SEGMENTS; i++ )
+    {
+        for( uint16_t k = 0; k < sim_trace[i].nb_windows; k++ )
+        {
+            sim_synthesize( sim_trace[i].model, &phase, &sim_windows[sim_nb_windows++] );
+        }
+    }
+}
+
+static uint64_t sim_cycles( void )
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+    return __rdtsc( );
+#else
+    return 0;
+#endif
+}
+
+static double sim_now_ns( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void sim_print_matrix( const char* name, uint32_t matrix[ACTIVITY_NB][ACTIVITY_NB] )
+{
+    printf( "%-24s %10s %10s %10s %10s\n", name, activity_classifier_get_name( ACTIVITY_STATIONARY ),
+            activity_classifier_get_name( ACTIVITY_WALKING ), activity_classifier_get_name( ACTIVITY_VEHICLE ),
+            activity_classifier_get_name( ACTIVITY_UNKNOWN ) );
+    for( uint8_t label = ACTIVITY_STATIONARY; label < ACTIVITY_NB; label++ )
+    {
+        printf( "%-24s %10u %10u %10u %10u\n", activity_classifier_get_name( ( activity_t ) label ),
+                matrix[label][ACTIVITY_STATIONARY], matrix[label][ACTIVITY_WALKING], matrix[label][ACTIVITY_VEHICLE],
+                matrix[label][ACTIVITY_UNKNOWN] );
+    }
+}
+
+/*
+ * Prints the share of the windows of each label confirmed right, returns the number of labels below min_percent
+ */
+static uint8_t sim_check_accuracy( const char* name, uint32_t matrix[ACTIVITY_NB][ACTIVITY_NB], uint8_t min_percent )
+{
+    uint8_t nb_failed = 0;
+
+    for( uint8_t label = ACTIVITY_STATIONARY; label < ACTIVITY_NB; label++ )
+    {
+        uint32_t total = 0;
+
+        for( uint8_t k = 0; k < ACTIVITY_NB; k++ )
+        {
+            total += matrix[label][k];
+        }
+        printf( "%-10s %-18s %5.1f %% confirmed right\n", activity_classifier_get_name( ( activity_t ) label ), name,
+                100.0 * matrix[label][label] / total );
+        if( ( 100 * matrix[label][label] ) < ( min_percent * total ) )
+        {
+            printf( "FAIL: less than %u %% of the %s %s confirmed right\n", min_percent,
+                    activity_classifier_get_name( ( activity_t ) label ), name );
+            nb_failed++;
+        }
+    }
+    return nb_failed;
+}
+
+int main( void )
+{
+    uint32_t windows[ACTIVITY_NB][ACTIVITY_NB]   = { { 0 } };
+    uint32_t confirmed[ACTIVITY_NB][ACTIVITY_NB] = { { 0 } };
+    uint32_t hard[ACTIVITY_NB][ACTIVITY_NB]      = { { 0 } };
+    uint32_t now_ds                              = 0;  // Time in tenths of a second, one per sample
+    uint32_t now                                 = 0;
+    uint8_t  nb_failed                           = 0;
+    uint64_t start_cycles;
+    double   start_ns;
+    double   elapsed_ns;
+    double   elapsed_cycles;
+
+    sim_build_trace( );
+
+    /* Accuracy */
+    activity_classifier_reset( );
+    for( uint16_t i = 0; i < sim_nb_windows; i++ )
+    {
+        activity_t window_class = activity_classifier_update( sim_windows[i].samples, SIM_WINDOW, now );
+        activity_t activity     = activity_classifier_get( now );
+
+        if( sim_windows[i].hard == true )
+        {
+            hard[sim_windows[i].label][activity]++;
+        }
+        else
+        {
+            windows[sim_windows[i].label][window_class]++;
+            confirmed[sim_windows[i].label][activity]++;
+        }
+        now_ds += SIM_WINDOW;
+        now = now_ds / 10;
+    }
+
+    printf( "%u windows of %u samples, %u s of motion\n", sim_nb_windows, SIM_WINDOW, now );
+    sim_print_matrix( "label \\ window class", windows );
+    sim_print_matrix( "label \\ confirmed", confirmed );
+    sim_print_matrix( "hard cases \\ confirmed", hard );
+
+    nb_failed += sim_check_accuracy( "windows", confirmed, SIM_MIN_ACCURACY_PERCENT );
+    nb_failed += sim_check_accuracy( "hard case windows", hard, SIM_MIN_HARD_ACCURACY_PERCENT );
+
+    /* Cost of a window */
+    start_ns     = sim_now_ns( );
+    start_cycles = sim_cycles( );
+    for( uint16_t run = 0; run < SIM_NB_TIMED_RUNS; run++ )
+    {
+        for( uint16_t i = 0; i < sim_nb_windows; i++ )
+        {
+            activity_classifier_update( sim_windows[i].samples, SIM_WINDOW, now );
+        }
+    }
+    elapsed_cycles = ( double ) ( sim_cycles( ) - start_cycles );
+    elapsed_ns     = sim_now_ns( ) - start_ns;
+    printf( "%.1f ns, %.0f host cycles per window\n", elapsed_ns / ( SIM_NB_TIMED_RUNS * sim_nb_windows ),
+            elapsed_cycles / ( SIM_NB_TIMED_RUNS * sim_nb_windows ) );
+
+    return ( nb_failed == 0 ) ? 0 : 1;
+}
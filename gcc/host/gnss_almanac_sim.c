@@ -0,0 +1,327 @@
+/*
+ * Simulation of the almanac refresh over LoRaWAN (gnss_almanac.c) on the host, against a stand-in of the application
+ * server which drops a share of its downlinks.
+ *
+ * The tracker sends an uplink every period, gnss_almanac_request_get tells if the almanac request rides along. The
+ * server answers a request with the segment starting at its next chunk, as many 20 bytes chunks as the data rate
+ * allows, unless the CRC of the request is already the one of its almanac. The segment is split into fragments and
+ * written as main_tracker.c does, to a stand-in of the LR1110 which only takes the new global CRC once every chunk is
+ * written in sequence.
+ *
+ * Each scenario checks that the almanac converges unless every downlink is dropped, that no more than
+ * GNSS_ALMANAC_MAX_REQUESTS_PER_DAY requests, and as many downlinks, are sent over any 24 hours, that a single request
+ * a day is sent while no segment comes, and that the requests stop once the almanac is fresh.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_hal.h"
+#include "gnss_almanac.h"
+
+#define SIM_DAY_S ( 24UL * 3600UL )
+#define SIM_MAX_DAYS 14
+#define SIM_MAX_EVENTS 2048
+#define SIM_INITIAL_AGE_S ( 40UL * SIM_DAY_S )
+#define SIM_OLD_CRC 0x11111111UL
+#define SIM_NEW_CRC 0x5EC7EC4AUL
+#define SIM_ALMANAC_DATE 2600
+
+/*
+ * LoRaWAN downlink, 13 bytes of MAC header, frame header, port and MIC around the segment
+ */
+#define SIM_LORAWAN_OVERHEAD 13
+
+typedef struct sim_scenario_s
+{
+    const char* name;
+    uint32_t    uplink_period_s;
+    uint8_t     spreading_factor;
+    uint8_t     max_payload;  // Largest FRMPayload of the data rate, EU868
+    uint8_t     loss_percent;
+} sim_scenario_t;
+
+typedef struct sim_result_s
+{
+    bool     converged;
+    uint32_t convergence_s;
+    uint16_t nb_requests;
+    uint16_t nb_downlinks;
+    uint16_t nb_lost;
+    uint16_t max_requests_per_day;
+    uint32_t max_airtime_per_day_ms;
+} sim_result_t;
+
+static const sim_scenario_t sim_scenarios[] = {
+    { "DR5, 60 s uplinks, no loss", 60, 7, 242, 0 },
+    { "DR5, 60 s uplinks, 30 % lost", 60, 7, 242, 30 },
+    { "DR3, 60 s uplinks, 30 % lost", 60, 9, 115, 30 },
+    { "DR3, 60 s uplinks, 70 % lost", 60, 9, 115, 70 },
+    { "DR3, 1 h uplinks, 70 % lost", 3600, 9, 115, 70 },
+    { "DR5, 60 s uplinks, all lost", 60, 7, 242, 100 },
+};
+
+static uint8_t  sim_almanac[GNSS_ALMANAC_NB_CHUNKS][LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE];
+static uint32_t sim_seed = 1;
+
+static uint32_t sim_device_crc;
+static uint16_t sim_device_next_chunk;
+
+static uint32_t sim_request_times[SIM_MAX_EVENTS];
+static uint32_t sim_downlink_times[SIM_MAX_EVENTS];
+static uint32_t sim_downlink_airtimes_ms[SIM_MAX_EVENTS];
+
+static uint32_t sim_random( void )
+{
+    sim_seed ^= sim_seed << 13;
+    sim_seed ^= sim_seed >> 17;
+    sim_seed ^= sim_seed << 5;
+    return sim_seed;
+}
+
+/*
+ * Stand-in of the LR1110: the new CRC is taken once the header and all the chunks are written in sequence
+ */
+lr1110_modem_response_code_t lr1110_modem_gnss_one_chunk_almanac_update(
+    const void* context, const lr1110_modem_gnss_almanac_one_chunk_bytestream_t almanac_one_chunk_bytestream )
+{
+    if( memcmp( almanac_one_chunk_bytestream, sim_almanac[0], LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE ) == 0 )
+    {
+        sim_device_next_chunk = 1;
+    }
+    else if( ( sim_device_next_chunk != 0 ) && ( sim_device_next_chunk < GNSS_ALMANAC_NB_CHUNKS ) &&
+             ( memcmp( almanac_one_chunk_bytestream, sim_almanac[sim_device_next_chunk],
+                       LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE ) == 0 ) )
+    {
+        sim_device_next_chunk++;
+    }
+    else
+    {
+        printf( "FAIL: chunk written out of sequence, %u expected\n", sim_device_next_chunk );
+        exit( 1 );
+    }
+
+    if( sim_device_next_chunk == GNSS_ALMANAC_NB_CHUNKS )
+    {
+        sim_device_crc = SIM_NEW_CRC;
+    }
+    return LR1110_MODEM_RESPONSE_CODE_OK;
+}
+
+lr1110_modem_response_code_t lr1110_modem_gnss_get_context( const void*                  context,
+                                                            lr1110_modem_gnss_context_t* gnss_context )
+{
+    memset( gnss_context, 0, sizeof( lr1110_modem_gnss_context_t ) );
+    gnss_context->global_almanac_crc = sim_device_crc;
+    return LR1110_MODEM_RESPONSE_CODE_OK;
+}
+
+/*
+ * LoRa time on air, 125 kHz, coding rate 4/5, 8 symbols preamble, explicit header, no payload CRC on downlinks
+ */
+static uint32_t sim_airtime_ms( uint8_t spreading_factor, uint16_t payload_len )
+{
+    double symbol_ms  = ( double ) ( 1 << spreading_factor ) / 125.0;
+    int    low_rate   = ( spreading_factor >= 11 ) ? 1 : 0;
+    double nb_symbols = 8 + ceil( ( 8.0 * payload_len - 4.0 * spreading_factor + 28 ) /
+                                  ( 4.0 * ( spreading_factor - 2 * low_rate ) ) ) * 5;
+
+    if( nb_symbols < 8 )
+    {
+        nb_symbols = 8;
+    }
+    return ( uint32_t ) ceil( ( 12.25 + nb_symbols ) * symbol_ms );
+}
+
+static void sim_build_almanac( void )
+{
+    // Header: type, date and global CRC, little endian
+    memset( sim_almanac[0], 0, LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE );
+    sim_almanac[0][0] = 0x80;
+    sim_almanac[0][1] = SIM_ALMANAC_DATE & 0xFF;
+    sim_almanac[0][2] = SIM_ALMANAC_DATE >> 8;
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        sim_almanac[0][3 + i] = ( SIM_NEW_CRC >> ( 8 * i ) ) & 0xFF;
+    }
+    for( uint16_t chunk = 1; chunk < GNSS_ALMANAC_NB_CHUNKS; chunk++ )
+    {
+        sim_almanac[chunk][0] = chunk - 1;  // Satellite id
+        for( uint8_t i = 1; i < LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE; i++ )
+        {
+            sim_almanac[chunk][i] = sim_random( ) & 0xFF;
+        }
+    }
+}
+
+/*
+ * Delivers a segment as main_tracker.c does, fragments of at most GNSS_ALMANAC_FRAGMENT_MAX_CHUNKS chunks written by
+ * the almanac task before the next uplink
+ */
+static void sim_deliver_segment( uint8_t first_chunk, uint8_t nb_chunks )
+{
+    for( uint8_t i = 0; i < nb_chunks; i += GNSS_ALMANAC_FRAGMENT_MAX_CHUNKS )
+    {
+        uint8_t nb_fragment_chunks = nb_chunks - i;
+
+        if( nb_fragment_chunks > GNSS_ALMANAC_FRAGMENT_MAX_CHUNKS )
+        {
+            nb_fragment_chunks = GNSS_ALMANAC_FRAGMENT_MAX_CHUNKS;
+        }
+        if( gnss_almanac_update_push( NULL, first_chunk + i, nb_fragment_chunks, sim_almanac[first_chunk + i] ) ==
+            false )
+        {
+            break;
+        }
+    }
+    while( gnss_almanac_update_process( NULL ) == true )
+    {
+    }
+}
+
+static uint16_t sim_max_in_a_day( const uint32_t* times, const uint32_t* weights, uint16_t nb, uint32_t* max_weight )
+{
+    uint16_t max_count = 0;
+
+    *max_weight = 0;
+    for( uint16_t first = 0; first < nb; first++ )
+    {
+        uint16_t count  = 0;
+        uint32_t weight = 0;
+
+        for( uint16_t i = first; ( i < nb ) && ( ( times[i] - times[first] ) < SIM_DAY_S ); i++ )
+        {
+            count++;
+            weight += ( weights != NULL ) ? weights[i] : 0;
+        }
+        if( count > max_count )
+        {
+            max_count = count;
+        }
+        if( weight > *max_weight )
+        {
+            *max_weight = weight;
+        }
+    }
+    return max_count;
+}
+
+static void sim_run( const sim_scenario_t* scenario, uint32_t start, sim_result_t* result )
+{
+    uint8_t  segment_chunks = ( scenario->max_payload - 1 ) / LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE;
+    uint32_t end            = start + SIM_MAX_DAYS * SIM_DAY_S;
+    uint32_t fresh_since    = 0;
+    uint32_t unused;
+
+    memset( result, 0, sizeof( sim_result_t ) );
+    sim_device_crc        = SIM_OLD_CRC;
+    sim_device_next_chunk = 0;
+
+    for( uint32_t now = start; now < end; now += scenario->uplink_period_s )
+    {
+        gnss_almanac_update_state_t state;
+        gnss_almanac_request_t      request;
+        uint32_t                    age = SIM_INITIAL_AGE_S + now - start;
+
+        if( result->converged == true )
+        {
+            age = now - fresh_since;
+        }
+
+        if( gnss_almanac_request_get( NULL, now, age, &request ) == true )
+        {
+            uint8_t nb_chunks;
+
+            if( result->converged == true )
+            {
+                printf( "FAIL: almanac requested while fresh\n" );
+                exit( 1 );
+            }
+            sim_request_times[result->nb_requests++] = now;
+            if( request.crc == SIM_NEW_CRC )
+            {
+                continue;  // Nothing to send
+            }
+
+            nb_chunks = GNSS_ALMANAC_NB_CHUNKS - request.next_chunk;
+            if( nb_chunks > segment_chunks )
+            {
+                nb_chunks = segment_chunks;
+            }
+            sim_downlink_times[result->nb_downlinks] = now;
+            sim_downlink_airtimes_ms[result->nb_downlinks++] =
+                sim_airtime_ms( scenario->spreading_factor,
+                                SIM_LORAWAN_OVERHEAD + 1 + nb_chunks * LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE );
+
+            if( ( sim_random( ) % 100 ) < scenario->loss_percent )
+            {
+                result->nb_lost++;
+                continue;
+            }
+            sim_deliver_segment( request.next_chunk, nb_chunks );
+        }
+
+        if( ( gnss_almanac_update_get_completion( &state ) == true ) && ( state.status == GNSS_ALMANAC_UPDATE_DONE ) )
+        {
+            // main_tracker.c stores the date of the update, the almanac is fresh again
+            result->converged     = true;
+            result->convergence_s = now - start;
+            fresh_since           = now;
+        }
+        if( result->nb_requests == SIM_MAX_EVENTS )
+        {
+            break;
+        }
+    }
+
+    result->max_requests_per_day = sim_max_in_a_day( sim_request_times, NULL, result->nb_requests, &unused );
+    sim_max_in_a_day( sim_downlink_times, sim_downlink_airtimes_ms, result->nb_downlinks,
+                      &result->max_airtime_per_day_ms );
+}
+
+int main( void )
+{
+    uint32_t start     = SIM_DAY_S;
+    uint8_t  nb_failed = 0;
+
+    host_trace_enabled = false;
+    sim_build_almanac( );
+
+    printf( "scenario                         converged   requests  downlinks  lost  max req/day  max airtime/day\n" );
+    for( uint8_t i = 0; i < sizeof( sim_scenarios ) / sizeof( sim_scenarios[0] ); i++ )
+    {
+        const sim_scenario_t* scenario = &sim_scenarios[i];
+        sim_result_t          result;
+        uint32_t              airtime_bound_ms;
+        bool                  pass;
+
+        sim_run( scenario, start, &result );
+        start += ( SIM_MAX_DAYS + 2 ) * SIM_DAY_S;
+
+        airtime_bound_ms = GNSS_ALMANAC_MAX_REQUESTS_PER_DAY *
+                           sim_airtime_ms( scenario->spreading_factor, SIM_LORAWAN_OVERHEAD + scenario->max_payload );
+        pass = ( result.converged == ( scenario->loss_percent < 100 ) ) &&
+               ( result.max_requests_per_day <= GNSS_ALMANAC_MAX_REQUESTS_PER_DAY ) &&
+               ( result.max_airtime_per_day_ms <= airtime_bound_ms ) &&
+               ( ( result.nb_downlinks != result.nb_lost ) || ( result.max_requests_per_day <= 1 ) );
+
+        if( result.converged == true )
+        {
+            printf( "%-32s %7.1f h", scenario->name, result.convergence_s / 3600.0 );
+        }
+        else
+        {
+            printf( "%-32s %9s", scenario->name, "no" );
+        }
+        printf( " %10u %10u %5u %12u %10.1f s / %.1f s%s\n", result.nb_requests, result.nb_downlinks, result.nb_lost,
+                result.max_requests_per_day, result.max_airtime_per_day_ms / 1000.0, airtime_bound_ms / 1000.0,
+                ( pass == true ) ? "" : "  FAIL" );
+        if( pass == false )
+        {
+            nb_failed++;
+        }
+    }
+
+    return ( nb_failed == 0 ) ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+/*
+ * Host stand-in of the MCU and RTC HAL, see host_hal.h
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host_hal.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+
+uint32_t host_rtc_ticks             = 0;
+bool     host_rtc_alarm_armed       = false;
+uint32_t host_rtc_alarm_timestamp   = 0;
+uint32_t host_rtc_nb_alarm_programs = 0;
+bool     host_trace_enabled         = true;
+
+static uint32_t host_rtc_time_ref = 0;
+
+void hal_mcu_critical_section_begin( uint32_t* mask ) { *mask = 0; }
+
+void hal_mcu_critical_section_end( uint32_t* mask ) { ( void ) mask; }
+
+void hal_mcu_panic( void )
+{
+    fprintf( stderr, "hal_mcu_panic\n" );
+    abort( );
+}
+
+void hal_mcu_trace_print( const char* fmt, ... )
+{
+    va_list args;
+
+    if( host_trace_enabled == false )
+    {
+        return;
+    }
+    va_start( args, fmt );
+    vprintf( fmt, args );
+    va_end( args );
+}
+
+uint32_t hal_rtc_get_time_s( void ) { return host_rtc_ticks >> 10; }
+
+uint32_t hal_rtc_get_time_ms( void ) { return hal_rtc_tick_2_ms( host_rtc_ticks ); }
+
+uint32_t hal_rtc_get_timer_value( void ) { return host_rtc_ticks; }
+
+uint32_t hal_rtc_set_time_ref_in_ticks( void )
+{
+    host_rtc_time_ref = host_rtc_ticks;
+    return host_rtc_time_ref;
+}
+
+uint32_t hal_rtc_get_time_ref_in_ticks( void ) { return host_rtc_time_ref; }
+
+uint32_t hal_rtc_ms_2_tick( const uint32_t milliseconds )
+{
+    return ( uint32_t )( ( ( uint64_t ) milliseconds << 10 ) / 1000 );
+}
+
+uint32_t hal_rtc_tick_2_ms( const uint32_t tick ) { return ( uint32_t )( ( ( uint64_t ) tick * 1000 ) >> 10 ); }
+
+uint32_t hal_rtc_get_minimum_timeout( void ) { return 3; }
+
+uint32_t hal_rtc_temp_compensation( uint32_t period, float temperature )
+{
+    ( void ) temperature;
+    return period;
+}
+
+void hal_rtc_stop_alarm( void ) { host_rtc_alarm_armed = false; }
+
+void hal_rtc_start_alarm( uint32_t timeout )
+{
+    host_rtc_alarm_armed     = true;
+    host_rtc_alarm_timestamp = host_rtc_time_ref + timeout;
+    host_rtc_nb_alarm_programs++;
+}
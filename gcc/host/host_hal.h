@@ -0,0 +1,32 @@
+/*
+ * Host stand-in of the MCU and RTC HAL: the RTC is a tick counter moved by the simulation, the critical sections are
+ * empty and a panic aborts.
+ */
+#ifndef __HOST_HAL_H__
+#define __HOST_HAL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * \brief Simulated RTC, 1024 ticks per second
+ */
+extern uint32_t host_rtc_ticks;
+
+/*!
+ * \brief RTC alarm programmed by hal_rtc_start_alarm, absolute time in ticks
+ */
+extern bool     host_rtc_alarm_armed;
+extern uint32_t host_rtc_alarm_timestamp;
+
+/*!
+ * \brief Number of hal_rtc_start_alarm calls
+ */
+extern uint32_t host_rtc_nb_alarm_programs;
+
+/*!
+ * \brief Debug traces of the modules printed on stdout, true by default
+ */
+extern bool host_trace_enabled;
+
+#endif  // __HOST_HAL_H__
@@ -0,0 +1,10 @@
+/*
+ * Host stand-in of the board definitions, only the LR1110 modem types and the debug traces
+ */
+#ifndef __LR1110_TRACKER_BOARD_H__
+#define __LR1110_TRACKER_BOARD_H__
+
+#include "lr1110_modem_gnss.h"
+#include "smtc_hal_dbg_trace.h"
+
+#endif  // __LR1110_TRACKER_BOARD_H__
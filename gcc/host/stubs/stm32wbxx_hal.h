@@ -0,0 +1,29 @@
+/*
+ * Host stand-in of the STM32WBxx HAL, only the types used by the HAL headers of the modules built on the host
+ */
+#ifndef __STM32WBXX_HAL_H
+#define __STM32WBXX_HAL_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint8_t Hours;
+    uint8_t Minutes;
+    uint8_t Seconds;
+} RTC_TimeTypeDef;
+
+typedef struct
+{
+    uint8_t WeekDay;
+    uint8_t Month;
+    uint8_t Date;
+    uint8_t Year;
+} RTC_DateTypeDef;
+
+typedef struct
+{
+    void* Instance;
+} RTC_HandleTypeDef;
+
+#endif  // __STM32WBXX_HAL_H
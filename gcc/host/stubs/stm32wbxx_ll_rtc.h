@@ -0,0 +1,7 @@
+/*
+ * Host stand-in of the STM32WBxx RTC low layer driver, nothing is used by the modules built on the host
+ */
+#ifndef __STM32WBxx_LL_RTC_H
+#define __STM32WBxx_LL_RTC_H
+
+#endif  // __STM32WBxx_LL_RTC_H
@@ -0,0 +1,127 @@
+/*
+ * Microbenchmark of the timer heap (smtc_hal_tmr_list.c): cost of timer_start and timer_stop against the number of
+ * running timers, on the host. The heap is built with TIMER_HEAP_SIZE=128 to show the trend beyond the firmware size.
+ *
+ * Each point restarts random timers, each restart being a timer_stop and a timer_start, and checks after each one
+ * that the RTC alarm is programmed for the earliest timeout plus slack of the running timers. The random case rarely
+ * moves the alarm. In the worst case all the timers share the same timeout, so each stop removes the timer setting
+ * the alarm and the next wakeup has to be found again.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "host_hal.h"
+#include "smtc_hal_tmr_list.h"
+
+#define BENCH_MAX_TIMERS 127
+#define BENCH_NB_RESTARTS 200000
+
+static timer_event_t bench_timers[BENCH_MAX_TIMERS];
+static uint32_t      bench_seed = 1;
+
+static uint32_t bench_random( void )
+{
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 17;
+    bench_seed ^= bench_seed << 5;
+    return bench_seed;
+}
+
+static void bench_callback( void* context ) { ( void ) context; }
+
+static double bench_now_ns( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench_check_alarm( uint8_t nb_timers )
+{
+    uint32_t wakeup = bench_timers[0].timestamp + bench_timers[0].slack;
+
+    for( uint8_t i = 1; i < nb_timers; i++ )
+    {
+        uint32_t deadline = bench_timers[i].timestamp + bench_timers[i].slack;
+
+        if( ( int32_t )( deadline - wakeup ) < 0 )
+        {
+            wakeup = deadline;
+        }
+    }
+    if( ( host_rtc_alarm_armed == false ) || ( host_rtc_alarm_timestamp != wakeup ) )
+    {
+        printf( "FAIL: alarm at %u, earliest wakeup at %u\n", host_rtc_alarm_timestamp, wakeup );
+        exit( 1 );
+    }
+}
+
+static void bench_run( uint8_t nb_timers, bool same_timeout )
+{
+    double   start_ns;
+    double   elapsed_ns;
+    uint32_t nb_programs;
+
+    for( uint8_t i = 0; i < nb_timers; i++ )
+    {
+        uint32_t delay_ms = ( same_timeout == true ) ? 1000 : 100 + bench_random( ) % 100000;
+
+        timer_init( &bench_timers[i], bench_callback );
+        timer_set_value( &bench_timers[i], delay_ms );
+        if( ( same_timeout == false ) && ( ( bench_random( ) % 2 ) != 0 ) )
+        {
+            timer_set_slack( &bench_timers[i], delay_ms >> 3 );
+        }
+        timer_start( &bench_timers[i] );
+    }
+
+    /* Correctness pass, the time does not move so no timer expires */
+    for( uint32_t n = 0; n < 10000; n++ )
+    {
+        timer_event_t* timer = &bench_timers[bench_random( ) % nb_timers];
+
+        timer_stop( timer );
+        timer_start( timer );
+        bench_check_alarm( nb_timers );
+    }
+
+    /* Timed pass */
+    nb_programs = host_rtc_nb_alarm_programs;
+    start_ns    = bench_now_ns( );
+    for( uint32_t n = 0; n < BENCH_NB_RESTARTS; n++ )
+    {
+        timer_event_t* timer = &bench_timers[bench_random( ) % nb_timers];
+
+        timer_stop( timer );
+        timer_start( timer );
+    }
+    elapsed_ns  = bench_now_ns( ) - start_ns;
+    nb_programs = host_rtc_nb_alarm_programs - nb_programs;
+
+    printf( "%-8s %7u %12.1f %16.3f\n", ( same_timeout == true ) ? "worst" : "random", nb_timers,
+            elapsed_ns / BENCH_NB_RESTARTS, ( double ) nb_programs / BENCH_NB_RESTARTS );
+
+    for( uint8_t i = 0; i < nb_timers; i++ )
+    {
+        timer_stop( &bench_timers[i] );
+    }
+}
+
+int main( void )
+{
+    static const uint8_t points[] = { 1, 2, 4, 8, 16, 32, 64, 127 };
+
+    printf( "case      timers   ns/restart   alarms/restart\n" );
+    for( uint8_t i = 0; i < sizeof( points ); i++ )
+    {
+        bench_run( points[i], false );
+    }
+    for( uint8_t i = 0; i < sizeof( points ); i++ )
+    {
+        bench_run( points[i], true );
+    }
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * Simulation of the RTC alarm coalescing of the timer heap (smtc_hal_tmr_list.c) on the host, over 24 hours of RTC
+ * time. The RTC jumps from one alarm to the next and timer_irq_handler serves the timers.
+ *
+ * The timers are the ones the heap is sized for: 8 application timers with random delays from 100 ms to 30 s, half
+ * of them with a slack of 1/8 of their delay like the software watchdog, and 6 exact timers like the BLE timer
+ * server ones, with random delays from 10 ms to 2 s. Each timer is restarted from its callback with a new delay.
+ *
+ * The application timers are simulated alone, then with the exact ones. Each set is run first with coalescing
+ * disabled, all the timers exact and without slack, which gives the alarm interrupts needed without coalescing.
+ *
+ * Every callback checks its timer is not served later than its slack, nor earlier than the coalescing window allows,
+ * exact timers never early. A timer due less than the RTC minimum timeout after the wakeup serving another one waits
+ * for that minimum timeout, this lateness is reported.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_hal.h"
+#include "smtc_hal_tmr_list.h"
+#include "smtc_hal_rtc.h"
+
+#define SIM_NB_APP_TIMERS 8
+#define SIM_NB_EXACT_TIMERS 6
+#define SIM_NB_TIMERS ( SIM_NB_APP_TIMERS + SIM_NB_EXACT_TIMERS )
+#define SIM_DURATION_TICKS ( 24UL * 3600UL * 1024UL )
+#define SIM_COALESCE_WINDOW 16  // TIMER_COALESCE_WINDOW of smtc_hal_tmr_list.c
+#define SIM_COALESCE_SHIFT 3    // TIMER_COALESCE_SHIFT of smtc_hal_tmr_list.c
+
+typedef struct sim_timer_s
+{
+    timer_event_t timer;
+    uint32_t      min_delay_ms;
+    uint32_t      max_delay_ms;
+    bool          has_slack;
+    bool          coalesce;
+} sim_timer_t;
+
+typedef struct sim_result_s
+{
+    timer_stats_t stats;
+    uint32_t      nb_early;
+    uint32_t      nb_late;
+    int32_t       max_late;
+} sim_result_t;
+
+static sim_timer_t  sim_timers[SIM_NB_TIMERS];
+static uint32_t     sim_seed = 1;
+static sim_result_t sim_result;
+
+static uint32_t sim_random( void )
+{
+    sim_seed ^= sim_seed << 13;
+    sim_seed ^= sim_seed >> 17;
+    sim_seed ^= sim_seed << 5;
+    return sim_seed;
+}
+
+static void sim_start( sim_timer_t* sim )
+{
+    uint32_t delay_ms = sim->min_delay_ms + sim_random( ) % ( sim->max_delay_ms - sim->min_delay_ms + 1 );
+
+    timer_set_value( &sim->timer, delay_ms );
+    timer_set_slack( &sim->timer, ( ( sim->coalesce == true ) && ( sim->has_slack == true ) ) ? delay_ms >> 3 : 0 );
+    timer_start( &sim->timer );
+}
+
+static void sim_callback( void* context )
+{
+    sim_timer_t* sim    = ( sim_timer_t* ) context;
+    int32_t      offset = ( int32_t )( host_rtc_ticks - sim->timer.timestamp );
+    int32_t      window = sim->timer.reload_value >> SIM_COALESCE_SHIFT;
+
+    if( window > SIM_COALESCE_WINDOW )
+    {
+        window = SIM_COALESCE_WINDOW;
+    }
+    if( sim->timer.is_exact == true )
+    {
+        window = 0;
+    }
+
+    if( ( offset < -window ) || ( offset > ( int32_t )( sim->timer.slack + hal_rtc_get_minimum_timeout( ) ) ) )
+    {
+        printf( "FAIL: timer %u served %d ticks after its timeout, window %d, slack %u\n",
+                ( unsigned ) ( sim - sim_timers ), offset, window, sim->timer.slack );
+        exit( 1 );
+    }
+    if( offset < 0 )
+    {
+        sim_result.nb_early++;
+    }
+    if( offset > ( int32_t ) sim->timer.slack )
+    {
+        sim_result.nb_late++;
+        if( ( offset - ( int32_t ) sim->timer.slack ) > sim_result.max_late )
+        {
+            sim_result.max_late = offset - ( int32_t ) sim->timer.slack;
+        }
+    }
+
+    sim_start( sim );
+}
+
+static void sim_run( uint8_t nb_timers, bool coalesce, sim_result_t* result )
+{
+    uint32_t      end = host_rtc_ticks + SIM_DURATION_TICKS;
+    timer_stats_t start_stats;
+
+    sim_seed = 1;
+    memset( &sim_result, 0, sizeof( sim_result ) );
+    for( uint8_t i = 0; i < nb_timers; i++ )
+    {
+        sim_timer_t* sim = &sim_timers[i];
+
+        sim->min_delay_ms = ( i < SIM_NB_APP_TIMERS ) ? 100 : 10;
+        sim->max_delay_ms = ( i < SIM_NB_APP_TIMERS ) ? 30000 : 2000;
+        sim->has_slack    = ( i < SIM_NB_APP_TIMERS ) && ( ( i % 2 ) == 0 );
+        sim->coalesce     = coalesce;
+        timer_init( &sim->timer, sim_callback );
+        timer_set_context( &sim->timer, sim );
+        timer_set_exact( &sim->timer, ( coalesce == false ) || ( i >= SIM_NB_APP_TIMERS ) );
+        sim_start( sim );
+    }
+
+    timer_get_stats( &start_stats );
+    while( ( int32_t )( host_rtc_ticks - end ) < 0 )
+    {
+        if( host_rtc_alarm_armed == false )
+        {
+            printf( "FAIL: timers are running without an RTC alarm\n" );
+            exit( 1 );
+        }
+        if( ( int32_t )( host_rtc_alarm_timestamp - host_rtc_ticks ) > 0 )
+        {
+            host_rtc_ticks = host_rtc_alarm_timestamp;
+        }
+        timer_irq_handler( );
+    }
+    timer_get_stats( &sim_result.stats );
+    sim_result.stats.wakeups -= start_stats.wakeups;
+    sim_result.stats.expiries -= start_stats.expiries;
+    *result = sim_result;
+
+    for( uint8_t i = 0; i < nb_timers; i++ )
+    {
+        timer_stop( &sim_timers[i].timer );
+    }
+}
+
+static double sim_print( const char* name, const sim_result_t* result )
+{
+    double alarms_per_expiry = ( double ) result->stats.wakeups / result->stats.expiries;
+
+    printf( "%-10s %9u %8u %9.1f %17.3f %6u %6u %9d\n", name, result->stats.expiries, result->stats.wakeups,
+            result->stats.wakeups / 24.0, alarms_per_expiry, result->nb_early, result->nb_late, result->max_late );
+    return alarms_per_expiry;
+}
+
+static void sim_compare( const char* name, uint8_t nb_timers )
+{
+    sim_result_t reference;
+    sim_result_t coalesced;
+    double       reference_ratio;
+    double       coalesced_ratio;
+
+    sim_run( nb_timers, false, &reference );
+    sim_run( nb_timers, true, &coalesced );
+
+    printf( "== %s\n", name );
+    printf( "case        expiries   alarms   alarms/h   alarms/expiry  early   late  max late\n" );
+    reference_ratio = sim_print( "exact", &reference );
+    coalesced_ratio = sim_print( "coalesced", &coalesced );
+    printf( "%.1f %% of the alarm interrupts per expiry saved\n", 100.0 * ( 1.0 - coalesced_ratio / reference_ratio ) );
+}
+
+int main( void )
+{
+    sim_compare( "application timers", SIM_NB_APP_TIMERS );
+    sim_compare( "application and BLE timer server timers", SIM_NB_TIMERS );
+
+    return 0;
+}
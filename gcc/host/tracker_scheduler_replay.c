@@ -0,0 +1,377 @@
+/*
+ * Replay of motion traces through the scan scheduler (tracker_scheduler.c) on the host, with the scan cycle of
+ * main_tracker.c: the 8 cycles motion history, the static mode with its keep alive frame every hour, and the scan
+ * started at once when a static tracker starts to move and tracker_scheduler_allow_motion_fix allows it.
+ *
+ * A trace is a list of segments of stillness, walking or driving. A cycle sees a motion when a walking or driving
+ * segment overlaps the time since the previous cycle, a motion start is the beginning of a walking or driving segment
+ * after stillness. The charge model gives the total charge passed to the scheduler: a sleep current, a small cost
+ * for the cycles without a scan, and the cost of a scan cycle, Wi-Fi and uplink or GNSS and uplink in a vehicle.
+ *
+ * Each trace is replayed with the default policy, then with the scheduler disabled, the fixed 60 s scan interval. The
+ * scans per hour and the charge are reported against the hourly budget. The replay checks that no hour window of the
+ * scheduler draws more than the budget plus one scan cycle, and that the motion starts of a static tracker are served
+ * at once until the budget is spent.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tracker_scheduler.h"
+
+#define SIM_APP_SCAN_INTERVAL_S 60          // TRACKER_SCAN_INTERVAL of main_tracker.h
+#define SIM_KEEP_ALIVE_INTERVAL_S 3600      // TRACKER_KEEP_ALIVE_FRAME_INTERVAL of main_tracker.h
+#define SIM_MAX_HOURS 24
+#define SIM_MAX_SEGMENTS 32
+
+/*
+ * Charge model, in nAh
+ */
+#define SIM_SLEEP_NAH_PER_S 3              // 10 uA average asleep, accelerometer and BLE advertising off
+#define SIM_CYCLE_NAH 100                  // Wakeup of a static cycle without a scan
+#define SIM_WIFI_SCAN_CYCLE_NAH 25000      // Wi-Fi scan, uplink and receive windows
+#define SIM_GNSS_SCAN_CYCLE_NAH 45000      // GNSS scan, Wi-Fi scan, uplink and receive windows
+
+typedef enum sim_motion_e
+{
+    SIM_STILL,
+    SIM_WALKING,
+    SIM_DRIVING,
+} sim_motion_t;
+
+typedef struct sim_segment_s
+{
+    uint32_t     duration_s;
+    sim_motion_t motion;
+} sim_segment_t;
+
+typedef struct sim_trace_s
+{
+    const char*   name;
+    sim_segment_t segments[SIM_MAX_SEGMENTS];
+} sim_trace_t;
+
+typedef struct sim_result_s
+{
+    uint32_t nb_hours;
+    uint32_t nb_scans;
+    uint32_t nb_keep_alive_scans;
+    uint32_t max_scans_per_hour;
+    uint32_t charge_uah;
+    uint32_t max_charge_per_hour_uah;
+    uint32_t max_window_charge_uah;
+    uint32_t nb_motion_starts;
+    uint32_t nb_motion_fixes;
+    uint32_t nb_motion_fixes_denied;
+    uint32_t nb_throttled;
+    uint8_t  max_level;
+} sim_result_t;
+
+static const sim_trace_t sim_traces[] = {
+    {
+        "commuter day",
+        {
+            { 7 * 3600, SIM_STILL },     { 15 * 60, SIM_WALKING }, { 45 * 60, SIM_DRIVING }, { 5 * 60, SIM_WALKING },
+            { 4 * 3600, SIM_STILL },     { 30 * 60, SIM_WALKING }, { 5 * 3600, SIM_STILL },  { 5 * 60, SIM_WALKING },
+            { 50 * 60, SIM_DRIVING },    { 10 * 60, SIM_WALKING }, { 320 * 60, SIM_STILL },
+        },
+    },
+    {
+        "parked, bumped every 3 h",
+        {
+            { 3 * 3600, SIM_STILL }, { 2, SIM_WALKING }, { 3 * 3600, SIM_STILL }, { 2, SIM_WALKING },
+            { 3 * 3600, SIM_STILL }, { 2, SIM_WALKING }, { 3 * 3600, SIM_STILL }, { 2, SIM_WALKING },
+            { 3 * 3600, SIM_STILL }, { 2, SIM_WALKING }, { 3 * 3600, SIM_STILL }, { 2, SIM_WALKING },
+            { 3 * 3600, SIM_STILL }, { 2, SIM_WALKING }, { 3 * 3600 - 14, SIM_STILL },
+        },
+    },
+    {
+        "delivery round",
+        {
+            { 3600, SIM_STILL },         { 20 * 60, SIM_DRIVING }, { 4 * 60, SIM_WALKING }, { 3 * 60, SIM_STILL },
+            { 15 * 60, SIM_DRIVING },    { 5 * 60, SIM_WALKING },  { 2 * 60, SIM_STILL },   { 25 * 60, SIM_DRIVING },
+            { 3 * 60, SIM_WALKING },     { 4 * 60, SIM_STILL },    { 18 * 60, SIM_DRIVING }, { 6 * 60, SIM_WALKING },
+            { 3 * 60, SIM_STILL },       { 22 * 60, SIM_DRIVING }, { 4 * 60, SIM_WALKING }, { 2 * 60, SIM_STILL },
+            { 30 * 60, SIM_DRIVING },    { 5 * 60, SIM_WALKING },  { 129 * 60, SIM_STILL },
+        },
+    },
+    {
+        "long drive",
+        {
+            { 3600, SIM_STILL }, { 4 * 3600, SIM_DRIVING }, { 3600, SIM_STILL },
+        },
+    },
+};
+
+#define NB_SIM_TRACES ( sizeof( sim_traces ) / sizeof( sim_traces[0] ) )
+
+static uint32_t sim_charge_nah;
+static uint32_t sim_scans_per_hour[SIM_MAX_HOURS];
+static uint32_t sim_charge_per_hour_nah[SIM_MAX_HOURS];
+
+static uint32_t sim_trace_duration( const sim_trace_t* trace )
+{
+    uint32_t duration = 0;
+
+    for( uint8_t i = 0; ( i < SIM_MAX_SEGMENTS ) && ( trace->segments[i].duration_s != 0 ); i++ )
+    {
+        duration += trace->segments[i].duration_s;
+    }
+    return duration;
+}
+
+/*
+ * Motion of the trace at a time
+ */
+static sim_motion_t sim_motion_at( const sim_trace_t* trace, uint32_t time_s )
+{
+    uint32_t start = 0;
+
+    for( uint8_t i = 0; ( i < SIM_MAX_SEGMENTS ) && ( trace->segments[i].duration_s != 0 ); i++ )
+    {
+        if( time_s < ( start + trace->segments[i].duration_s ) )
+        {
+            return trace->segments[i].motion;
+        }
+        start += trace->segments[i].duration_s;
+    }
+    return SIM_STILL;
+}
+
+/*
+ * Tells if the trace moves in ]from, to], a motion starting at to included as it wakes up the tracker
+ */
+static bool sim_moved( const sim_trace_t* trace, uint32_t from, uint32_t to )
+{
+    uint32_t start = 0;
+
+    for( uint8_t i = 0; ( i < SIM_MAX_SEGMENTS ) && ( trace->segments[i].duration_s != 0 ); i++ )
+    {
+        uint32_t end = start + trace->segments[i].duration_s;
+
+        if( ( trace->segments[i].motion != SIM_STILL ) && ( start <= to ) && ( end > from ) )
+        {
+            return true;
+        }
+        start = end;
+    }
+    return false;
+}
+
+/*
+ * Finds the first motion start in ]from, to]
+ */
+static bool sim_next_motion_start( const sim_trace_t* trace, uint32_t from, uint32_t to, uint32_t* motion_start )
+{
+    uint32_t start = 0;
+
+    for( uint8_t i = 1; ( i < SIM_MAX_SEGMENTS ) && ( trace->segments[i].duration_s != 0 ); i++ )
+    {
+        start += trace->segments[i - 1].duration_s;
+        if( ( trace->segments[i - 1].motion == SIM_STILL ) && ( trace->segments[i].motion != SIM_STILL ) &&
+            ( start > from ) && ( start <= to ) )
+        {
+            *motion_start = start;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Draws some charge at a time, the charge passed to the scheduler is in uAh like hal_energy_get_total_charge
+ */
+static void sim_draw( uint32_t time_s, uint32_t charge_nah )
+{
+    sim_charge_nah += charge_nah;
+    sim_charge_per_hour_nah[time_s / 3600] += charge_nah;
+}
+
+static void sim_sleep( uint32_t from, uint32_t to )
+{
+    while( from < to )
+    {
+        uint32_t hour_end = ( ( from / 3600 ) + 1 ) * 3600;
+        uint32_t end      = ( hour_end < to ) ? hour_end : to;
+
+        sim_draw( from, ( end - from ) * SIM_SLEEP_NAH_PER_S );
+        from = end;
+    }
+}
+
+static void sim_replay( const sim_trace_t* trace, const tracker_scheduler_policy_t* policy, sim_result_t* result )
+{
+    uint32_t                  duration         = sim_trace_duration( trace );
+    uint32_t                  now              = 0;
+    uint32_t                  last_cycle       = 0;
+    uint32_t                  next_cycle       = 0;
+    uint8_t                   move_history     = 1;  // As set at startup by main_tracker.c
+    bool                      send_alive_frame = false;
+    uint32_t                  next_frame_ctn   = 0;
+    bool                      enabled          = ( policy->flags & TRACKER_SCHEDULER_ENABLED ) != 0;
+    tracker_scheduler_stats_t stats;
+
+    tracker_scheduler_reset( );
+    sim_charge_nah = 0;
+    memset( sim_scans_per_hour, 0, sizeof( sim_scans_per_hour ) );
+    memset( sim_charge_per_hour_nah, 0, sizeof( sim_charge_per_hour_nah ) );
+    memset( result, 0, sizeof( sim_result_t ) );
+
+    while( next_cycle < duration )
+    {
+        tracker_scheduler_decision_t decision;
+        bool                         moved;
+        uint32_t                     interval_s;
+
+        /* A static tracker starting to move scans at once when the scheduler allows it, or when the cycle is due */
+        while( move_history == 0 )
+        {
+            uint32_t motion_start;
+
+            if( sim_next_motion_start( trace, now, next_cycle, &motion_start ) == false )
+            {
+                break;
+            }
+            sim_sleep( now, motion_start );
+            now = motion_start;
+            result->nb_motion_starts++;
+            if( ( now == next_cycle ) || ( enabled == false ) ||
+                ( tracker_scheduler_allow_motion_fix( policy, now, sim_charge_nah / 1000 ) == true ) )
+            {
+                result->nb_motion_fixes++;
+                next_cycle = now;
+                break;
+            }
+            result->nb_motion_fixes_denied++;
+        }
+        sim_sleep( now, next_cycle );
+        now = next_cycle;
+
+        /* tracker_scan_task */
+        moved        = sim_moved( trace, last_cycle, now );
+        last_cycle   = now;
+        move_history = ( move_history << 1 ) + moved;
+        if( ( move_history != 0 ) || ( send_alive_frame == true ) )
+        {
+            tracker_scheduler_update( policy, moved, true, now, sim_charge_nah / 1000, &decision );
+            interval_s = ( ( enabled == false ) || ( move_history == 0 ) ) ? SIM_APP_SCAN_INTERVAL_S
+                                                                           : decision.interval_s;
+            if( send_alive_frame == true )
+            {
+                result->nb_keep_alive_scans++;
+            }
+            send_alive_frame = false;
+            next_frame_ctn   = 0;
+
+            sim_draw( now, ( sim_motion_at( trace, now ) == SIM_DRIVING ) ? SIM_GNSS_SCAN_CYCLE_NAH
+                                                                           : SIM_WIFI_SCAN_CYCLE_NAH );
+            sim_scans_per_hour[now / 3600]++;
+            result->nb_scans++;
+        }
+        else
+        {
+            tracker_scheduler_update( policy, moved, false, now, sim_charge_nah / 1000, &decision );
+            interval_s = SIM_APP_SCAN_INTERVAL_S;
+            if( next_frame_ctn >= ( SIM_KEEP_ALIVE_INTERVAL_S / SIM_APP_SCAN_INTERVAL_S ) )
+            {
+                send_alive_frame = true;
+            }
+            else
+            {
+                next_frame_ctn++;
+            }
+            sim_draw( now, SIM_CYCLE_NAH );
+        }
+
+        if( ( enabled == true ) && ( decision.level > result->max_level ) )
+        {
+            result->max_level = decision.level;
+        }
+        tracker_scheduler_get_stats( &stats );
+        if( stats.hour_charge_uah > result->max_window_charge_uah )
+        {
+            result->max_window_charge_uah = stats.hour_charge_uah;
+        }
+        next_cycle = now + interval_s;
+    }
+    sim_sleep( now, duration );
+
+    tracker_scheduler_get_stats( &stats );
+    result->nb_throttled = ( enabled == true ) ? stats.nb_throttled : 0;
+    result->nb_hours     = duration / 3600;
+    result->charge_uah   = sim_charge_nah / 1000;
+    for( uint32_t hour = 0; hour < result->nb_hours; hour++ )
+    {
+        if( sim_scans_per_hour[hour] > result->max_scans_per_hour )
+        {
+            result->max_scans_per_hour = sim_scans_per_hour[hour];
+        }
+        if( ( sim_charge_per_hour_nah[hour] / 1000 ) > result->max_charge_per_hour_uah )
+        {
+            result->max_charge_per_hour_uah = sim_charge_per_hour_nah[hour] / 1000;
+        }
+    }
+}
+
+static void sim_print( const char* name, const sim_result_t* result )
+{
+    printf( "%-10s %6u %8.1f %8u %6u %9u %8.1f %8u %9u %6u/%u/%u %9u %5u\n", name, result->nb_scans,
+            ( double ) result->nb_scans / result->nb_hours, result->max_scans_per_hour, result->nb_keep_alive_scans,
+            result->charge_uah, ( double ) result->charge_uah / result->nb_hours, result->max_charge_per_hour_uah,
+            result->max_window_charge_uah, result->nb_motion_starts, result->nb_motion_fixes,
+            result->nb_motion_fixes_denied, result->nb_throttled, result->max_level );
+}
+
+static bool sim_check( const tracker_scheduler_policy_t* policy, const sim_result_t* result )
+{
+    uint32_t max_window_charge = policy->max_charge_per_hour_uah + ( SIM_GNSS_SCAN_CYCLE_NAH / 1000 );
+    bool     pass              = true;
+
+    if( result->max_window_charge_uah > max_window_charge )
+    {
+        printf( "FAIL: %u uAh drawn in an hour window, over the budget of %u uAh and a scan cycle\n",
+                result->max_window_charge_uah, policy->max_charge_per_hour_uah );
+        pass = false;
+    }
+    if( ( result->nb_motion_fixes + result->nb_motion_fixes_denied ) != result->nb_motion_starts )
+    {
+        printf( "FAIL: %u motion starts of a static tracker, %u served at once, %u denied by the budget\n",
+                result->nb_motion_starts, result->nb_motion_fixes, result->nb_motion_fixes_denied );
+        pass = false;
+    }
+    return pass;
+}
+
+int main( void )
+{
+    tracker_scheduler_policy_t policy;
+    tracker_scheduler_policy_t fixed;
+    sim_result_t               result;
+    uint8_t                    nb_failed = 0;
+
+    tracker_scheduler_policy_set_default( &policy );
+    fixed = policy;
+    fixed.flags &= ~TRACKER_SCHEDULER_ENABLED;
+
+    printf( "hourly budget %u uAh, Wi-Fi scan cycle %u uAh, GNSS scan cycle %u uAh, asleep %u uAh/h\n",
+            policy.max_charge_per_hour_uah, SIM_WIFI_SCAN_CYCLE_NAH / 1000, SIM_GNSS_SCAN_CYCLE_NAH / 1000,
+            SIM_SLEEP_NAH_PER_S * 3600 / 1000 );
+    for( uint8_t i = 0; i < NB_SIM_TRACES; i++ )
+    {
+        printf( "== %s, %u h\n", sim_traces[i].name, sim_trace_duration( &sim_traces[i] ) / 3600 );
+        printf( "policy      scans  scans/h  max/h  alive  charge uAh   uAh/h  max uAh/h  window max  "
+                "starts/fix/deny throttled level\n" );
+
+        sim_replay( &sim_traces[i], &policy, &result );
+        sim_print( "scheduler", &result );
+        if( sim_check( &policy, &result ) == false )
+        {
+            nb_failed++;
+        }
+
+        sim_replay( &sim_traces[i], &fixed, &result );
+        sim_print( "fixed 60 s", &result );
+    }
+
+    return ( nb_failed == 0 ) ? 0 : 1;
+}
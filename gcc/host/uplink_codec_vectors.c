@@ -0,0 +1,149 @@
+/*
+ * Golden vectors of the uplink codec (uplink_codec.c) on the host: the cycles of uplink_codec_vectors.h are encoded
+ * in order as build_and_stream_payload does, and the cycles the server receives are compared byte for byte with the
+ * records of uplink_codec_vectors.txt. gcc/payload_decoder.py --expect checks the decodes of the same records.
+ *
+ * Usage: uplink_codec_vectors [--print] [records file]
+ *        --print writes the records of the current encoder, to review and commit with a new codec version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "uplink_codec_vectors.h"
+
+#define NB_VECTOR_CYCLES ( sizeof( vector_cycles ) / sizeof( vector_cycles[0] ) )
+#define VECTOR_MAX_LEN ( UPLINK_CODEC_HEADER_LEN + UPLINK_CODEC_WIFI_MAX_LEN + UPLINK_CODEC_SENSORS_MAX_LEN )
+#define VECTOR_MAX_LINE ( ( 2 * VECTOR_MAX_LEN ) + 64 )
+
+static wifi_scan_all_result_t vector_results;
+
+static uint16_t vector_encode( const vector_cycle_t* cycle, uint8_t* buffer )
+{
+    uint16_t len = 0;
+
+    len += uplink_codec_begin_cycle( buffer );
+    if( cycle->nb_aps > 0 )
+    {
+        memset( &vector_results, 0, sizeof( vector_results ) );
+        vector_results.nbr_results = cycle->nb_aps;
+        for( uint8_t i = 0; i < cycle->nb_aps; i++ )
+        {
+            memcpy( vector_results.results[i].mac_address, cycle->aps[i].mac_address,
+                    LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH );
+            vector_results.results[i].rssi = cycle->aps[i].rssi;
+        }
+        len += uplink_codec_encode_wifi( &vector_results, buffer + len );
+    }
+    len += uplink_codec_encode_sensors( &cycle->sensors, buffer + len );
+
+    if( cycle->fate == VECTOR_REFUSED )
+    {
+        uplink_codec_force_key( );
+    }
+    return len;
+}
+
+/*
+ * Reads the next record of the file, the empty lines and the comments starting with # are skipped
+ */
+static int vector_read_record( FILE* file, uint8_t* record )
+{
+    char line[VECTOR_MAX_LINE];
+
+    while( fgets( line, sizeof( line ), file ) != NULL )
+    {
+        int len = 0;
+
+        if( ( line[0] == '#' ) || ( line[0] == '\n' ) || ( line[0] == '\r' ) )
+        {
+            continue;
+        }
+        while( ( len < VECTOR_MAX_LEN ) && ( sscanf( &line[2 * len], "%2hhx", &record[len] ) == 1 ) )
+        {
+            len++;
+        }
+        return len;
+    }
+    return -1;
+}
+
+static void vector_print( const uint8_t* buffer, uint16_t len )
+{
+    for( uint16_t i = 0; i < len; i++ )
+    {
+        printf( "%02x", buffer[i] );
+    }
+    printf( "\n" );
+}
+
+int main( int argc, char* argv[] )
+{
+    const char* path      = "uplink_codec_vectors.txt";
+    bool        print     = false;
+    uint8_t     nb_failed = 0;
+    uint8_t     nb_sent   = 0;
+    FILE*       file      = NULL;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        if( strcmp( argv[i], "--print" ) == 0 )
+        {
+            print = true;
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+    if( ( print == false ) && ( ( file = fopen( path, "r" ) ) == NULL ) )
+    {
+        printf( "FAIL: can not open %s\n", path );
+        return 1;
+    }
+
+    for( uint8_t i = 0; i < NB_VECTOR_CYCLES; i++ )
+    {
+        const vector_cycle_t* cycle = &vector_cycles[i];
+        uint8_t               encoded[VECTOR_MAX_LEN];
+        uint8_t               expected[VECTOR_MAX_LEN];
+        uint16_t              len = vector_encode( cycle, encoded );
+        int                   expected_len;
+
+        if( cycle->fate != VECTOR_SENT )
+        {
+            continue;
+        }
+        nb_sent++;
+        if( print == true )
+        {
+            vector_print( encoded, len );
+            continue;
+        }
+
+        expected_len = vector_read_record( file, expected );
+        if( ( expected_len != len ) || ( memcmp( encoded, expected, len ) != 0 ) )
+        {
+            printf( "FAIL: cycle %u, %s\n  encoded  ", i, cycle->name );
+            vector_print( encoded, len );
+            printf( "  expected " );
+            vector_print( expected, ( expected_len > 0 ) ? expected_len : 0 );
+            nb_failed++;
+        }
+    }
+
+    if( print == true )
+    {
+        return 0;
+    }
+    if( vector_read_record( file, vector_results.raw_buffer ) >= 0 )
+    {
+        printf( "FAIL: more records in %s than cycles received\n", path );
+        nb_failed++;
+    }
+    fclose( file );
+
+    printf( "%u / %u records as expected, %u cycles encoded\n", nb_sent - nb_failed, nb_sent,
+            ( unsigned ) NB_VECTOR_CYCLES );
+    return ( nb_failed == 0 ) ? 0 : 1;
+}
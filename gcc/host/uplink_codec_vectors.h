@@ -0,0 +1,145 @@
+/*
+ * Input cycles of the golden vectors of the uplink codec (uplink_codec.c), encoded in order by uplink_codec_vectors.c.
+ * The golden records are in uplink_codec_vectors.txt, one line per cycle the server receives, and their expected
+ * decodes by gcc/payload_decoder.py in uplink_codec_vectors_decoded.txt.
+ *
+ * The cycles go through a key cycle, dictionary hits and misses, deltas on each length, a cycle lost over the air and
+ * the gap seen by the decoder, a record refused by the stream and the forced key cycle, the periodic key cycle, a full
+ * dictionary and the replacement of its least recently used entries.
+ */
+#ifndef __UPLINK_CODEC_VECTORS_H__
+#define __UPLINK_CODEC_VECTORS_H__
+
+#include "uplink_codec.h"
+
+/*!
+ * \brief What the stream does with an encoded cycle
+ */
+typedef enum vector_fate_e
+{
+    VECTOR_SENT,     // Received by the server, in uplink_codec_vectors.txt
+    VECTOR_LOST,     // Sent but lost over the air, the decoder sees a sequence gap
+    VECTOR_REFUSED,  // Refused by the stream, the firmware calls uplink_codec_force_key
+} vector_fate_t;
+
+typedef struct vector_ap_s
+{
+    uint8_t mac_address[LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH];
+    int8_t  rssi;
+} vector_ap_t;
+
+typedef struct vector_cycle_s
+{
+    const char*            name;
+    vector_fate_t          fate;
+    uint8_t                nb_aps;  // No TAG_WIFI_SCAN_DICT when 0, like build_and_stream_payload
+    vector_ap_t            aps[WIFI_MAX_RESULT_TOTAL];
+    uplink_codec_sensors_t sensors;  // move history, acc x, y, z in mg, temperature, charge, voltage
+} vector_cycle_t;
+
+#define VECTOR_AP_A { 0x00, 0x11, 0x22, 0x33, 0x44, 0x50 }
+#define VECTOR_AP_B { 0x00, 0x11, 0x22, 0x33, 0x55, 0x10 }
+#define VECTOR_AP_C { 0x02, 0xAA, 0xBB, 0xCC, 0xDD, 0x01 }
+#define VECTOR_AP_D { 0x00, 0x11, 0x22, 0x33, 0x66, 0x20 }
+#define VECTOR_AP_FLEET( i ) { 0x00, 0x16, 0x3E, 0x00, 0x00, i }
+
+/*!
+ * \brief Parked between two key cycles: no Wi-Fi scan and the sensor values of the forced key cycle, every delta is 0
+ */
+#define VECTOR_PARKED { "parked", VECTOR_SENT, 0, { { { 0 }, 0 } }, { 0x00, 0, 0, 1008, 25, 80500, 3280 } }
+
+static const vector_cycle_t vector_cycles[] = {
+    {
+        // First cycle, key: every MAC in full, absolute sensor values, acc rounded to 1, -2 and 63 steps of 16 mg
+        "first, key",
+        VECTOR_SENT,
+        3,
+        { { VECTOR_AP_A, -60 }, { VECTOR_AP_B, -72 }, { VECTOR_AP_C, -81 } },
+        { 0x01, 16, -32, 1000, 23, 12345, 3300 },
+    },
+    {
+        // A and B from the dictionary, D in full, 4-bit deltas and an unchanged temperature and voltage
+        "dictionary hits, small deltas",
+        VECTOR_SENT,
+        3,
+        { { VECTOR_AP_A, -61 }, { VECTOR_AP_B, -70 }, { VECTOR_AP_D, -90 } },
+        { 0x03, 24, -40, 1003, 23, 12351, 3300 },
+    },
+    {
+        // No scan, 32-bit charge delta and 16-bit negative voltage delta, the decoder never gets it
+        "lost over the air",
+        VECTOR_LOST,
+        0,
+        { { { 0 }, 0 } },
+        { 0x07, 24, -40, 1003, 24, 80000, 3290 },
+    },
+    {
+        // The decoder sees the sequence gap and skips the compressed TLVs
+        "after the gap",
+        VECTOR_SENT,
+        1,
+        { { VECTOR_AP_C, -79 } },
+        { 0x0F, 0, 0, 1008, 24, 80100, 3290 },
+    },
+    {
+        "refused by the stream",
+        VECTOR_REFUSED,
+        1,
+        { { VECTOR_AP_A, -58 } },
+        { 0x1F, 0, 0, 1008, 25, 80300, 3285 },
+    },
+    {
+        // Forced key cycle, the dictionary is reset so A goes in full again
+        "forced key",
+        VECTOR_SENT,
+        1,
+        { { VECTOR_AP_A, -58 } },
+        { 0x00, 0, 0, 1008, 25, 80500, 3280 },
+    },
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    VECTOR_PARKED,
+    {
+        // UPLINK_CODEC_KEY_PERIOD cycles after the forced key: periodic key cycle which fills the dictionary
+        "periodic key, full dictionary",
+        VECTOR_SENT,
+        32,
+        {
+            { VECTOR_AP_FLEET( 0x00 ), -40 }, { VECTOR_AP_FLEET( 0x01 ), -41 }, { VECTOR_AP_FLEET( 0x02 ), -42 },
+            { VECTOR_AP_FLEET( 0x03 ), -43 }, { VECTOR_AP_FLEET( 0x04 ), -44 }, { VECTOR_AP_FLEET( 0x05 ), -45 },
+            { VECTOR_AP_FLEET( 0x06 ), -46 }, { VECTOR_AP_FLEET( 0x07 ), -47 }, { VECTOR_AP_FLEET( 0x08 ), -48 },
+            { VECTOR_AP_FLEET( 0x09 ), -49 }, { VECTOR_AP_FLEET( 0x0A ), -50 }, { VECTOR_AP_FLEET( 0x0B ), -51 },
+            { VECTOR_AP_FLEET( 0x0C ), -52 }, { VECTOR_AP_FLEET( 0x0D ), -53 }, { VECTOR_AP_FLEET( 0x0E ), -54 },
+            { VECTOR_AP_FLEET( 0x0F ), -55 }, { VECTOR_AP_FLEET( 0x10 ), -56 }, { VECTOR_AP_FLEET( 0x11 ), -57 },
+            { VECTOR_AP_FLEET( 0x12 ), -58 }, { VECTOR_AP_FLEET( 0x13 ), -59 }, { VECTOR_AP_FLEET( 0x14 ), -60 },
+            { VECTOR_AP_FLEET( 0x15 ), -61 }, { VECTOR_AP_FLEET( 0x16 ), -62 }, { VECTOR_AP_FLEET( 0x17 ), -63 },
+            { VECTOR_AP_FLEET( 0x18 ), -64 }, { VECTOR_AP_FLEET( 0x19 ), -65 }, { VECTOR_AP_FLEET( 0x1A ), -66 },
+            { VECTOR_AP_FLEET( 0x1B ), -67 }, { VECTOR_AP_FLEET( 0x1C ), -68 }, { VECTOR_AP_FLEET( 0x1D ), -69 },
+            { VECTOR_AP_FLEET( 0x1E ), -70 }, { VECTOR_AP_FLEET( 0x1F ), -71 },
+        },
+        { 0x01, -8, 0, 1008, 26, 81000, 3275 },
+    },
+    {
+        // The new MAC takes the least recently used entry 0, the MAC it held goes in full in entry 1, 5 is a hit
+        "least recently used entries replaced",
+        VECTOR_SENT,
+        3,
+        { { { 0x00, 0x16, 0x3E, 0x00, 0x01, 0x00 }, -75 }, { VECTOR_AP_FLEET( 0x00 ), -40 },
+          { VECTOR_AP_FLEET( 0x05 ), -45 } },
+        { 0x03, -8, 0, 1008, 26, 81020, 3275 },
+    },
+};
+
+#endif  // __UPLINK_CODEC_VECTORS_H__
@@ -0,0 +1,339 @@
+/*
+ * Tests of the uplink queue (uplink_queue.c) on the host: superseded position reports, deadline expiry, overflow
+ * eviction and the drop callback, the streaming order, and the key cycle of the uplink codec (uplink_codec.c) forced
+ * by a dropped record.
+ *
+ * The last test streams the cycles of a tracker in poor coverage through the queue, one record per cycle, with the
+ * rules of main_tracker.c: a record started while the queue is not empty is a key cycle, and on_uplink_queue_drop
+ * forces a key cycle. Every record handed to the stream must decode alone or follow the previous one. The same
+ * stream without the first rule is reported for comparison.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main_tracker.h"
+#include "uplink_codec.h"
+#include "uplink_queue.h"
+
+#define TEST_CHECK( condition )                                                 \
+    do                                                                          \
+    {                                                                           \
+        if( !( condition ) )                                                    \
+        {                                                                       \
+            printf( "FAIL: %s:%d: %s\n", __func__, __LINE__, #condition );     \
+            test_nb_failed++;                                                   \
+        }                                                                       \
+    } while( 0 )
+
+#define TEST_NOW 100000
+#define TEST_STREAM_CYCLES 2000
+#define TEST_CYCLE_S 60
+
+static uint16_t test_nb_failed = 0;
+static uint8_t  test_dropped[UPLINK_QUEUE_NB_RECORDS * 2];
+static uint8_t  test_nb_dropped;
+
+/*
+ * Drop callback of the unit tests, the records are one byte long and hold their id
+ */
+static void test_on_drop( const uint8_t* record, const uint8_t len )
+{
+    if( ( len == 1 ) && ( test_nb_dropped < sizeof( test_dropped ) ) )
+    {
+        test_dropped[test_nb_dropped] = record[0];
+    }
+    test_nb_dropped++;
+}
+
+/*
+ * Drop callback of the stream test, as on_uplink_queue_drop of main_tracker.c
+ */
+static void test_on_stream_drop( const uint8_t* record, const uint8_t len ) { uplink_codec_force_key( ); }
+
+static void test_init( void )
+{
+    uplink_queue_init( test_on_drop );
+    test_nb_dropped = 0;
+}
+
+static bool test_push( uint8_t id, uplink_queue_priority_t priority, bool supersedable, uint32_t deadline )
+{
+    return uplink_queue_push( &id, 1, priority, supersedable, deadline, TEST_NOW );
+}
+
+static uint8_t test_pop( uint32_t now )
+{
+    const uplink_queue_record_t* record = uplink_queue_peek( now );
+    uint8_t                      id;
+
+    if( record == NULL )
+    {
+        return 0;
+    }
+    id = record->record[0];
+    uplink_queue_pop( );
+    return id;
+}
+
+static void test_supersede( void )
+{
+    uplink_queue_stats_t stats;
+
+    test_init( );
+    TEST_CHECK( test_push( 1, UPLINK_QUEUE_PRIORITY_NORMAL, true, TEST_NOW + 900 ) == true );
+    TEST_CHECK( test_push( 2, UPLINK_QUEUE_PRIORITY_NORMAL, false, TEST_NOW + 900 ) == true );  // Keep alive
+    TEST_CHECK( test_push( 3, UPLINK_QUEUE_PRIORITY_HIGH, true, TEST_NOW + 3600 ) == true );
+
+    /* Replaces 1 only: 2 is not supersedable, 3 has another priority */
+    TEST_CHECK( test_push( 4, UPLINK_QUEUE_PRIORITY_NORMAL, true, TEST_NOW + 900 ) == true );
+    TEST_CHECK( test_nb_dropped == 1 );
+    TEST_CHECK( test_dropped[0] == 1 );
+    TEST_CHECK( uplink_queue_get_nb_records( ) == 3 );
+
+    /* A record which is not supersedable replaces none */
+    TEST_CHECK( test_push( 5, UPLINK_QUEUE_PRIORITY_NORMAL, false, TEST_NOW + 900 ) == true );
+    TEST_CHECK( test_nb_dropped == 1 );
+
+    uplink_queue_get_stats( &stats );
+    TEST_CHECK( stats.nb_pushed == 5 );
+    TEST_CHECK( stats.nb_superseded == 1 );
+    TEST_CHECK( stats.nb_queued == 4 );
+    TEST_CHECK( stats.max_queued == 4 );
+
+    TEST_CHECK( test_pop( TEST_NOW ) == 3 );
+    TEST_CHECK( test_pop( TEST_NOW ) == 2 );
+    TEST_CHECK( test_pop( TEST_NOW ) == 4 );
+    TEST_CHECK( test_pop( TEST_NOW ) == 5 );
+    TEST_CHECK( test_pop( TEST_NOW ) == 0 );
+}
+
+static void test_expiry( void )
+{
+    uplink_queue_stats_t stats;
+
+    test_init( );
+    TEST_CHECK( test_push( 1, UPLINK_QUEUE_PRIORITY_NORMAL, false, TEST_NOW + 900 ) == true );
+    TEST_CHECK( test_push( 2, UPLINK_QUEUE_PRIORITY_HIGH, false, TEST_NOW + 3600 ) == true );
+
+    /* Still streamed at its deadline, dropped after */
+    TEST_CHECK( uplink_queue_peek( TEST_NOW + 900 ) != NULL );
+    TEST_CHECK( uplink_queue_get_nb_records( ) == 2 );
+    TEST_CHECK( test_nb_dropped == 0 );
+    TEST_CHECK( uplink_queue_peek( TEST_NOW + 901 )->record[0] == 2 );
+    TEST_CHECK( test_nb_dropped == 1 );
+    TEST_CHECK( test_dropped[0] == 1 );
+
+    /* A push drops the expired records first */
+    TEST_CHECK( uplink_queue_push( ( const uint8_t* ) "\x03", 1, UPLINK_QUEUE_PRIORITY_NORMAL, false, TEST_NOW + 5000,
+                                   TEST_NOW + 3601 ) == true );
+    TEST_CHECK( test_nb_dropped == 2 );
+    TEST_CHECK( test_dropped[1] == 2 );
+    TEST_CHECK( uplink_queue_get_nb_records( ) == 1 );
+
+    uplink_queue_get_stats( &stats );
+    TEST_CHECK( stats.nb_expired == 2 );
+    TEST_CHECK( stats.nb_sent == 0 );
+}
+
+static void test_overflow( void )
+{
+    uplink_queue_stats_t stats;
+
+    test_init( );
+    TEST_CHECK( test_push( 1, UPLINK_QUEUE_PRIORITY_NORMAL, false, TEST_NOW + 900 ) == true );
+    TEST_CHECK( test_push( 2, UPLINK_QUEUE_PRIORITY_LOW, false, TEST_NOW + 900 ) == true );
+    TEST_CHECK( test_push( 3, UPLINK_QUEUE_PRIORITY_NORMAL, false, TEST_NOW + 900 ) == true );
+    TEST_CHECK( test_push( 4, UPLINK_QUEUE_PRIORITY_LOW, false, TEST_NOW + 900 ) == true );
+
+    /* The lowest priority, oldest first, goes */
+    TEST_CHECK( test_push( 5, UPLINK_QUEUE_PRIORITY_NORMAL, false, TEST_NOW + 900 ) == true );
+    TEST_CHECK( ( test_nb_dropped == 1 ) && ( test_dropped[0] == 2 ) );
+    TEST_CHECK( test_push( 6, UPLINK_QUEUE_PRIORITY_LOW, false, TEST_NOW + 900 ) == true );
+    TEST_CHECK( ( test_nb_dropped == 2 ) && ( test_dropped[1] == 4 ) );
+    TEST_CHECK( test_push( 7, UPLINK_QUEUE_PRIORITY_HIGH, false, TEST_NOW + 3600 ) == true );
+    TEST_CHECK( ( test_nb_dropped == 3 ) && ( test_dropped[2] == 6 ) );
+    TEST_CHECK( test_push( 8, UPLINK_QUEUE_PRIORITY_HIGH, false, TEST_NOW + 3600 ) == true );
+    TEST_CHECK( ( test_nb_dropped == 4 ) && ( test_dropped[3] == 1 ) );
+
+    /* The pushed record goes itself when every queued one has a higher priority */
+    TEST_CHECK( test_push( 9, UPLINK_QUEUE_PRIORITY_LOW, false, TEST_NOW + 900 ) == false );
+    TEST_CHECK( ( test_nb_dropped == 5 ) && ( test_dropped[4] == 9 ) );
+    TEST_CHECK( uplink_queue_get_nb_records( ) == UPLINK_QUEUE_NB_RECORDS );
+
+    uplink_queue_get_stats( &stats );
+    TEST_CHECK( stats.nb_overflow == 5 );
+    TEST_CHECK( stats.nb_queued == UPLINK_QUEUE_NB_RECORDS );
+
+    TEST_CHECK( test_pop( TEST_NOW ) == 7 );
+    TEST_CHECK( test_pop( TEST_NOW ) == 8 );
+    TEST_CHECK( test_pop( TEST_NOW ) == 3 );
+    TEST_CHECK( test_pop( TEST_NOW ) == 5 );
+
+    /* A record of invalid length is refused without being counted */
+    TEST_CHECK( uplink_queue_push( ( const uint8_t* ) "", 0, UPLINK_QUEUE_PRIORITY_HIGH, false, TEST_NOW, TEST_NOW ) ==
+                false );
+    uplink_queue_get_stats( &stats );
+    TEST_CHECK( stats.nb_pushed == 9 );
+    TEST_CHECK( stats.nb_sent == 4 );
+}
+
+static void test_order( void )
+{
+    test_init( );
+    TEST_CHECK( test_push( 1, UPLINK_QUEUE_PRIORITY_NORMAL, false, TEST_NOW + 900 ) == true );
+    TEST_CHECK( test_push( 2, UPLINK_QUEUE_PRIORITY_NORMAL, false, TEST_NOW + 600 ) == true );
+    TEST_CHECK( test_push( 3, UPLINK_QUEUE_PRIORITY_NORMAL, false, TEST_NOW + 600 ) == true );
+    TEST_CHECK( test_push( 4, UPLINK_QUEUE_PRIORITY_HIGH, false, TEST_NOW + 3600 ) == true );
+
+    /* Highest priority, then earliest deadline, then oldest */
+    TEST_CHECK( test_pop( TEST_NOW ) == 4 );
+    TEST_CHECK( test_pop( TEST_NOW ) == 2 );
+    TEST_CHECK( test_pop( TEST_NOW ) == 3 );
+    TEST_CHECK( test_pop( TEST_NOW ) == 1 );
+
+    /* A push between peek and pop cancels the pop, the record peeked may no longer be the next one */
+    TEST_CHECK( test_push( 5, UPLINK_QUEUE_PRIORITY_NORMAL, false, TEST_NOW + 900 ) == true );
+    TEST_CHECK( uplink_queue_peek( TEST_NOW )->record[0] == 5 );
+    TEST_CHECK( test_push( 6, UPLINK_QUEUE_PRIORITY_HIGH, false, TEST_NOW + 3600 ) == true );
+    uplink_queue_pop( );
+    TEST_CHECK( uplink_queue_get_nb_records( ) == 2 );
+    TEST_CHECK( test_pop( TEST_NOW ) == 6 );
+}
+
+/*
+ * Encodes a cycle in a record: codec header and sensors, the charge changes on every cycle
+ */
+static uint8_t test_encode_cycle( uint32_t cycle, uint8_t* record )
+{
+    uplink_codec_sensors_t sensors = { 0x01, 0, 0, 1000, 25, 1000 + cycle, 3300 };
+    uint8_t                len;
+
+    len = uplink_codec_begin_cycle( record );
+    len += uplink_codec_encode_sensors( &sensors, record + len );
+    return len;
+}
+
+static void test_forced_key( void )
+{
+    uint8_t record[UPLINK_CODEC_HEADER_LEN + UPLINK_CODEC_SENSORS_MAX_LEN];
+
+    uplink_queue_init( test_on_stream_drop );
+
+    /* The cycle after a dropped record is a key one, the next ones are not */
+    test_encode_cycle( 0, record );
+    test_encode_cycle( 1, record );
+    TEST_CHECK( ( record[2] & UPLINK_CODEC_FLAG_KEY ) == 0 );
+    TEST_CHECK( uplink_queue_push( record, 1, UPLINK_QUEUE_PRIORITY_NORMAL, true, TEST_NOW + 900, TEST_NOW ) == true );
+    TEST_CHECK( uplink_queue_push( record, 1, UPLINK_QUEUE_PRIORITY_NORMAL, true, TEST_NOW + 900, TEST_NOW ) == true );
+    test_encode_cycle( 2, record );
+    TEST_CHECK( record[0] == TAG_CODEC );
+    TEST_CHECK( ( record[2] & UPLINK_CODEC_FLAG_KEY ) != 0 );
+    test_encode_cycle( 3, record );
+    TEST_CHECK( ( record[2] & UPLINK_CODEC_FLAG_KEY ) == 0 );
+
+    /* Same on expiry */
+    uplink_queue_peek( TEST_NOW + 901 );
+    test_encode_cycle( 4, record );
+    TEST_CHECK( ( record[2] & UPLINK_CODEC_FLAG_KEY ) != 0 );
+}
+
+/*
+ * Streams cycles through the queue in poor coverage, returns the number of records handed to the stream which can
+ * not be decoded: neither a key cycle nor the cycle after the previous record streamed
+ */
+static uint32_t test_stream( bool key_on_queued, uint32_t* nb_streamed, uint32_t* nb_key )
+{
+    uint32_t now            = TEST_NOW;
+    uint32_t nb_undecodable = 0;
+    uint32_t seed           = 1;
+    bool     synced         = false;
+    uint8_t  last_seq       = 0;
+
+    uplink_queue_init( test_on_stream_drop );
+    uplink_codec_force_key( );  // First cycle after a reset
+    *nb_streamed = 0;
+    *nb_key      = 0;
+
+    for( uint32_t cycle = 0; cycle < TEST_STREAM_CYCLES; cycle++ )
+    {
+        uint8_t                      record[UPLINK_CODEC_HEADER_LEN + UPLINK_CODEC_SENSORS_MAX_LEN];
+        uint8_t                      len;
+        const uplink_queue_record_t* next;
+        bool                         critical = ( cycle % 7 ) == 0;
+
+        /* A record which may wait in the queue, or be streamed before the queued ones, is decoded alone */
+        if( ( key_on_queued == true ) && ( uplink_queue_get_nb_records( ) > 0 ) )
+        {
+            uplink_codec_force_key( );
+        }
+        len = test_encode_cycle( cycle, record );
+        uplink_queue_push( record, len,
+                           ( critical == true ) ? UPLINK_QUEUE_PRIORITY_HIGH : UPLINK_QUEUE_PRIORITY_NORMAL,
+                           critical == false,
+                           now + ( ( critical == true ) ? UPLINK_QUEUE_EVENT_LIFETIME_S
+                                                        : UPLINK_QUEUE_POSITION_LIFETIME_S ),
+                           now );
+
+        /* The stream takes a record on one cycle in four, the decoder follows the sequence */
+        seed = ( seed * 1103515245 ) + 12345;
+        if( ( ( seed >> 16 ) % 4 ) == 0 )
+        {
+            next = uplink_queue_peek( now );
+            if( next != NULL )
+            {
+                bool key = ( next->record[2] & UPLINK_CODEC_FLAG_KEY ) != 0;
+
+                if( ( key == false ) && ( ( synced == false ) || ( next->record[3] != ( uint8_t )( last_seq + 1 ) ) ) )
+                {
+                    nb_undecodable++;
+                    synced = false;
+                }
+                else
+                {
+                    synced = true;
+                }
+                last_seq = next->record[3];
+                *nb_key += ( key == true ) ? 1 : 0;
+                ( *nb_streamed )++;
+                uplink_queue_pop( );
+            }
+        }
+        now += TEST_CYCLE_S;
+    }
+    return nb_undecodable;
+}
+
+static void test_stream_decodes( void )
+{
+    uint32_t             nb_streamed;
+    uint32_t             nb_key;
+    uint32_t             nb_undecodable;
+    uplink_queue_stats_t stats;
+
+    nb_undecodable = test_stream( true, &nb_streamed, &nb_key );
+    uplink_queue_get_stats( &stats );
+    printf( "stream: %u cycles, %u streamed, %u key, %u superseded, %u expired, %u overflow, %u undecodable\n",
+            TEST_STREAM_CYCLES, nb_streamed, nb_key, stats.nb_superseded, stats.nb_expired, stats.nb_overflow,
+            nb_undecodable );
+    TEST_CHECK( nb_undecodable == 0 );
+    TEST_CHECK( stats.nb_superseded > 0 );
+    TEST_CHECK( stats.nb_overflow > 0 );
+
+    nb_undecodable = test_stream( false, &nb_streamed, &nb_key );
+    printf( "without a key cycle on a queued record: %u streamed, %u key, %u undecodable\n", nb_streamed, nb_key,
+            nb_undecodable );
+}
+
+int main( void )
+{
+    test_supersede( );
+    test_expiry( );
+    test_overflow( );
+    test_order( );
+    test_forced_key( );
+    test_stream_decodes( );
+
+    printf( "%u failed checks\n", test_nb_failed );
+    return ( test_nb_failed == 0 ) ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+/*
+ * Wi-Fi scan fixtures of wifi_filter_apply (wifi_filter.c) and the expected filtered and ranked outputs, replayed in
+ * order by wifi_filter_replay.c as the ranking depends on the previous scans.
+ *
+ * The scans follow the shapes met in the field: multi-SSID radios whose BSSIDs only differ by the low nibble, a phone
+ * hotspot with a locally administered address, an AP flagged as mobile by the LR1110 and APs under the RSSI floor.
+ * The expected outputs are worked out by hand from the ranking rules, the score being the RSSI, plus 4 dB per
+ * consecutive previous scan the AP was heard in (3 at most), minus half of its RSSI variation (20 dB at most).
+ */
+#ifndef __WIFI_FILTER_FIXTURES_H__
+#define __WIFI_FILTER_FIXTURES_H__
+
+#include "wifi_filter.h"
+
+#define FIXTURE_MAX_APS 10
+
+typedef struct fixture_ap_s
+{
+    uint8_t mac_address[LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH];
+    int8_t  rssi;
+    uint8_t mac_origin;
+} fixture_ap_t;
+
+typedef struct fixture_scan_s
+{
+    const char*            name;
+    wifi_filter_settings_t settings;
+    uint8_t                budget_aps;
+    uint8_t                nb_aps;
+    fixture_ap_t           aps[FIXTURE_MAX_APS];
+    wifi_filter_stats_t    stats;                  // Expected statistics
+    uint8_t                kept[FIXTURE_MAX_APS];  // Expected output, indexes in aps, the first ranked first
+} fixture_scan_t;
+
+#define FIXTURE_FIXED 0x01
+#define FIXTURE_MOBILE WIFI_MAC_ORIGIN_MOBILE_AP
+
+#define FIXTURE_SETTINGS_DEFAULT \
+    { WIFI_FILTER_FLAGS_DEFAULT, WIFI_FILTER_MAX_APS_DEFAULT, WIFI_FILTER_RSSI_FLOOR_DEFAULT }
+
+static const fixture_scan_t fixture_scans[] = {
+    {
+        // Every stage drops one result, the weakest candidate is over the budget of 4
+        "home, all stages",
+        FIXTURE_SETTINGS_DEFAULT,
+        4,
+        9,
+        {
+            { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x50 }, -60, FIXTURE_FIXED },   // 0 radio A, SSID 1
+            { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x51 }, -58, FIXTURE_FIXED },   // 1 radio A, SSID 2, stands for A
+            { { 0x00, 0x11, 0x22, 0x33, 0x55, 0x10 }, -70, FIXTURE_FIXED },   // 2 B
+            { { 0x02, 0xAA, 0xBB, 0xCC, 0xDD, 0x01 }, -50, FIXTURE_FIXED },   // 3 hotspot, locally administered
+            { { 0x00, 0x11, 0x22, 0x33, 0x66, 0x20 }, -65, FIXTURE_MOBILE },  // 4 mobile AP
+            { { 0x00, 0x11, 0x22, 0x33, 0x77, 0x30 }, -92, FIXTURE_FIXED },   // 5 under the floor
+            { { 0x00, 0x11, 0x22, 0x33, 0x88, 0x40 }, -75, FIXTURE_FIXED },   // 6 F
+            { { 0x00, 0x11, 0x22, 0x33, 0x99, 0x50 }, -80, FIXTURE_FIXED },   // 7 G
+            { { 0x00, 0x11, 0x22, 0x33, 0xAA, 0x60 }, -85, FIXTURE_FIXED },   // 8 H, over the budget
+        },
+        { 9, 1, 1, 1, 1, 1, 4 },
+        { 1, 2, 6, 7 },
+    },
+    {
+        // A new AP (-66) outranks B (-72 + 4 - 1) and H (-70 + 4 - 7), F stays at the floor
+        "home, second scan",
+        FIXTURE_SETTINGS_DEFAULT,
+        3,
+        5,
+        {
+            { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x51 }, -60, FIXTURE_FIXED },  // 0 radio A, -60 + 4 - 1
+            { { 0x00, 0x11, 0x22, 0x33, 0x55, 0x10 }, -72, FIXTURE_FIXED },  // 1 B
+            { { 0x00, 0x11, 0x22, 0x33, 0xAA, 0x60 }, -70, FIXTURE_FIXED },  // 2 H
+            { { 0x00, 0x11, 0x22, 0x33, 0xBB, 0x70 }, -66, FIXTURE_FIXED },  // 3 N, new
+            { { 0x00, 0x11, 0x22, 0x33, 0x88, 0x40 }, -90, FIXTURE_FIXED },  // 4 F, -90 + 4 - 7
+        },
+        { 5, 0, 0, 0, 0, 2, 3 },
+        { 0, 3, 1 },
+    },
+    {
+        // Heard twice, B and H (-71 + 8) tie with the new BSSID of radio N (-63) and keep the arrival order
+        "street, ties",
+        FIXTURE_SETTINGS_DEFAULT,
+        20,
+        7,
+        {
+            { { 0x00, 0x11, 0x22, 0x33, 0xBB, 0x70 }, -64, FIXTURE_FIXED },  // 0 N, replaced by its stronger sibling
+            { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x51 }, -61, FIXTURE_FIXED },  // 1 radio A, -61 + 8
+            { { 0x00, 0x11, 0x22, 0x33, 0xBB, 0x7F }, -63, FIXTURE_FIXED },  // 2 N, other SSID, no history
+            { { 0x00, 0x11, 0x22, 0x33, 0x55, 0x10 }, -71, FIXTURE_FIXED },  // 3 B
+            { { 0x00, 0x11, 0x22, 0x33, 0xAA, 0x60 }, -71, FIXTURE_FIXED },  // 4 H
+            { { 0x00, 0x11, 0x22, 0x33, 0x99, 0x50 }, -79, FIXTURE_FIXED },  // 5 G, missed by the previous scan
+            { { 0x02, 0xAA, 0xBB, 0xCC, 0xDD, 0x01 }, -50, FIXTURE_FIXED },  // 6 hotspot
+        },
+        { 7, 1, 0, 0, 1, 0, 5 },
+        { 1, 2, 3, 4, 5 },
+    },
+    {
+        // Only the mobile AP stage and a -80 floor, the budget of 1 is raised to WIFI_FILTER_MIN_APS
+        "custom settings, minimum APs",
+        { WIFI_FILTER_DROP_MOBILE_AP, 0, -80 },
+        1,
+        5,
+        {
+            { { 0x02, 0xAA, 0xBB, 0xCC, 0xDD, 0x01 }, -50, FIXTURE_FIXED },   // 0 hotspot, kept
+            { { 0x00, 0x11, 0x22, 0x33, 0x66, 0x20 }, -65, FIXTURE_MOBILE },  // 1 mobile AP
+            { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x50 }, -62, FIXTURE_FIXED },   // 2 radio A, SSID 1, no history
+            { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x51 }, -60, FIXTURE_FIXED },   // 3 radio A, SSID 2, -60 + 12
+            { { 0x00, 0x11, 0x22, 0x33, 0x77, 0x30 }, -85, FIXTURE_FIXED },   // 4 under the floor
+        },
+        { 5, 0, 1, 1, 0, 0, 3 },
+        { 3, 0, 2 },
+    },
+};
+
+#endif  // __WIFI_FILTER_FIXTURES_H__
@@ -0,0 +1,83 @@
+/*
+ * Replays the Wi-Fi scan fixtures of wifi_filter_fixtures.h through wifi_filter_apply (wifi_filter.c) on the host, in
+ * order, and checks the statistics and the filtered and ranked outputs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wifi_filter_fixtures.h"
+
+#define NB_FIXTURE_SCANS ( sizeof( fixture_scans ) / sizeof( fixture_scans[0] ) )
+
+static wifi_scan_all_result_t replay_results;
+
+static void replay_print_mac( const uint8_t* mac_address )
+{
+    printf( "%02X:%02X:%02X:%02X:%02X:%02X", mac_address[0], mac_address[1], mac_address[2], mac_address[3],
+            mac_address[4], mac_address[5] );
+}
+
+static bool replay_scan( const fixture_scan_t* scan )
+{
+    wifi_filter_stats_t stats;
+    bool                pass = true;
+
+    memset( &replay_results, 0, sizeof( replay_results ) );
+    replay_results.nbr_results = scan->nb_aps;
+    for( uint8_t i = 0; i < scan->nb_aps; i++ )
+    {
+        memcpy( replay_results.results[i].mac_address, scan->aps[i].mac_address, LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH );
+        replay_results.results[i].rssi       = scan->aps[i].rssi;
+        replay_results.results[i].mac_origin = scan->aps[i].mac_origin;
+    }
+
+    wifi_filter_apply( &scan->settings, scan->budget_aps, &replay_results, &stats );
+
+    printf( "%-30s in %2u | local %u | mobile %u | weak %u | dup %u | over %u | out %2u\n", scan->name, stats.nb_in,
+            stats.nb_locally_administered, stats.nb_mobile, stats.nb_weak, stats.nb_duplicates, stats.nb_over_budget,
+            stats.nb_out );
+    if( memcmp( &stats, &scan->stats, sizeof( stats ) ) != 0 )
+    {
+        printf( "FAIL: statistics differ from the expected ones\n" );
+        pass = false;
+    }
+
+    for( uint8_t i = 0; i < replay_results.nbr_results; i++ )
+    {
+        const fixture_ap_t* expected = &scan->aps[scan->kept[i]];
+
+        printf( "  %2u ", i );
+        replay_print_mac( replay_results.results[i].mac_address );
+        printf( " %4d dBm", replay_results.results[i].rssi );
+        if( ( i >= scan->stats.nb_out ) ||
+            ( memcmp( replay_results.results[i].mac_address, expected->mac_address,
+                      LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH ) != 0 ) ||
+            ( replay_results.results[i].rssi != expected->rssi ) )
+        {
+            printf( "  FAIL: expected " );
+            replay_print_mac( expected->mac_address );
+            pass = false;
+        }
+        printf( "\n" );
+    }
+    return pass;
+}
+
+int main( void )
+{
+    uint8_t nb_failed = 0;
+
+    wifi_filter_reset( );
+    for( uint8_t i = 0; i < NB_FIXTURE_SCANS; i++ )
+    {
+        if( replay_scan( &fixture_scans[i] ) == false )
+        {
+            nb_failed++;
+        }
+    }
+
+    printf( "%u / %u scans as expected\n", ( unsigned ) ( NB_FIXTURE_SCANS - nb_failed ),
+            ( unsigned ) NB_FIXTURE_SCANS );
+    return ( nb_failed == 0 ) ? 0 : 1;
+}
@@ -0,0 +1,337 @@
+#!/usr/bin/env python3
+"""
+Reference decoder of the uplink stream records, see uplink_aggregator.h and uplink_codec.h.
+
+The records are the ones reassembled from the stream on port 199, one record in hexadecimal per line, the lines
+starting with # are comments. The golden vectors of the codec are checked with --expect against the decodes of
+host/uplink_codec_vectors_decoded.txt, the same records are checked against the C encoder by the host build.
+
+The benchmark runs the encoder on records of the firmwares without the codec and reports the compression ratio, the
+encode time on the target is given by the uplink_codec_encode_wifi and uplink_codec_encode_sensors zones of
+GET_APP_PROFILING_CMD.
+
+Usage:
+    python3 payload_decoder.py records.txt
+    python3 payload_decoder.py --expect host/uplink_codec_vectors_decoded.txt host/uplink_codec_vectors.txt
+    python3 payload_decoder.py --benchmark legacy_records.txt
+
+Codec version 1, each cycle starts with a TAG_CODEC header:
+    | version (4 bits) | flags (4 bits) | sequence (1) |
+TAG_WIFI_SCAN_DICT, bit packed, most significant bit first:
+    | nb APs (6 bits) | per AP: -RSSI (7 bits) | 1 + dictionary index (5 bits) or 0 + MAC (48 bits) |
+TAG_SENSORS_PACKED, bit packed:
+    | move history (8 bits) | acc x, y, z in 16 mg steps, temperature, charge, voltage as deltas |
+A delta is zigzag encoded after a 2 bits prefix giving its length: 0, 4, 16 or 32 bits.
+"""
+
+import argparse
+import difflib
+import io
+import sys
+
+TAG_WIFI_SCAN = 8
+TAG_ACCELEROMETER = 9
+TAG_CHARGE = 10
+TAG_VOLTAGE = 11
+TAG_CYCLE = 16
+TAG_CODEC = 17
+TAG_WIFI_SCAN_DICT = 18
+TAG_SENSORS_PACKED = 19
+
+CODEC_VERSION = 1
+FLAG_KEY = 0x01
+KEY_PERIOD = 16
+DICT_INDEX_BITS = 5
+DICT_SIZE = 1 << DICT_INDEX_BITS
+ACC_RESOLUTION_MG = 16
+DELTA_BITS = (0, 4, 16, 32)
+SENSOR_FIELDS = ("acc_x", "acc_y", "acc_z", "temperature", "charge", "voltage")
+SENSOR_WIDTHS = (16, 16, 16, 16, 32, 16)
+RAW_SENSORS_LEN = (2 + 9) + (2 + 4) + (2 + 2)
+RAW_BEACON_LEN = 7
+
+
+def tlvs(record):
+    index = 0
+    while index + 2 <= len(record):
+        tag, length = record[index], record[index + 1]
+        yield tag, record[index + 2:index + 2 + length]
+        index += 2 + length
+
+
+def signed(value, bits):
+    return value - (1 << bits) if value & (1 << (bits - 1)) else value
+
+
+def wrap(value, bits):
+    return signed(value & ((1 << bits) - 1), bits)
+
+
+class BitReader:
+    def __init__(self, data):
+        self.data = data
+        self.index = 0
+
+    def get(self, bits):
+        value = 0
+        for _ in range(bits):
+            byte = self.data[self.index >> 3]
+            value = (value << 1) | ((byte >> (7 - (self.index & 7))) & 1)
+            self.index += 1
+        return value
+
+    def delta(self):
+        zigzag = self.get(DELTA_BITS[self.get(2)])
+        return (zigzag >> 1) ^ -(zigzag & 1)
+
+
+class BitWriter:
+    def __init__(self):
+        self.bits = []
+
+    def put(self, value, bits):
+        self.bits.extend((value >> i) & 1 for i in range(bits - 1, -1, -1))
+
+    def delta(self, delta):
+        zigzag = ((delta << 1) ^ (delta >> 31)) & 0xFFFFFFFF
+        prefix = 0 if zigzag == 0 else 1 if zigzag < (1 << 4) else 2 if zigzag < (1 << 16) else 3
+        self.put(prefix, 2)
+        self.put(zigzag, DELTA_BITS[prefix])
+
+    def tobytes(self):
+        bits = self.bits + [0] * (-len(self.bits) % 8)
+        return bytes(int("".join(map(str, bits[i:i + 8])), 2) for i in range(0, len(bits), 8))
+
+
+class Dictionary:
+    """Rolling MAC dictionary, same replacement as uplink_codec_dict_lookup"""
+
+    def __init__(self):
+        self.macs = [b""] * DICT_SIZE
+        self.last_use = [0] * DICT_SIZE
+        self.tick = 0
+
+    def lookup(self, mac):
+        self.tick += 1
+        for i in range(DICT_SIZE):
+            if self.last_use[i] != 0 and self.macs[i] == mac:
+                self.last_use[i] = self.tick
+                return i, True
+        oldest = self.last_use.index(min(self.last_use))
+        self.macs[oldest] = mac
+        self.last_use[oldest] = self.tick
+        return oldest, False
+
+    def get(self, index):
+        self.tick += 1
+        self.last_use[index] = self.tick
+        return self.macs[index]
+
+
+class Codec:
+    def __init__(self):
+        self.reset()
+        self.seq = None
+        self.synced = False
+        self.since_key = 0
+        self.nb_hits = 0
+
+    def reset(self):
+        self.reference = dict.fromkeys(SENSOR_FIELDS, 0)
+        self.dictionary = Dictionary()
+
+    def decode_header(self, value):
+        version, flags, seq = value[0] >> 4, value[0] & 0x0F, value[1]
+        if version != CODEC_VERSION:
+            self.synced = False
+        elif flags & FLAG_KEY:
+            self.reset()
+            self.synced = True
+        elif self.seq is None or seq != (self.seq + 1) & 0xFF:
+            # A cycle is lost, the state is unknown until the next key cycle
+            self.synced = False
+        self.seq = seq
+        return {"version": version, "key": bool(flags & FLAG_KEY), "seq": seq, "synced": self.synced}
+
+    def decode_wifi(self, value):
+        bits = BitReader(value)
+        aps = []
+        for _ in range(bits.get(6)):
+            rssi = -bits.get(7)
+            if bits.get(1):
+                mac = self.dictionary.get(bits.get(DICT_INDEX_BITS))
+            else:
+                mac = bytes(bits.get(8) for _ in range(6))
+                self.dictionary.lookup(mac)
+            aps.append((mac.hex(":"), rssi))
+        return aps
+
+    def decode_sensors(self, value):
+        bits = BitReader(value)
+        sensors = {"move_history": bits.get(8)}
+        for field, width in zip(SENSOR_FIELDS, SENSOR_WIDTHS):
+            self.reference[field] = wrap(self.reference[field] + bits.delta(), width)
+            sensors[field] = self.reference[field]
+        for field in ("acc_x", "acc_y", "acc_z"):
+            sensors[field] *= ACC_RESOLUTION_MG
+        sensors["charge"] &= 0xFFFFFFFF
+        sensors["voltage"] &= 0xFFFF
+        return sensors
+
+    def encode_cycle(self, aps, sensors):
+        """Mirror of uplink_codec_begin_cycle, uplink_codec_encode_wifi and uplink_codec_encode_sensors"""
+        key = self.seq is None or self.since_key >= KEY_PERIOD - 1
+        if key:
+            self.reset()
+            self.since_key = 0
+        else:
+            self.since_key += 1
+        self.seq = ((self.seq or 0) + 1) & 0xFF
+        out = bytes((TAG_CODEC, 2, (CODEC_VERSION << 4) | (FLAG_KEY if key else 0), self.seq))
+        if aps:
+            bits = BitWriter()
+            bits.put(len(aps), 6)
+            for mac, rssi in aps:
+                bits.put(min(127, max(0, -rssi)), 7)
+                index, hit = self.dictionary.lookup(mac)
+                bits.put(hit, 1)
+                if hit:
+                    bits.put(index, DICT_INDEX_BITS)
+                    self.nb_hits += 1
+                else:
+                    for byte in mac:
+                        bits.put(byte, 8)
+            data = bits.tobytes()
+            out += bytes((TAG_WIFI_SCAN_DICT, len(data))) + data
+        bits = BitWriter()
+        bits.put(sensors["move_history"], 8)
+        quantized = dict(sensors)
+        for field in ("acc_x", "acc_y", "acc_z"):
+            value = sensors[field]
+            step = (abs(value) + ACC_RESOLUTION_MG // 2) // ACC_RESOLUTION_MG
+            quantized[field] = step if value >= 0 else -step
+        for field, width in zip(SENSOR_FIELDS, SENSOR_WIDTHS):
+            bits.delta(wrap(quantized[field] - self.reference[field], 32))
+            self.reference[field] = quantized[field]
+        data = bits.tobytes()
+        return out + bytes((TAG_SENSORS_PACKED, len(data))) + data
+
+
+def records(lines):
+    for line in lines:
+        line = line.strip()
+        if line and not line.startswith("#"):
+            yield bytes.fromhex(line)
+
+
+def decode(lines, out):
+    codec = Codec()
+    header = None
+    for record in records(lines):
+        for tag, value in tlvs(record):
+            if tag == TAG_CYCLE:
+                out.write("cycle, %d s ago\n" % ((value[0] << 8) | value[1]))
+            elif tag == TAG_CODEC:
+                header = codec.decode_header(value)
+                out.write("  codec v%(version)d seq %(seq)d%(key)s\n" %
+                          dict(header, key=" key" if header["key"] else ""))
+            elif tag in (TAG_WIFI_SCAN_DICT, TAG_SENSORS_PACKED) and not codec.synced:
+                out.write("  tag %d skipped, waiting for a key cycle\n" % tag)
+            elif tag == TAG_WIFI_SCAN_DICT:
+                out.write("  wifi %s\n" % ", ".join("%s %d dBm" % ap for ap in codec.decode_wifi(value)))
+            elif tag == TAG_SENSORS_PACKED:
+                out.write("  sensors %s\n" % codec.decode_sensors(value))
+            else:
+                out.write("  tag %d: %s\n" % (tag, value.hex()))
+
+
+def legacy_cycles(lines):
+    """Wi-Fi scans and sensor values of the records sent without the codec, a cycle ends with TAG_VOLTAGE"""
+    aps, sensors = [], {}
+    for record in records(lines):
+        for tag, value in tlvs(record):
+            if tag == TAG_WIFI_SCAN:
+                aps = [(bytes(value[i + 1:i + 7]), signed(value[i], 8)) for i in range(0, len(value), RAW_BEACON_LEN)]
+            elif tag == TAG_ACCELEROMETER and len(value) == 9:
+                sensors = {"move_history": value[0]}
+                for i, field in enumerate(("acc_x", "acc_y", "acc_z", "temperature")):
+                    sensors[field] = signed((value[1 + 2 * i] << 8) | value[2 + 2 * i], 16)
+            elif tag == TAG_CHARGE and len(value) == 4:
+                sensors["charge"] = int.from_bytes(value, "big")
+            elif tag == TAG_VOLTAGE and len(value) == 2 and "charge" in sensors:
+                sensors["voltage"] = int.from_bytes(value, "big")
+                yield aps, sensors
+                aps, sensors = [], {}
+
+
+def benchmark(lines, out):
+    encoder, decoder = Codec(), Codec()
+    nb_cycles = raw_bytes = encoded_bytes = nb_aps = nb_errors = 0
+    for aps, sensors in legacy_cycles(lines):
+        encoded = encoder.encode_cycle(aps, sensors)
+        nb_cycles += 1
+        nb_aps += len(aps)
+        raw_bytes += RAW_SENSORS_LEN + ((2 + RAW_BEACON_LEN * len(aps)) if aps else 0)
+        encoded_bytes += len(encoded)
+
+        # Round trip through the reference decoder
+        decoded_aps, decoded_sensors = [], None
+        for tag, value in tlvs(encoded):
+            if tag == TAG_CODEC:
+                decoder.decode_header(value)
+            elif tag == TAG_WIFI_SCAN_DICT:
+                decoded_aps = decoder.decode_wifi(value)
+            elif tag == TAG_SENSORS_PACKED:
+                decoded_sensors = decoder.decode_sensors(value)
+        expected = [(mac.hex(":"), min(0, max(-127, rssi))) for mac, rssi in aps]
+        acc_error = max(abs(decoded_sensors[f] - sensors[f]) for f in ("acc_x", "acc_y", "acc_z"))
+        if decoded_aps != expected or acc_error > ACC_RESOLUTION_MG // 2 or any(
+                decoded_sensors[f] != sensors[f] for f in ("move_history", "temperature", "charge", "voltage")):
+            nb_errors += 1
+
+    if nb_cycles == 0:
+        out.write("no cycle found\n")
+        return 1
+    out.write("cycles            : %d\n" % nb_cycles)
+    out.write("uncompressed      : %d bytes, %.1f per cycle\n" % (raw_bytes, raw_bytes / nb_cycles))
+    out.write("compressed        : %d bytes, %.1f per cycle\n" % (encoded_bytes, encoded_bytes / nb_cycles))
+    out.write("compression ratio : %.2f\n" % (raw_bytes / encoded_bytes))
+    out.write("dictionary hits   : %d of %d MACs\n" % (encoder.nb_hits, nb_aps))
+    out.write("round trip errors : %d\n" % nb_errors)
+    return 1 if nb_errors else 0
+
+
+def check(lines, expected, out):
+    """Decodes the records and compares the output with the expected decodes"""
+    decoded = io.StringIO()
+    decode(lines, decoded)
+    diff = list(difflib.unified_diff(expected.read().splitlines(), decoded.getvalue().splitlines(),
+                                     "expected", "decoded", lineterm=""))
+    if diff:
+        out.write("\n".join(diff) + "\n")
+        return 1
+    out.write("%d lines decoded as expected\n" % len(decoded.getvalue().splitlines()))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode the uplink stream records of the tracker")
+    parser.add_argument("--benchmark", action="store_true",
+                        help="encode records sent without the codec and report the compression ratio")
+    parser.add_argument("--expect", metavar="DECODES",
+                        help="compare the decodes with a file of expected decodes, for the golden vectors")
+    parser.add_argument("input", nargs="?", default="-", help="records in hexadecimal, one per line, stdin by default")
+    args = parser.parse_args()
+
+    lines = sys.stdin if args.input == "-" else open(args.input)
+    if args.benchmark:
+        return benchmark(lines, sys.stdout)
+    if args.expect:
+        with open(args.expect) as expected:
+            return check(lines, expected, sys.stdout)
+    decode(lines, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""
+Decoder of the binary traces sent when HAL_DBG_TRACE_BINARY is enabled.
+
+The format table is extracted from the ELF file by "make trace_fmt", the flash image (.bin) is only needed to expand
+%s arguments pointing to constant strings.
+
+Usage:
+    stty -F /dev/ttyACM0 921600 raw
+    python3 trace_decoder.py --fmt build/lora_edge_tracker_sdk_<version>.fmt \
+                             --bin build/lora_edge_tracker_sdk_<version>.bin /dev/ttyACM0
+
+Record layout, little endian, see smtc_hal_dbg_trace.h:
+    | sync (1) | type (1) | payload length (1) | timestamp in RTC ticks (4) | format id (4) | payload |
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+SYNC = 0xA5
+HEADER_SIZE = 11
+RECORD_PRINTF = 0x00
+RECORD_ARRAY = 0x01
+RECORD_PACKARRAY = 0x02
+RECORD_CONTINUED = 0x80
+RTC_TICKS_PER_SECOND = 1024
+FLASH_BASE = 0x08000000
+
+CONVERSION = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(?:hh|h|ll|l|z|j|t)?([diouxXcsp%])")
+
+
+class Decoder:
+    def __init__(self, fmt_table, flash, out):
+        self.fmt_table = fmt_table
+        self.flash = flash
+        self.out = out
+        self.line_start = True
+        self.array_index = 0
+        self.array_open = False
+
+    def c_string(self, blob, offset):
+        if offset < 0 or offset >= len(blob):
+            return None
+        end = blob.find(b"\0", offset)
+        return blob[offset:end if end >= 0 else len(blob)].decode("latin-1")
+
+    def string_arg(self, address):
+        if self.flash is not None:
+            text = self.c_string(self.flash, address - FLASH_BASE)
+            if text is not None:
+                return text
+        return "<str@0x%08X>" % address
+
+    def expand(self, fmt, args):
+        args = list(args)
+
+        def convert(match):
+            flags, width, precision, conversion = match.groups()
+            if conversion == "%":
+                return "%"
+            value = args.pop(0) if args else 0
+            spec = "%" + flags + width + ("." + precision if precision is not None else "")
+            if conversion in "di":
+                return (spec + "d") % (value - (1 << 32) if value & 0x80000000 else value)
+            if conversion == "u":
+                return (spec + "d") % value
+            if conversion == "c":
+                return (spec + "c") % chr(value & 0xFF)
+            if conversion == "s":
+                return (spec + "s") % self.string_arg(value)
+            if conversion == "p":
+                return "0x%08x" % value
+            return (spec + conversion) % value
+
+        return CONVERSION.sub(convert, fmt)
+
+    def write(self, text, timestamp):
+        for line in text.splitlines(True):
+            if self.line_start:
+                self.out.write("[%10.3f] " % (timestamp / RTC_TICKS_PER_SECOND))
+            self.out.write(line)
+            self.line_start = line.endswith("\n")
+        self.out.flush()
+
+    def record(self, record_type, timestamp, fmt, payload):
+        kind = record_type & ~RECORD_CONTINUED
+        if self.array_open and not (kind == RECORD_ARRAY and record_type & RECORD_CONTINUED):
+            # The array ended with the previous record
+            self.write("\n", timestamp)
+        self.array_open = kind == RECORD_ARRAY
+        if kind == RECORD_PRINTF:
+            args = struct.unpack("<%dI" % (len(payload) // 4), payload)
+            self.write(self.expand(fmt, args), timestamp)
+        elif kind == RECORD_ARRAY:
+            # Same layout as the text HAL_DBG_TRACE_ARRAY, the length is not known before the last chunk
+            text = ""
+            if not record_type & RECORD_CONTINUED:
+                text += "%s:\n" % fmt
+                self.array_index = 0
+            for byte in payload:
+                if self.array_index % 16 == 0 and self.array_index > 0:
+                    text += "\n"
+                text += " %02X" % byte
+                self.array_index += 1
+            self.write(text, timestamp)
+        elif kind == RECORD_PACKARRAY:
+            self.write("".join("%02X" % byte for byte in payload), timestamp)
+
+    def run(self, stream):
+        buffer = b""
+        while True:
+            data = stream.read(1)
+            if not data:
+                break
+            buffer += data
+            while buffer:
+                if buffer[0] != SYNC:
+                    # Plain text traces (hal_mcu_trace_print) are passed through
+                    self.out.write(buffer[:1].decode("latin-1"))
+                    buffer = buffer[1:]
+                    continue
+                if len(buffer) < HEADER_SIZE:
+                    break
+                record_type, length, timestamp, fmt_id = struct.unpack("<BBII", buffer[1:HEADER_SIZE])
+                fmt = self.c_string(self.fmt_table, fmt_id)
+                if fmt is None or (record_type & ~RECORD_CONTINUED) > RECORD_PACKARRAY:
+                    self.out.write(buffer[:1].decode("latin-1"))
+                    buffer = buffer[1:]
+                    continue
+                if len(buffer) < HEADER_SIZE + length:
+                    break
+                self.record(record_type, timestamp, fmt, buffer[HEADER_SIZE:HEADER_SIZE + length])
+                buffer = buffer[HEADER_SIZE + length:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode the binary traces of the tracker")
+    parser.add_argument("--fmt", required=True, help="format table extracted by 'make trace_fmt'")
+    parser.add_argument("--bin", help="flash image, used to expand %%s arguments")
+    parser.add_argument("input", nargs="?", default="-", help="serial device or capture file, stdin by default")
+    args = parser.parse_args()
+
+    with open(args.fmt, "rb") as f:
+        fmt_table = f.read()
+    flash = None
+    if args.bin:
+        with open(args.bin, "rb") as f:
+            flash = f.read()
+
+    decoder = Decoder(fmt_table, flash, sys.stdout)
+    if args.input == "-":
+        decoder.run(sys.stdin.buffer)
+    else:
+        with open(args.input, "rb", buffering=0) as stream:
+            decoder.run(stream)
+
+
+if __name__ == "__main__":
+    main()
@@ -528,12 +528,27 @@ typedef enum
     CFG_FIRST_TASK_ID_WITH_NO_HCICMD = CFG_LAST_TASK_ID_WITH_HCICMD - 1,        /**< Shall be FIRST in the list */
     CFG_TASK_SYSTEM_HCI_ASYNCH_EVT_ID,
 /* USER CODE BEGIN CFG_Task_Id_With_NO_HCI_Cmd_t */
-
+    CFG_TASK_TRACKER_MODEM_EVT_ID,
+    CFG_TASK_TRACKER_SCAN_ID,
+    CFG_TASK_TRACKER_SENSORS_ID,
+    CFG_TASK_TRACKER_STORE_ID,
+    CFG_TASK_TRACKER_UPLINK_ID,
+    CFG_TASK_TRACKER_BLE_ID,
+    CFG_TASK_TRACKER_MOTION_ID,
+    CFG_TASK_TRACKER_ALMANAC_ID,
 /* USER CODE END CFG_Task_Id_With_NO_HCI_Cmd_t */
     CFG_LAST_TASK_ID_WITHO_NO_HCICMD                                            /**< Shall be LAST in the list */
 } CFG_Task_Id_With_NO_HCI_Cmd_t;
 #define CFG_TASK_NBR    CFG_LAST_TASK_ID_WITHO_NO_HCICMD
 
+/**
+ * Tracker tasks paused while the BLE thread is running, they use the radios or restart the BLE thread.
+ * The LoRaWAN modem events keep being processed during a BLE connection
+ */
+#define CFG_TASK_TRACKER_BLE_PAUSED_MASK  ( ( 1 << CFG_TASK_TRACKER_SCAN_ID ) | ( 1 << CFG_TASK_TRACKER_SENSORS_ID ) | \
+                                            ( 1 << CFG_TASK_TRACKER_STORE_ID ) | ( 1 << CFG_TASK_TRACKER_UPLINK_ID ) | \
+                                            ( 1 << CFG_TASK_TRACKER_BLE_ID ) | ( 1 << CFG_TASK_TRACKER_MOTION_ID ) )
+
 /**
  * This is the list of priority required by the application
  * Each Id shall be in the range 0..31
@@ -541,6 +556,7 @@ typedef enum
 typedef enum
 {
     CFG_SCH_PRIO_0,
+    CFG_SCH_PRIO_1,
     CFG_PRIO_NBR,
 } CFG_SCH_Prio_Id_t;
 
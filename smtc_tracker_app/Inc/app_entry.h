@@ -56,6 +56,7 @@ extern "C" {
 /* Exported functions ---------------------------------------------*/
   void APPE_Init( void );
 /* USER CODE BEGIN EF */
+  void APPE_Idle( void );
 
 /* USER CODE END EF */
 
@@ -42,6 +42,7 @@ extern "C" {
  */
 
 #include "stdint.h"
+#include "stdbool.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -75,6 +76,13 @@ extern "C" {
  */
 void start_ble_thread( uint32_t adv_timeout );
 
+/*!
+ * \brief  Indicates if the BLE thread is running, the sequencer idle time then belongs to the BLE stack
+ *
+ * \retval [true : BLE thread running, false : BLE thread stopped]
+ */
+bool ble_thread_is_running( void );
+
 #ifdef __cplusplus
 }
 #endif
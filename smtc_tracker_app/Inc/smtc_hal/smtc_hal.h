@@ -57,6 +57,9 @@ extern "C" {
 #include "smtc_hal_flash.h"
 #include "smtc_hal_i2c.h"
 #include "smtc_hal_adc.h"
+#include "smtc_hal_energy.h"
+#include "smtc_hal_residency.h"
+#include "smtc_hal_profiling.h"
 
 #include "board-config.h"
 
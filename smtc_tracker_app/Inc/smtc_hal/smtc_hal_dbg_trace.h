@@ -79,10 +79,51 @@ extern "C" {
 
     #if ( UNIT_TEST_DBG )
         #define HAL_DBG_TRACE_PRINTF( ... )  printf (  __VA_ARGS__ )
+    #elif ( HAL_DBG_TRACE_BINARY == HAL_FEATURE_ON )
+        #define HAL_DBG_TRACE_PRINTF( fmt, ... )                                                             \
+            HAL_DBG_TRACE_BIN( hal_mcu_trace_bin, HAL_DBG_TRACE_BIN_RECORD_PRINTF, fmt,                      \
+                               HAL_DBG_TRACE_NARGS( fmt, ##__VA_ARGS__ ), ##__VA_ARGS__ )
     #else
         #define HAL_DBG_TRACE_PRINTF( ... )  hal_mcu_trace_print (  __VA_ARGS__ )
     #endif
 
+#if ( HAL_DBG_TRACE_BINARY == HAL_FEATURE_ON ) && !( UNIT_TEST_DBG )
+
+    /* Number of arguments following the format, up to HAL_DBG_TRACE_BIN_MAX_ARGS */
+    #define HAL_DBG_TRACE_NARGS( ... ) HAL_DBG_TRACE_NARGS_( __VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0 )
+    #define HAL_DBG_TRACE_NARGS_( _fmt, _1, _2, _3, _4, _5, _6, _7, _8, n, ... ) n
+
+    /* The format string only lives in the trace format section, the record carries its address */
+    #define HAL_DBG_TRACE_BIN( func, type, fmt, ... )                                                       \
+    do                                                                                                     \
+    {                                                                                                      \
+        static const char hal_dbg_trace_fmt[] __attribute__( ( section( ".hal_trace_fmt" ) ) ) = fmt;      \
+        func( type, hal_dbg_trace_fmt, __VA_ARGS__ );                                                      \
+    } while( 0 )
+
+    #define HAL_DBG_TRACE_LEVEL( prefix, fmt, ... )                                                         \
+        HAL_DBG_TRACE_PRINTF( prefix fmt HAL_DBG_TRACE_COLOR_DEFAULT, ##__VA_ARGS__ )
+
+    #define HAL_DBG_TRACE_MSG( msg ) HAL_DBG_TRACE_PRINTF( HAL_DBG_TRACE_COLOR_DEFAULT msg );
+
+    #define HAL_DBG_TRACE_MSG_COLOR( msg, color ) HAL_DBG_TRACE_PRINTF( color msg HAL_DBG_TRACE_COLOR_DEFAULT );
+
+    #define HAL_DBG_TRACE_INFO( ... ) HAL_DBG_TRACE_LEVEL( HAL_DBG_TRACE_COLOR_GREEN "INFO : ", __VA_ARGS__ );
+
+    #define HAL_DBG_TRACE_WARNING( ... ) HAL_DBG_TRACE_LEVEL( HAL_DBG_TRACE_COLOR_YELLOW "WARN : ", __VA_ARGS__ );
+
+    #define HAL_DBG_TRACE_ERROR( ... ) HAL_DBG_TRACE_LEVEL( HAL_DBG_TRACE_COLOR_RED "ERROR: ", __VA_ARGS__ );
+
+    #define HAL_DBG_TRACE_ARRAY( msg, array, len )                                                          \
+        HAL_DBG_TRACE_BIN( hal_mcu_trace_bin_array, HAL_DBG_TRACE_BIN_RECORD_ARRAY, msg,                    \
+                           ( const uint8_t* ) ( array ), ( uint32_t ) ( len ) );
+
+    #define HAL_DBG_TRACE_PACKARRAY( msg, array, len )                                                      \
+        HAL_DBG_TRACE_BIN( hal_mcu_trace_bin_array, HAL_DBG_TRACE_BIN_RECORD_PACKARRAY, msg,                \
+                           ( const uint8_t* ) ( array ), ( uint32_t ) ( len ) );
+
+#else
+
     #define HAL_DBG_TRACE_MSG( msg )                                           \
     do                                                                         \
     {                                                                          \
@@ -149,6 +190,8 @@ extern "C" {
         }                                                \
     } while( 0 );
 
+#endif
+
 #else
     #define HAL_DBG_TRACE_PRINTF( ... )
     #define HAL_DBG_TRACE_MSG( msg )
@@ -172,6 +215,22 @@ extern "C" {
  * --- PUBLIC CONSTANTS --------------------------------------------------------
  */
 
+/*!
+ * Binary trace record, little endian:
+ * | sync (1) | type (1) | payload length (1) | timestamp in RTC ticks (4) | format id (4) | payload |
+ * The format id is the address of the string in the .hal_trace_fmt section of the ELF file. The payload holds the
+ * 32-bit arguments of a printf record, or the bytes of an array record.
+ */
+#define HAL_DBG_TRACE_BIN_SYNC 0xA5
+#define HAL_DBG_TRACE_BIN_HEADER_SIZE 11
+#define HAL_DBG_TRACE_BIN_MAX_ARGS 8
+#define HAL_DBG_TRACE_BIN_MAX_ARRAY_CHUNK 64
+
+#define HAL_DBG_TRACE_BIN_RECORD_PRINTF 0x00
+#define HAL_DBG_TRACE_BIN_RECORD_ARRAY 0x01
+#define HAL_DBG_TRACE_BIN_RECORD_PACKARRAY 0x02
+#define HAL_DBG_TRACE_BIN_RECORD_CONTINUED 0x80  //!< Flag of the next chunks of an array record
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC TYPES ------------------------------------------------------------
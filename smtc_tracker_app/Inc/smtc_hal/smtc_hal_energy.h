@@ -0,0 +1,215 @@
+/*!
+ * \file      smtc_hal_energy.h
+ *
+ * \brief     Board specific package energy accounting API definition.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __SMTC_HAL_ENERGY_H__
+#define __SMTC_HAL_ENERGY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * \brief Energy model of the board, typical values from the STM32WB55 and LR1110 datasheets
+ */
+#define HAL_ENERGY_MCU_RUN_CURRENT_UA 3300               // CPU1 @ 32 MHz on HSE, range 1
+#define HAL_ENERGY_MCU_RUN_LOW_CURRENT_UA 1500           // CPU1 @ 16 MHz on MSI, range 2, HSE kept on
+#define HAL_ENERGY_MCU_RUN_BOOST_CURRENT_UA 6400         // CPU1 @ 64 MHz on PLL, range 1
+#define HAL_ENERGY_MCU_STOP2_CURRENT_UA 2                // STOP2 with RTC on LSE
+#define HAL_ENERGY_GNSS_CURRENT_UA 10000                 // LR1110 GNSS capture in DC-DC mode + external LNA
+#define HAL_ENERGY_BLE_CURRENT_UA 1000                   // Average of the BLE thread, advertising and connected
+#define HAL_ENERGY_FLASH_PAGE_ERASE_UAS 60               // 22 ms page erase @ 2.7 mA, in uAs
+#define HAL_ENERGY_FLASH_DOUBLE_WORD_PROGRAM_NAS 220     // 82 us double word programming @ 2.7 mA, in nAs
+
+/*!
+ * \brief Resolution of the LoRa TX charge, the remainder of the modem charge counter which counts in whole mAh
+ *
+ * \remark The LoRa TX charge of a cycle is either 0 or a multiple of this step, only its running total is meaningful
+ */
+#define HAL_ENERGY_LORA_TX_RESOLUTION_UAS 3600000
+
+/*!
+ * \brief Depth of the power state transitions history
+ */
+#define HAL_ENERGY_TRANSITION_HISTORY_LEN 16
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief Subsystems whose charge is accounted
+ */
+typedef enum hal_energy_subsystem_e
+{
+    HAL_ENERGY_MCU = 0,
+    HAL_ENERGY_WIFI,
+    HAL_ENERGY_GNSS,
+    HAL_ENERGY_LORA_TX,
+    HAL_ENERGY_FLASH,
+    HAL_ENERGY_BLE,
+    HAL_ENERGY_SUBSYSTEM_NB,
+} hal_energy_subsystem_t;
+
+/*!
+ * \brief Power state transition, time-stamped with the RTC
+ */
+typedef struct hal_energy_transition_s
+{
+    uint32_t timestamp;   //!< RTC timestamp in ticks
+    uint8_t  subsystem;   //!< \ref hal_energy_subsystem_t
+    uint32_t current_ua;  //!< Current drawn by the subsystem from this transition on
+} hal_energy_transition_t;
+
+/*!
+ * \brief Energy accounting report
+ */
+typedef struct hal_energy_report_s
+{
+    uint32_t nb_cycles;                                //!< Number of closed cycles
+    uint32_t cycle_duration_ms;                        //!< Duration of the last closed cycle
+    uint32_t cycle_charge_uas[HAL_ENERGY_SUBSYSTEM_NB];  //!< Charge of the last closed cycle in uAs, LoRa TX in
+                                                         //!< steps of HAL_ENERGY_LORA_TX_RESOLUTION_UAS
+    uint32_t total_charge_uah[HAL_ENERGY_SUBSYSTEM_NB];  //!< Running totals in uAh
+} hal_energy_report_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief Initializes the energy accounting, the MCU is considered in run mode
+ *
+ * \remark Shall be called once the RTC is initialized
+ */
+void hal_energy_init( void );
+
+/*!
+ * \brief Records a power state transition of a subsystem
+ *
+ * \remark The charge drawn in the previous state is integrated up to now
+ *
+ * \param [in] subsystem  Subsystem changing of power state \ref hal_energy_subsystem_t
+ * \param [in] current_ua Current drawn in the new state, 0 when the subsystem is off
+ */
+void hal_energy_set_state( const hal_energy_subsystem_t subsystem, const uint32_t current_ua );
+
+/*!
+ * \brief Adds a charge computed out of the state machine to a subsystem
+ *
+ * \remark Used for activities too short for the RTC resolution or measured by the radio itself
+ *
+ * \param [in] subsystem  Subsystem to charge \ref hal_energy_subsystem_t
+ * \param [in] charge_uas Charge in uAs
+ */
+void hal_energy_add_charge( const hal_energy_subsystem_t subsystem, const uint32_t charge_uas );
+
+/*!
+ * \brief Updates the modem charge counter
+ *
+ * \remark The modem counter includes the Wi-Fi and GNSS activity already modelled, only the remainder is attributed
+ *         to the LoRa transmissions. The counter has a 1 mAh resolution, the LoRa TX charge of a cycle is 0 or whole
+ *         mAh steps, see HAL_ENERGY_LORA_TX_RESOLUTION_UAS
+ *
+ * \param [in] modem_charge_mah Modem charge counter in mAh as returned by lr1110_modem_get_charge
+ */
+void hal_energy_update_modem_charge( const uint32_t modem_charge_mah );
+
+/*!
+ * \brief Closes the current accounting cycle and adds its charge to the running totals
+ */
+void hal_energy_close_cycle( void );
+
+/*!
+ * \brief Returns the energy accounting report
+ *
+ * \param [out] report Report of the last closed cycle and running totals \ref hal_energy_report_t
+ */
+void hal_energy_get_report( hal_energy_report_t* report );
+
+/*!
+ * \brief Returns the sum of the running totals of all subsystems
+ *
+ * \retval total Total charge in uAh
+ */
+uint32_t hal_energy_get_total_charge( void );
+
+/*!
+ * \brief Restores the running totals, typically from the flash memory
+ *
+ * \param [in] total_charge_uah Running totals in uAh, HAL_ENERGY_SUBSYSTEM_NB values
+ */
+void hal_energy_set_total_charge( const uint32_t* total_charge_uah );
+
+/*!
+ * \brief Resets the running totals
+ */
+void hal_energy_reset_total_charge( void );
+
+/*!
+ * \brief Returns the power state transitions history, oldest first
+ *
+ * \param [out] transitions Buffer of HAL_ENERGY_TRANSITION_HISTORY_LEN elements
+ *
+ * \retval nb_transitions Number of transitions copied
+ */
+uint8_t hal_energy_get_transitions( hal_energy_transition_t* transitions );
+
+/*!
+ * \brief Prints the energy accounting report on the debug trace
+ */
+void hal_energy_print_report( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_HAL_ENERGY_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -190,6 +190,25 @@ void hal_gpio_toggle( const hal_gpio_pin_names_t pin );
  */
 uint32_t hal_gpio_get_value( const hal_gpio_pin_names_t pin );
 
+/*!
+ * \brief Saves the configuration registers of a pin (mode, type, speed, pull and alternate function)
+ *
+ * \remark The clock of its port must be enabled, the registers read 0 otherwise
+ *
+ * \param [in] pin   MCU pin to be saved
+ *
+ * \retval config Packed pin configuration, to be given to hal_gpio_restore_config
+ */
+uint32_t hal_gpio_save_config( const hal_gpio_pin_names_t pin );
+
+/*!
+ * \brief Restores the configuration of a pin saved by hal_gpio_save_config, the clock of its port is enabled
+ *
+ * \param [in] pin    MCU pin to be restored
+ * \param [in] config Packed pin configuration
+ */
+void hal_gpio_restore_config( const hal_gpio_pin_names_t pin, const uint32_t config );
+
 /*!
  * \brief Indicates if there are gpio IRQs pending.
  *
@@ -198,6 +217,14 @@ uint32_t hal_gpio_get_value( const hal_gpio_pin_names_t pin );
  */
 bool hal_gpio_is_pending_irq( void );
 
+/*!
+ * \brief Called from the EXTI interrupt once the callback of the pin has been executed. Weak, the application
+ *        overrides it to post the matching task to its scheduler
+ *
+ * \param [in] pin   MCU pin which triggered the interrupt
+ */
+void hal_gpio_irq_notify( const hal_gpio_pin_names_t pin );
+
 /*!
  * \brief EXTI IRQ Handler.
  */
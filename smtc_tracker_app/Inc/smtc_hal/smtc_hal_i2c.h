@@ -57,6 +57,21 @@ extern "C" {
  * --- PUBLIC CONSTANTS --------------------------------------------------------
  */
 
+/*!
+ * \brief Transactions queued on an I2C interface at most, the one in progress included
+ */
+#define HAL_I2C_QUEUE_LEN 4
+
+/*!
+ * \brief Status of a transaction not completed yet, SUCCESS or FAIL afterwards
+ */
+#define HAL_I2C_TRANSACTION_PENDING 2
+
+/*!
+ * \brief Time given to a queued transaction by hal_i2c_transact and hal_i2c_flush
+ */
+#define HAL_I2C_TRANSACTION_TIMEOUT_MS 2000
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC TYPES ------------------------------------------------------------
@@ -74,8 +89,43 @@ typedef struct hal_i2c_s
         hal_gpio_pin_names_t sda;
         hal_gpio_pin_names_t scl;
     } pins;
+    struct
+    {
+        uint32_t sda;
+        uint32_t scl;
+    } pins_config;      // Pins configuration saved by hal_i2c_suspend
+    bool is_suspended;  // Pins to be restored before the next transfer
 } hal_i2c_t;
 
+/*!
+ * \brief Register access of a transaction
+ */
+typedef struct hal_i2c_transfer_s
+{
+    uint8_t  device_addr;  // Device address
+    uint16_t addr;         // Register address, with the auto-increment bit of the device for a burst
+    uint8_t* buffer;       // Data read or written
+    uint16_t size;         // Number of bytes
+    bool     is_read;      // Read, write otherwise
+} hal_i2c_transfer_t;
+
+/*!
+ * \brief Completion callback of a transaction, called from the I2C interrupt
+ */
+typedef void ( *hal_i2c_transaction_cb_t )( void* context, uint8_t status );
+
+/*!
+ * \brief Transaction, the transfers are run back to back from the interrupts with a single completion
+ */
+typedef struct hal_i2c_transaction_s
+{
+    hal_i2c_transfer_t*      transfers;     // Transfers run in order, to be kept until completion
+    uint8_t                  nb_transfers;  // Number of transfers
+    hal_i2c_transaction_cb_t callback;      // Completion callback, NULL for none
+    void*                    context;       // Context given to the callback
+    volatile uint8_t         status;        // HAL_I2C_TRANSACTION_PENDING, then SUCCESS or FAIL
+} hal_i2c_transaction_t;
+
 /*!
  * \brief I2C peripheral ID
  */
@@ -143,6 +193,33 @@ void hal_i2c_init( const uint32_t id, const hal_gpio_pin_names_t sda, const hal_
  */
 void hal_i2c_deinit( const uint32_t id );
 
+/*!
+ * \brief Prepares the I2C for STOP2, its pins configuration is saved and the pins are set in analog mode
+ *
+ * \remark The I2C registers are retained in STOP2, the pins are restored by hal_i2c_resume on the next transfer
+ *         instead of running the full HAL_I2C_Init
+ *
+ * \param [in] id I2C interface id [1:N]
+ */
+void hal_i2c_suspend( const uint32_t id );
+
+/*!
+ * \brief Restores the pins saved by hal_i2c_suspend, does nothing if the I2C is not suspended
+ *
+ * \param [in] id I2C interface id [1:N]
+ */
+void hal_i2c_resume( const uint32_t id );
+
+/*!
+ * \brief Adapts the I2C timing prescaler to the current APB1 clock, to be called after a system clock change
+ *
+ * \remark The SCL timings are kept for a 16 MHz prescaled clock, the APB1 clock is expected to be a multiple of
+ *         16 MHz
+ *
+ * \param [in] id I2C interface id [1:N]
+ */
+void hal_i2c_retime( const uint32_t id );
+
 /*!
  * \brief Write data to the I2C device
  *
@@ -185,6 +262,31 @@ uint8_t hal_i2c_read( const uint32_t id, uint8_t device_addr, uint16_t addr, uin
  */
 uint8_t hal_i2c_read_buffer( const uint32_t id, uint8_t device_addr, uint16_t addr, uint8_t* buffer, uint16_t size );
 
+/*!
+ * \brief Queues a transaction, the reads are run with the DMA and the writes with the interrupts
+ * \remark The transaction and its transfers are to be kept until completion. Only the first I2C interface has its
+ *         interrupts and DMA set up
+ * \param [in] id           I2C interface id [1:N]
+ * \param [in] transaction  Transaction \ref hal_i2c_transaction_t, its status is set to HAL_I2C_TRANSACTION_PENDING
+ * \retval status [SUCCESS, FAIL] FAIL if the queue is full
+ */
+uint8_t hal_i2c_submit( const uint32_t id, hal_i2c_transaction_t* transaction );
+
+/*!
+ * \brief Runs transfers in one transaction and waits for its completion, the core sleeps meanwhile
+ * \param [in] id           I2C interface id [1:N]
+ * \param [in] transfers    Transfers \ref hal_i2c_transfer_t run in order
+ * \param [in] nb_transfers Number of transfers
+ * \retval status [SUCCESS, FAIL]
+ */
+uint8_t hal_i2c_transact( const uint32_t id, hal_i2c_transfer_t* transfers, const uint8_t nb_transfers );
+
+/*!
+ * \brief Waits for the queued transactions, to be called before hal_i2c_suspend
+ * \param [in] id I2C interface id [1:N]
+ */
+void hal_i2c_flush( const uint32_t id );
+
 /*!
  * \brief Sets the internal device address size
  *
@@ -70,6 +70,43 @@ extern "C" {
  * --- PUBLIC TYPES ------------------------------------------------------------
  */
 
+/*!
+ * \brief MCU clock and voltage profiles
+ */
+typedef enum hal_mcu_clock_profile_e
+{
+    HAL_MCU_CLOCK_PROFILE_LOW = 0,  //!< MSI 16 MHz, voltage range 2, while waiting for the radio or a sensor
+    HAL_MCU_CLOCK_PROFILE_NOMINAL,  //!< HSE 32 MHz, voltage range 1
+    HAL_MCU_CLOCK_PROFILE_BOOST,    //!< PLL 64 MHz, voltage range 1, for short CPU or bus bound bursts
+    HAL_MCU_CLOCK_PROFILE_NB,
+} hal_mcu_clock_profile_t;
+
+/*!
+ * \brief Time and charge spent by the MCU in run mode in each clock profile
+ */
+typedef struct hal_mcu_clock_profile_stats_s
+{
+    uint32_t time_ms[HAL_MCU_CLOCK_PROFILE_NB];     //!< Time in run mode, STOP2 excluded
+    uint32_t charge_uas[HAL_MCU_CLOCK_PROFILE_NB];  //!< Charge drawn by the MCU in uAs
+    int32_t  saving_uas[HAL_MCU_CLOCK_PROFILE_NB];  //!< Charge saved compared to the nominal profile in uAs
+    uint32_t switches[HAL_MCU_CLOCK_PROFILE_NB];    //!< Number of switches to the profile
+} hal_mcu_clock_profile_stats_t;
+
+/*!
+ * \brief STOP2 wake-to-ready statistics, means per wakeup
+ *
+ * \remark Ready means the clock tree, the radio IOs and the bus pins used during the wake period are restored
+ */
+typedef struct hal_mcu_wake_stats_s
+{
+    uint32_t nb_wakes;           //!< Number of STOP2 wakeups profiled
+    uint32_t clocks_cycles;      //!< Cycles restoring the clock tree, mostly on the HSI16 wakeup clock
+    uint32_t resume_cycles;      //!< Other cycles of hal_mcu_reinit, at the core clock
+    uint32_t bus_resume_cycles;  //!< Cycles restoring the bus pins on their first transfer, at the core clock
+    uint32_t ready_us;           //!< Wake-to-ready time in us
+    uint32_t charge_nas;         //!< MCU charge drawn until ready in nAs
+} hal_mcu_wake_stats_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -96,6 +133,8 @@ void hal_mcu_init( void );
 
 /*!
  * \brief Initializes MCU after a stop mode
+ *
+ * \remark Only the clocks and the radio IOs are restored here, the buses are resumed on their first use
  */
 void hal_mcu_reinit( void );
 
@@ -146,6 +185,58 @@ void hal_mcu_set_sleep_for_s( const int32_t seconds );
  */
 void hal_mcu_wait_us( const int32_t microseconds );
 
+/*!
+ * \brief Switches the MCU to a clock and voltage profile
+ *
+ * \remark The SPI, I2C and UART are retimed to the new bus clocks, the pending asynchronous traces are flushed
+ *         first. The profile is restored after STOP2. Shall be called from thread mode.
+ *
+ * \param [in] profile Profile to switch to \ref hal_mcu_clock_profile_t
+ *
+ * \retval previous Profile in use before the call, to be restored at the end of the workload
+ */
+hal_mcu_clock_profile_t hal_mcu_set_clock_profile( const hal_mcu_clock_profile_t profile );
+
+/*!
+ * \brief Returns the clock profile in use
+ *
+ * \retval profile \ref hal_mcu_clock_profile_t
+ */
+hal_mcu_clock_profile_t hal_mcu_get_clock_profile( void );
+
+/*!
+ * \brief Returns the time and charge accounted in each clock profile since the boot or the last reset
+ *
+ * \param [out] stats Clock profile statistics
+ */
+void hal_mcu_get_clock_profile_stats( hal_mcu_clock_profile_stats_t* stats );
+
+/*!
+ * \brief Resets the clock profile statistics
+ */
+void hal_mcu_reset_clock_profile_stats( void );
+
+/*!
+ * \brief Prints the clock profile statistics
+ */
+void hal_mcu_print_clock_profile_stats( void );
+
+/*!
+ * \brief Returns the STOP2 wake-to-ready statistics, out of the DWT profiling zones
+ *
+ * \remark Only available when HAL_PROFILING is on, the statistics are reset with the profiling zones
+ *
+ * \param [out] stats Wake-to-ready statistics \ref hal_mcu_wake_stats_t
+ */
+void hal_mcu_get_wake_stats( hal_mcu_wake_stats_t* stats );
+
+/*!
+ * \brief Prints the STOP2 wake-to-ready statistics
+ *
+ * \remark Only available when HAL_PROFILING is on
+ */
+void hal_mcu_print_wake_stats( void );
+
 /*!
  * \brief Get Vref intern from the MCU in mV
  *
@@ -174,6 +265,28 @@ void hal_mcu_smps_enable( bool enable );
  */
 void hal_mcu_trace_print( const char* fmt, ... );
 
+/*!
+ * \brief Sends a binary trace record, used by the trace macros when HAL_DBG_TRACE_BINARY is enabled
+ *
+ * \remark fmt is only used as an identifier and is never read, arguments shall be 32-bit wide (no double or long
+ *         long)
+ *
+ * \param [in] type Record type, see HAL_DBG_TRACE_BIN_RECORD_*
+ * \param [in] fmt Format string placed in the trace format section
+ * \param [in] nb_args Number of arguments following
+ */
+void hal_mcu_trace_bin( uint8_t type, const char* fmt, uint32_t nb_args, ... );
+
+/*!
+ * \brief Sends a byte array as binary trace records, used by the trace macros when HAL_DBG_TRACE_BINARY is enabled
+ *
+ * \param [in] type Record type, see HAL_DBG_TRACE_BIN_RECORD_*
+ * \param [in] msg Message placed in the trace format section
+ * \param [in] array Bytes to send
+ * \param [in] len Number of bytes to send
+ */
+void hal_mcu_trace_bin_array( uint8_t type, const char* msg, const uint8_t* array, uint32_t len );
+
 /*!
  * \brief Suspend low power process and avoid looping on it
  */
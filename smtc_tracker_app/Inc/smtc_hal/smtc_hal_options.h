@@ -58,6 +58,9 @@ extern "C" {
 
 #define HAL_DBG_TRACE                               HAL_FEATURE_ON
 #define HAL_DBG_TRACE_COLOR                         HAL_FEATURE_ON
+// HAL_FEATURE_ON to send the traces as binary records (format id, timestamp, raw arguments) decoded on the host by
+// gcc/trace_decoder.py, the format strings stay in the ELF file and are not flashed (GCC build)
+#define HAL_DBG_TRACE_BINARY                        HAL_FEATURE_OFF
 
 // HAL_FEATURE_ON to activate sleep mode
 
@@ -72,10 +75,18 @@ extern "C" {
 #define HAL_PRINTF_UART_ID                          1
 #define HAL_PRINT_BUFFER_SIZE                       255
 
+// HAL_FEATURE_ON to queue the traces in a ring drained by DMA instead of blocking on the UART
+#define HAL_DBG_TRACE_ASYNC                         HAL_FEATURE_ON
+// Size in bytes of the trace ring, shall be a power of 2
+#define HAL_DBG_TRACE_RING_SIZE                     2048
+
 #define HAL_RADIO_SPI_ID                            1
 
 #define HAL_I2C_ID                                  1
 
+// HAL_FEATURE_ON to enable the DWT cycle counter profiling zones, keep it off in production builds
+#define HAL_PROFILING                               HAL_FEATURE_OFF
+
 // HAL_FEATURE_OFF to not use watchdog
 #define HAL_USE_WATCHDOG                            HAL_FEATURE_OFF
 
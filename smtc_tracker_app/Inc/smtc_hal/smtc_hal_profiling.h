@@ -0,0 +1,159 @@
+/*!
+ * \file      smtc_hal_profiling.h
+ *
+ * \brief     Board specific package DWT cycle counter profiling API definition.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __SMTC_HAL_PROFILING_H__
+#define __SMTC_HAL_PROFILING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "smtc_hal_options.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * \brief Profiling zone markers, removed at compile time when HAL_PROFILING is off
+ *
+ * \remark A zone can't be nested in itself, the cycles spent in STOP2 are not counted
+ */
+#if( HAL_PROFILING == HAL_FEATURE_ON )
+    #define HAL_PROF_INIT( )            hal_prof_init( )
+    #define HAL_PROF_ZONE_BEGIN( zone ) hal_prof_zone_begin( zone )
+    #define HAL_PROF_ZONE_END( zone )   hal_prof_zone_end( zone )
+    #define HAL_PROF_DUMP( )            hal_prof_dump( )
+#else
+    #define HAL_PROF_INIT( )
+    #define HAL_PROF_ZONE_BEGIN( zone )
+    #define HAL_PROF_ZONE_END( zone )
+    #define HAL_PROF_DUMP( )
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief Profiled zones
+ */
+typedef enum hal_prof_zone_e
+{
+    HAL_PROF_ZONE_BUILD_PAYLOAD = 0,
+    HAL_PROF_ZONE_STORE_INTERNAL_LOG,
+    HAL_PROF_ZONE_PARSE_CMD,
+    HAL_PROF_ZONE_WIFI_SCAN,
+    HAL_PROF_ZONE_GNSS_RESULTS,
+    HAL_PROF_ZONE_STOP2_RESUME,
+    HAL_PROF_ZONE_TIMER_START,
+    HAL_PROF_ZONE_TIMER_STOP,
+    HAL_PROF_ZONE_ENCODE_WIFI,
+    HAL_PROF_ZONE_ENCODE_SENSORS,
+    HAL_PROF_ZONE_STOP2_CLOCKS,  // Nested in HAL_PROF_ZONE_STOP2_RESUME
+    HAL_PROF_ZONE_BUS_RESUME,
+    HAL_PROF_ZONE_NB,
+} hal_prof_zone_t;
+
+/*!
+ * \brief Statistics of a profiled zone, in CPU cycles
+ */
+typedef struct hal_prof_zone_stats_s
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t mean;
+} hal_prof_zone_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief Enables the DWT cycle counter and resets the zones statistics
+ */
+void hal_prof_init( void );
+
+/*!
+ * \brief Marks the beginning of a zone
+ *
+ * \param [in] zone Profiled zone \ref hal_prof_zone_t
+ */
+void hal_prof_zone_begin( const hal_prof_zone_t zone );
+
+/*!
+ * \brief Marks the end of a zone and updates its statistics
+ *
+ * \param [in] zone Profiled zone \ref hal_prof_zone_t
+ */
+void hal_prof_zone_end( const hal_prof_zone_t zone );
+
+/*!
+ * \brief Returns the statistics of a zone
+ *
+ * \param [in]  zone  Profiled zone \ref hal_prof_zone_t
+ * \param [out] stats Zone statistics \ref hal_prof_zone_stats_t
+ */
+void hal_prof_get_zone_stats( const hal_prof_zone_t zone, hal_prof_zone_stats_t* stats );
+
+/*!
+ * \brief Resets the statistics of all zones
+ */
+void hal_prof_reset( void );
+
+/*!
+ * \brief Prints the statistics of all zones on the debug trace
+ */
+void hal_prof_dump( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_HAL_PROFILING_H__
+
+/* --- EOF ------------------------------------------------------------------ */
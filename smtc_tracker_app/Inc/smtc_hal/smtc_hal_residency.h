@@ -0,0 +1,161 @@
+/*!
+ * \file      smtc_hal_residency.h
+ *
+ * \brief     Board specific package low power residency and wake source accounting API definition.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __SMTC_HAL_RESIDENCY_H__
+#define __SMTC_HAL_RESIDENCY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * \brief Number of application states the residency is broken down into, higher states are merged in the last one
+ */
+#define HAL_RESIDENCY_APP_STATE_NB 8
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief MCU power modes whose residency is accounted
+ */
+typedef enum hal_residency_mode_e
+{
+    HAL_RESIDENCY_RUN = 0,
+    HAL_RESIDENCY_SLEEP,
+    HAL_RESIDENCY_STOP2,
+    HAL_RESIDENCY_MODE_NB,
+} hal_residency_mode_t;
+
+/*!
+ * \brief Sources waking up the MCU from SLEEP or STOP2
+ */
+typedef enum hal_residency_wake_source_e
+{
+    HAL_RESIDENCY_WAKE_RTC_ALARM = 0,
+    HAL_RESIDENCY_WAKE_RADIO_EVENT,
+    HAL_RESIDENCY_WAKE_ACCELEROMETER,
+    HAL_RESIDENCY_WAKE_HALL_EFFECT,
+    HAL_RESIDENCY_WAKE_USER_BUTTON,
+    HAL_RESIDENCY_WAKE_IPCC,
+    HAL_RESIDENCY_WAKE_OTHER,  //!< No known interrupt has been served between the wakeup and the next sleep
+    HAL_RESIDENCY_WAKE_SOURCE_NB,
+} hal_residency_wake_source_t;
+
+/*!
+ * \brief Residency report, since boot or the last reset
+ */
+typedef struct hal_residency_report_s
+{
+    uint32_t time_s[HAL_RESIDENCY_APP_STATE_NB][HAL_RESIDENCY_MODE_NB];  //!< Time spent per application state and mode
+    uint32_t mode_time_s[HAL_RESIDENCY_MODE_NB];                         //!< Time spent per mode, all states
+    uint32_t wakeups[HAL_RESIDENCY_WAKE_SOURCE_NB];                      //!< Wakeups per source
+} hal_residency_report_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief Initializes the residency accounting, the MCU is considered in run mode and application state 0
+ *
+ * \remark Shall be called once the RTC is initialized
+ */
+void hal_residency_init( void );
+
+/*!
+ * \brief Records a power mode transition of the MCU
+ *
+ * \remark Leaving SLEEP or STOP2 arms the wake source accounting, the first interrupt notified afterwards is counted
+ *         as the wake source
+ *
+ * \param [in] mode Power mode the MCU enters \ref hal_residency_mode_t
+ */
+void hal_residency_set_mode( const hal_residency_mode_t mode );
+
+/*!
+ * \brief Records an application state transition
+ *
+ * \param [in] app_state Application state, from 0 to HAL_RESIDENCY_APP_STATE_NB - 1
+ */
+void hal_residency_set_app_state( const uint8_t app_state );
+
+/*!
+ * \brief Notifies an interrupt, counted as wake source if it is the first one since the MCU left low power
+ *
+ * \param [in] source Interrupt source \ref hal_residency_wake_source_t
+ */
+void hal_residency_notify_wake( const hal_residency_wake_source_t source );
+
+/*!
+ * \brief Returns the residency report
+ *
+ * \param [out] report Residency per application state and mode, and wakeups per source \ref hal_residency_report_t
+ */
+void hal_residency_get_report( hal_residency_report_t* report );
+
+/*!
+ * \brief Resets the residency times and the wakeup counters
+ */
+void hal_residency_reset( void );
+
+/*!
+ * \brief Prints the residency report on the debug trace
+ */
+void hal_residency_print_report( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_HAL_RESIDENCY_H__
+
+/* --- EOF ------------------------------------------------------------------ */
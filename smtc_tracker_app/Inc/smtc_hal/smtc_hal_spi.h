@@ -40,6 +40,9 @@ extern "C" {
  * --- DEPENDENCIES ------------------------------------------------------------
  */
 
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
 #include "stm32wbxx_hal.h"
 #include "stm32wbxx_ll_spi.h"
 #include "smtc_hal_gpio_pin_names.h"
@@ -72,6 +75,13 @@ typedef struct hal_spi_s
         hal_gpio_pin_names_t miso;
         hal_gpio_pin_names_t sclk;
     } pins;
+    struct
+    {
+        uint32_t mosi;
+        uint32_t miso;
+        uint32_t sclk;
+    } pins_config;      // Pins configuration saved by hal_spi_suspend
+    bool is_suspended;  // Pins to be restored before the next transfer
 } hal_spi_t;
 
 /*
@@ -107,6 +117,30 @@ void hal_spi_deinit( const uint32_t id );
  */
 uint16_t hal_spi_in_out( const uint32_t id, const uint16_t out_data );
 
+/*!
+ * \brief Prepares the SPI for STOP2, only its pins configuration is saved
+ *
+ * \remark The SPI registers are retained in STOP2, the pins are restored by hal_spi_resume on the next transfer
+ *         instead of running the full HAL_SPI_Init
+ *
+ * \param [in] id   SPI interface id [1:N]
+ */
+void hal_spi_suspend( const uint32_t id );
+
+/*!
+ * \brief Restores the pins saved by hal_spi_suspend, does nothing if the SPI is not suspended
+ *
+ * \param [in] id   SPI interface id [1:N]
+ */
+void hal_spi_resume( const uint32_t id );
+
+/*!
+ * \brief Adapts the SPI clock prescaler to the current APB2 clock, to be called after a system clock change
+ *
+ * \param [in] id   SPI interface id [1:N]
+ */
+void hal_spi_retime( const uint32_t id );
+
 #ifdef __cplusplus
 }
 #endif
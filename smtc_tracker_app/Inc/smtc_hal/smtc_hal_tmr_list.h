@@ -63,15 +63,28 @@ extern "C" {
  */
 typedef struct timer_event_s
 {
-    uint32_t timestamp;                   //! Current timer value
+    uint32_t timestamp;                   //! Absolute expiry time in RTC ticks
     uint32_t reload_value;                //! Timer delay value
+    uint32_t slack;                       //! Delay the expiry may be postponed by to share a wakeup, in RTC ticks
     bool     is_started;                  //! Is the timer currently running
-    bool     is_next_2_expire;            //! Is the next timer to expire
+    bool     is_exact;                    //! Never served before its timeout to share a wakeup
+    uint8_t  heap_index[2];               //! Position in the heaps of running timers, by timeout and by wakeup
     void ( *callback )( void* context );  //! Timer IRQ callback function
-    void*                 context;        //! User defined data object pointer to pass back
-    struct timer_event_s* next;           //! Pointer to the next Timer object.
+    void* context;                        //! User defined data object pointer to pass back
 } timer_event_t;
 
+/*!
+ * \brief Timer wakeup counters
+ */
+typedef struct timer_stats_s
+{
+    uint32_t wakeups;               //! RTC alarm interrupts
+    uint32_t expiries;              //! Timer callbacks executed
+    uint32_t wakeups_saved;         //! Timers served by a wakeup due to another timer or to an external event
+    uint32_t wakeups_last_hour;     //! RTC alarm interrupts during the last complete hour
+    uint32_t wakeups_max_per_hour;  //! Highest number of RTC alarm interrupts in an hour since boot
+} timer_stats_t;
+
 /*!
  * \brief Timer time variable definition
  */
@@ -105,6 +118,29 @@ void timer_init( timer_event_t* obj, void ( *callback )( void* context ) );
  */
 void timer_set_context( timer_event_t* obj, void* context );
 
+/*!
+ * \brief Sets the delay the expiry of the timer may be postponed by
+ *
+ * \remark The timer callback is called between the timeout and the timeout plus the slack, at the wakeup shared with
+ *         the largest number of other timers. The slack is kept by timer_set_value and is 0 after timer_init.
+ *
+ * \param [in] obj   Structure containing the timer object parameters
+ * \param [in] slack Tolerated delay in ms
+ */
+void timer_set_slack( timer_event_t* obj, uint32_t slack );
+
+/*!
+ * \brief Forbids serving the timer before its timeout
+ *
+ * \remark Timers are otherwise served up to TIMER_COALESCE_WINDOW ticks early by a wakeup due to another timer. Meant
+ *         for timers whose owner relies on the delay being elapsed, like the BLE timer server. The flag is false after
+ *         timer_init.
+ *
+ * \param [in] obj      Structure containing the timer object parameters
+ * \param [in] is_exact [true : never served early, false : may be served early to share a wakeup]
+ */
+void timer_set_exact( timer_event_t* obj, bool is_exact );
+
 /*!
  * \brief Timer IRQ event handler
  */
@@ -178,6 +214,30 @@ timer_time_t timer_get_elapsed_time( timer_time_t past );
  */
 timer_time_t timer_temp_compensation( timer_time_t period, float temperature );
 
+/*!
+ * \brief Returns the time left before the next timer expiry
+ *
+ * \retval time Time left in ms, TIMERTIME_T_MAX when no timer is running
+ */
+timer_time_t timer_get_remaining_time( void );
+
+/*!
+ * \brief Serves the timers whose timeout is reached while their slack is not elapsed yet
+ *
+ * \remark To be called when the MCU is awake for another reason, before going back to low power. It saves the RTC
+ *         alarm wakeup these timers would need later on.
+ *
+ * \retval served [true : at least one timer callback has been called, false : no timer was due]
+ */
+bool timer_serve_due( void );
+
+/*!
+ * \brief Returns the wakeup and coalescing counters since boot
+ *
+ * \param [out] stats Counters \ref timer_stats_t
+ */
+void timer_get_stats( timer_stats_t* stats );
+
 #ifdef __cplusplus
 }
 #endif
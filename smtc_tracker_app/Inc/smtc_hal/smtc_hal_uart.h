@@ -41,6 +41,7 @@ extern "C" {
  */
 
 #include "stm32wbxx_hal.h"
+#include "smtc_hal_options.h"
 #include "smtc_hal_gpio_pin_names.h"
 
 /*
@@ -58,6 +59,16 @@ extern "C" {
  * --- PUBLIC TYPES ------------------------------------------------------------
  */
 
+/*!
+ * \brief Statistics of the asynchronous TX ring
+ */
+typedef struct hal_uart_tx_stats_s
+{
+    volatile uint32_t dropped_msgs;   //!< Messages dropped because the ring was full
+    volatile uint32_t dropped_bytes;  //!< Bytes dropped because the ring was full or the transfer failed
+    volatile uint32_t high_water;     //!< Highest ring occupancy seen, in bytes
+} hal_uart_tx_stats_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -79,6 +90,33 @@ void hal_uart_init( const uint32_t id, const hal_gpio_pin_names_t uart_tx, const
  */
 void hal_uart_deinit( const uint32_t id );
 
+/*!
+ * \brief Prepares the UART for STOP2, its pins configuration is saved and the pins are set in analog mode
+ *
+ * \remark The UART registers are retained in STOP2, the pins are restored by hal_uart_resume on the next transfer
+ *         instead of running the full HAL_UART_Init
+ *
+ * \param [in] id UART interface id [1:N]
+ */
+void hal_uart_suspend( const uint32_t id );
+
+/*!
+ * \brief Restores the pins saved by hal_uart_suspend, does nothing if the UART is not suspended
+ *
+ * \param [in] id UART interface id [1:N]
+ */
+void hal_uart_resume( const uint32_t id );
+
+/*!
+ * \brief Recomputes the UART baud rate divider from the current APB2 clock, to be called after a system clock change
+ *
+ * \remark The pending asynchronous traces are flushed first, the oversampling drops to 8 when the APB2 clock is too
+ *         low to keep the baud rate accurate with 16
+ *
+ * \param [in] id UART interface id [1:N]
+ */
+void hal_uart_retime( const uint32_t id );
+
 /*!
  * \brief Send an amount on data on the UART bus
  *
@@ -97,6 +135,37 @@ void hal_uart_tx( const uint32_t id, uint8_t* buff, uint16_t len );
  */
 void hal_uart_rx( const uint32_t id, uint8_t* rx_buffer, uint8_t len );
 
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+/*!
+ * \brief Queues data in the TX ring, the DMA sends it in the background
+ *
+ * \remark Can be called from any context, it only copies the data. The message is dropped and counted when the ring
+ *         is full.
+ *
+ * \param [in] id UART interface id [1:N]
+ * \param [in] buff buffer containing data to send
+ * \param [in] len data length to send
+ */
+void hal_uart_tx_async( const uint32_t id, const uint8_t* buff, uint16_t len );
+
+/*!
+ * \brief Waits until the TX ring is empty and the last byte is out of the UART
+ *
+ * \remark Shall be called from thread mode, or with interrupts masked in which case the transfer is polled
+ *
+ * \param [in] id UART interface id [1:N]
+ */
+void hal_uart_flush( const uint32_t id );
+
+/*!
+ * \brief Returns the statistics of the TX ring
+ *
+ * \param [in] id UART interface id [1:N]
+ * \param [out] stats Statistics of the TX ring
+ */
+void hal_uart_get_tx_stats( const uint32_t id, hal_uart_tx_stats_t* stats );
+#endif
+
 #ifdef __cplusplus
 }
 #endif
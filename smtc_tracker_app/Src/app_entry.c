@@ -31,6 +31,7 @@
 #include "app_debug.h"
 #include "smtc_hal_rtc.h"
 #include "tracker_utility.h"
+#include "ble_thread.h"
 
 
 /* Private includes -----------------------------------------------------------*/
@@ -219,6 +220,13 @@ static void APPE_SysUserEvtRx( void * pPayload )
  *************************************************************/
 void UTIL_SEQ_Idle( void )
 {
+  if( ble_thread_is_running( ) == false )
+  {
+    // Outside of the BLE thread the idle time belongs to the application
+    APPE_Idle( );
+    return;
+  }
+
 #if ( CFG_LPM_SUPPORTED == 1)
 	// Go on low power only when Advertisement or Connection are ON
 	if(tracker_ctx.ble_advertisement_on == true)
@@ -260,6 +268,17 @@ void shci_cmd_resp_wait(uint32_t timeout)
 }
 
 /* USER CODE BEGIN FD_WRAP_FUNCTIONS */
-
+/**
+  * @brief  This function is called by the scheduler when no task is pending
+  *         outside of the BLE thread. The application overrides it to enter
+  *         its low power mode.
+  *
+  * @param  None
+  * @retval None
+  */
+__weak void APPE_Idle( void )
+{
+  return;
+}
 /* USER CODE END FD_WRAP_FUNCTIONS */
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,322 @@
+/*!
+ * \file      activity_classifier.c
+ *
+ * \brief     Activity classifier on the accelerometer FIFO batches implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "activity_classifier.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * \brief Fractional bits of the features
+ */
+#define ACTIVITY_CLASSIFIER_SHIFT 4
+
+/*!
+ * \brief Below this variance the tracker is stationary, above the noise of the 8-bit output (about 23 mg RMS)
+ */
+#define ACTIVITY_CLASSIFIER_STILL_VARIANCE ( 2 << ACTIVITY_CLASSIFIER_SHIFT )
+
+/*!
+ * \brief Walking: strong motion (about 100 mg RMS) at the step frequency, 0.95 Hz to 3.1 Hz at 10 Hz ODR
+ */
+#define ACTIVITY_CLASSIFIER_WALK_VARIANCE ( 36 << ACTIVITY_CLASSIFIER_SHIFT )
+#define ACTIVITY_CLASSIFIER_WALK_ZC_MIN 6
+#define ACTIVITY_CLASSIFIER_WALK_ZC_MAX 20
+
+/*!
+ * \brief Walking: energy below 7/4 of the variance, the motion is mostly under 2.3 Hz. Wide band vibrations of a
+ *        vehicle, aliased at 10 Hz ODR, give twice the variance
+ */
+#define ACTIVITY_CLASSIFIER_WALK_ENERGY_NUM 7
+#define ACTIVITY_CLASSIFIER_WALK_ENERGY_DEN 4
+
+/*!
+ * \brief Slow walking, or a tracker carried in a bag: weaker motion (about 45 mg RMS) accepted when its energy is
+ *        below 5/4 of the variance. A stroll at 1.2 Hz to 1.5 Hz gives less than the variance, the vibrations of a
+ *        vehicle more than 3/2 of it
+ */
+#define ACTIVITY_CLASSIFIER_SLOW_WALK_VARIANCE ( 8 << ACTIVITY_CLASSIFIER_SHIFT )
+#define ACTIVITY_CLASSIFIER_SLOW_WALK_ENERGY_NUM 5
+#define ACTIVITY_CLASSIFIER_SLOW_WALK_ENERGY_DEN 4
+
+/*!
+ * \brief Dead band around the mean not counted as a crossing, in LSB
+ */
+#define ACTIVITY_CLASSIFIER_ZC_DEADBAND 1
+
+/*!
+ * \brief Window length the zero crossings are normalized to
+ */
+#define ACTIVITY_CLASSIFIER_ZC_WINDOW 32
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*!
+ * \brief Activity names, for the traces
+ */
+static const char* activity_classifier_names[ACTIVITY_NB] = { "unknown", "stationary", "walking", "vehicle" };
+
+/*!
+ * \brief Confirmed activity and class of the last windows
+ */
+static activity_t activity_classifier_current         = ACTIVITY_UNKNOWN;
+static activity_t activity_classifier_candidate       = ACTIVITY_UNKNOWN;
+static uint8_t    activity_classifier_candidate_count = 0;
+
+/*!
+ * \brief Time of the last window classified
+ */
+static bool     activity_classifier_updated     = false;
+static uint32_t activity_classifier_last_update = 0;
+
+/*!
+ * \brief Classifier statistics
+ */
+static activity_classifier_stats_t activity_classifier_stats;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+activity_t activity_classifier_update( const acc_sample_t* samples, const uint8_t nb_samples, const uint32_t now )
+{
+    activity_features_t features;
+    activity_t          activity;
+
+    if( ( samples == NULL ) || ( nb_samples < ACTIVITY_CLASSIFIER_MIN_WINDOW ) )
+    {
+        return ACTIVITY_UNKNOWN;
+    }
+
+    activity_classifier_get_features( samples, nb_samples, &features );
+    activity = activity_classifier_classify( &features );
+
+    if( activity == activity_classifier_candidate )
+    {
+        if( activity_classifier_candidate_count < ACTIVITY_CLASSIFIER_CONFIRM_WINDOWS )
+        {
+            activity_classifier_candidate_count++;
+        }
+    }
+    else
+    {
+        activity_classifier_candidate       = activity;
+        activity_classifier_candidate_count = 1;
+    }
+
+    if( ( activity_classifier_candidate_count >= ACTIVITY_CLASSIFIER_CONFIRM_WINDOWS ) &&
+        ( activity_classifier_current != activity ) )
+    {
+        activity_classifier_current = activity;
+        activity_classifier_stats.nb_changes++;
+    }
+
+    activity_classifier_updated     = true;
+    activity_classifier_last_update = now;
+
+    activity_classifier_stats.nb_windows++;
+    activity_classifier_stats.nb_windows_per_class[activity]++;
+    activity_classifier_stats.last_features = features;
+
+    return activity;
+}
+
+activity_t activity_classifier_get( const uint32_t now )
+{
+    if( ( activity_classifier_updated == false ) ||
+        ( ( now - activity_classifier_last_update ) > ACTIVITY_CLASSIFIER_MAX_AGE_S ) )
+    {
+        return ACTIVITY_UNKNOWN;
+    }
+
+    return activity_classifier_current;
+}
+
+void activity_classifier_get_features( const acc_sample_t* samples, const uint8_t nb_samples,
+                                       activity_features_t* features )
+{
+    int32_t  sum[3]            = { 0 };
+    int32_t  sum_square[3]     = { 0 };
+    uint32_t diff_square       = 0;
+    uint32_t variance_n2       = 0;  // Variance scaled by nb_samples^2, no division in the loop
+    uint32_t axis_variance_max = 0;
+    uint8_t  axis              = 0;
+    int8_t   last_sign         = 0;
+    uint8_t  nb_crossings      = 0;
+    int32_t  n                 = nb_samples;
+
+    for( uint8_t i = 0; i < nb_samples; i++ )
+    {
+        const int32_t value[3] = { samples[i].x, samples[i].y, samples[i].z };
+
+        for( uint8_t k = 0; k < 3; k++ )
+        {
+            sum[k] += value[k];
+            sum_square[k] += value[k] * value[k];
+        }
+
+        if( i > 0 )
+        {
+            const int32_t dx = value[0] - samples[i - 1].x;
+            const int32_t dy = value[1] - samples[i - 1].y;
+            const int32_t dz = value[2] - samples[i - 1].z;
+
+            diff_square += ( uint32_t )( ( dx * dx ) + ( dy * dy ) + ( dz * dz ) );
+        }
+    }
+
+    for( uint8_t k = 0; k < 3; k++ )
+    {
+        const uint32_t axis_variance = ( uint32_t )( ( n * sum_square[k] ) - ( sum[k] * sum[k] ) );
+
+        variance_n2 += axis_variance;
+        if( axis_variance > axis_variance_max )
+        {
+            axis_variance_max = axis_variance;
+            axis              = k;
+        }
+    }
+
+    /* Crossings of the mean on the most varying axis, n * value is compared to the sum */
+    for( uint8_t i = 0; i < nb_samples; i++ )
+    {
+        const int32_t value     = ( axis == 0 ) ? samples[i].x : ( ( axis == 1 ) ? samples[i].y : samples[i].z );
+        const int32_t deviation = ( n * value ) - sum[axis];
+        int8_t        sign;
+
+        if( deviation > ( n * ACTIVITY_CLASSIFIER_ZC_DEADBAND ) )
+        {
+            sign = 1;
+        }
+        else if( deviation < -( n * ACTIVITY_CLASSIFIER_ZC_DEADBAND ) )
+        {
+            sign = -1;
+        }
+        else
+        {
+            continue;
+        }
+
+        if( ( last_sign != 0 ) && ( sign != last_sign ) )
+        {
+            nb_crossings++;
+        }
+        last_sign = sign;
+    }
+
+    features->variance       = ( variance_n2 << ACTIVITY_CLASSIFIER_SHIFT ) / ( uint32_t )( n * n );
+    features->energy         = ( diff_square << ACTIVITY_CLASSIFIER_SHIFT ) / ( uint32_t )( n - 1 );
+    features->zero_crossings = ( nb_crossings * ACTIVITY_CLASSIFIER_ZC_WINDOW ) / nb_samples;
+}
+
+activity_t activity_classifier_classify( const activity_features_t* features )
+{
+    if( features->variance < ACTIVITY_CLASSIFIER_STILL_VARIANCE )
+    {
+        return ACTIVITY_STATIONARY;
+    }
+
+    if( ( features->zero_crossings >= ACTIVITY_CLASSIFIER_WALK_ZC_MIN ) &&
+        ( features->zero_crossings <= ACTIVITY_CLASSIFIER_WALK_ZC_MAX ) )
+    {
+        if( ( features->variance >= ACTIVITY_CLASSIFIER_WALK_VARIANCE ) &&
+            ( ( features->energy * ACTIVITY_CLASSIFIER_WALK_ENERGY_DEN ) <=
+              ( features->variance * ACTIVITY_CLASSIFIER_WALK_ENERGY_NUM ) ) )
+        {
+            return ACTIVITY_WALKING;
+        }
+
+        if( ( features->variance >= ACTIVITY_CLASSIFIER_SLOW_WALK_VARIANCE ) &&
+            ( ( features->energy * ACTIVITY_CLASSIFIER_SLOW_WALK_ENERGY_DEN ) <=
+              ( features->variance * ACTIVITY_CLASSIFIER_SLOW_WALK_ENERGY_NUM ) ) )
+        {
+            return ACTIVITY_WALKING;
+        }
+    }
+
+    /* Moving but not walking: vibrations and accelerations of a vehicle */
+    return ACTIVITY_VEHICLE;
+}
+
+const char* activity_classifier_get_name( const activity_t activity )
+{
+    if( activity >= ACTIVITY_NB )
+    {
+        return activity_classifier_names[ACTIVITY_UNKNOWN];
+    }
+
+    return activity_classifier_names[activity];
+}
+
+void activity_classifier_get_stats( activity_classifier_stats_t* stats ) { *stats = activity_classifier_stats; }
+
+void activity_classifier_reset( void )
+{
+    activity_classifier_current         = ACTIVITY_UNKNOWN;
+    activity_classifier_candidate       = ACTIVITY_UNKNOWN;
+    activity_classifier_candidate_count = 0;
+    activity_classifier_updated         = false;
+    memset( &activity_classifier_stats, 0, sizeof( activity_classifier_stats ) );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+/* --- EOF ------------------------------------------------------------------ */
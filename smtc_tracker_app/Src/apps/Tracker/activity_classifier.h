@@ -0,0 +1,184 @@
+/*!
+ * \file      activity_classifier.h
+ *
+ * \brief     Activity classifier on the accelerometer FIFO batches definition
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ACTIVITY_CLASSIFIER_H__
+#define __ACTIVITY_CLASSIFIER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "lis2de12.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * \brief Smallest batch classified, the features of shorter windows are not reliable
+ */
+#define ACTIVITY_CLASSIFIER_MIN_WINDOW 16
+
+/*!
+ * \brief Consecutive windows of the same class before the activity changes
+ */
+#define ACTIVITY_CLASSIFIER_CONFIRM_WINDOWS 2
+
+/*!
+ * \brief Age from which the activity is unknown, the FIFO is drained every 2.4 s
+ */
+#define ACTIVITY_CLASSIFIER_MAX_AGE_S 30
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief Activities told apart
+ */
+typedef enum
+{
+    ACTIVITY_UNKNOWN = 0,
+    ACTIVITY_STATIONARY,
+    ACTIVITY_WALKING,
+    ACTIVITY_VEHICLE,
+    ACTIVITY_NB,
+} activity_t;
+
+/*!
+ * \brief Features of a window, fixed point with 4 fractional bits, 1 LSB is 16 mg
+ */
+typedef struct
+{
+    uint32_t variance;        // Sum of the variances of the 3 axes, LSB^2
+    uint32_t energy;          // Mean squared difference between consecutive samples, LSB^2
+    uint8_t  zero_crossings;  // Mean crossings of the most varying axis, per 32 samples
+} activity_features_t;
+
+/*!
+ * \brief Classifier statistics
+ */
+typedef struct
+{
+    uint32_t            nb_windows;                         // Windows classified
+    uint32_t            nb_windows_per_class[ACTIVITY_NB];  // Windows classified per class
+    uint32_t            nb_changes;                         // Confirmed activity changes
+    activity_features_t last_features;                      // Features of the last window
+} activity_classifier_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief Classifies a batch of samples and updates the current activity
+ *
+ * \remark Integer arithmetic only, about 700 cycles for a 24 samples window on the host. The module has no
+ *         hardware dependency, labelled FIFO batches are replayed through it by gcc/host/activity_classifier_replay.c
+ *
+ * \param [in] samples Samples drained from the accelerometer FIFO, oldest first
+ * \param [in] nb_samples Number of samples, windows shorter than ACTIVITY_CLASSIFIER_MIN_WINDOW are ignored
+ * \param [in] now Current time in seconds
+ *
+ * \return Class of the window, ACTIVITY_UNKNOWN if ignored
+ */
+activity_t activity_classifier_update( const acc_sample_t* samples, const uint8_t nb_samples, const uint32_t now );
+
+/*!
+ * \brief Returns the current activity, confirmed over ACTIVITY_CLASSIFIER_CONFIRM_WINDOWS windows
+ *
+ * \param [in] now Current time in seconds
+ *
+ * \return Activity, ACTIVITY_UNKNOWN if no recent window
+ */
+activity_t activity_classifier_get( const uint32_t now );
+
+/*!
+ * \brief Computes the features of a window
+ *
+ * \param [in] samples Samples, oldest first
+ * \param [in] nb_samples Number of samples, at least 2
+ * \param [out] features Features of the window \ref activity_features_t
+ */
+void activity_classifier_get_features( const acc_sample_t* samples, const uint8_t nb_samples,
+                                       activity_features_t* features );
+
+/*!
+ * \brief Classifies a window from its features
+ *
+ * \param [in] features Features of the window \ref activity_features_t
+ *
+ * \return Class of the window
+ */
+activity_t activity_classifier_classify( const activity_features_t* features );
+
+/*!
+ * \brief Returns the name of an activity, for the traces
+ *
+ * \param [in] activity Activity
+ *
+ * \return Constant string
+ */
+const char* activity_classifier_get_name( const activity_t activity );
+
+/*!
+ * \brief Returns the classifier statistics
+ *
+ * \param [out] stats Statistics \ref activity_classifier_stats_t
+ */
+void activity_classifier_get_stats( activity_classifier_stats_t* stats );
+
+/*!
+ * \brief Forgets the current activity
+ */
+void activity_classifier_reset( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __ACTIVITY_CLASSIFIER_H__
+
+/* --- EOF ------------------------------------------------------------------ */
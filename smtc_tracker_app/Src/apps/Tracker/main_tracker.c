@@ -39,9 +39,19 @@
 #include "lorawan_config.h"
 #include "lr1110_tracker_board.h"
 #include "wifi_scan.h"
+#include "wifi_channel_plan.h"
+#include "gnss_antenna.h"
+#include "gnss_almanac.h"
 #include "gnss_scan.h"
+#include "activity_classifier.h"
+#include "uplink_aggregator.h"
+#include "uplink_codec.h"
+#include "uplink_queue.h"
 #include "tracker_utility.h"
 #include "ble_thread.h"
+#include "app_conf.h"
+#include "app_entry.h"
+#include "stm32_seq.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -59,11 +69,27 @@
  */
 #define APP_TX_DUTYCYCLE_RND 1000
 
+/*!
+ * \brief Delay the LEDs may be switched off late by to share a wakeup, value in [ms]
+ */
+#define LED_TIMER_SLACK 25
+
 /*!
  * \brief Force the LoRaWAN keys writing in flash memory
  */
 #define FORCE_NEW_TRACKER_CONTEXT 0
 
+/*!
+ * \brief Energy accounting total charge increase triggering a context store, value in [uAh]
+ */
+#define ENERGY_TOTAL_CHARGE_STORE_THRESHOLD 1000
+
+/*!
+ * \brief Bytes of the next uplink not available to the Wi-Fi MAC addresses, the TAG_WIFI_SCAN TLV header and the
+ * TAG_WIFI_FINGERPRINT TLV
+ */
+#define WIFI_UPLINK_OVERHEAD 5
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -130,6 +156,31 @@ static uint32_t downlink_cnt = 0;
  */
 static uint32_t previous_modem_charge = 0;
 
+/*!
+ * \brief Energy accounting total charge when the context has been stored for the last time
+ */
+static uint32_t previous_energy_total_charge = 0;
+
+/*!
+ * \brief Interval to the next cycle in ms, decided by the scan scheduler from the motion
+ */
+static uint32_t scan_interval = TRACKER_SCAN_INTERVAL;
+
+/*!
+ * \brief Payload to be built and streamed by the uplink task
+ */
+static bool payload_pending = false;
+
+/*!
+ * \brief Keep alive status of the pending payload
+ */
+static bool payload_keep_alive_frame = false;
+
+/*!
+ * \brief The voltage went under BOARD_VOLTAGE_LOW_BATTERY, only the first cycle under it is a critical event
+ */
+static bool low_battery_reported = false;
+
 /*!
  * \brief Device states
  */
@@ -177,11 +228,37 @@ static void print_lorawan_keys( const uint8_t* dev_eui, const uint8_t* join_eui,
 static void join_network( void );
 
 /*!
- * \brief   add payload of the frame
+ * \brief   Hands the queued records to the stream while they fit, with a single stream status check
+ *
+ * \retval  [true : the stream status has been read, false : empty queue]
+ */
+static bool stream_uplink_queue( void );
+
+/*!
+ * \brief   Adds TLVs of the cycle in the aggregated record, a full record is queued for the stream
+ *
+ * \param [in] payload TLVs
+ * \param [in] len Length of the TLVs
+ */
+static void add_payload_in_aggregated_record( const uint8_t* payload, uint16_t len );
+
+/*!
+ * \brief   Pushes the aggregated record in the uplink queue
+ *
+ * \param [in] priority Priority of the record \ref uplink_queue_priority_t
+ * \param [in] supersedable The record is a position report replacing the queued ones
+ *
+ * \retval  [true : record queued, false : empty record or dropped on a full queue]
+ */
+static bool submit_aggregated_record( uplink_queue_priority_t priority, bool supersedable );
+
+/*!
+ * \brief   Called for each record dropped by the uplink queue, the state referring to it is reset
  *
- * \retval  [true : payload could be add, false : error]
+ * \param [in] record Record
+ * \param [in] len Length of the record
  */
-static bool add_payload_in_streaming_fifo( uint8_t* payload, uint16_t len );
+static void on_uplink_queue_drop( const uint8_t* record, const uint8_t len );
 
 /*!
  * \brief   Check if the next scan is possible
@@ -303,6 +380,11 @@ static void store_new_assistance_position( void );
  */
 static void store_new_acculated_charge( uint32_t modem_charge );
 
+/*!
+ * \brief Update in flash context the energy accounting running totals if they increased enough
+ */
+static void store_new_energy_total_charge( void );
+
 /*!
  * \brief Convert lr1110 modem status to string
  *
@@ -319,6 +401,13 @@ static void modem_status_to_string( lr1110_modem_status_t modem_status );
  */
 static void tracker_run_wifi_scan( wifi_settings_t wifi_settings, wifi_scan_all_result_t* wifi_result );
 
+/*!
+ * \brief Returns the number of Wi-Fi MAC addresses fitting in the next uplink
+ *
+ * \return Number of MAC addresses, WIFI_MAX_RESULT_TOTAL if the next uplink size is not known
+ */
+static uint8_t tracker_get_wifi_budget( void );
+
 /*!
  * \brief Run and call the necessary function for the GNSS scan
  *
@@ -336,9 +425,93 @@ static void tracker_run_gnss_scan( gnss_settings_t gnss_settings, antenna_t ante
                                    uint8_t* nb_detected_satellites, uint16_t* nav_message_len );
 
 /*!
- * \brief build payload in TLV format and stream it
+ * \brief Runs the GNSS scan on the antenna expected to detect the most satellites in the current orientation, and
+ * on the other antenna if too few satellites are detected
+ */
+static void tracker_run_gnss_scans( void );
+
+/*!
+ * \brief Runs the GNSS scan on an antenna
+ *
+ * \param [in] antenna GNSS antenna selection for the scan \ref antenna_t
+ *
+ * \return Number of detected satellites
+ */
+static uint8_t tracker_run_gnss_scan_on( antenna_t antenna );
+
+/*!
+ * \brief build payload in TLV format and queue it for the stream
+ *
+ * \remark The TLVs of several cycles are packed in one stream record, queued when the frame is latency critical,
+ *         the record is full or the next cycle would exceed tracker_ctx.uplink_latency_bound_s. The critical events,
+ *         motion start, almanac request and low battery, are queued with a high priority, the position reports
+ *         supersede the queued ones
+ *
+ * \param [in] keep_alive_frame the energy accounting totals are added to the keep alive frames
+ */
+static void build_and_stream_payload( bool keep_alive_frame );
+
+/*!
+ * \brief Modem task, processes the LR1110 modem events, posted by the event line interrupt
  */
-static void build_and_stream_payload( void );
+static void tracker_modem_event_task( void );
+
+/*!
+ * \brief Scan task, runs the Wi-Fi and GNSS scans, posted by the modem alarm or a motion in static mode
+ */
+static void tracker_scan_task( void );
+
+/*!
+ * \brief Sensors task, collects the sensors data once the scans are done
+ */
+static void tracker_sensors_task( void );
+
+/*!
+ * \brief Persistence task, updates the flash context and the internal log with the collected data
+ */
+static void tracker_store_task( void );
+
+/*!
+ * \brief Uplink task, streams the collected data and schedules the next cycle
+ */
+static void tracker_uplink_task( void );
+
+/*!
+ * \brief BLE task, starts the BLE thread on a user button or hall effect interrupt
+ */
+static void tracker_ble_task( void );
+
+/*!
+ * \brief Motion task, drains the accelerometer FIFO on a watermark and leaves the static mode on a motion
+ */
+static void tracker_motion_task( void );
+
+/*!
+ * \brief Ends the current cycle and sets the LR1110 modem alarm to the next one
+ */
+static void tracker_schedule_next_cycle( void );
+
+/*!
+ * \brief Decides the interval to the next cycle from the motion and the hourly charge budget
+ *
+ * \param [in] moved Motion detected during the cycle
+ * \param [in] scanned A scan is run during the cycle
+ */
+static void tracker_update_scan_interval( bool moved, bool scanned );
+
+/*!
+ * \brief Returns the longest interval between two cycles, the software watchdog is set from it
+ *
+ * \retval Interval in ms
+ */
+static uint32_t tracker_get_max_scan_interval( void );
+
+/*!
+ * \brief Changes the device state, the MCU residency is broken down per device state
+ *
+ * \param [in] state New device state
+ */
+static void tracker_set_device_state( enum edevice_state state );
 
 /*
  * -----------------------------------------------------------------------------
@@ -425,6 +598,7 @@ int main( void )
         memcpy( join_eui, tracker_ctx.join_eui, LORAWAN_JOIN_EUI_LEN );
         memcpy( app_key, tracker_ctx.app_key, LORAWAN_APP_KEY_LEN );
     }
+    previous_energy_total_charge = hal_energy_get_total_charge( );
 
     /* Basic LoRaWAN configuration */
     if( lorawan_init( tracker_ctx.lorawan_region ) != LR1110_MODEM_RESPONSE_CODE_OK )
@@ -450,6 +624,9 @@ int main( void )
     tracker_ctx.stream_done                = true;
     tracker_ctx.voltage                    = hal_mcu_get_vref_level( );
 
+    /* Init the uplink queue, a dropped record resets the compression and fingerprint states */
+    uplink_queue_init( on_uplink_queue_drop );
+
     /* Check if the voltage is too low, if yes switch the tracker in airplane mode */
     if( tracker_ctx.voltage < BOARD_VOLTAGE_THRESHOLD )
     {
@@ -458,343 +635,572 @@ int main( void )
     }
 
     /* Init the software watchdog */
-    hal_mcu_init_software_watchdog( tracker_ctx.app_scan_interval * 3 );
+    scan_interval = tracker_ctx.app_scan_interval;
+    hal_mcu_init_software_watchdog( tracker_get_max_scan_interval( ) * 3 );
 
     /* Init Leds timer */
     timer_init( &led_tx_timer, on_led_tx_timer_event );
     timer_set_value( &led_tx_timer, 25 );
+    timer_set_slack( &led_tx_timer, LED_TIMER_SLACK );
     timer_init( &led_rx_timer, on_led_rx_timer_event );
     timer_set_value( &led_rx_timer, 25 );
+    timer_set_slack( &led_rx_timer, LED_TIMER_SLACK );
+
+    /* Register the tracker tasks, posted from the interrupts and run by the sequencer */
+    UTIL_SEQ_RegTask( 1 << CFG_TASK_TRACKER_MODEM_EVT_ID, UTIL_SEQ_RFU, tracker_modem_event_task );
+    UTIL_SEQ_RegTask( 1 << CFG_TASK_TRACKER_SCAN_ID, UTIL_SEQ_RFU, tracker_scan_task );
+    UTIL_SEQ_RegTask( 1 << CFG_TASK_TRACKER_SENSORS_ID, UTIL_SEQ_RFU, tracker_sensors_task );
+    UTIL_SEQ_RegTask( 1 << CFG_TASK_TRACKER_STORE_ID, UTIL_SEQ_RFU, tracker_store_task );
+    UTIL_SEQ_RegTask( 1 << CFG_TASK_TRACKER_UPLINK_ID, UTIL_SEQ_RFU, tracker_uplink_task );
+    UTIL_SEQ_RegTask( 1 << CFG_TASK_TRACKER_BLE_ID, UTIL_SEQ_RFU, tracker_ble_task );
+    UTIL_SEQ_RegTask( 1 << CFG_TASK_TRACKER_MOTION_ID, UTIL_SEQ_RFU, tracker_motion_task );
+    UTIL_SEQ_RegTask( 1 << CFG_TASK_TRACKER_ALMANAC_ID, UTIL_SEQ_RFU, tracker_almanac_update_task );
 
     /* Start BLE advertisement for 30s */
     start_ble_thread( ADV_TIMEOUT_MS );
 
     /* set the watchdog to the right value for application operation */
-    hal_mcu_set_software_watchdog_value( tracker_ctx.app_scan_interval * 3 );
+    hal_mcu_set_software_watchdog_value( tracker_get_max_scan_interval( ) * 3 );
     hal_mcu_start_software_watchdog( );
 
+    /* Process the events raised by the modem while the BLE thread was running */
+    lr1110_modem_event_process( &lr1110 );
+
+    tracker_set_device_state( DEVICE_STATE_INIT );
+
+    HAL_DBG_TRACE_INFO( "###### ===== LR1110 MODEM INIT ==== ######\r\n\r\n" );
+
+    if( tracker_ctx.use_semtech_join_server == true )
+    {
+        modem_response_code = lr1110_modem_derive_keys( &lr1110 );
+    }
+    else
+    {
+        modem_response_code = lr1110_modem_set_app_key( &lr1110, app_key );
+    }
+
+    if( modem_response_code != LR1110_MODEM_RESPONSE_CODE_OK )
+    {
+        HAL_DBG_TRACE_ERROR( "###### ===== LR1110 MODEM INIT ERROR ==== ######\r\n\r\n" );
+    }
+
+    tracker_set_device_state( DEVICE_STATE_JOIN );
+
+    /* Display used keys */
+    print_lorawan_keys( dev_eui, join_eui, app_key, tracker_ctx.lorawan_pin );
+
+    if( tracker_ctx.airplane_mode == false )
+    {
+        join_network( );
+    }
+    else
+    {
+        HAL_DBG_TRACE_MSG( "TRACKER IN AIRPLANE MODE\r\n\r\n" );
+    }
+
+    /* From now on everything is done by the tracker tasks, the LR1110 modem alarm posts the scan task */
+    tracker_schedule_next_cycle( );
+
     while( 1 )
     {
-        /* Process Event */
-        if( lr1110.event.callback != NULL )
+        /* Run the posted tasks, the sequencer calls APPE_Idle when none is left */
+        UTIL_SEQ_Run( UTIL_SEQ_DEFAULT );
+    }
+}
+
+void hal_gpio_irq_notify( const hal_gpio_pin_names_t pin )
+{
+    switch( pin )
+    {
+    case RADIO_EVENT:
+        UTIL_SEQ_SetTask( 1 << CFG_TASK_TRACKER_MODEM_EVT_ID, CFG_SCH_PRIO_0 );
+        break;
+    case USER_BUTTON:
+    case EFFECT_HALL_OUT:
+        UTIL_SEQ_SetTask( 1 << CFG_TASK_TRACKER_BLE_ID, CFG_SCH_PRIO_1 );
+        break;
+    case ACC_INT1:
+        UTIL_SEQ_SetTask( 1 << CFG_TASK_TRACKER_MOTION_ID, CFG_SCH_PRIO_1 );
+        break;
+    default:
+        break;
+    }
+}
+
+void APPE_Idle( void )
+{
+    /* Called with the interrupts disabled, a task posted meanwhile is kept pending and wakes up the MCU */
+    if( lr1110_modem_board_read_event_line( &lr1110 ) == true )
+    {
+        /* The event line rose before its interrupt was enabled, no edge will come */
+        UTIL_SEQ_SetTask( 1 << CFG_TASK_TRACKER_MODEM_EVT_ID, CFG_SCH_PRIO_0 );
+    }
+    else
+    {
+        hal_mcu_low_power_handler( );
+    }
+}
+
+void _Error_Handler( int line )
+{
+    /* USER CODE BEGIN Error_Handler_Debug */
+    /* User can add his own implementation to report the HAL error return state */
+    HAL_DBG_TRACE_ERROR( "Error Handler : %s\n", __FUNCTION__ );
+
+    // reset the board
+    hal_mcu_reset( );
+    /* USER CODE END Error_Handler_Debug */
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void tracker_modem_event_task( void ) { lr1110_modem_event_process( &lr1110 ); }
+
+static void tracker_scan_task( void )
+{
+    bool       moved    = false;
+    activity_t activity = ACTIVITY_UNKNOWN;
+    bool       gnss_scan;
+
+    tracker_set_device_state( DEVICE_COLLECT_DATA );
+
+    /* Create a movevment history on 8 bits, updated while the stream is busy as the records wait in the queue */
+    moved                                  = is_accelerometer_detected_moved( );
+    tracker_ctx.accelerometer_move_history = ( tracker_ctx.accelerometer_move_history << 1 ) + moved;
+
+    /* Check if scan can be launched */
+    if( is_next_scan_possible( ) == true )
+    {
+        lr1110_modem_adr_profiles_t adr_profile;
+
+        tracker_update_scan_interval( moved, true );
+
+        /* Reload the software watchdog */
+        hal_mcu_reset_software_watchdog( );
+
+        /* Adapt the ADR following the acceleromer movement */
+        if( tracker_ctx.send_alive_frame == true ) // means device is static
         {
-            lr1110_modem_event_process( &lr1110 );
+            lr1110_modem_get_adr_profile ( &lr1110, &adr_profile );
+            if( adr_profile != LR1110_MODEM_ADR_PROFILE_NETWORK_SERVER_CONTROLLED )
+            {
+                HAL_DBG_TRACE_MSG( "Set ADR to LR1110_MODEM_ADR_PROFILE_NETWORK_SERVER_CONTROLLED\n\r\n\r" );
+                lr1110_modem_set_adr_profile( &lr1110, LR1110_MODEM_ADR_PROFILE_NETWORK_SERVER_CONTROLLED, adr_custom_list );
+            }
         }
-
-        switch( device_state )
+        else // means device is mobile
         {
-            case DEVICE_STATE_INIT:
+            lr1110_modem_get_adr_profile ( &lr1110, &adr_profile );
+            if( adr_profile != tracker_ctx.lorawan_adr_profile )
             {
-                HAL_DBG_TRACE_INFO( "###### ===== LR1110 MODEM INIT ==== ######\r\n\r\n" );
+                HAL_DBG_TRACE_PRINTF( "Set ADR to %d\n\r\n\r", tracker_ctx.lorawan_adr_profile );
+                lr1110_modem_set_adr_profile( &lr1110, ( lr1110_modem_adr_profiles_t ) tracker_ctx.lorawan_adr_profile, adr_custom_list );
+            }
+        }
 
-                if( tracker_ctx.use_semtech_join_server == true )
-                {
-                    modem_response_code = lr1110_modem_derive_keys( &lr1110 );
-                }
-                else
-                {
-                    modem_response_code = lr1110_modem_set_app_key( &lr1110, app_key );
-                }
+        /* Led start for user notification */
+        leds_on( LED_TX_MASK );
+        timer_start( &led_tx_timer );
 
-                device_state = DEVICE_STATE_JOIN;
+        /* Start Hall Effect sensors while the tracker moves */
+        lr1110_modem_board_hall_effect_enable( true );
 
-                break;
-            }
+        /* Activate the partial low power mode */
+        hal_mcu_partial_sleep_enable( true );
+
+        /* The payload built by the uplink task tells if it is a keep alive frame */
+        payload_keep_alive_frame = tracker_ctx.send_alive_frame;
+
+        /* Reset flag and counter */
+        tracker_ctx.send_alive_frame = false;
+        tracker_ctx.next_frame_ctn   = 0;
+
+        /* Scans picked from the activity: Wi-Fi while walking, GNSS in a vehicle, none when parked. The keep alive
+         * frames keep both */
+        if( ( ( tracker_ctx.scan_policy.flags & TRACKER_SCHEDULER_ACTIVITY_SCAN ) != 0 ) &&
+            ( payload_keep_alive_frame == false ) )
+        {
+            activity = activity_classifier_get( hal_rtc_get_time_s( ) );
+            HAL_DBG_TRACE_PRINTF( "Activity : %s\r\n", activity_classifier_get_name( activity ) );
+        }
+
+        /*  WIFI SCAN */
+        tracker_ctx.wifi_fingerprint.valid      = false;
+        tracker_ctx.wifi_fingerprint.same_place = false;
+        if( ( tracker_ctx.wifi_settings.enabled == true ) && ( activity != ACTIVITY_STATIONARY ) &&
+            ( activity != ACTIVITY_VEHICLE ) )
+        {
+            HAL_DBG_TRACE_INFO( "*** Wi-Fi Scan *** \n\r\n\r" );
 
-            case DEVICE_STATE_JOIN:
+            tracker_run_wifi_scan( tracker_ctx.wifi_settings, &tracker_ctx.wifi_result );
+
+            /* Compare with the places already uplinked */
+            wifi_fingerprint_match( &tracker_ctx.wifi_result, &tracker_ctx.wifi_fingerprint );
+        }
+
+        /*  GNSS SCAN */
+        switch( activity )
+        {
+        case ACTIVITY_STATIONARY:
+            gnss_scan = false;
+            break;
+        case ACTIVITY_WALKING:
+            /* Outdoors when no access point is seen */
+            gnss_scan = ( tracker_ctx.wifi_result.nbr_results == 0 );
+            break;
+        case ACTIVITY_VEHICLE:
+            gnss_scan = true;
+            break;
+        default:
+            gnss_scan = ( tracker_ctx.gnss_scan_if_wifi_not_good_enough == false ) ||
+                        ( ( tracker_ctx.gnss_scan_if_wifi_not_good_enough == true ) &&
+                          ( tracker_ctx.wifi_result.nbr_results < 6 ) );
+            break;
+        }
+        if( gnss_scan == true )
+        {
+            if( tracker_ctx.gnss_settings.enabled == true )
             {
-                /* Display used keys */
-                print_lorawan_keys( dev_eui, join_eui, app_key, tracker_ctx.lorawan_pin );
+                HAL_DBG_TRACE_INFO( "*** Gnss Scan ***\n\r\n\r" );
 
-                if( tracker_ctx.airplane_mode == false )
+                /* Check if a new assistance position is available */
+                store_new_assistance_position( );
+
+                if( tracker_ctx.has_date == true )
                 {
-                    join_network( );
+                    /* Timestamp scan */
+                    tracker_ctx.timestamp = lr1110_modem_board_get_systime_from_gps( &lr1110 );
+
+                    if( ( tracker_ctx.gnss_antenna_sel & ( GNSS_PATCH_ANTENNA | GNSS_PCB_ANTENNA ) ) != 0 )
+                    {
+                        tracker_run_gnss_scans( );
+                    }
                 }
                 else
                 {
-                    HAL_DBG_TRACE_MSG( "TRACKER IN AIRPLANE MODE\r\n\r\n" );
+                    HAL_DBG_TRACE_MSG( "Wait application layer clock synchronisation\r\n\r\n" );
                 }
+            }
+        }
+        else if( activity != ACTIVITY_UNKNOWN )
+        {
+            HAL_DBG_TRACE_PRINTF( "Activity %s, don't perform GNSS scan\n\r",
+                                  activity_classifier_get_name( activity ) );
+        }
+        else
+        {
+            HAL_DBG_TRACE_MSG( "Wi-Fi Scan result good enough, don't perform GNSS scan\n\r" );
+        }
 
-                device_state = DEVICE_STATE_CYCLE;
+        /* Deactivate the partial low power mode */
+        hal_mcu_partial_sleep_enable( false );
 
-                break;
+        UTIL_SEQ_SetTask( 1 << CFG_TASK_TRACKER_SENSORS_ID, CFG_SCH_PRIO_1 );
+    }
+    else
+    {
+        if( tracker_ctx.stream_done == true )
+        {
+            tracker_update_scan_interval( moved, false );
+
+            /* Stop Hall Effect sensors while the tracker is static */
+            lr1110_modem_board_hall_effect_enable( false );
+
+            if( tracker_ctx.next_frame_ctn >=
+                ( tracker_ctx.app_keep_alive_frame_interval / tracker_ctx.app_scan_interval ) )
+            {
+                HAL_DBG_TRACE_INFO( "Send an alive frame\r\n" );
+                tracker_ctx.send_alive_frame = true;
             }
-            case DEVICE_COLLECT_DATA:
+            else
             {
-                /* Create a movevment history on 8 bits and update this value only if the stream is done */
-                if( tracker_ctx.stream_done == true )
-                {
-                    tracker_ctx.accelerometer_move_history =
-                        ( tracker_ctx.accelerometer_move_history << 1 ) + is_accelerometer_detected_moved( );
-                }
+                HAL_DBG_TRACE_PRINTF(
+                    "Device is static next keep alive frame in %d sec\r\n",
+                    ( ( tracker_ctx.app_keep_alive_frame_interval / tracker_ctx.app_scan_interval ) -
+                      tracker_ctx.next_frame_ctn ) *
+                        ( tracker_ctx.app_scan_interval / 1000 ) );
+                tracker_ctx.next_frame_ctn++;
+            }
 
-                /* Check if scan can be launched */
-                if( is_next_scan_possible( ) == true )
-                {
-                    lr1110_modem_adr_profiles_t adr_profile;
+            tracker_schedule_next_cycle( );
+        }
+        else
+        {
+            /* Previous payload still streaming */
+            UTIL_SEQ_SetTask( 1 << CFG_TASK_TRACKER_UPLINK_ID, CFG_SCH_PRIO_1 );
+        }
+    }
+}
 
-                    /* Reload the software watchdog */
-                    hal_mcu_reset_software_watchdog( );
+static void tracker_sensors_task( void )
+{
+    timer_stats_t               timer_stats;
+    wifi_fingerprint_stats_t    wifi_fingerprint_stats;
+    gnss_antenna_stats_t        gnss_antenna_stats;
+    tracker_scheduler_stats_t   scheduler_stats;
+    acc_fifo_stats_t            acc_fifo_stats;
+    activity_classifier_stats_t activity_stats;
+
+    /*  SENSORS DATA */
+    HAL_DBG_TRACE_INFO( "*** sensors collect ***\n\r\n\r" );
+
+    /* Acceleration and temperature, read together from the accelerometer */
+    acc_read_sensors( &tracker_ctx.tout );
+    tracker_ctx.accelerometer_x = acc_get_raw_x( );
+    tracker_ctx.accelerometer_y = acc_get_raw_y( );
+    tracker_ctx.accelerometer_z = acc_get_raw_z( );
+    HAL_DBG_TRACE_PRINTF( "Acceleration [mg]: X=%d mg | Y=%d mg | Z=%d mg \r\n",
+                          tracker_ctx.accelerometer_x, tracker_ctx.accelerometer_y,
+                          tracker_ctx.accelerometer_z );
+
+    /* Move history */
+    HAL_DBG_TRACE_PRINTF( "Move history : %d\r\n", tracker_ctx.accelerometer_move_history );
+
+    /* Temperature */
+    HAL_DBG_TRACE_PRINTF( "Temperature : %d *C\r\n", tracker_ctx.tout/100 );
+
+    /* Hall Effect */
+    tracker_ctx.dry_contact = read_hall_effect_output( );
+    HAL_DBG_TRACE_PRINTF( "Hall Effect ouput : %d\r\n", tracker_ctx.dry_contact );
+
+    /* Modem charge */
+    lr1110_modem_get_charge( &lr1110, &tracker_ctx.charge );
+    HAL_DBG_TRACE_PRINTF( "Charge value : %d mAh\r\n", tracker_ctx.charge );
+
+    /* Energy accounting of the cycle */
+    hal_energy_update_modem_charge( tracker_ctx.charge );
+    hal_energy_close_cycle( );
+    hal_energy_print_report( );
+
+    /* Timer wakeups */
+    timer_get_stats( &timer_stats );
+    HAL_DBG_TRACE_PRINTF( "Timer wakeups : %u, expiries : %u, wakeups saved : %u\r\n", timer_stats.wakeups,
+                          timer_stats.expiries, timer_stats.wakeups_saved );
+    HAL_DBG_TRACE_PRINTF( "Timer wakeups last hour : %u, max per hour : %u\r\n", timer_stats.wakeups_last_hour,
+                          timer_stats.wakeups_max_per_hour );
+    hal_residency_print_report( );
+    hal_mcu_print_clock_profile_stats( );
+#if( HAL_PROFILING == HAL_FEATURE_ON )
+    hal_mcu_print_wake_stats( );
+#endif
+    wifi_fingerprint_get_stats( &wifi_fingerprint_stats );
+    HAL_DBG_TRACE_PRINTF( "Wi-Fi fingerprints : %u scans, %u same place, %u new\r\n", wifi_fingerprint_stats.nb_scans,
+                          wifi_fingerprint_stats.nb_matches, wifi_fingerprint_stats.nb_new );
+    tracker_scheduler_get_stats( &scheduler_stats );
+    HAL_DBG_TRACE_PRINTF( "Scan scheduler : %u cycles, %u throttled, motion fixes %u, denied %u, %u uAh this hour\r\n",
+                          scheduler_stats.nb_cycles, scheduler_stats.nb_throttled, scheduler_stats.nb_motion_fixes,
+                          scheduler_stats.nb_motion_fixes_denied, scheduler_stats.hour_charge_uah );
+    acc_fifo_get_stats( &acc_fifo_stats );
+    HAL_DBG_TRACE_PRINTF( "Accelerometer FIFO : %u interrupts, %u drains, %u samples, %u overruns\r\n",
+                          acc_fifo_stats.nb_irq, acc_fifo_stats.nb_drains, acc_fifo_stats.nb_samples,
+                          acc_fifo_stats.nb_overruns );
+    activity_classifier_get_stats( &activity_stats );
+    HAL_DBG_TRACE_PRINTF( "Activity : %u windows, stationary %u, walking %u, vehicle %u, %u changes\r\n",
+                          activity_stats.nb_windows, activity_stats.nb_windows_per_class[ACTIVITY_STATIONARY],
+                          activity_stats.nb_windows_per_class[ACTIVITY_WALKING],
+                          activity_stats.nb_windows_per_class[ACTIVITY_VEHICLE], activity_stats.nb_changes );
+    HAL_DBG_TRACE_PRINTF( "Activity last window : variance %u, energy %u (1/16 LSB^2), %u crossings\r\n",
+                          activity_stats.last_features.variance, activity_stats.last_features.energy,
+                          activity_stats.last_features.zero_crossings );
+    gnss_antenna_get_stats( &gnss_antenna_stats );
+    HAL_DBG_TRACE_PRINTF( "GNSS antenna selections : %u, patch first : %u, PCB first : %u\r\n",
+                          gnss_antenna_stats.nb_selections, gnss_antenna_stats.nb_patch_first,
+                          gnss_antenna_stats.nb_pcb_first );
+    HAL_DBG_TRACE_PRINTF( "GNSS antenna explorations : %u, fallbacks : %u, scans saved : %u\r\n",
+                          gnss_antenna_stats.nb_explorations, gnss_antenna_stats.nb_fallbacks,
+                          gnss_antenna_stats.nb_scans_saved );
+
+    /* Board voltage charge */
+    tracker_ctx.voltage = hal_mcu_get_vref_level( );
+    HAL_DBG_TRACE_PRINTF( "Board voltage : %d mV\r\n", tracker_ctx.voltage );
+
+    UTIL_SEQ_SetTask( 1 << CFG_TASK_TRACKER_STORE_ID, CFG_SCH_PRIO_1 );
+}
 
-                    /* Adapt the ADR following the acceleromer movement */
-                    if( tracker_ctx.send_alive_frame == true ) // means device is static
-                    {
-                        lr1110_modem_get_adr_profile ( &lr1110, &adr_profile );
-                        if( adr_profile != LR1110_MODEM_ADR_PROFILE_NETWORK_SERVER_CONTROLLED )
-                        {
-                            HAL_DBG_TRACE_MSG( "Set ADR to LR1110_MODEM_ADR_PROFILE_NETWORK_SERVER_CONTROLLED\n\r\n\r" );
-                            lr1110_modem_set_adr_profile( &lr1110, LR1110_MODEM_ADR_PROFILE_NETWORK_SERVER_CONTROLLED, adr_custom_list );
-                        }
-                    }
-                    else // means device is mobile
-                    {
-                        lr1110_modem_get_adr_profile ( &lr1110, &adr_profile );
-                        if( adr_profile != tracker_ctx.lorawan_adr_profile )
-                        {
-                            HAL_DBG_TRACE_PRINTF( "Set ADR to %d\n\r\n\r", tracker_ctx.lorawan_adr_profile );
-                            lr1110_modem_set_adr_profile( &lr1110, ( lr1110_modem_adr_profiles_t ) tracker_ctx.lorawan_adr_profile, adr_custom_list );
-                        }
-                    }
+static void tracker_store_task( void )
+{
+    store_new_acculated_charge( tracker_ctx.charge );
+    HAL_DBG_TRACE_PRINTF( "Accumulated charge value : %d mAh\r\n", tracker_ctx.accumulated_charge );
 
-                    /* Led start for user notification */
-                    leds_on( LED_TX_MASK );
-                    timer_start( &led_tx_timer );
+    store_new_energy_total_charge( );
 
-                    /* Start Hall Effect sensors while the tracker moves */
-                    lr1110_modem_board_hall_effect_enable( true );
+    /* Nothing new to log when only the APs of a place already logged were heard */
+    if( ( tracker_ctx.internal_log_enable ) && ( ( tracker_ctx.wifi_fingerprint.same_place == false ) ||
+                                                 ( tracker_ctx.patch_nb_detected_satellites > 2 ) ||
+                                                 ( tracker_ctx.pcb_nb_detected_satellites > 2 ) ) )
+    {
+        // Short CPU and flash bound burst, encoded and written faster at a higher clock
+        hal_mcu_clock_profile_t clock_profile = hal_mcu_set_clock_profile( HAL_MCU_CLOCK_PROFILE_BOOST );
+        tracker_store_internal_log( );
+        hal_mcu_set_clock_profile( clock_profile );
+        HAL_DBG_TRACE_PRINTF( "Internal Log memory space remaining: %d %%\r\n", tracker_get_remaining_memory_space( ) );
+    }
 
-                    /* Activate the partial low power mode */
-                    hal_mcu_partial_sleep_enable( true );
+    payload_pending = true;
+    UTIL_SEQ_SetTask( 1 << CFG_TASK_TRACKER_UPLINK_ID, CFG_SCH_PRIO_1 );
+}
 
-                    /* Reset flag and counter */
-                    tracker_ctx.send_alive_frame = false;
-                    tracker_ctx.next_frame_ctn   = 0;
+static void tracker_uplink_task( void )
+{
+    bool stream_status_read;
 
-                    /*  WIFI SCAN */
-                    if( tracker_ctx.wifi_settings.enabled == true )
-                    {
-                        HAL_DBG_TRACE_INFO( "*** Wi-Fi Scan *** \n\r\n\r" );
+    tracker_set_device_state( DEVICE_STATE_SEND );
 
-                        tracker_run_wifi_scan( tracker_ctx.wifi_settings, &tracker_ctx.wifi_result );
-                    }
+    if( payload_pending == true )
+    {
+        payload_pending = false;
 
-                    /*  GNSS SCAN */
-                    if( ( tracker_ctx.gnss_scan_if_wifi_not_good_enough == false ) || 
-                        ( ( tracker_ctx.gnss_scan_if_wifi_not_good_enough == true ) && ( tracker_ctx.wifi_result.nbr_results < 6 ) ) )
-                    {
-                        if( tracker_ctx.gnss_settings.enabled == true )
-                        {
-                            HAL_DBG_TRACE_INFO( "*** Gnss Scan ***\n\r\n\r" );
-
-                            /* Check if a new assistance position is available */
-                            store_new_assistance_position( );
-
-                            if( tracker_ctx.has_date == true )
-                            {
-                                /* Timestamp scan */
-                                tracker_ctx.timestamp = lr1110_modem_board_get_systime_from_gps( &lr1110 );
-
-                                if( ( tracker_ctx.gnss_antenna_sel & GNSS_PATCH_ANTENNA ) == GNSS_PATCH_ANTENNA )
-                                {
-                                    tracker_run_gnss_scan(
-                                        tracker_ctx.gnss_settings, GNSS_PATCH_ANTENNA, tracker_ctx.patch_nav_message,
-                                        &tracker_ctx.patch_nb_detected_satellites, &tracker_ctx.patch_nav_message_len );
-                                }
-
-                                if( ( tracker_ctx.gnss_antenna_sel & GNSS_PCB_ANTENNA ) == GNSS_PCB_ANTENNA )
-                                {
-                                    tracker_run_gnss_scan(
-                                        tracker_ctx.gnss_settings, GNSS_PCB_ANTENNA, tracker_ctx.pcb_nav_message,
-                                        &tracker_ctx.pcb_nb_detected_satellites, &tracker_ctx.pcb_nav_message_len );
-                                }
-                            }
-                            else
-                            {
-                                HAL_DBG_TRACE_MSG( "Wait application layer clock synchronisation\r\n\r\n" );
-                            }
-                        }
-                    }
-                    else
-                    {
-                        HAL_DBG_TRACE_MSG( "Wi-Fi Scan result good enough, don't perform GNSS scan\n\r" );
-                    }
+        /* Build the payload and queue it */
+        build_and_stream_payload( payload_keep_alive_frame );
+    }
 
-                    /* Deactivate the partial low power mode */
-                    hal_mcu_partial_sleep_enable( false );
-
-                    /*  SENSORS DATA */
-                    HAL_DBG_TRACE_INFO( "*** sensors collect ***\n\r\n\r" );
-                    
-                    /* Acceleration */
-                    acc_read_raw_data( );
-                    tracker_ctx.accelerometer_x = acc_get_raw_x( );
-                    tracker_ctx.accelerometer_y = acc_get_raw_y( );
-                    tracker_ctx.accelerometer_z = acc_get_raw_z( );
-                    HAL_DBG_TRACE_PRINTF( "Acceleration [mg]: X=%4.2f mg | Y=%4.2f mg | Z=%4.2f mg \r\n",
-                                          ( double ) tracker_ctx.accelerometer_x,
-                                          ( double ) tracker_ctx.accelerometer_y,
-                                          ( double ) tracker_ctx.accelerometer_z );
-
-                    /* Move history */
-                    HAL_DBG_TRACE_PRINTF( "Move history : %d\r\n", tracker_ctx.accelerometer_move_history );
-
-                    /* Temperature */
-                    tracker_ctx.tout = acc_get_temperature( );
-                    HAL_DBG_TRACE_PRINTF( "Temperature : %d *C\r\n", tracker_ctx.tout/100 );
-
-                    /* Hall Effect */
-                    tracker_ctx.dry_contact = read_hall_effect_output( );
-                    HAL_DBG_TRACE_PRINTF( "Hall Effect ouput : %d\r\n", tracker_ctx.dry_contact );
-
-                    /* Modem charge */
-                    lr1110_modem_get_charge( &lr1110, &tracker_ctx.charge );
-                    HAL_DBG_TRACE_PRINTF( "Charge value : %d mAh\r\n", tracker_ctx.charge );
-                    store_new_acculated_charge( tracker_ctx.charge );
-                    HAL_DBG_TRACE_PRINTF( "Accumulated charge value : %d mAh\r\n", tracker_ctx.accumulated_charge );
-                        
-                    /* Board voltage charge */
-                    tracker_ctx.voltage = hal_mcu_get_vref_level( );
-                    HAL_DBG_TRACE_PRINTF( "Board voltage : %d mV\r\n", tracker_ctx.voltage );
-
-                    if( tracker_ctx.internal_log_enable )
-                    {
-                        tracker_store_internal_log( );
-                        HAL_DBG_TRACE_PRINTF( "Internal Log memory space remaining: %d %%\r\n", tracker_get_remaining_memory_space( ) );
-                    }
+    /* Stream the queued records, the stream status is read only once */
+    stream_status_read = stream_uplink_queue( );
+    if( ( tracker_ctx.stream_done == false ) && ( stream_status_read == false ) )
+    {
+        lr1110_modem_stream_status_t stream_status;
 
-                    /* Build the payload and stream it */
-                    build_and_stream_payload( );
+        /* Stream previous payload if it's not terminated */
+        lr1110_modem_stream_status( &lr1110, LORAWAN_STREAM_APP_PORT, &stream_status );
+        HAL_DBG_TRACE_PRINTF( "Streaming ongoing %d bytes remaining %d bytes free \r\n", stream_status.pending,
+                              stream_status.free );
+    }
 
-                    device_state = DEVICE_STATE_SEND;
-                }
-                else
-                {
-                    if( tracker_ctx.stream_done == true )
-                    {
-                        /* Stop Hall Effect sensors while the tracker is static */
-                        lr1110_modem_board_hall_effect_enable( false );
-
-                        if( tracker_ctx.next_frame_ctn >=
-                            ( tracker_ctx.app_keep_alive_frame_interval / tracker_ctx.app_scan_interval ) )
-                        {
-                            HAL_DBG_TRACE_INFO( "Send an alive frame\r\n" );
-                            tracker_ctx.send_alive_frame = true;
-                        }
-                        else
-                        {
-                            HAL_DBG_TRACE_PRINTF(
-                                "Device is static next keep alive frame in %d sec\r\n",
-                                ( ( tracker_ctx.app_keep_alive_frame_interval / tracker_ctx.app_scan_interval ) -
-                                  tracker_ctx.next_frame_ctn ) *
-                                    ( tracker_ctx.app_scan_interval / 1000 ) );
-                            tracker_ctx.next_frame_ctn++;
-                        }
-                        device_state = DEVICE_STATE_CYCLE;
-                    }
-                    else
-                    {
-                        device_state = DEVICE_STATE_SEND;
-                    }
-                }
-                
-                break;
-            }
-            case DEVICE_STATE_SEND:
-            {
-                if( tracker_ctx.stream_done == false )
-                {
-                    lr1110_modem_stream_status_t stream_status;
+    tracker_schedule_next_cycle( );
+}
 
-                    /* Stream previous payload if it's not terminated */
-                    lr1110_modem_stream_status( &lr1110, LORAWAN_STREAM_APP_PORT, &stream_status );
-                    HAL_DBG_TRACE_PRINTF( "Streaming ongoing %d bytes remaining %d bytes free \r\n",
-                                          stream_status.pending, stream_status.free );
-                }
+static void tracker_ble_task( void )
+{
+    /* The BLE thread is started between two cycles only, tracker_schedule_next_cycle posts this task again */
+    if( device_state != DEVICE_STATE_SLEEP )
+    {
+        return;
+    }
 
-                device_state = DEVICE_STATE_CYCLE;
+    if( ( get_hall_effect_irq_state( ) == true ) || ( get_usr_button_irq_state( ) == true ) )
+    {
+        clear_usr_button_irq_state( );
+        clear_hall_effect_irq_state( );
 
-                break;
-            }
-            case DEVICE_STATE_CYCLE:
-            {
-                /* Reload the software watchdog */
-                hal_mcu_reset_software_watchdog( );
+        tracker_set_device_state( DEVICE_START_BLE );
 
-                device_state = DEVICE_STATE_SLEEP;
+        /* Stop the LR1110 modem alarm */
+        lr1110_modem_set_alarm_timer( &lr1110, 0 );
 
-                /* Schedule next packet transmission */
-                tx_duty_cycle_time =
-                    ( tracker_ctx.app_scan_interval + randr( -APP_TX_DUTYCYCLE_RND, APP_TX_DUTYCYCLE_RND ) ) / 1000;
+        start_ble_thread( ADV_TIMEOUT_MS );
 
-                /* Schedule next packet transmission */
-                modem_response_code = lr1110_modem_set_alarm_timer( &lr1110, tx_duty_cycle_time );
-                HAL_DBG_TRACE_PRINTF( "lr1110_modem_set_alarm_timer : %d s, response code : %d \r\n\r\n",
-                                      tx_duty_cycle_time, modem_response_code );
+        tracker_schedule_next_cycle( );
+    }
+}
 
-                break;
-            }
-            case DEVICE_START_BLE:
-            {
-                /* Stop the LR1110 modem alarm */
-                lr1110_modem_set_alarm_timer( &lr1110, 0 );
+static void tracker_motion_task( void )
+{
+    const acc_sample_t* samples;
+    uint8_t             nb_samples;
 
-                start_ble_thread( ADV_TIMEOUT_MS );
+    /* The INT1 line is shared by the motion and the FIFO watermark, a full batch feeds the activity classifier */
+    if( ( acc_irq1_service( ) & ACC_IRQ1_WATERMARK ) != 0 )
+    {
+        nb_samples = acc_fifo_get_samples( &samples );
+        activity_classifier_update( samples, nb_samples, hal_rtc_get_time_s( ) );
+    }
 
-                device_state = DEVICE_STATE_CYCLE;
+    /* Wake up from static mode thanks the accelerometer ? The scan scheduler may leave the motion to the next cycle */
+    if( ( device_state == DEVICE_STATE_SLEEP ) && ( get_accelerometer_irq1_state( ) == true ) &&
+        ( is_tracker_in_static_mode( ) == true ) &&
+        ( ( ( tracker_ctx.scan_policy.flags & TRACKER_SCHEDULER_ENABLED ) == 0 ) ||
+          ( tracker_scheduler_allow_motion_fix( &tracker_ctx.scan_policy, hal_rtc_get_time_s( ),
+                                                hal_energy_get_total_charge( ) ) == true ) ) )
+    {
+        /* Stop the LR1110 current modem alarm */
+        lr1110_modem_set_alarm_timer( &lr1110, 0 );
 
-                break;
-            }
-            case DEVICE_STATE_SLEEP:
-            {
-                if( ( get_hall_effect_irq_state( ) == true ) || ( get_usr_button_irq_state( ) == true ) )
-                {
-                    clear_usr_button_irq_state( );
-                    clear_hall_effect_irq_state( );
-                    device_state = DEVICE_START_BLE;
-                }
-                else
-                {
-                    /* go in low power */
-                    if( lr1110_modem_board_read_event_line( &lr1110 ) == false )
-                    {
-                        hal_mcu_low_power_handler( );
-                    }
+        UTIL_SEQ_SetTask( 1 << CFG_TASK_TRACKER_SCAN_ID, CFG_SCH_PRIO_1 );
+    }
+}
 
-                    /* Wake up from static mode thanks the accelerometer ? */
-                    if( ( get_accelerometer_irq1_state( ) == true ) && ( is_tracker_in_static_mode( ) == true ) )
-                    {
-                        /* Stop the LR1110 current modem alarm */
-                        lr1110_modem_set_alarm_timer( &lr1110, 0 );
+static void tracker_schedule_next_cycle( void )
+{
+    lr1110_modem_response_code_t modem_response_code = LR1110_MODEM_RESPONSE_CODE_OK;
+    timer_time_t                 next_timer_wakeup;
 
-                        device_state = DEVICE_COLLECT_DATA;
-                    }
-                }
-                break;
-            }
-            default:
-            {
-                device_state = DEVICE_STATE_INIT;
-                break;
-            }
-        }
+    tracker_set_device_state( DEVICE_STATE_CYCLE );
+
+    /* Reload the software watchdog */
+    hal_mcu_reset_software_watchdog( );
+
+    /* Schedule next packet transmission, on the next MCU timer wakeup when it falls in the random window */
+    next_timer_wakeup = timer_get_remaining_time( );
+    if( ( next_timer_wakeup != TIMERTIME_T_MAX ) &&
+        ( next_timer_wakeup + APP_TX_DUTYCYCLE_RND >= scan_interval ) &&
+        ( next_timer_wakeup <= scan_interval + APP_TX_DUTYCYCLE_RND ) )
+    {
+        tx_duty_cycle_time = ( next_timer_wakeup + 999 ) / 1000;
+    }
+    else
+    {
+        tx_duty_cycle_time = ( scan_interval + randr( -APP_TX_DUTYCYCLE_RND, APP_TX_DUTYCYCLE_RND ) ) / 1000;
+    }
+
+    /* Schedule next packet transmission */
+    modem_response_code = lr1110_modem_set_alarm_timer( &lr1110, tx_duty_cycle_time );
+    HAL_DBG_TRACE_PRINTF( "lr1110_modem_set_alarm_timer : %d s, response code : %d \r\n\r\n", tx_duty_cycle_time,
+                          modem_response_code );
+
+    tracker_set_device_state( DEVICE_STATE_SLEEP );
+
+    /* A BLE request received during the cycle is served now */
+    if( ( get_hall_effect_irq_state( ) == true ) || ( get_usr_button_irq_state( ) == true ) )
+    {
+        UTIL_SEQ_SetTask( 1 << CFG_TASK_TRACKER_BLE_ID, CFG_SCH_PRIO_1 );
     }
 }
 
-void _Error_Handler( int line )
+static void tracker_update_scan_interval( bool moved, bool scanned )
 {
-    /* USER CODE BEGIN Error_Handler_Debug */
-    /* User can add his own implementation to report the HAL error return state */
-    HAL_DBG_TRACE_ERROR( "Error Handler : %s\n", __FUNCTION__ );
+    tracker_scheduler_decision_t decision;
 
-    // reset the board
-    hal_mcu_reset( );
-    /* USER CODE END Error_Handler_Debug */
+    tracker_scheduler_update( &tracker_ctx.scan_policy, moved, scanned, hal_rtc_get_time_s( ),
+                              hal_energy_get_total_charge( ), &decision );
+
+    /* The keep alive frames of the static mode are counted in fixed intervals */
+    if( ( ( tracker_ctx.scan_policy.flags & TRACKER_SCHEDULER_ENABLED ) == 0 ) ||
+        ( tracker_ctx.accelerometer_used == 0 ) || ( is_tracker_in_static_mode( ) == true ) )
+    {
+        scan_interval = tracker_ctx.app_scan_interval;
+    }
+    else
+    {
+        scan_interval = decision.interval_s * 1000;
+        HAL_DBG_TRACE_PRINTF( "Scan level %d, next scan in %d s%s\r\n", decision.level, decision.interval_s,
+                              ( decision.throttled == true ) ? ", hourly charge budget reached" : "" );
+    }
 }
 
-/*
- * -----------------------------------------------------------------------------
- * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
- */
+static uint32_t tracker_get_max_scan_interval( void )
+{
+    uint32_t max_interval = tracker_ctx.app_scan_interval;
+
+    if( ( tracker_ctx.scan_policy.flags & TRACKER_SCHEDULER_ENABLED ) != 0 )
+    {
+        uint32_t policy_max_interval = tracker_scheduler_get_max_interval( &tracker_ctx.scan_policy ) * 1000;
+
+        if( policy_max_interval > max_interval )
+        {
+            max_interval = policy_max_interval;
+        }
+    }
+    return max_interval;
+}
+
+static void tracker_set_device_state( enum edevice_state state )
+{
+    device_state = state;
+    hal_residency_set_app_state( state );
+}
 
 static void tracker_run_wifi_scan( wifi_settings_t wifi_settings, wifi_scan_all_result_t *wifi_result )
 {
@@ -806,9 +1212,21 @@ static void tracker_run_wifi_scan( wifi_settings_t wifi_settings, wifi_scan_all_
 
     if( wifi_execute_scan( &lr1110 ) == WIFI_SCAN_SUCCESS )
     {
+        wifi_filter_stats_t wifi_filter_stats;
+
         lr1110_display_wifi_scan_results( );
+        wifi_channel_plan_print( );
 
         *wifi_result = wifi.results;
+
+        /* Keep the best APs fitting in the uplink */
+        wifi_filter_apply( &tracker_ctx.wifi_filter_settings, tracker_get_wifi_budget( ), wifi_result,
+                           &wifi_filter_stats );
+        HAL_DBG_TRACE_PRINTF( "Wi-Fi filter : %d in, dropped %d locally administered, %d mobile, %d weak, "
+                              "%d duplicates, %d over budget, %d kept\r\n",
+                              wifi_filter_stats.nb_in, wifi_filter_stats.nb_locally_administered,
+                              wifi_filter_stats.nb_mobile, wifi_filter_stats.nb_weak, wifi_filter_stats.nb_duplicates,
+                              wifi_filter_stats.nb_over_budget, wifi_filter_stats.nb_out );
     }
     else
     {
@@ -819,6 +1237,18 @@ static void tracker_run_wifi_scan( wifi_settings_t wifi_settings, wifi_scan_all_
     spdt_2g4_off( );
 }
 
+static uint8_t tracker_get_wifi_budget( void )
+{
+    uint8_t tx_max_payload = 0;
+
+    if( ( lr1110_modem_get_next_tx_max_payload( &lr1110, &tx_max_payload ) != LR1110_MODEM_RESPONSE_CODE_OK ) ||
+        ( tx_max_payload <= WIFI_UPLINK_OVERHEAD ) )
+    {
+        return WIFI_MAX_RESULT_TOTAL;
+    }
+    return ( tx_max_payload - WIFI_UPLINK_OVERHEAD ) / WIFI_SINGLE_BEACON_LEN;
+}
+
 static void tracker_run_gnss_scan( gnss_settings_t gnss_settings, antenna_t antenna, uint8_t *nav_message, uint8_t *nb_detected_satellites, uint16_t *nav_message_len )
 {
     uint8_t gnss_status;
@@ -847,12 +1277,81 @@ static void tracker_run_gnss_scan( gnss_settings_t gnss_settings, antenna_t ante
     }
 }
 
-static void build_and_stream_payload( void )
+static void tracker_run_gnss_scans( void )
+{
+    gnss_antenna_orientation_t orientation;
+    gnss_antenna_selection_t   selection;
+    uint8_t                    nb_detected_satellites;
+    bool                       second_scanned = false;
+
+    /* No NAV message left from a previous cycle for an antenna not scanned in this one */
+    tracker_ctx.patch_nb_detected_satellites = 0;
+    tracker_ctx.patch_nav_message_len        = 0;
+    tracker_ctx.pcb_nb_detected_satellites   = 0;
+    tracker_ctx.pcb_nav_message_len          = 0;
+
+    acc_read_raw_data( );
+    orientation = gnss_antenna_get_orientation( acc_get_raw_x( ), acc_get_raw_y( ), acc_get_raw_z( ) );
+    gnss_antenna_select( orientation, tracker_ctx.gnss_antenna_sel, &selection );
+
+    nb_detected_satellites = tracker_run_gnss_scan_on( selection.first );
+    gnss_antenna_add_result( orientation, selection.first, nb_detected_satellites );
+
+    if( ( selection.has_second == true ) &&
+        ( ( selection.scan_both == true ) || ( nb_detected_satellites <= GNSS_ANTENNA_FALLBACK_NB_SAT ) ) )
+    {
+        nb_detected_satellites = tracker_run_gnss_scan_on( selection.second );
+        gnss_antenna_add_result( orientation, selection.second, nb_detected_satellites );
+        second_scanned = true;
+    }
+    gnss_antenna_count_second( &selection, second_scanned );
+
+    HAL_DBG_TRACE_PRINTF( "GNSS antenna orientation %d, %s first%s\r\n", orientation,
+                          ( selection.first == GNSS_PATCH_ANTENNA ) ? "patch" : "PCB",
+                          ( second_scanned == true ) ? ", both scanned" : "" );
+}
+
+static uint8_t tracker_run_gnss_scan_on( antenna_t antenna )
 {
+    if( antenna == GNSS_PATCH_ANTENNA )
+    {
+        tracker_run_gnss_scan( tracker_ctx.gnss_settings, GNSS_PATCH_ANTENNA, tracker_ctx.patch_nav_message,
+                               &tracker_ctx.patch_nb_detected_satellites, &tracker_ctx.patch_nav_message_len );
+        return tracker_ctx.patch_nb_detected_satellites;
+    }
+    else
+    {
+        tracker_run_gnss_scan( tracker_ctx.gnss_settings, GNSS_PCB_ANTENNA, tracker_ctx.pcb_nav_message,
+                               &tracker_ctx.pcb_nb_detected_satellites, &tracker_ctx.pcb_nav_message_len );
+        return tracker_ctx.pcb_nb_detected_satellites;
+    }
+}
+
+static void build_and_stream_payload( bool keep_alive_frame )
+{
+    uint32_t               now      = hal_rtc_get_time_s( );
+    bool                   urgent   = keep_alive_frame;
+    bool                   critical = false;
+    uplink_codec_sensors_t sensors;
+
+    HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_BUILD_PAYLOAD );
+
+    /* A record which may wait in the queue, or be streamed before the queued ones, is decoded alone */
+    if( ( uplink_aggregator_is_empty( ) == true ) &&
+        ( ( uplink_queue_get_nb_records( ) > 0 ) || ( tracker_ctx.stream_done == false ) ) )
+    {
+        uplink_codec_force_key( );
+    }
+
+    uplink_aggregator_begin_cycle( now );
+
     /* BUILD THE PAYLOAD IN TLV FORMAT */
     tracker_ctx.lorawan_payload_len = 0;  // reset the payload len
 
-    HAL_DBG_TRACE_MSG( "\r\nIs added in the stream FiFo:\r\n" );
+    /* Header of the compressed cycle, the Wi-Fi and sensors TLVs are encoded against the previous cycle */
+    tracker_ctx.lorawan_payload_len += uplink_codec_begin_cycle( tracker_ctx.lorawan_payload );
+
+    HAL_DBG_TRACE_MSG( "\r\nIs added in the aggregated record:\r\n" );
 
     if( tracker_ctx.patch_nb_detected_satellites > 2 )
     {
@@ -865,8 +1364,8 @@ static void build_and_stream_payload( void )
                 tracker_ctx.patch_nav_message_len );
         tracker_ctx.lorawan_payload_len += tracker_ctx.patch_nav_message_len;
 
-        /* Push the NAV message in the FiFo stream */
-        add_payload_in_streaming_fifo( tracker_ctx.lorawan_payload, tracker_ctx.lorawan_payload_len );
+        /* Add the NAV message in the aggregated record */
+        add_payload_in_aggregated_record( tracker_ctx.lorawan_payload, tracker_ctx.lorawan_payload_len );
 
         tracker_ctx.lorawan_payload_len          = 0;  // reset the payload len
         tracker_ctx.patch_nb_detected_satellites = 0;  // Reset the nb_detected_satellites result
@@ -882,76 +1381,176 @@ static void build_and_stream_payload( void )
                 tracker_ctx.pcb_nav_message_len );
         tracker_ctx.lorawan_payload_len += tracker_ctx.pcb_nav_message_len;
 
-        /* Push the NAV message in the FiFo stream */
-        add_payload_in_streaming_fifo( tracker_ctx.lorawan_payload, tracker_ctx.lorawan_payload_len );
+        /* Add the NAV message in the aggregated record */
+        add_payload_in_aggregated_record( tracker_ctx.lorawan_payload, tracker_ctx.lorawan_payload_len );
 
         tracker_ctx.lorawan_payload_len        = 0;  // reset the payload len
         tracker_ctx.pcb_nb_detected_satellites = 0;  // Reset the nb_detected_satellites result
     }
 
-    if( tracker_ctx.wifi_result.nbr_results > 0 )
+    if( ( tracker_ctx.wifi_result.nbr_results > 0 ) && ( tracker_ctx.wifi_fingerprint.same_place == true ) )
     {
-        /* Add Wi-Fi scan */
-        uint8_t wifi_index = 0;
+        /* Same place as a full scan already sent, only its fingerprint id is added */
+        HAL_DBG_TRACE_PRINTF( " - WiFi fingerprint #%d : ", tracker_ctx.wifi_fingerprint.id );
+        tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = TAG_WIFI_FINGERPRINT;  // Fingerprint TAG
+        tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = 1;                     // Fingerprint LEN
+        tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.wifi_fingerprint.id;
+
+        /* Add the fingerprint in the aggregated record */
+        add_payload_in_aggregated_record( tracker_ctx.lorawan_payload, tracker_ctx.lorawan_payload_len );
+
+        tracker_ctx.lorawan_payload_len     = 0;  // reset the payload len
+        tracker_ctx.wifi_result.nbr_results = 0;  // reset the nbr_results mac addresses
+    }
+    else if( tracker_ctx.wifi_result.nbr_results > 0 )
+    {
+        /* Add Wi-Fi scan, the MACs already sent are replaced by their index in the dictionary */
         HAL_DBG_TRACE_MSG( " - WiFi scan : " );
-        tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = TAG_WIFI_SCAN;  // Wi-Fi TAG
-        tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] =
-            tracker_ctx.wifi_result.nbr_results * WIFI_SINGLE_BEACON_LEN;  // Wi-Fi Len
+        HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_ENCODE_WIFI );
+        tracker_ctx.lorawan_payload_len += uplink_codec_encode_wifi(
+            &tracker_ctx.wifi_result, tracker_ctx.lorawan_payload + tracker_ctx.lorawan_payload_len );
+        HAL_PROF_ZONE_END( HAL_PROF_ZONE_ENCODE_WIFI );
 
-        wifi_index = tracker_ctx.lorawan_payload_len;
-        for( uint8_t i = 0; i < tracker_ctx.wifi_result.nbr_results; i++ )
+        /* A fingerprint sent along with the full scan is the one the next scans at this place refer to */
+        if( tracker_ctx.wifi_fingerprint.valid == true )
         {
-            tracker_ctx.lorawan_payload[wifi_index] = tracker_ctx.wifi_result.results[i].rssi;
-            memcpy( &tracker_ctx.lorawan_payload[wifi_index + 1], tracker_ctx.wifi_result.results[i].mac_address, 6 );
-            wifi_index += WIFI_SINGLE_BEACON_LEN;
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = TAG_WIFI_FINGERPRINT;  // Fingerprint TAG
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = 1;                     // Fingerprint LEN
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.wifi_fingerprint.id;
         }
-        tracker_ctx.lorawan_payload_len += tracker_ctx.wifi_result.nbr_results * WIFI_SINGLE_BEACON_LEN;
 
-        /* Push the Wi-Fi data in the FiFo stream */
-        add_payload_in_streaming_fifo( tracker_ctx.lorawan_payload, tracker_ctx.lorawan_payload_len );
+        /* Add the Wi-Fi data in the aggregated record, the fingerprint is invalidated if the record is dropped */
+        add_payload_in_aggregated_record( tracker_ctx.lorawan_payload, tracker_ctx.lorawan_payload_len );
 
         tracker_ctx.lorawan_payload_len = 0;        // reset the payload len
         tracker_ctx.wifi_result.nbr_results = 0;    // reset the nbr_results mac addresses
     }
 
-    /* Send sensors value */
+    /* Send sensors value, bit packed deltas to the previous cycle */
     HAL_DBG_TRACE_MSG( " - sensors value : " );
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = TAG_ACCELEROMETER;  // Accelerometer TAG
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = 9;                  // Accelerometer LEN
-
-    /* Accelemrometer movement history  */
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.accelerometer_move_history;
-
-    /* Acceleromter data */
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.accelerometer_x >> 8;
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.accelerometer_x;
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.accelerometer_y >> 8;
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.accelerometer_y;
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.accelerometer_z >> 8;
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.accelerometer_z;
-
-    /* Temperature from accelerometer */
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.tout >> 8;
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.tout;
-
-    /* Get charge */
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = TAG_CHARGE;  // Charge TAG
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = 4;           // Charge LEN
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.accumulated_charge >> 24;
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.accumulated_charge >> 16;
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.accumulated_charge >> 8;
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.accumulated_charge;
-
-    /* Get board voltage */
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = TAG_VOLTAGE;  // Voltage TAG
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = 2;            // Voltage LEN
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.voltage >> 8;
-    tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = tracker_ctx.voltage;
-
-    /* Push the sensor values in the FiFo stream */
-    add_payload_in_streaming_fifo( tracker_ctx.lorawan_payload, tracker_ctx.lorawan_payload_len );
+    sensors.move_history    = tracker_ctx.accelerometer_move_history;
+    sensors.accelerometer_x = tracker_ctx.accelerometer_x;
+    sensors.accelerometer_y = tracker_ctx.accelerometer_y;
+    sensors.accelerometer_z = tracker_ctx.accelerometer_z;
+    sensors.temperature     = tracker_ctx.tout;
+    sensors.charge          = tracker_ctx.accumulated_charge;
+    sensors.voltage         = tracker_ctx.voltage;
+
+    HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_ENCODE_SENSORS );
+    tracker_ctx.lorawan_payload_len +=
+        uplink_codec_encode_sensors( &sensors, tracker_ctx.lorawan_payload + tracker_ctx.lorawan_payload_len );
+    HAL_PROF_ZONE_END( HAL_PROF_ZONE_ENCODE_SENSORS );
+
+    /* Get energy accounting totals, the LoRa TX one has the 1 mAh resolution of the modem charge counter */
+    if( keep_alive_frame == true )
+    {
+        hal_energy_report_t energy_report;
+
+        hal_energy_get_report( &energy_report );
+
+        tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = TAG_ENERGY;                   // Energy TAG
+        tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = 4 * HAL_ENERGY_SUBSYSTEM_NB;  // Energy LEN
+        for( uint8_t i = 0; i < HAL_ENERGY_SUBSYSTEM_NB; i++ )
+        {
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = energy_report.total_charge_uah[i] >> 24;
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = energy_report.total_charge_uah[i] >> 16;
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = energy_report.total_charge_uah[i] >> 8;
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = energy_report.total_charge_uah[i];
+        }
+    }
+
+    /* Get low power residency, time per mode and wakeups per source saturated on 16 bits */
+    if( keep_alive_frame == true )
+    {
+        hal_residency_report_t residency_report;
+
+        hal_residency_get_report( &residency_report );
+
+        tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = TAG_RESIDENCY;  // Residency TAG
+        tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] =
+            ( 4 * HAL_RESIDENCY_MODE_NB ) + ( 2 * HAL_RESIDENCY_WAKE_SOURCE_NB );  // Residency LEN
+        for( uint8_t i = 0; i < HAL_RESIDENCY_MODE_NB; i++ )
+        {
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = residency_report.mode_time_s[i] >> 24;
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = residency_report.mode_time_s[i] >> 16;
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = residency_report.mode_time_s[i] >> 8;
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = residency_report.mode_time_s[i];
+        }
+        for( uint8_t i = 0; i < HAL_RESIDENCY_WAKE_SOURCE_NB; i++ )
+        {
+            uint16_t wakeups = ( residency_report.wakeups[i] > 0xFFFF ) ? 0xFFFF : residency_report.wakeups[i];
+
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = wakeups >> 8;
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = wakeups;
+        }
+    }
+
+    /* Ask the application server for the almanac when too old, the request rides along the sensor values */
+    if( tracker_ctx.has_date == true )
+    {
+        gnss_almanac_request_t almanac_request;
+        uint32_t               gps_time    = lr1110_modem_board_get_systime_from_gps( &lr1110 );
+        uint32_t               almanac_age = UINT32_MAX;  // Unknown date, after a failed update
+
+        if( ( tracker_ctx.last_almanac_update != 0 ) && ( gps_time > tracker_ctx.last_almanac_update ) )
+        {
+            almanac_age = gps_time - tracker_ctx.last_almanac_update;
+        }
+
+        if( gnss_almanac_request_get( &lr1110, gps_time, almanac_age, &almanac_request ) == true )
+        {
+            /* The application server answers with the almanac segments, the request is not delayed */
+            critical = true;
+
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = TAG_ALMANAC_REQUEST;       // Almanac TAG
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = GNSS_ALMANAC_REQUEST_LEN;  // Almanac LEN
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = almanac_request.crc >> 24;
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = almanac_request.crc >> 16;
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = almanac_request.crc >> 8;
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = almanac_request.crc;
+            tracker_ctx.lorawan_payload[tracker_ctx.lorawan_payload_len++] = almanac_request.next_chunk;
+        }
+    }
+
+    /* Add the sensor values in the aggregated record */
+    add_payload_in_aggregated_record( tracker_ctx.lorawan_payload, tracker_ctx.lorawan_payload_len );
 
     tracker_ctx.lorawan_payload_len = 0;  // reset the payload len
+
+    /* The first position after a motion start and the last one before the static mode are not delayed */
+    if( ( tracker_ctx.accelerometer_used == 1 ) &&
+        ( ( ( tracker_ctx.accelerometer_move_history & 0x03 ) == 0x01 ) ||
+          ( ( uint8_t )( tracker_ctx.accelerometer_move_history << 1 ) == 0 ) ) )
+    {
+        urgent = true;
+    }
+
+    /* A motion start or a low battery goes before the position reports waiting in the queue */
+    if( ( tracker_ctx.accelerometer_used == 1 ) && ( ( tracker_ctx.accelerometer_move_history & 0x03 ) == 0x01 ) )
+    {
+        critical = true;
+    }
+    if( ( tracker_ctx.voltage < BOARD_VOLTAGE_LOW_BATTERY ) && ( low_battery_reported == false ) )
+    {
+        critical = true;
+    }
+    low_battery_reported = ( tracker_ctx.voltage < BOARD_VOLTAGE_LOW_BATTERY );
+
+    if( ( urgent == true ) || ( critical == true ) ||
+        ( uplink_aggregator_is_due( now, scan_interval / 1000, tracker_ctx.uplink_latency_bound_s ) == true ) )
+    {
+        if( critical == true )
+        {
+            submit_aggregated_record( UPLINK_QUEUE_PRIORITY_HIGH, false );
+        }
+        else
+        {
+            /* The energy accounting totals of a keep alive frame are not superseded by a position report */
+            submit_aggregated_record( UPLINK_QUEUE_PRIORITY_NORMAL, keep_alive_frame == false );
+        }
+    }
+
+    HAL_PROF_ZONE_END( HAL_PROF_ZONE_BUILD_PAYLOAD );
 }
 
 static lr1110_modem_response_code_t gnss_init( void )
@@ -999,6 +1598,21 @@ static void store_new_acculated_charge( uint32_t modem_charge )
     }
 }
 
+static void store_new_energy_total_charge( void )
+{
+    uint32_t energy_total_charge = hal_energy_get_total_charge( );
+
+    /* Limit the flash wear, the totals are also saved with any other context store */
+    if( ( energy_total_charge < previous_energy_total_charge ) ||
+        ( ( energy_total_charge - previous_energy_total_charge ) >= ENERGY_TOTAL_CHARGE_STORE_THRESHOLD ) )
+    {
+        HAL_DBG_TRACE_MSG( "New energy totals stored\r\n" );
+        tracker_store_app_ctx( );
+
+        previous_energy_total_charge = energy_total_charge;
+    }
+}
+
 static void print_hex_buffer( const uint8_t* buffer, uint8_t size )
 {
     uint8_t newline = 0;
@@ -1069,33 +1683,116 @@ static void join_network( void )
     }
 }
 
-static bool add_payload_in_streaming_fifo( uint8_t* payload, uint16_t len )
+static bool stream_uplink_queue( void )
 {
+    uint32_t                     now = hal_rtc_get_time_s( );
+    const uplink_queue_record_t* record;
     lr1110_modem_stream_status_t stream_status;
+    uplink_queue_stats_t         queue_stats;
 
-    /* Push the Payload in the FiFo stream */
+    record = uplink_queue_peek( now );
+    if( record == NULL )
+    {
+        return false;
+    }
+
+    /* Push the records in the FiFo stream, the highest priority first, while they fit */
     lr1110_modem_stream_status( &lr1110, LORAWAN_STREAM_APP_PORT, &stream_status );
-    if( stream_status.free > len )
+    HAL_DBG_TRACE_PRINTF( "add in streaming FiFo, %d bytes pending before\r\n", stream_status.pending );
+    while( ( record != NULL ) && ( stream_status.free > record->len ) )
     {
         tracker_ctx.stream_done = false;
-        HAL_DBG_TRACE_MSG( "add in streaming FiFo\r\n" );
-        lr1110_modem_send_stream_data( &lr1110, LORAWAN_STREAM_APP_PORT, payload, len );
+        lr1110_modem_send_stream_data( &lr1110, LORAWAN_STREAM_APP_PORT, record->record, record->len );
+        stream_status.free -= record->len;
 
-        return true;
+        uplink_queue_pop( );
+        record = uplink_queue_peek( now );
     }
-    else
+
+    uplink_queue_get_stats( &queue_stats );
+    HAL_DBG_TRACE_PRINTF( "Uplink queue : %d waiting, %d free, %d sent, %d superseded, %d expired, %d overflow\r\n",
+                          queue_stats.nb_queued, stream_status.free, queue_stats.nb_sent, queue_stats.nb_superseded,
+                          queue_stats.nb_expired, queue_stats.nb_overflow );
+
+    return true;
+}
+
+static void add_payload_in_aggregated_record( const uint8_t* payload, uint16_t len )
+{
+    uint16_t index = 0;
+
+    while( index < len )
     {
-        HAL_DBG_TRACE_PRINTF( "Not enought space, need = %d bytes - free = %d bytes\r\n", len, stream_status.free );
+        index += uplink_aggregator_add( payload + index, len - index );
+
+        /* The record is full, the rest of the cycle depends on it so it is not superseded */
+        if( index < len )
+        {
+            submit_aggregated_record( UPLINK_QUEUE_PRIORITY_NORMAL, false );
+        }
+    }
+}
 
+static bool submit_aggregated_record( uplink_queue_priority_t priority, bool supersedable )
+{
+    uint32_t                  now = hal_rtc_get_time_s( );
+    uplink_aggregator_stats_t aggregator_stats;
+    uplink_codec_stats_t      codec_stats;
+    const uint8_t*            record;
+    uint8_t                   record_len;
+    uint32_t                  deadline;
+    bool                      queued = false;
+
+    record_len = uplink_aggregator_get_record( now, &record );
+    if( record_len == 0 )
+    {
         return false;
     }
+
+    /* A record dropped by the queue is reported to on_uplink_queue_drop */
+    deadline = now + ( ( priority == UPLINK_QUEUE_PRIORITY_HIGH ) ? UPLINK_QUEUE_EVENT_LIFETIME_S
+                                                                  : UPLINK_QUEUE_POSITION_LIFETIME_S );
+    queued = uplink_queue_push( record, record_len, priority, supersedable, deadline, now );
+    uplink_aggregator_release( queued );
+
+    uplink_aggregator_get_stats( &aggregator_stats );
+    HAL_DBG_TRACE_PRINTF( "Aggregated record : %d bytes, %d cycles in %d records, %d failed, %d dropped TLVs\r\n",
+                          record_len, aggregator_stats.nb_cycles, aggregator_stats.nb_records,
+                          aggregator_stats.nb_failed, aggregator_stats.nb_dropped );
+    uplink_codec_get_stats( &codec_stats );
+    HAL_DBG_TRACE_PRINTF( "Uplink codec : %d cycles, %d key, %d bytes from %d, MACs %d in dictionary %d new\r\n",
+                          codec_stats.nb_cycles, codec_stats.nb_key_cycles, codec_stats.encoded_bytes,
+                          codec_stats.raw_bytes, codec_stats.nb_dict_hits, codec_stats.nb_dict_miss );
+
+    return queued;
+}
+
+static void on_uplink_queue_drop( const uint8_t* record, const uint8_t len )
+{
+    uint16_t index     = 0;
+    bool     full_scan = false;
+
+    HAL_DBG_TRACE_WARNING( "Uplink record of %d bytes dropped\r\n", len );
+
+    /* The next cycles can not be encoded against a cycle never sent */
+    uplink_codec_force_key( );
+
+    /* The next scans at these places can not refer to a full scan never sent */
+    while( ( index + 1 ) < len )
+    {
+        if( ( full_scan == true ) && ( record[index] == TAG_WIFI_FINGERPRINT ) && ( ( index + 2 ) < len ) )
+        {
+            wifi_fingerprint_invalidate( record[index + 2] );
+        }
+        full_scan = ( record[index] == TAG_WIFI_SCAN_DICT );
+        index += 2 + record[index + 1];
+    }
 }
 
 static bool is_next_scan_possible( void )
 {
-    if( ( ( tracker_ctx.accelerometer_move_history != 0 ) || ( tracker_ctx.send_alive_frame == true ) ||
-          ( tracker_ctx.accelerometer_used == 0 ) ) &&
-        ( tracker_ctx.stream_done == true ) )
+    if( ( tracker_ctx.accelerometer_move_history != 0 ) || ( tracker_ctx.send_alive_frame == true ) ||
+        ( tracker_ctx.accelerometer_used == 0 ) )
     {
         return true;
     }
@@ -1217,23 +1914,23 @@ void lr1110_modem_alarm( void )
         else if( ( ( modem_status & LR1110_LORAWAN_MUTE ) == LR1110_LORAWAN_MUTE ) ||
                  ( ( modem_status & LR1110_LORAWAN_SUSPEND ) == LR1110_LORAWAN_SUSPEND ) )
         {
-            device_state = DEVICE_STATE_CYCLE;
+            tracker_schedule_next_cycle( );
         }
         else if( ( ( modem_status & LR1110_LORAWAN_JOINED ) == LR1110_LORAWAN_JOINED ) ||
                  ( ( modem_status & LR1110_LORAWAN_STREAM ) == LR1110_LORAWAN_STREAM ) ||
                  ( ( modem_status & LR1110_LORAWAN_UPLOAD ) == LR1110_LORAWAN_UPLOAD ) )
         {
-            device_state = DEVICE_COLLECT_DATA;
+            UTIL_SEQ_SetTask( 1 << CFG_TASK_TRACKER_SCAN_ID, CFG_SCH_PRIO_1 );
         }
         else if( ( modem_status & LR1110_LORAWAN_JOINING ) == LR1110_LORAWAN_JOINING )
         {
             /* Network not joined yet. Wait */
-            device_state = DEVICE_STATE_CYCLE;
+            tracker_schedule_next_cycle( );
         }
         else
         {
             HAL_DBG_TRACE_WARNING( "Unknow modem status %d\r\n\r\n", modem_status );
-            device_state = DEVICE_STATE_CYCLE;
+            tracker_schedule_next_cycle( );
         }
     }
 }
@@ -1284,6 +1981,9 @@ static void lr1110_modem_stream_done( void )
     HAL_DBG_TRACE_INFO( "###### ===== STREAM DONE nb %d ==== ######\r\n\r\n", stream_cnt++ );
 
     tracker_ctx.stream_done = true;
+
+    /* Room in the stream, the queued records go on */
+    stream_uplink_queue( );
 }
 
 static void lr1110_modem_time_updated_alc_sync( lr1110_modem_alc_sync_state_t alc_sync_state )
@@ -1333,6 +2033,42 @@ static void parse_frame( uint8_t port, const uint8_t* payload, uint8_t size )
 
         break;
     }
+    case GNSS_ALMANAC_SEGMENT_PORT:
+    {
+        uint8_t first_chunk;
+        uint8_t nb_chunks;
+
+        HAL_DBG_TRACE_INFO( "###### ===== GNSS ALMANAC SEGMENT ==== ######\r\n\r\n" );
+
+        if( ( size <= 1 ) || ( ( ( size - 1 ) % LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE ) != 0 ) )
+        {
+            HAL_DBG_TRACE_ERROR( "Wrong almanac segment size %d\r\n", size );
+            break;
+        }
+
+        first_chunk = payload[0];
+        nb_chunks   = ( size - 1 ) / LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE;
+
+        /* Written by the almanac update task, between the scans */
+        for( uint8_t i = 0; i < nb_chunks; i += GNSS_ALMANAC_FRAGMENT_MAX_CHUNKS )
+        {
+            uint8_t nb_fragment_chunks = nb_chunks - i;
+
+            if( nb_fragment_chunks > GNSS_ALMANAC_FRAGMENT_MAX_CHUNKS )
+            {
+                nb_fragment_chunks = GNSS_ALMANAC_FRAGMENT_MAX_CHUNKS;
+            }
+
+            if( tracker_almanac_update_push( first_chunk + i, nb_fragment_chunks,
+                                             payload + 1 + ( i * LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE ) ) ==
+                false )
+            {
+                HAL_DBG_TRACE_PRINTF( "Almanac chunk %d rejected\r\n", first_chunk + i );
+                break;
+            }
+        }
+        break;
+    }
     default:
         break;
     }
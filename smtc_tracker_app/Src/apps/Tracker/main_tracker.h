@@ -81,6 +81,12 @@ extern "C" {
  */
 #define BOARD_VOLTAGE_THRESHOLD 2500
 
+/*!
+ * \brief Define the voltage in mV under which the uplinks are
+ * queued with a high priority, before the airplane mode.
+ */
+#define BOARD_VOLTAGE_LOW_BATTERY 2700
+
 /*!
  * \brief Defines the application firmware version
  */
@@ -101,6 +107,14 @@ extern "C" {
 #define TAG_ACCELEROMETER 9
 #define TAG_CHARGE 10
 #define TAG_VOLTAGE 11
+#define TAG_ENERGY 12
+#define TAG_RESIDENCY 13
+#define TAG_WIFI_FINGERPRINT 14
+#define TAG_ALMANAC_REQUEST 15
+#define TAG_CYCLE 16
+#define TAG_CODEC 17
+#define TAG_WIFI_SCAN_DICT 18
+#define TAG_SENSORS_PACKED 19
 
 /*!
  * \brief LoRaWAN stream application port
@@ -112,6 +126,11 @@ extern "C" {
  */
 #define GNSS_PUSH_SOLVER_MSG_PORT 150
 
+/*!
+ * \brief LoRaWAN port of the almanac segments sent by the application server, first chunk index then chunks
+ */
+#define GNSS_ALMANAC_SEGMENT_PORT 151
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC TYPES ------------------------------------------------------------
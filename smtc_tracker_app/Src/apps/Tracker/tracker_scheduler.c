@@ -0,0 +1,320 @@
+/*!
+ * \file      tracker_scheduler.c
+ *
+ * \brief     Motion-adaptive scan scheduler implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "tracker_scheduler.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * \brief Length of the window the charge budget applies to
+ */
+#define TRACKER_SCHEDULER_WINDOW_S 3600
+
+/*!
+ * \brief Fractional bits of the average scan cost, the charge totals are in uAh only
+ */
+#define TRACKER_SCHEDULER_COST_SHIFT 4
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*!
+ * \brief Default policy table
+ */
+static const tracker_scheduler_level_t tracker_scheduler_levels_default[TRACKER_SCHEDULER_NB_LEVELS] = {
+    { 0, 300 }, { 2, 120 }, { 4, 60 }, { 8, 30 }
+};
+
+/*!
+ * \brief Consecutive cycles with motion
+ */
+static uint8_t tracker_scheduler_moving_cycles = 0;
+
+/*!
+ * \brief Hour window, started at the first decision
+ */
+static bool     tracker_scheduler_window_started      = false;
+static uint32_t tracker_scheduler_window_start        = 0;
+static uint32_t tracker_scheduler_window_start_charge = 0;
+
+/*!
+ * \brief Average charge of a cycle with a scan, in 1/16 uAh
+ */
+static uint32_t tracker_scheduler_scan_cost       = 0;
+static uint32_t tracker_scheduler_last_charge     = 0;
+static bool     tracker_scheduler_last_cycle_scan = false;
+
+/*!
+ * \brief Scheduler statistics
+ */
+static tracker_scheduler_stats_t tracker_scheduler_stats;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief Starts a new hour window once the current one elapsed
+ *
+ * \param [in] now Current time in seconds
+ * \param [in] charge_uah Total charge drawn so far in uAh
+ */
+static void tracker_scheduler_update_window( const uint32_t now, const uint32_t charge_uah );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void tracker_scheduler_update( const tracker_scheduler_policy_t* policy, const bool moved, const bool scanned,
+                               const uint32_t now, const uint32_t charge_uah, tracker_scheduler_decision_t* decision )
+{
+    uint8_t level = 0;
+
+    tracker_scheduler_update_window( now, charge_uah );
+
+    /* The charge drawn since the previous decision is the cost of its cycle */
+    if( ( tracker_scheduler_last_cycle_scan == true ) && ( charge_uah >= tracker_scheduler_last_charge ) )
+    {
+        uint32_t cost = ( charge_uah - tracker_scheduler_last_charge ) << TRACKER_SCHEDULER_COST_SHIFT;
+
+        tracker_scheduler_scan_cost = ( tracker_scheduler_scan_cost == 0 )
+                                          ? cost
+                                          : ( ( 3 * tracker_scheduler_scan_cost ) + cost ) / 4;
+    }
+    tracker_scheduler_last_charge     = charge_uah;
+    tracker_scheduler_last_cycle_scan = scanned;
+
+    /* Activity level */
+    if( moved == true )
+    {
+        if( tracker_scheduler_moving_cycles < UINT8_MAX )
+        {
+            tracker_scheduler_moving_cycles++;
+        }
+    }
+    else
+    {
+        tracker_scheduler_moving_cycles = 0;
+    }
+    for( uint8_t i = 1; i < TRACKER_SCHEDULER_NB_LEVELS; i++ )
+    {
+        if( tracker_scheduler_moving_cycles >= policy->levels[i].min_moving_cycles )
+        {
+            level = i;
+        }
+    }
+
+    decision->level      = level;
+    decision->interval_s = policy->levels[level].interval_s;
+    decision->throttled  = false;
+
+    /* Spread the scans the budget left allows over the time left in the window */
+    if( ( policy->max_charge_per_hour_uah != 0 ) && ( tracker_scheduler_scan_cost != 0 ) )
+    {
+        uint32_t spent     = charge_uah - tracker_scheduler_window_start_charge;
+        uint32_t time_left = TRACKER_SCHEDULER_WINDOW_S - ( now - tracker_scheduler_window_start );
+        uint32_t nb_scans  = 0;
+        uint32_t interval;
+
+        if( spent < policy->max_charge_per_hour_uah )
+        {
+            nb_scans = ( ( policy->max_charge_per_hour_uah - spent ) << TRACKER_SCHEDULER_COST_SHIFT ) /
+                       tracker_scheduler_scan_cost;
+        }
+        interval = ( nb_scans == 0 ) ? time_left : ( time_left / nb_scans );
+        if( interval > TRACKER_SCHEDULER_INTERVAL_MAX_S )
+        {
+            interval = TRACKER_SCHEDULER_INTERVAL_MAX_S;
+        }
+        if( interval > decision->interval_s )
+        {
+            decision->interval_s = interval;
+            decision->throttled  = true;
+            tracker_scheduler_stats.nb_throttled++;
+        }
+    }
+
+    tracker_scheduler_stats.nb_cycles++;
+}
+
+bool tracker_scheduler_allow_motion_fix( const tracker_scheduler_policy_t* policy, const uint32_t now,
+                                         const uint32_t charge_uah )
+{
+    if( ( policy->flags & TRACKER_SCHEDULER_FIX_ON_MOTION_START ) == 0 )
+    {
+        return false;
+    }
+
+    tracker_scheduler_update_window( now, charge_uah );
+
+    if( ( policy->max_charge_per_hour_uah != 0 ) &&
+        ( ( charge_uah - tracker_scheduler_window_start_charge ) >= policy->max_charge_per_hour_uah ) )
+    {
+        tracker_scheduler_stats.nb_motion_fixes_denied++;
+        return false;
+    }
+
+    tracker_scheduler_stats.nb_motion_fixes++;
+    return true;
+}
+
+uint32_t tracker_scheduler_get_max_interval( const tracker_scheduler_policy_t* policy )
+{
+    uint32_t max_interval = 0;
+
+    /* The hourly charge budget may stretch any interval up to the maximum */
+    if( policy->max_charge_per_hour_uah != 0 )
+    {
+        return TRACKER_SCHEDULER_INTERVAL_MAX_S;
+    }
+
+    for( uint8_t i = 0; i < TRACKER_SCHEDULER_NB_LEVELS; i++ )
+    {
+        if( policy->levels[i].interval_s > max_interval )
+        {
+            max_interval = policy->levels[i].interval_s;
+        }
+    }
+    return max_interval;
+}
+
+bool tracker_scheduler_policy_is_valid( const tracker_scheduler_policy_t* policy )
+{
+    for( uint8_t i = 0; i < TRACKER_SCHEDULER_NB_LEVELS; i++ )
+    {
+        if( ( policy->levels[i].interval_s < TRACKER_SCHEDULER_INTERVAL_MIN_S ) ||
+            ( policy->levels[i].interval_s > TRACKER_SCHEDULER_INTERVAL_MAX_S ) )
+        {
+            return false;
+        }
+        if( ( i > 0 ) && ( policy->levels[i].min_moving_cycles < policy->levels[i - 1].min_moving_cycles ) )
+        {
+            return false;
+        }
+    }
+    return ( policy->flags & ~TRACKER_SCHEDULER_FLAGS_MASK ) == 0;
+}
+
+void tracker_scheduler_policy_serialize( const tracker_scheduler_policy_t* policy, uint8_t* buffer )
+{
+    uint8_t index = 0;
+
+    buffer[index++] = policy->flags;
+    buffer[index++] = policy->max_charge_per_hour_uah >> 8;
+    buffer[index++] = policy->max_charge_per_hour_uah;
+    for( uint8_t i = 0; i < TRACKER_SCHEDULER_NB_LEVELS; i++ )
+    {
+        buffer[index++] = policy->levels[i].min_moving_cycles;
+        buffer[index++] = policy->levels[i].interval_s >> 8;
+        buffer[index++] = policy->levels[i].interval_s;
+    }
+}
+
+void tracker_scheduler_policy_deserialize( const uint8_t* buffer, tracker_scheduler_policy_t* policy )
+{
+    uint8_t index = 0;
+
+    policy->flags                   = buffer[index++];
+    policy->max_charge_per_hour_uah = ( uint16_t ) buffer[index++] << 8;
+    policy->max_charge_per_hour_uah += buffer[index++];
+    for( uint8_t i = 0; i < TRACKER_SCHEDULER_NB_LEVELS; i++ )
+    {
+        policy->levels[i].min_moving_cycles = buffer[index++];
+        policy->levels[i].interval_s        = ( uint16_t ) buffer[index++] << 8;
+        policy->levels[i].interval_s += buffer[index++];
+    }
+}
+
+void tracker_scheduler_policy_set_default( tracker_scheduler_policy_t* policy )
+{
+    policy->flags                   = TRACKER_SCHEDULER_FLAGS_DEFAULT;
+    policy->max_charge_per_hour_uah = TRACKER_SCHEDULER_MAX_CHARGE_PER_HOUR_DEFAULT;
+    memcpy( policy->levels, tracker_scheduler_levels_default, sizeof( policy->levels ) );
+}
+
+void tracker_scheduler_get_stats( tracker_scheduler_stats_t* stats )
+{
+    *stats                 = tracker_scheduler_stats;
+    stats->hour_charge_uah = ( tracker_scheduler_last_charge > tracker_scheduler_window_start_charge )
+                                 ? ( tracker_scheduler_last_charge - tracker_scheduler_window_start_charge )
+                                 : 0;
+}
+
+void tracker_scheduler_reset( void )
+{
+    tracker_scheduler_moving_cycles   = 0;
+    tracker_scheduler_window_started  = false;
+    tracker_scheduler_scan_cost       = 0;
+    tracker_scheduler_last_cycle_scan = false;
+    memset( &tracker_scheduler_stats, 0, sizeof( tracker_scheduler_stats ) );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void tracker_scheduler_update_window( const uint32_t now, const uint32_t charge_uah )
+{
+    if( ( tracker_scheduler_window_started == false ) ||
+        ( ( now - tracker_scheduler_window_start ) >= TRACKER_SCHEDULER_WINDOW_S ) ||
+        ( charge_uah < tracker_scheduler_window_start_charge ) )
+    {
+        tracker_scheduler_window_started      = true;
+        tracker_scheduler_window_start        = now;
+        tracker_scheduler_window_start_charge = charge_uah;
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,229 @@
+/*!
+ * \file      tracker_scheduler.h
+ *
+ * \brief     Motion-adaptive scan scheduler definition
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __TRACKER_SCHEDULER_H__
+#define __TRACKER_SCHEDULER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * \brief Number of rows of the policy table, one per activity level
+ */
+#define TRACKER_SCHEDULER_NB_LEVELS 4
+
+/*!
+ * \brief Options of tracker_scheduler_policy_t.flags
+ */
+#define TRACKER_SCHEDULER_ENABLED 0x01              // Otherwise the fixed app_scan_interval is used
+#define TRACKER_SCHEDULER_FIX_ON_MOTION_START 0x02  // Scan as soon as a static tracker moves
+#define TRACKER_SCHEDULER_ACTIVITY_SCAN 0x04        // Scans picked from the activity, see activity_classifier.h
+#define TRACKER_SCHEDULER_FLAGS_MASK \
+    ( TRACKER_SCHEDULER_ENABLED | TRACKER_SCHEDULER_FIX_ON_MOTION_START | TRACKER_SCHEDULER_ACTIVITY_SCAN )
+
+/*!
+ * \brief Scan intervals accepted in the policy table, same bounds as the fixed scan interval
+ */
+#define TRACKER_SCHEDULER_INTERVAL_MIN_S 10
+#define TRACKER_SCHEDULER_INTERVAL_MAX_S 1800
+
+/*!
+ * \brief Default policy, the scans get closer as the motion lasts
+ */
+#define TRACKER_SCHEDULER_FLAGS_DEFAULT \
+    ( TRACKER_SCHEDULER_ENABLED | TRACKER_SCHEDULER_FIX_ON_MOTION_START | TRACKER_SCHEDULER_ACTIVITY_SCAN )
+#define TRACKER_SCHEDULER_MAX_CHARGE_PER_HOUR_DEFAULT 1500
+
+/*!
+ * \brief Size of a policy serialized in a BLE command
+ */
+#define TRACKER_SCHEDULER_POLICY_LEN ( 3 + ( 3 * TRACKER_SCHEDULER_NB_LEVELS ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief Row of the policy table
+ */
+typedef struct
+{
+    uint8_t  min_moving_cycles;  // Consecutive cycles with motion from which the row applies
+    uint16_t interval_s;         // Scan interval
+} tracker_scheduler_level_t;
+
+/*!
+ * \brief Scan policy, the rows are sorted by increasing min_moving_cycles
+ */
+typedef struct
+{
+    uint8_t                   flags;                    // TRACKER_SCHEDULER_xxx options
+    uint16_t                  max_charge_per_hour_uah;  // Charge drawn in one hour at most, 0 for no bound
+    tracker_scheduler_level_t levels[TRACKER_SCHEDULER_NB_LEVELS];
+} tracker_scheduler_policy_t;
+
+/*!
+ * \brief Scan interval decided for the next cycle
+ */
+typedef struct
+{
+    uint32_t interval_s;  // Interval to the next cycle
+    uint8_t  level;       // Row of the policy table applied
+    bool     throttled;   // The interval is stretched to stay in the hourly charge budget
+} tracker_scheduler_decision_t;
+
+/*!
+ * \brief Scheduler statistics
+ */
+typedef struct
+{
+    uint32_t nb_cycles;               // Decisions taken
+    uint32_t nb_throttled;            // Decisions stretched by the hourly charge budget
+    uint32_t nb_motion_fixes;         // Scans started on a motion start
+    uint32_t nb_motion_fixes_denied;  // Motion starts ignored, the hourly charge budget being spent
+    uint32_t hour_charge_uah;         // Charge drawn since the beginning of the hour window
+} tracker_scheduler_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief Decides the interval to the next cycle from the motion of the cycle
+ *
+ * \remark The activity level is the number of consecutive cycles with motion, it selects the row of the policy table.
+ *         The scan cost is averaged over the cycles with a scan and the interval is stretched so that the scans left
+ *         in the hour window fit in the budget left
+ *
+ * \remark The module has no hardware dependency, recorded motion traces can be replayed through it on a host
+ *
+ * \param [in] policy Scan policy \ref tracker_scheduler_policy_t
+ * \param [in] moved Motion detected during the cycle
+ * \param [in] scanned A scan is run during the cycle
+ * \param [in] now Current time in seconds
+ * \param [in] charge_uah Total charge drawn so far in uAh
+ * \param [out] decision Interval to the next cycle \ref tracker_scheduler_decision_t
+ */
+void tracker_scheduler_update( const tracker_scheduler_policy_t* policy, const bool moved, const bool scanned,
+                               const uint32_t now, const uint32_t charge_uah, tracker_scheduler_decision_t* decision );
+
+/*!
+ * \brief Tells if a scan is to be started on a motion start
+ *
+ * \param [in] policy Scan policy \ref tracker_scheduler_policy_t
+ * \param [in] now Current time in seconds
+ * \param [in] charge_uah Total charge drawn so far in uAh
+ *
+ * \return true if the option is set and the hourly charge budget is not spent
+ */
+bool tracker_scheduler_allow_motion_fix( const tracker_scheduler_policy_t* policy, const uint32_t now,
+                                         const uint32_t charge_uah );
+
+/*!
+ * \brief Returns the longest interval the policy can decide
+ *
+ * \param [in] policy Scan policy \ref tracker_scheduler_policy_t
+ *
+ * \return Interval in seconds
+ */
+uint32_t tracker_scheduler_get_max_interval( const tracker_scheduler_policy_t* policy );
+
+/*!
+ * \brief Tells if a policy is valid
+ *
+ * \param [in] policy Scan policy \ref tracker_scheduler_policy_t
+ *
+ * \return true if the intervals are in bounds and the rows sorted
+ */
+bool tracker_scheduler_policy_is_valid( const tracker_scheduler_policy_t* policy );
+
+/*!
+ * \brief Serializes a policy, big endian
+ *
+ * \param [in] policy Scan policy \ref tracker_scheduler_policy_t
+ * \param [out] buffer Buffer of TRACKER_SCHEDULER_POLICY_LEN bytes
+ */
+void tracker_scheduler_policy_serialize( const tracker_scheduler_policy_t* policy, uint8_t* buffer );
+
+/*!
+ * \brief Deserializes a policy, big endian
+ *
+ * \param [in] buffer Buffer of TRACKER_SCHEDULER_POLICY_LEN bytes
+ * \param [out] policy Scan policy \ref tracker_scheduler_policy_t
+ */
+void tracker_scheduler_policy_deserialize( const uint8_t* buffer, tracker_scheduler_policy_t* policy );
+
+/*!
+ * \brief Sets the default policy
+ *
+ * \param [out] policy Scan policy \ref tracker_scheduler_policy_t
+ */
+void tracker_scheduler_policy_set_default( tracker_scheduler_policy_t* policy );
+
+/*!
+ * \brief Returns the scheduler statistics
+ *
+ * \param [out] stats Statistics \ref tracker_scheduler_stats_t
+ */
+void tracker_scheduler_get_stats( tracker_scheduler_stats_t* stats );
+
+/*!
+ * \brief Forgets the motion and charge history
+ */
+void tracker_scheduler_reset( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __TRACKER_SCHEDULER_H__
+
+/* --- EOF ------------------------------------------------------------------ */
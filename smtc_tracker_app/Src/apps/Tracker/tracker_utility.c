@@ -38,6 +38,11 @@
 #include "lorawan_config.h"
 #include "lr1110_tracker_board.h"
 #include "tracker_utility.h"
+#include "wifi_channel_plan.h"
+#include "gnss_antenna.h"
+#include "gnss_almanac.h"
+#include "app_conf.h"
+#include "stm32_seq.h"
 #include "main_tracker.h"
 #include "lorawan_commissioning.h"
 
@@ -53,9 +58,11 @@
 
 #define NB_CHUNK_MODEM 1703
 #define NB_CHUNK_ALMANAC 42
+#define NB_SV_PER_CHUNK_ALMANAC 3
 #define CHUNK_INTERNAL_LOG 145
 #define INTERNAL_LOG_BUFFER_LEN 3000
 #define ACCUMULATED_CHARGE_THRESHOLD 10000
+#define ENERGY_TOTAL_CHARGE_THRESHOLD ( ACCUMULATED_CHARGE_THRESHOLD * 1000 )
 
 /*
  * -----------------------------------------------------------------------------
@@ -112,6 +119,11 @@ uint32_t internal_log_scan_index = 1;
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+/*!
+ * \brief Saves the almanac date once the update completes
+ */
+static void tracker_check_almanac_update_completion( void );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -355,15 +367,75 @@ uint8_t tracker_restore_app_ctx( void )
         {
             tracker_ctx.accumulated_charge = 0;
         }
+
+        /* Energy accounting running totals in uAh, same protection as the accumulated charge */
+        {
+            uint32_t energy_total_charge[HAL_ENERGY_SUBSYSTEM_NB];
+
+            for( uint8_t i = 0; i < HAL_ENERGY_SUBSYSTEM_NB; i++ )
+            {
+                energy_total_charge[i] = tracker_ctx_buf[tracker_ctx_buf_idx++];
+                energy_total_charge[i] += tracker_ctx_buf[tracker_ctx_buf_idx++] << 8;
+                energy_total_charge[i] += tracker_ctx_buf[tracker_ctx_buf_idx++] << 16;
+                energy_total_charge[i] += tracker_ctx_buf[tracker_ctx_buf_idx++] << 24;
+
+                if( energy_total_charge[i] > ENERGY_TOTAL_CHARGE_THRESHOLD )
+                {
+                    energy_total_charge[i] = 0;
+                }
+            }
+            hal_energy_set_total_charge( energy_total_charge );
+        }
+
+        /* Wi-Fi scan quality target, not set in the flash by the previous versions */
+        tracker_ctx.wifi_settings.early_stop_nb_aps     = tracker_ctx_buf[tracker_ctx_buf_idx++];
+        tracker_ctx.wifi_settings.early_stop_rssi_floor = ( int8_t ) tracker_ctx_buf[tracker_ctx_buf_idx++];
+        if( tracker_ctx.wifi_settings.early_stop_nb_aps > WIFI_MAX_RESULT_TOTAL )
+        {
+            tracker_ctx.wifi_settings.early_stop_nb_aps     = WIFI_EARLY_STOP_NB_APS_DEFAULT;
+            tracker_ctx.wifi_settings.early_stop_rssi_floor = WIFI_EARLY_STOP_RSSI_FLOOR_DEFAULT;
+        }
+
+        /* Wi-Fi channel statistics of the sites, reset if the version does not match */
+        wifi_channel_plan_restore( tracker_ctx_buf + tracker_ctx_buf_idx );
+        tracker_ctx_buf_idx += WIFI_CHANNEL_PLAN_CTX_SIZE;
+
+        /* Wi-Fi results filter, not set in the flash by the previous versions */
+        tracker_ctx.wifi_filter_settings.flags      = tracker_ctx_buf[tracker_ctx_buf_idx++];
+        tracker_ctx.wifi_filter_settings.max_aps    = tracker_ctx_buf[tracker_ctx_buf_idx++];
+        tracker_ctx.wifi_filter_settings.rssi_floor = ( int8_t ) tracker_ctx_buf[tracker_ctx_buf_idx++];
+        if( wifi_filter_settings_are_valid( &tracker_ctx.wifi_filter_settings ) == false )
+        {
+            tracker_ctx.wifi_filter_settings.flags      = WIFI_FILTER_FLAGS_DEFAULT;
+            tracker_ctx.wifi_filter_settings.max_aps    = WIFI_FILTER_MAX_APS_DEFAULT;
+            tracker_ctx.wifi_filter_settings.rssi_floor = WIFI_FILTER_RSSI_FLOOR_DEFAULT;
+        }
+
+        /* Scan policy, not set in the flash by the previous versions */
+        tracker_scheduler_policy_deserialize( tracker_ctx_buf + tracker_ctx_buf_idx, &tracker_ctx.scan_policy );
+        tracker_ctx_buf_idx += TRACKER_SCHEDULER_POLICY_LEN;
+        if( tracker_scheduler_policy_is_valid( &tracker_ctx.scan_policy ) == false )
+        {
+            tracker_scheduler_policy_set_default( &tracker_ctx.scan_policy );
+        }
+
+        /* Uplink latency bound, not set in the flash by the previous versions */
+        tracker_ctx.uplink_latency_bound_s = tracker_ctx_buf[tracker_ctx_buf_idx++];
+        tracker_ctx.uplink_latency_bound_s += tracker_ctx_buf[tracker_ctx_buf_idx++] << 8;
+        if( uplink_aggregator_latency_bound_is_valid( tracker_ctx.uplink_latency_bound_s ) == false )
+        {
+            tracker_ctx.uplink_latency_bound_s = UPLINK_AGGREGATOR_LATENCY_BOUND_DEFAULT_S;
+        }
     }
     return SUCCESS;
 }
 
 void tracker_store_app_ctx( void )
 {
-    uint8_t  tracker_ctx_buf[255];
-    uint8_t  tracker_ctx_buf_idx = 0;
-    int32_t latitude = 0, longitude = 0;
+    uint8_t             tracker_ctx_buf[255];
+    uint8_t             tracker_ctx_buf_idx = 0;
+    int32_t             latitude = 0, longitude = 0;
+    hal_energy_report_t energy_report;
 
     if( tracker_ctx.tracker_context_empty != FLASH_BYTE_EMPTY_CONTENT )
     {
@@ -440,6 +512,37 @@ void tracker_store_app_ctx( void )
     tracker_ctx_buf[tracker_ctx_buf_idx++] = tracker_ctx.accumulated_charge >> 16;
     tracker_ctx_buf[tracker_ctx_buf_idx++] = tracker_ctx.accumulated_charge >> 24;
 
+    /* Energy accounting running totals */
+    hal_energy_get_report( &energy_report );
+    for( uint8_t i = 0; i < HAL_ENERGY_SUBSYSTEM_NB; i++ )
+    {
+        tracker_ctx_buf[tracker_ctx_buf_idx++] = energy_report.total_charge_uah[i];
+        tracker_ctx_buf[tracker_ctx_buf_idx++] = energy_report.total_charge_uah[i] >> 8;
+        tracker_ctx_buf[tracker_ctx_buf_idx++] = energy_report.total_charge_uah[i] >> 16;
+        tracker_ctx_buf[tracker_ctx_buf_idx++] = energy_report.total_charge_uah[i] >> 24;
+    }
+
+    /* Wi-Fi scan quality target */
+    tracker_ctx_buf[tracker_ctx_buf_idx++] = tracker_ctx.wifi_settings.early_stop_nb_aps;
+    tracker_ctx_buf[tracker_ctx_buf_idx++] = tracker_ctx.wifi_settings.early_stop_rssi_floor;
+
+    /* Wi-Fi channel statistics of the sites */
+    wifi_channel_plan_save( tracker_ctx_buf + tracker_ctx_buf_idx );
+    tracker_ctx_buf_idx += WIFI_CHANNEL_PLAN_CTX_SIZE;
+
+    /* Wi-Fi results filter */
+    tracker_ctx_buf[tracker_ctx_buf_idx++] = tracker_ctx.wifi_filter_settings.flags;
+    tracker_ctx_buf[tracker_ctx_buf_idx++] = tracker_ctx.wifi_filter_settings.max_aps;
+    tracker_ctx_buf[tracker_ctx_buf_idx++] = tracker_ctx.wifi_filter_settings.rssi_floor;
+
+    /* Scan policy */
+    tracker_scheduler_policy_serialize( &tracker_ctx.scan_policy, tracker_ctx_buf + tracker_ctx_buf_idx );
+    tracker_ctx_buf_idx += TRACKER_SCHEDULER_POLICY_LEN;
+
+    /* Uplink latency bound */
+    tracker_ctx_buf[tracker_ctx_buf_idx++] = tracker_ctx.uplink_latency_bound_s;
+    tracker_ctx_buf[tracker_ctx_buf_idx++] = tracker_ctx.uplink_latency_bound_s >> 8;
+
     flash_write_buffer( FLASH_USER_TRACKER_CTX_START_ADDR, tracker_ctx_buf, tracker_ctx_buf_idx );
 }
 
@@ -469,22 +572,31 @@ void tracker_init_app_ctx( uint8_t* dev_eui, uint8_t* join_eui, uint8_t* app_key
     tracker_ctx.gnss_scan_if_wifi_not_good_enough           = false;
 
     /* Wi-Fi Parameters */
-    tracker_ctx.wifi_settings.enabled       = true;
-    tracker_ctx.wifi_settings.channels      = 0x3FFF;  // by default enable all channels
-    tracker_ctx.wifi_settings.types         = LR1110_MODEM_WIFI_TYPE_SCAN_B;
-    tracker_ctx.wifi_settings.scan_mode     = LR1110_MODEM_WIFI_SCAN_MODE_BEACON_AND_PACKET;
-    tracker_ctx.wifi_settings.nbr_retrials  = WIFI_NBR_RETRIALS_DEFAULT;
-    tracker_ctx.wifi_settings.max_results   = WIFI_MAX_RESULTS_DEFAULT;
-    tracker_ctx.wifi_settings.timeout       = WIFI_TIMEOUT_IN_MS_DEFAULT;
-    tracker_ctx.wifi_settings.result_format = LR1110_MODEM_WIFI_RESULT_FORMAT_BASIC_MAC_TYPE_CHANNEL;
+    tracker_ctx.wifi_settings.enabled               = true;
+    tracker_ctx.wifi_settings.channels              = 0x3FFF;  // by default enable all channels
+    tracker_ctx.wifi_settings.types                 = LR1110_MODEM_WIFI_TYPE_SCAN_B;
+    tracker_ctx.wifi_settings.scan_mode             = LR1110_MODEM_WIFI_SCAN_MODE_BEACON_AND_PACKET;
+    tracker_ctx.wifi_settings.nbr_retrials          = WIFI_NBR_RETRIALS_DEFAULT;
+    tracker_ctx.wifi_settings.max_results           = WIFI_MAX_RESULTS_DEFAULT;
+    tracker_ctx.wifi_settings.timeout               = WIFI_TIMEOUT_IN_MS_DEFAULT;
+    tracker_ctx.wifi_settings.result_format         = LR1110_MODEM_WIFI_RESULT_FORMAT_BASIC_MAC_TYPE_CHANNEL;
+    tracker_ctx.wifi_settings.early_stop_nb_aps     = WIFI_EARLY_STOP_NB_APS_DEFAULT;
+    tracker_ctx.wifi_settings.early_stop_rssi_floor = WIFI_EARLY_STOP_RSSI_FLOOR_DEFAULT;
+    wifi_channel_plan_reset( );
+    tracker_ctx.wifi_filter_settings.flags      = WIFI_FILTER_FLAGS_DEFAULT;
+    tracker_ctx.wifi_filter_settings.max_aps    = WIFI_FILTER_MAX_APS_DEFAULT;
+    tracker_ctx.wifi_filter_settings.rssi_floor = WIFI_FILTER_RSSI_FLOOR_DEFAULT;
 
     /* Application Parameters */
     tracker_ctx.accelerometer_used = true;
     tracker_ctx.app_scan_interval               = TRACKER_SCAN_INTERVAL;
     tracker_ctx.app_keep_alive_frame_interval   = TRACKER_KEEP_ALIVE_FRAME_INTERVAL;
+    tracker_scheduler_policy_set_default( &tracker_ctx.scan_policy );
+    tracker_ctx.uplink_latency_bound_s          = UPLINK_AGGREGATOR_LATENCY_BOUND_DEFAULT_S;
     tracker_ctx.airplane_mode = true; 
     tracker_ctx.internal_log_enable = false;
     tracker_ctx.accumulated_charge = 0;
+    hal_energy_reset_total_charge( );
     
     if( store_in_flash == true )
     {
@@ -500,6 +612,8 @@ void tracker_store_internal_log( void )
     uint16_t index_next_addr      = 0;
     uint32_t next_scan_addr       = 0;
 
+    HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_STORE_INTERNAL_LOG );
+
     memset( scan_buf, 0, 512 );
 
     if( tracker_ctx.flash_remaining_space > 512 )
@@ -589,6 +703,8 @@ void tracker_store_internal_log( void )
         tracker_ctx.flash_addr_current = next_scan_addr;
         tracker_store_internal_log_ctx( );
     }
+
+    HAL_PROF_ZONE_END( HAL_PROF_ZONE_STORE_INTERNAL_LOG );
 }
 
 void tracker_restore_internal_log( void )
@@ -649,7 +765,10 @@ void tracker_restore_internal_log( void )
         HAL_DBG_TRACE_PRINTF( "[%d-%d-%d %d:%d:%d.000] ", epoch_time.tm_year + 1900, epoch_time.tm_mon + 1,
                               epoch_time.tm_mday, epoch_time.tm_hour, epoch_time.tm_min, epoch_time.tm_sec );
         HAL_DBG_TRACE_PRINTF( "[%d - %d] ", job_counter++, 5 );
-        HAL_DBG_TRACE_PRINTF( "%2.2f\r\n", ( ( float ) temperature ) / 100 );
+        // Fixed point print, binary traces do not carry double arguments
+        HAL_DBG_TRACE_PRINTF( "%s%d.%02d\r\n", ( temperature < 0 ) ? "-" : "",
+                              ( ( temperature < 0 ) ? -temperature : temperature ) / 100,
+                              ( ( temperature < 0 ) ? -temperature : temperature ) % 100 );
 
         while( nb_elements_index < nb_elements )
         {
@@ -1106,6 +1225,8 @@ uint8_t tracker_parse_cmd( uint8_t* payload, uint8_t* buffer_out )
     uint8_t res_size            = 0;
     bool    reset_board_asked   = false;
 
+    HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_PARSE_CMD );
+
     nb_elements = payload[payload_index++];
 
     buffer_out[0] = 0;  // ensure that byte 0 is set to 0 at the beggining.
@@ -1208,6 +1329,9 @@ uint8_t tracker_parse_cmd( uint8_t* payload, uint8_t* buffer_out )
             {
                 uint16_t modem_fragment_id;
                 uint8_t i = 0;
+                /* The chunks are streamed to the bootloader at a higher clock */
+                hal_mcu_clock_profile_t clock_profile = hal_mcu_set_clock_profile( HAL_MCU_CLOCK_PROFILE_BOOST );
+
                 modem_fragment_id = ( uint16_t ) payload[payload_index++] << 8;
                 modem_fragment_id += payload[payload_index++];
 
@@ -1268,6 +1392,8 @@ uint8_t tracker_parse_cmd( uint8_t* payload, uint8_t* buffer_out )
                     tracker_ctx.lorawan_parameters_have_changed = true;
                 }
 
+                hal_mcu_set_clock_profile( clock_profile );
+
                 HAL_DBG_TRACE_PRINTF( "modem_fragment_id %d\n\r", modem_fragment_id );
 
                 /* Ack the CMD */
@@ -1700,45 +1826,15 @@ uint8_t tracker_parse_cmd( uint8_t* payload, uint8_t* buffer_out )
 
             case GNSS_ALMANAC_UPDATE_CMD:
             {
-                uint16_t                     alamac_fragment_id;
+                uint16_t alamac_fragment_id;
                 alamac_fragment_id = ( uint16_t ) payload[payload_index++] << 8;
                 alamac_fragment_id += payload[payload_index++];
-                uint8_t           almanac_one_sv_buffer[20];
-                volatile uint32_t almanac_date;
-
-                for( uint8_t i = 0; i < 3; i++ )
-                {
-                    memcpy( almanac_one_sv_buffer,
-                             payload + payload_index + ( LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE * i ), 20 );
-                    lr1110_modem_gnss_one_chunk_almanac_update( &lr1110, almanac_one_sv_buffer );
-                }
-
-                /* set the date */
-                if( alamac_fragment_id == 0 )
-                {
-                    almanac_date = ( ( payload[payload_index + 2] << 8 ) + payload[payload_index + 1] );
-                    almanac_date = ( GNSS_EPOCH_SECONDS + 24 * 3600 * ( 2048 * 7 + almanac_date ) );
-                    tracker_ctx.last_almanac_update = almanac_date;
-                }
 
-                if( alamac_fragment_id == NB_CHUNK_ALMANAC )
+                /* Acked once queued, the phone sends the next fragment while this one is written */
+                if( alamac_fragment_id <= NB_CHUNK_ALMANAC )
                 {
-                    lr1110_modem_event_fields_t event_fields;
-
-                    HAL_Delay( 100 );
-
-                    lr1110_modem_get_event( &lr1110, &event_fields );
-
-                    if( ( event_fields.buffer[0] == 0x00 ) && ( event_fields.buffer[1] == 0x00 ) )
-                    {
-                        /* store the new almanac update date just once */
-                        tracker_ctx.new_value_to_set = true;
-                    }
-                    else
-                    {
-                        /* reset the date in case of wrong almanac update */
-                        tracker_ctx.last_almanac_update = 0;
-                    }
+                    tracker_almanac_update_push( alamac_fragment_id * NB_SV_PER_CHUNK_ALMANAC, NB_SV_PER_CHUNK_ALMANAC,
+                                                 payload + payload_index );
                 }
 
                 /* Ack the CMD */
@@ -1751,7 +1847,54 @@ uint8_t tracker_parse_cmd( uint8_t* payload, uint8_t* buffer_out )
                 memcpy( buffer_out + output_buffer_index, payload + payload_index, 60 );
                 output_buffer_index += 60;
 
-                payload_index += GNSS_ALMANAC_UPDATE_LEN;
+                payload_index += GNSS_ALMANAC_UPDATE_LEN - 2;  // The fragment id is already parsed
+                break;
+            }
+
+            case GNSS_ALMANAC_FRAGMENT_CMD:
+            {
+                uint16_t                    first_chunk;
+                uint8_t                     nb_chunks;
+                bool                        accepted = false;
+                gnss_almanac_update_state_t almanac_state;
+
+                first_chunk = ( uint16_t ) payload[payload_index] << 8;
+                first_chunk += payload[payload_index + 1];
+                nb_chunks = payload[payload_index + 2];
+
+                /* Up to GNSS_ALMANAC_FRAGMENT_MAX_CHUNKS chunks, acked once queued */
+                if( len == ( 3 + ( nb_chunks * LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE ) ) )
+                {
+                    accepted = tracker_almanac_update_push( first_chunk, nb_chunks, payload + payload_index + 3 );
+                }
+                gnss_almanac_update_get_state( &almanac_state );
+
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = GNSS_ALMANAC_FRAGMENT_CMD;
+                buffer_out[output_buffer_index++] = GNSS_ALMANAC_FRAGMENT_ANSWER_LEN;
+                buffer_out[output_buffer_index++] = first_chunk >> 8;
+                buffer_out[output_buffer_index++] = first_chunk;
+                buffer_out[output_buffer_index++] = accepted;
+                buffer_out[output_buffer_index++] = almanac_state.status;
+
+                payload_index += len;
+                break;
+            }
+
+            case GET_GNSS_ALMANAC_UPDATE_STATUS_CMD:
+            {
+                gnss_almanac_update_state_t almanac_state;
+
+                gnss_almanac_update_get_state( &almanac_state );
+
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = GET_GNSS_ALMANAC_UPDATE_STATUS_CMD;
+                buffer_out[output_buffer_index++] = GET_GNSS_ALMANAC_UPDATE_STATUS_ANSWER_LEN;
+                buffer_out[output_buffer_index++] = almanac_state.status;
+                buffer_out[output_buffer_index++] = almanac_state.nb_chunks_received;
+                buffer_out[output_buffer_index++] = almanac_state.nb_chunks_written;
+
+                payload_index += GET_GNSS_ALMANAC_UPDATE_STATUS_LEN;
                 break;
             }
 
@@ -1828,6 +1971,180 @@ uint8_t tracker_parse_cmd( uint8_t* payload, uint8_t* buffer_out )
                 break;
             }
 
+            case SET_WIFI_EARLY_STOP_CMD:
+            {
+                tracker_ctx.new_value_to_set = true;
+                if( payload[payload_index] <= WIFI_MAX_RESULT_TOTAL )
+                {
+                    /* A target of 0 runs a single passive scan over all the channels */
+                    tracker_ctx.wifi_settings.early_stop_nb_aps     = payload[payload_index];
+                    tracker_ctx.wifi_settings.early_stop_rssi_floor = ( int8_t ) payload[payload_index + 1];
+                }
+                else
+                {
+                    /* Clip the value, NAck with the value in use */
+                    tracker_ctx.wifi_settings.early_stop_nb_aps = WIFI_MAX_RESULT_TOTAL;
+                }
+
+                /* Ack the CMD */
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = SET_WIFI_EARLY_STOP_CMD;
+                buffer_out[output_buffer_index++] = SET_WIFI_EARLY_STOP_LEN;
+                buffer_out[output_buffer_index++] = tracker_ctx.wifi_settings.early_stop_nb_aps;
+                buffer_out[output_buffer_index++] = tracker_ctx.wifi_settings.early_stop_rssi_floor;
+
+                payload_index += SET_WIFI_EARLY_STOP_LEN;
+                break;
+            }
+
+            case GET_WIFI_EARLY_STOP_CMD:
+            {
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = GET_WIFI_EARLY_STOP_CMD;
+                buffer_out[output_buffer_index++] = GET_WIFI_EARLY_STOP_ANSWER_LEN;
+                buffer_out[output_buffer_index++] = tracker_ctx.wifi_settings.early_stop_nb_aps;
+                buffer_out[output_buffer_index++] = tracker_ctx.wifi_settings.early_stop_rssi_floor;
+
+                payload_index += GET_WIFI_EARLY_STOP_LEN;
+                break;
+            }
+
+            case SET_WIFI_FILTER_CMD:
+            {
+                wifi_filter_settings_t wifi_filter_settings;
+
+                wifi_filter_settings.flags      = payload[payload_index];
+                wifi_filter_settings.max_aps    = payload[payload_index + 1];
+                wifi_filter_settings.rssi_floor = ( int8_t ) payload[payload_index + 2];
+                if( wifi_filter_settings_are_valid( &wifi_filter_settings ) == true )
+                {
+                    tracker_ctx.new_value_to_set     = true;
+                    tracker_ctx.wifi_filter_settings = wifi_filter_settings;
+                }
+
+                /* Ack the CMD, NAck with the values in use */
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = SET_WIFI_FILTER_CMD;
+                buffer_out[output_buffer_index++] = SET_WIFI_FILTER_LEN;
+                buffer_out[output_buffer_index++] = tracker_ctx.wifi_filter_settings.flags;
+                buffer_out[output_buffer_index++] = tracker_ctx.wifi_filter_settings.max_aps;
+                buffer_out[output_buffer_index++] = tracker_ctx.wifi_filter_settings.rssi_floor;
+
+                payload_index += SET_WIFI_FILTER_LEN;
+                break;
+            }
+
+            case GET_WIFI_FILTER_CMD:
+            {
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = GET_WIFI_FILTER_CMD;
+                buffer_out[output_buffer_index++] = GET_WIFI_FILTER_ANSWER_LEN;
+                buffer_out[output_buffer_index++] = tracker_ctx.wifi_filter_settings.flags;
+                buffer_out[output_buffer_index++] = tracker_ctx.wifi_filter_settings.max_aps;
+                buffer_out[output_buffer_index++] = tracker_ctx.wifi_filter_settings.rssi_floor;
+
+                payload_index += GET_WIFI_FILTER_LEN;
+                break;
+            }
+
+            case SET_SCAN_POLICY_CMD:
+            {
+                tracker_scheduler_policy_t scan_policy;
+
+                tracker_scheduler_policy_deserialize( payload + payload_index, &scan_policy );
+                if( tracker_scheduler_policy_is_valid( &scan_policy ) == true )
+                {
+                    tracker_ctx.new_value_to_set = true;
+                    tracker_ctx.scan_policy      = scan_policy;
+                }
+
+                /* Ack the CMD, NAck with the policy in use */
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = SET_SCAN_POLICY_CMD;
+                buffer_out[output_buffer_index++] = SET_SCAN_POLICY_LEN;
+                tracker_scheduler_policy_serialize( &tracker_ctx.scan_policy, buffer_out + output_buffer_index );
+                output_buffer_index += SET_SCAN_POLICY_LEN;
+
+                payload_index += SET_SCAN_POLICY_LEN;
+                break;
+            }
+
+            case GET_SCAN_POLICY_CMD:
+            {
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = GET_SCAN_POLICY_CMD;
+                buffer_out[output_buffer_index++] = GET_SCAN_POLICY_ANSWER_LEN;
+                tracker_scheduler_policy_serialize( &tracker_ctx.scan_policy, buffer_out + output_buffer_index );
+                output_buffer_index += GET_SCAN_POLICY_ANSWER_LEN;
+
+                payload_index += GET_SCAN_POLICY_LEN;
+                break;
+            }
+
+            case SET_UPLINK_LATENCY_BOUND_CMD:
+            {
+                uint16_t latency_bound_s;
+
+                latency_bound_s = ( uint16_t ) payload[payload_index] << 8;
+                latency_bound_s += payload[payload_index + 1];
+                if( uplink_aggregator_latency_bound_is_valid( latency_bound_s ) == true )
+                {
+                    tracker_ctx.new_value_to_set       = true;
+                    tracker_ctx.uplink_latency_bound_s = latency_bound_s;
+                }
+
+                /* Ack the CMD, NAck with the latency bound in use */
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = SET_UPLINK_LATENCY_BOUND_CMD;
+                buffer_out[output_buffer_index++] = SET_UPLINK_LATENCY_BOUND_LEN;
+                buffer_out[output_buffer_index++] = tracker_ctx.uplink_latency_bound_s >> 8;
+                buffer_out[output_buffer_index++] = tracker_ctx.uplink_latency_bound_s;
+
+                payload_index += SET_UPLINK_LATENCY_BOUND_LEN;
+                break;
+            }
+
+            case GET_UPLINK_LATENCY_BOUND_CMD:
+            {
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = GET_UPLINK_LATENCY_BOUND_CMD;
+                buffer_out[output_buffer_index++] = GET_UPLINK_LATENCY_BOUND_ANSWER_LEN;
+                buffer_out[output_buffer_index++] = tracker_ctx.uplink_latency_bound_s >> 8;
+                buffer_out[output_buffer_index++] = tracker_ctx.uplink_latency_bound_s;
+
+                payload_index += GET_UPLINK_LATENCY_BOUND_LEN;
+                break;
+            }
+
+            case GET_UPLINK_QUEUE_STATS_CMD:
+            {
+                uplink_queue_stats_t uplink_queue_stats;
+                uint32_t             values[5];
+
+                uplink_queue_get_stats( &uplink_queue_stats );
+                values[0] = uplink_queue_stats.nb_pushed;
+                values[1] = uplink_queue_stats.nb_sent;
+                values[2] = uplink_queue_stats.nb_superseded;
+                values[3] = uplink_queue_stats.nb_expired;
+                values[4] = uplink_queue_stats.nb_overflow;
+
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = GET_UPLINK_QUEUE_STATS_CMD;
+                buffer_out[output_buffer_index++] = GET_UPLINK_QUEUE_STATS_ANSWER_LEN;
+                for( uint8_t i = 0; i < 5; i++ )
+                {
+                    buffer_out[output_buffer_index++] = values[i] >> 24;
+                    buffer_out[output_buffer_index++] = values[i] >> 16;
+                    buffer_out[output_buffer_index++] = values[i] >> 8;
+                    buffer_out[output_buffer_index++] = values[i];
+                }
+                buffer_out[output_buffer_index++] = uplink_queue_stats.nb_queued;
+                buffer_out[output_buffer_index++] = uplink_queue_stats.max_queued;
+
+                payload_index += GET_UPLINK_QUEUE_STATS_LEN;
+                break;
+            }
+
             case GET_WIFI_CHANNELS_CMD:
             {
                 buffer_out[0] += 1;  // Add the element in the output buffer
@@ -2488,6 +2805,188 @@ uint8_t tracker_parse_cmd( uint8_t* payload, uint8_t* buffer_out )
                 break;
             }
 
+            case GET_APP_ENERGY_CMD:
+            {
+                /* The LoRa TX cycle charge is 0 or whole steps of HAL_ENERGY_LORA_TX_RESOLUTION_UAS */
+                hal_energy_report_t energy_report;
+
+                hal_energy_get_report( &energy_report );
+
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = GET_APP_ENERGY_CMD;
+                buffer_out[output_buffer_index++] = GET_APP_ENERGY_ANSWER_LEN;
+                buffer_out[output_buffer_index++] = energy_report.nb_cycles >> 24;
+                buffer_out[output_buffer_index++] = energy_report.nb_cycles >> 16;
+                buffer_out[output_buffer_index++] = energy_report.nb_cycles >> 8;
+                buffer_out[output_buffer_index++] = energy_report.nb_cycles;
+                for( uint8_t i = 0; i < HAL_ENERGY_SUBSYSTEM_NB; i++ )
+                {
+                    buffer_out[output_buffer_index++] = energy_report.total_charge_uah[i] >> 24;
+                    buffer_out[output_buffer_index++] = energy_report.total_charge_uah[i] >> 16;
+                    buffer_out[output_buffer_index++] = energy_report.total_charge_uah[i] >> 8;
+                    buffer_out[output_buffer_index++] = energy_report.total_charge_uah[i];
+                }
+                for( uint8_t i = 0; i < HAL_ENERGY_SUBSYSTEM_NB; i++ )
+                {
+                    buffer_out[output_buffer_index++] = energy_report.cycle_charge_uas[i] >> 24;
+                    buffer_out[output_buffer_index++] = energy_report.cycle_charge_uas[i] >> 16;
+                    buffer_out[output_buffer_index++] = energy_report.cycle_charge_uas[i] >> 8;
+                    buffer_out[output_buffer_index++] = energy_report.cycle_charge_uas[i];
+                }
+
+                payload_index += GET_APP_ENERGY_LEN;
+                break;
+            }
+
+            case RESET_APP_ENERGY_CMD:
+            {
+                tracker_ctx.new_value_to_set = true;
+                hal_energy_reset_total_charge( );
+
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = RESET_APP_ENERGY_CMD;
+                buffer_out[output_buffer_index++] = RESET_APP_ENERGY_LEN;
+
+                payload_index += RESET_APP_ENERGY_LEN;
+                break;
+            }
+
+#if( HAL_PROFILING == HAL_FEATURE_ON )
+            case GET_APP_PROFILING_CMD:
+            {
+                hal_prof_zone_stats_t stats;
+
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = GET_APP_PROFILING_CMD;
+                buffer_out[output_buffer_index++] = GET_APP_PROFILING_ANSWER_LEN;
+                for( uint8_t i = 0; i < HAL_PROF_ZONE_NB; i++ )
+                {
+                    hal_prof_get_zone_stats( ( hal_prof_zone_t ) i, &stats );
+                    buffer_out[output_buffer_index++] = stats.count >> 24;
+                    buffer_out[output_buffer_index++] = stats.count >> 16;
+                    buffer_out[output_buffer_index++] = stats.count >> 8;
+                    buffer_out[output_buffer_index++] = stats.count;
+                    buffer_out[output_buffer_index++] = stats.min >> 24;
+                    buffer_out[output_buffer_index++] = stats.min >> 16;
+                    buffer_out[output_buffer_index++] = stats.min >> 8;
+                    buffer_out[output_buffer_index++] = stats.min;
+                    buffer_out[output_buffer_index++] = stats.max >> 24;
+                    buffer_out[output_buffer_index++] = stats.max >> 16;
+                    buffer_out[output_buffer_index++] = stats.max >> 8;
+                    buffer_out[output_buffer_index++] = stats.max;
+                    buffer_out[output_buffer_index++] = stats.mean >> 24;
+                    buffer_out[output_buffer_index++] = stats.mean >> 16;
+                    buffer_out[output_buffer_index++] = stats.mean >> 8;
+                    buffer_out[output_buffer_index++] = stats.mean;
+                }
+
+                /* Also dump the zones on the debug trace */
+                HAL_PROF_DUMP( );
+
+                payload_index += GET_APP_PROFILING_LEN;
+                break;
+            }
+#endif
+
+            case GET_APP_RESIDENCY_CMD:
+            {
+                hal_residency_report_t residency_report;
+
+                hal_residency_get_report( &residency_report );
+
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = GET_APP_RESIDENCY_CMD;
+                buffer_out[output_buffer_index++] = GET_APP_RESIDENCY_ANSWER_LEN;
+                for( uint8_t state = 0; state < HAL_RESIDENCY_APP_STATE_NB; state++ )
+                {
+                    for( uint8_t mode = 0; mode < HAL_RESIDENCY_MODE_NB; mode++ )
+                    {
+                        buffer_out[output_buffer_index++] = residency_report.time_s[state][mode] >> 24;
+                        buffer_out[output_buffer_index++] = residency_report.time_s[state][mode] >> 16;
+                        buffer_out[output_buffer_index++] = residency_report.time_s[state][mode] >> 8;
+                        buffer_out[output_buffer_index++] = residency_report.time_s[state][mode];
+                    }
+                }
+                for( uint8_t i = 0; i < HAL_RESIDENCY_WAKE_SOURCE_NB; i++ )
+                {
+                    buffer_out[output_buffer_index++] = residency_report.wakeups[i] >> 24;
+                    buffer_out[output_buffer_index++] = residency_report.wakeups[i] >> 16;
+                    buffer_out[output_buffer_index++] = residency_report.wakeups[i] >> 8;
+                    buffer_out[output_buffer_index++] = residency_report.wakeups[i];
+                }
+
+                payload_index += GET_APP_RESIDENCY_LEN;
+                break;
+            }
+
+            case RESET_APP_RESIDENCY_CMD:
+            {
+                hal_residency_reset( );
+
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = RESET_APP_RESIDENCY_CMD;
+                buffer_out[output_buffer_index++] = RESET_APP_RESIDENCY_LEN;
+
+                payload_index += RESET_APP_RESIDENCY_LEN;
+                break;
+            }
+
+            case GET_APP_CLOCK_PROFILES_CMD:
+            {
+                hal_mcu_clock_profile_stats_t clock_stats;
+
+                hal_mcu_get_clock_profile_stats( &clock_stats );
+
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = GET_APP_CLOCK_PROFILES_CMD;
+                buffer_out[output_buffer_index++] = GET_APP_CLOCK_PROFILES_ANSWER_LEN;
+                for( uint8_t i = 0; i < HAL_MCU_CLOCK_PROFILE_NB; i++ )
+                {
+                    uint32_t values[4] = { clock_stats.time_ms[i], clock_stats.charge_uas[i],
+                                           ( uint32_t ) clock_stats.saving_uas[i], clock_stats.switches[i] };
+
+                    for( uint8_t j = 0; j < 4; j++ )
+                    {
+                        buffer_out[output_buffer_index++] = values[j] >> 24;
+                        buffer_out[output_buffer_index++] = values[j] >> 16;
+                        buffer_out[output_buffer_index++] = values[j] >> 8;
+                        buffer_out[output_buffer_index++] = values[j];
+                    }
+                }
+
+                payload_index += GET_APP_CLOCK_PROFILES_LEN;
+                break;
+            }
+
+            case GET_GNSS_ANTENNA_STATS_CMD:
+            {
+                gnss_antenna_stats_t gnss_antenna_stats;
+
+                uint32_t             values[6];
+
+                gnss_antenna_get_stats( &gnss_antenna_stats );
+                values[0] = gnss_antenna_stats.nb_selections;
+                values[1] = gnss_antenna_stats.nb_patch_first;
+                values[2] = gnss_antenna_stats.nb_pcb_first;
+                values[3] = gnss_antenna_stats.nb_explorations;
+                values[4] = gnss_antenna_stats.nb_fallbacks;
+                values[5] = gnss_antenna_stats.nb_scans_saved;
+
+                buffer_out[0] += 1;  // Add the element in the output buffer
+                buffer_out[output_buffer_index++] = GET_GNSS_ANTENNA_STATS_CMD;
+                buffer_out[output_buffer_index++] = GET_GNSS_ANTENNA_STATS_ANSWER_LEN;
+                for( uint8_t i = 0; i < 6; i++ )
+                {
+                    buffer_out[output_buffer_index++] = values[i] >> 24;
+                    buffer_out[output_buffer_index++] = values[i] >> 16;
+                    buffer_out[output_buffer_index++] = values[i] >> 8;
+                    buffer_out[output_buffer_index++] = values[i];
+                }
+
+                payload_index += GET_GNSS_ANTENNA_STATS_LEN;
+                break;
+            }
+
             case SET_APP_INTERNAL_LOG_CMD:
             {
                 tracker_ctx.new_value_to_set = true;
@@ -2552,6 +3051,8 @@ uint8_t tracker_parse_cmd( uint8_t* payload, uint8_t* buffer_out )
             {
                 uint8_t answer_len = 0;
                 static uint8_t internal_buffer[CHUNK_INTERNAL_LOG];
+                /* The log is read back and shifted at a higher clock */
+                hal_mcu_clock_profile_t clock_profile = hal_mcu_set_clock_profile( HAL_MCU_CLOCK_PROFILE_BOOST );
 
                 if( internal_log_scan_index <= tracker_ctx.nb_scan )
                 {
@@ -2601,6 +3102,8 @@ uint8_t tracker_parse_cmd( uint8_t* payload, uint8_t* buffer_out )
                     output_buffer_index += answer_len - 1;
                 }
 
+                hal_mcu_set_clock_profile( clock_profile );
+
                 payload_index += READ_APP_INTERNAL_LOG_LEN;
                 break;
             }
@@ -2650,12 +3153,68 @@ uint8_t tracker_parse_cmd( uint8_t* payload, uint8_t* buffer_out )
         res_size = output_buffer_index;
     }
 
+    HAL_PROF_ZONE_END( HAL_PROF_ZONE_PARSE_CMD );
+
     return res_size;
 }
 
+void tracker_almanac_update_task( void )
+{
+    /* One fragment per run, the BLE events are processed in between */
+    if( gnss_almanac_update_process( &lr1110 ) == true )
+    {
+        UTIL_SEQ_SetTask( 1 << CFG_TASK_TRACKER_ALMANAC_ID, CFG_SCH_PRIO_1 );
+    }
+    tracker_check_almanac_update_completion( );
+}
+
+void tracker_almanac_update_flush( void )
+{
+    while( gnss_almanac_update_process( &lr1110 ) == true )
+    {
+    }
+    tracker_check_almanac_update_completion( );
+}
+
+bool tracker_almanac_update_push( uint16_t first_chunk, uint8_t nb_chunks, const uint8_t* chunks )
+{
+    bool accepted;
+
+    /* The fragments come faster than the LR1110 writes them, write the oldest one now to make room */
+    if( gnss_almanac_update_is_queue_full( ) == true )
+    {
+        gnss_almanac_update_process( &lr1110 );
+    }
+
+    accepted = gnss_almanac_update_push( &lr1110, first_chunk, nb_chunks, chunks );
+    UTIL_SEQ_SetTask( 1 << CFG_TASK_TRACKER_ALMANAC_ID, CFG_SCH_PRIO_1 );
+
+    return accepted;
+}
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+static void tracker_check_almanac_update_completion( void )
+{
+    gnss_almanac_update_state_t almanac_state;
+
+    if( gnss_almanac_update_get_completion( &almanac_state ) == true )
+    {
+        if( almanac_state.status == GNSS_ALMANAC_UPDATE_FAILED )
+        {
+            /* reset the date in case of wrong almanac update */
+            tracker_ctx.last_almanac_update = 0;
+        }
+        else
+        {
+            tracker_ctx.last_almanac_update = GNSS_EPOCH_SECONDS + 24 * 3600 * ( 2048 * 7 + almanac_state.date );
+        }
+        /* store the new almanac update date just once */
+        tracker_ctx.new_value_to_set = true;
+    }
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -43,6 +43,11 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 #include "wifi_scan.h"
+#include "wifi_fingerprint.h"
+#include "wifi_filter.h"
+#include "tracker_scheduler.h"
+#include "uplink_aggregator.h"
+#include "uplink_queue.h"
 #include "gnss_scan.h"
 #include "lr1110_modem_lorawan.h"
 /*
@@ -270,6 +275,53 @@ extern "C" {
 #define GET_APP_ACCUMULATED_CHARGE_ANSWER_LEN 0x04
 #define RESET_APP_ACCUMULATED_CHARGE_CMD 0x4B
 #define RESET_APP_ACCUMULATED_CHARGE_LEN 0x00
+#define GET_APP_ENERGY_CMD 0x4C
+#define GET_APP_ENERGY_LEN 0x00
+#define GET_APP_ENERGY_ANSWER_LEN 0x34
+#define RESET_APP_ENERGY_CMD 0x4D
+#define RESET_APP_ENERGY_LEN 0x00
+#define GET_APP_PROFILING_CMD 0x4E
+#define GET_APP_PROFILING_LEN 0x00
+#define GET_APP_PROFILING_ANSWER_LEN ( HAL_PROF_ZONE_NB * 16 )  // Count, min, max and mean of each zone
+#define GET_APP_RESIDENCY_CMD 0x4F
+#define GET_APP_RESIDENCY_LEN 0x00
+#define GET_APP_RESIDENCY_ANSWER_LEN 0x7C
+#define RESET_APP_RESIDENCY_CMD 0x50
+#define RESET_APP_RESIDENCY_LEN 0x00
+#define GET_APP_CLOCK_PROFILES_CMD 0x51
+#define GET_APP_CLOCK_PROFILES_LEN 0x00
+#define GET_APP_CLOCK_PROFILES_ANSWER_LEN 0x30
+#define SET_WIFI_EARLY_STOP_CMD 0x52
+#define SET_WIFI_EARLY_STOP_LEN 0x02
+#define GET_WIFI_EARLY_STOP_CMD 0x53
+#define GET_WIFI_EARLY_STOP_LEN 0x00
+#define GET_WIFI_EARLY_STOP_ANSWER_LEN 0x02
+#define SET_WIFI_FILTER_CMD 0x54
+#define SET_WIFI_FILTER_LEN 0x03
+#define GET_WIFI_FILTER_CMD 0x55
+#define GET_WIFI_FILTER_LEN 0x00
+#define GET_WIFI_FILTER_ANSWER_LEN 0x03
+#define GET_GNSS_ANTENNA_STATS_CMD 0x56
+#define GET_GNSS_ANTENNA_STATS_LEN 0x00
+#define GET_GNSS_ANTENNA_STATS_ANSWER_LEN 0x18
+#define GNSS_ALMANAC_FRAGMENT_CMD 0x57
+#define GNSS_ALMANAC_FRAGMENT_ANSWER_LEN 0x04
+#define GET_GNSS_ALMANAC_UPDATE_STATUS_CMD 0x58
+#define GET_GNSS_ALMANAC_UPDATE_STATUS_LEN 0x00
+#define GET_GNSS_ALMANAC_UPDATE_STATUS_ANSWER_LEN 0x03
+#define SET_SCAN_POLICY_CMD 0x59
+#define SET_SCAN_POLICY_LEN TRACKER_SCHEDULER_POLICY_LEN
+#define GET_SCAN_POLICY_CMD 0x5A
+#define GET_SCAN_POLICY_LEN 0x00
+#define GET_SCAN_POLICY_ANSWER_LEN TRACKER_SCHEDULER_POLICY_LEN
+#define SET_UPLINK_LATENCY_BOUND_CMD 0x5B
+#define SET_UPLINK_LATENCY_BOUND_LEN 0x02
+#define GET_UPLINK_LATENCY_BOUND_CMD 0x5C
+#define GET_UPLINK_LATENCY_BOUND_LEN 0x00
+#define GET_UPLINK_LATENCY_BOUND_ANSWER_LEN 0x02
+#define GET_UPLINK_QUEUE_STATS_CMD 0x5D
+#define GET_UPLINK_QUEUE_STATS_LEN 0x00
+#define GET_UPLINK_QUEUE_STATS_ANSWER_LEN 0x16
 
 /*
  * -----------------------------------------------------------------------------
@@ -312,13 +364,21 @@ typedef struct
     uint32_t        last_almanac_update;
 
     /* WiFi Parameters */
-    wifi_settings_t wifi_settings;
+    wifi_settings_t        wifi_settings;
+    wifi_filter_settings_t wifi_filter_settings;
 
     /* Application Parameters */
     bool     accelerometer_used;
     uint32_t app_scan_interval;
     uint32_t app_keep_alive_frame_interval;
     uint8_t  accelerometer_move_history;
+
+    /* Scan cadence following the motion */
+    tracker_scheduler_policy_t scan_policy;
+
+    /* Longest time a cycle waits in the aggregated uplink record, 0 to stream every cycle at once */
+    uint16_t uplink_latency_bound_s;
+
     bool     send_alive_frame;
     bool     stream_done;
     bool     airplane_mode;
@@ -343,6 +403,7 @@ typedef struct
     uint8_t                pcb_nav_message[259];
     uint8_t                pcb_nb_detected_satellites;
     wifi_scan_all_result_t wifi_result;
+    wifi_fingerprint_t     wifi_fingerprint;
     int16_t                accelerometer_x;
     int16_t                accelerometer_y;
     int16_t                accelerometer_z;
@@ -458,6 +519,27 @@ uint8_t tracker_get_remaining_memory_space( void );
  */
 uint8_t tracker_parse_cmd( uint8_t* payload, uint8_t* buffer_out );
 
+/*!
+ * \brief Queues an almanac fragment received over BLE or LoRaWAN and posts the almanac update task
+ *
+ * \param [in] first_chunk Index of the first chunk of the fragment, 0 for the header
+ * \param [in] nb_chunks Number of chunks of the fragment
+ * \param [in] chunks Chunks of the fragment
+ *
+ * \retval true if the fragment is accepted
+ */
+bool tracker_almanac_update_push( uint16_t first_chunk, uint8_t nb_chunks, const uint8_t* chunks );
+
+/*!
+ * \brief Almanac update task, writes the almanac fragments received over BLE while the next ones are received
+ */
+void tracker_almanac_update_task( void );
+
+/*!
+ * \brief Writes the almanac fragments still queued, called when the BLE thread terminates
+ */
+void tracker_almanac_update_flush( void );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,237 @@
+/*!
+ * \file      uplink_aggregator.c
+ *
+ * \brief     Aggregation of the scan cycles in the uplink stream records implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "uplink_aggregator.h"
+#include "main_tracker.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*!
+ * \brief Record being filled
+ */
+static uint8_t uplink_aggregator_record[UPLINK_AGGREGATOR_RECORD_MAX];
+static uint8_t uplink_aggregator_len = 0;
+
+/*!
+ * \brief Cycles of the record, index of their header and start time
+ */
+static uint8_t  uplink_aggregator_nb_cycles = 0;
+static uint8_t  uplink_aggregator_cycle_index[UPLINK_AGGREGATOR_MAX_CYCLES];
+static uint32_t uplink_aggregator_cycle_time[UPLINK_AGGREGATOR_MAX_CYCLES];
+
+/*!
+ * \brief Current cycle, its header is written with its first TLV in the record
+ */
+static uint32_t uplink_aggregator_current_time      = 0;
+static bool     uplink_aggregator_current_in_record = false;
+static uint16_t uplink_aggregator_current_len       = 0;  // Bytes taken by the cycle, headers included
+
+/*!
+ * \brief Aggregation statistics
+ */
+static uplink_aggregator_stats_t uplink_aggregator_stats;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void uplink_aggregator_begin_cycle( const uint32_t now )
+{
+    uplink_aggregator_current_time      = now;
+    uplink_aggregator_current_in_record = false;
+    uplink_aggregator_current_len       = 0;
+
+    uplink_aggregator_stats.nb_cycles++;
+}
+
+uint16_t uplink_aggregator_add( const uint8_t* tlvs, const uint16_t len )
+{
+    uint16_t index = 0;
+
+    while( index < len )
+    {
+        uint16_t tlv_len;
+        uint16_t needed;
+
+        if( ( ( index + 1 ) >= len ) || ( ( index + 2 + tlvs[index + 1] ) > len ) )
+        {
+            /* Truncated TLV */
+            uplink_aggregator_stats.nb_dropped++;
+            index = len;
+            break;
+        }
+
+        tlv_len = 2 + tlvs[index + 1];
+        if( tlv_len > ( UPLINK_AGGREGATOR_RECORD_MAX - UPLINK_AGGREGATOR_CYCLE_HEADER_LEN ) )
+        {
+            /* Would not fit in an empty record */
+            uplink_aggregator_stats.nb_dropped++;
+            index += tlv_len;
+            continue;
+        }
+
+        needed = tlv_len;
+        if( uplink_aggregator_current_in_record == false )
+        {
+            if( uplink_aggregator_nb_cycles >= UPLINK_AGGREGATOR_MAX_CYCLES )
+            {
+                break;
+            }
+            needed += UPLINK_AGGREGATOR_CYCLE_HEADER_LEN;
+        }
+        if( ( uplink_aggregator_len + needed ) > UPLINK_AGGREGATOR_RECORD_MAX )
+        {
+            break;
+        }
+
+        if( uplink_aggregator_current_in_record == false )
+        {
+            /* The age is set on submission */
+            uplink_aggregator_cycle_index[uplink_aggregator_nb_cycles] = uplink_aggregator_len;
+            uplink_aggregator_cycle_time[uplink_aggregator_nb_cycles]  = uplink_aggregator_current_time;
+            uplink_aggregator_nb_cycles++;
+
+            uplink_aggregator_record[uplink_aggregator_len++] = TAG_CYCLE;
+            uplink_aggregator_record[uplink_aggregator_len++] = UPLINK_AGGREGATOR_CYCLE_HEADER_LEN - 2;
+            uplink_aggregator_record[uplink_aggregator_len++] = 0;
+            uplink_aggregator_record[uplink_aggregator_len++] = 0;
+
+            uplink_aggregator_current_in_record = true;
+        }
+
+        memcpy( uplink_aggregator_record + uplink_aggregator_len, tlvs + index, tlv_len );
+        uplink_aggregator_len += tlv_len;
+        uplink_aggregator_current_len += needed;
+        index += tlv_len;
+    }
+
+    return index;
+}
+
+bool uplink_aggregator_is_due( const uint32_t now, const uint32_t next_cycle_s, const uint16_t latency_bound_s )
+{
+    if( uplink_aggregator_len == 0 )
+    {
+        return false;
+    }
+
+    if( ( latency_bound_s == 0 ) || ( uplink_aggregator_nb_cycles >= UPLINK_AGGREGATOR_MAX_CYCLES ) )
+    {
+        return true;
+    }
+
+    /* The next cycle is expected as long as the current one */
+    if( ( uplink_aggregator_len + uplink_aggregator_current_len ) > UPLINK_AGGREGATOR_RECORD_MAX )
+    {
+        return true;
+    }
+
+    return ( ( now + next_cycle_s ) - uplink_aggregator_cycle_time[0] ) > latency_bound_s;
+}
+
+uint8_t uplink_aggregator_get_record( const uint32_t now, const uint8_t** record )
+{
+    for( uint8_t i = 0; i < uplink_aggregator_nb_cycles; i++ )
+    {
+        const uint32_t age   = now - uplink_aggregator_cycle_time[i];
+        const uint8_t  index = uplink_aggregator_cycle_index[i];
+
+        uplink_aggregator_record[index + 2] = ( age > 0xFFFF ) ? 0xFF : ( age >> 8 );
+        uplink_aggregator_record[index + 3] = ( age > 0xFFFF ) ? 0xFF : age;
+    }
+
+    *record = uplink_aggregator_record;
+
+    return uplink_aggregator_len;
+}
+
+void uplink_aggregator_release( const bool submitted )
+{
+    if( submitted == true )
+    {
+        uplink_aggregator_stats.nb_records++;
+        uplink_aggregator_stats.nb_bytes += uplink_aggregator_len;
+    }
+    else
+    {
+        uplink_aggregator_stats.nb_failed++;
+    }
+
+    uplink_aggregator_len               = 0;
+    uplink_aggregator_nb_cycles         = 0;
+    uplink_aggregator_current_in_record = false;
+}
+
+bool uplink_aggregator_is_empty( void ) { return uplink_aggregator_len == 0; }
+
+bool uplink_aggregator_latency_bound_is_valid( const uint16_t latency_bound_s )
+{
+    return latency_bound_s <= UPLINK_AGGREGATOR_LATENCY_BOUND_MAX_S;
+}
+
+void uplink_aggregator_get_stats( uplink_aggregator_stats_t* stats ) { *stats = uplink_aggregator_stats; }
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+/* --- EOF ------------------------------------------------------------------ */
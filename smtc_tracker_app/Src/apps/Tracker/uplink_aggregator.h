@@ -0,0 +1,178 @@
+/*!
+ * \file      uplink_aggregator.h
+ *
+ * \brief     Aggregation of the scan cycles in the uplink stream records definition
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __UPLINK_AGGREGATOR_H__
+#define __UPLINK_AGGREGATOR_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * \brief Longest record accepted by lr1110_modem_send_stream_data
+ */
+#define UPLINK_AGGREGATOR_RECORD_MAX 254
+
+/*!
+ * \brief Cycles packed in a record at most
+ */
+#define UPLINK_AGGREGATOR_MAX_CYCLES 8
+
+/*!
+ * \brief Header starting each cycle of a record: TAG_CYCLE, length and age of the cycle in seconds on 16 bits
+ */
+#define UPLINK_AGGREGATOR_CYCLE_HEADER_LEN 4
+
+/*!
+ * \brief Longest time a cycle waits for the submission of its record, 0 submits every cycle at once
+ */
+#define UPLINK_AGGREGATOR_LATENCY_BOUND_DEFAULT_S 300
+#define UPLINK_AGGREGATOR_LATENCY_BOUND_MAX_S 3600
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief Aggregation statistics
+ */
+typedef struct
+{
+    uint32_t nb_cycles;   // Cycles started
+    uint32_t nb_records;  // Records submitted to the stream
+    uint32_t nb_failed;   // Records not accepted by the stream, their cycles are lost
+    uint32_t nb_bytes;    // Bytes submitted, headers included
+    uint32_t nb_dropped;  // TLVs longer than a record, never sent
+} uplink_aggregator_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief Starts a cycle, the next TLVs added are preceded by its header
+ *
+ * \param [in] now Current time in seconds
+ */
+void uplink_aggregator_begin_cycle( const uint32_t now );
+
+/*!
+ * \brief Appends TLVs of the current cycle to the record
+ *
+ * \remark The TLVs are never split, the record is full when the returned length is shorter than the one given and
+ *         has to be submitted before adding the remaining TLVs. A cycle spread over two records has a header in each
+ *
+ * \param [in] tlvs TLVs with a length on one byte
+ * \param [in] len Length of the TLVs
+ *
+ * \return Length of the TLVs taken, dropped ones included
+ */
+uint16_t uplink_aggregator_add( const uint8_t* tlvs, const uint16_t len );
+
+/*!
+ * \brief Tells if the record has to be submitted before the next cycle
+ *
+ * \remark The module has no hardware dependency, recorded cycles can be replayed through it on a host
+ *
+ * \param [in] now Current time in seconds
+ * \param [in] next_cycle_s Interval to the next cycle in seconds
+ * \param [in] latency_bound_s Longest time a cycle waits for the submission, 0 for no aggregation
+ *
+ * \return true if the first cycle of the record would exceed the bound, no other cycle fits or the bound is 0
+ */
+bool uplink_aggregator_is_due( const uint32_t now, const uint32_t next_cycle_s, const uint16_t latency_bound_s );
+
+/*!
+ * \brief Returns the record to submit, the ages of its cycles are set
+ *
+ * \param [in] now Current time in seconds
+ * \param [out] record Record
+ *
+ * \return Length of the record, 0 if empty
+ */
+uint8_t uplink_aggregator_get_record( const uint32_t now, const uint8_t** record );
+
+/*!
+ * \brief Empties the record after its submission
+ *
+ * \param [in] submitted The stream accepted the record
+ */
+void uplink_aggregator_release( const bool submitted );
+
+/*!
+ * \brief Tells if the record is empty, the next cycle starts a new record
+ *
+ * \return true if no TLV waits in the record
+ */
+bool uplink_aggregator_is_empty( void );
+
+/*!
+ * \brief Tells if the latency bound is valid
+ *
+ * \param [in] latency_bound_s Latency bound in seconds
+ *
+ * \return true if not above UPLINK_AGGREGATOR_LATENCY_BOUND_MAX_S
+ */
+bool uplink_aggregator_latency_bound_is_valid( const uint16_t latency_bound_s );
+
+/*!
+ * \brief Returns the aggregation statistics
+ *
+ * \param [out] stats Statistics \ref uplink_aggregator_stats_t
+ */
+void uplink_aggregator_get_stats( uplink_aggregator_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __UPLINK_AGGREGATOR_H__
+
+/* --- EOF ------------------------------------------------------------------ */
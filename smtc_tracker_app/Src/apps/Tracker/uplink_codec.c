@@ -0,0 +1,361 @@
+/*!
+ * \file      uplink_codec.c
+ *
+ * \brief     Compressed uplink payload codec implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "uplink_codec.h"
+#include "main_tracker.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * \brief Resolution of the accelerometer values sent, 8-bit output at +/-2 g
+ */
+#define UPLINK_CODEC_ACC_RESOLUTION_MG 16
+
+/*!
+ * \brief Length of the uncompressed TLVs, for the statistics
+ */
+#define UPLINK_CODEC_RAW_BEACON_LEN 7
+#define UPLINK_CODEC_RAW_SENSORS_LEN ( ( 2 + 9 ) + ( 2 + 4 ) + ( 2 + 2 ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * \brief Bit writer, most significant bit first
+ */
+typedef struct
+{
+    uint8_t* buffer;
+    uint16_t bit_index;
+} uplink_codec_bits_t;
+
+/*!
+ * \brief Entry of the MAC dictionary
+ */
+typedef struct
+{
+    uint8_t  mac[6];
+    uint32_t last_use;  // Tick of the last use, 0 for a free entry
+} uplink_codec_dict_entry_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*!
+ * \brief Sensor values of the previous cycle, the deltas are taken against them
+ */
+static uplink_codec_sensors_t uplink_codec_reference;
+
+/*!
+ * \brief MAC dictionary, the tick is incremented on each MAC encoded
+ */
+static uplink_codec_dict_entry_t uplink_codec_dict[UPLINK_CODEC_DICT_SIZE];
+static uint32_t                  uplink_codec_tick = 0;
+
+/*!
+ * \brief Sequence number of the cycle, a gap tells the decoder a cycle is lost
+ */
+static uint8_t uplink_codec_seq              = 0;
+static uint8_t uplink_codec_cycles_since_key = 0;
+static bool    uplink_codec_key_needed       = true;
+
+/*!
+ * \brief Codec statistics
+ */
+static uplink_codec_stats_t uplink_codec_stats;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief Appends bits to the buffer
+ *
+ * \param [in] bits Bit writer
+ * \param [in] value Value, its nb_bits least significant bits are written
+ * \param [in] nb_bits Number of bits, 32 at most
+ */
+static void uplink_codec_put_bits( uplink_codec_bits_t* bits, const uint32_t value, const uint8_t nb_bits );
+
+/*!
+ * \brief Appends a signed delta, zigzag encoded after a 2 bits prefix giving its length: 0, 4, 16 or 32 bits
+ *
+ * \param [in] bits Bit writer
+ * \param [in] delta Delta to the reference
+ */
+static void uplink_codec_put_delta( uplink_codec_bits_t* bits, const int32_t delta );
+
+/*!
+ * \brief Quantizes an acceleration to the resolution sent, rounded to the nearest
+ *
+ * \param [in] acceleration_mg Acceleration in mg
+ *
+ * \return Acceleration in UPLINK_CODEC_ACC_RESOLUTION_MG steps
+ */
+static int16_t uplink_codec_quantize_acc( const int16_t acceleration_mg );
+
+/*!
+ * \brief Looks a MAC up in the dictionary and adds it if missing, in place of the least recently used entry
+ *
+ * \param [in] mac MAC address
+ * \param [out] index Index of the entry
+ *
+ * \return true if the MAC was in the dictionary
+ */
+static bool uplink_codec_dict_lookup( const uint8_t* mac, uint8_t* index );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+uint8_t uplink_codec_begin_cycle( uint8_t* buffer )
+{
+    uint8_t flags = 0;
+
+    if( ( uplink_codec_key_needed == true ) || ( uplink_codec_cycles_since_key >= ( UPLINK_CODEC_KEY_PERIOD - 1 ) ) )
+    {
+        memset( &uplink_codec_reference, 0, sizeof( uplink_codec_reference ) );
+        memset( uplink_codec_dict, 0, sizeof( uplink_codec_dict ) );
+        uplink_codec_tick             = 0;
+        uplink_codec_cycles_since_key = 0;
+        uplink_codec_key_needed       = false;
+
+        flags |= UPLINK_CODEC_FLAG_KEY;
+        uplink_codec_stats.nb_key_cycles++;
+    }
+    else
+    {
+        uplink_codec_cycles_since_key++;
+    }
+
+    uplink_codec_seq++;
+
+    buffer[0] = TAG_CODEC;
+    buffer[1] = UPLINK_CODEC_HEADER_LEN - 2;
+    buffer[2] = ( UPLINK_CODEC_VERSION << 4 ) | flags;
+    buffer[3] = uplink_codec_seq;
+
+    uplink_codec_stats.nb_cycles++;
+    uplink_codec_stats.encoded_bytes += UPLINK_CODEC_HEADER_LEN;
+
+    return UPLINK_CODEC_HEADER_LEN;
+}
+
+uint8_t uplink_codec_encode_wifi( const wifi_scan_all_result_t* results, uint8_t* buffer )
+{
+    uplink_codec_bits_t bits       = { .buffer = buffer + 2, .bit_index = 0 };
+    uint8_t             nb_results = results->nbr_results;
+    uint8_t             len;
+
+    if( nb_results > WIFI_MAX_RESULT_TOTAL )
+    {
+        nb_results = WIFI_MAX_RESULT_TOTAL;
+    }
+
+    uplink_codec_put_bits( &bits, nb_results, 6 );
+    for( uint8_t i = 0; i < nb_results; i++ )
+    {
+        const int8_t rssi = results->results[i].rssi;
+        uint8_t      index;
+
+        /* RSSI from 0 to -127 dBm */
+        uplink_codec_put_bits( &bits, ( rssi < -127 ) ? 127 : ( ( rssi > 0 ) ? 0 : -rssi ), 7 );
+
+        if( uplink_codec_dict_lookup( results->results[i].mac_address, &index ) == true )
+        {
+            uplink_codec_put_bits( &bits, 1, 1 );
+            uplink_codec_put_bits( &bits, index, UPLINK_CODEC_DICT_INDEX_BITS );
+            uplink_codec_stats.nb_dict_hits++;
+        }
+        else
+        {
+            uplink_codec_put_bits( &bits, 0, 1 );
+            for( uint8_t k = 0; k < 6; k++ )
+            {
+                uplink_codec_put_bits( &bits, results->results[i].mac_address[k], 8 );
+            }
+            uplink_codec_stats.nb_dict_miss++;
+        }
+    }
+
+    len       = 2 + ( ( bits.bit_index + 7 ) >> 3 );
+    buffer[0] = TAG_WIFI_SCAN_DICT;
+    buffer[1] = len - 2;
+
+    uplink_codec_stats.raw_bytes += 2 + ( nb_results * UPLINK_CODEC_RAW_BEACON_LEN );
+    uplink_codec_stats.encoded_bytes += len;
+
+    return len;
+}
+
+uint8_t uplink_codec_encode_sensors( const uplink_codec_sensors_t* sensors, uint8_t* buffer )
+{
+    uplink_codec_bits_t    bits = { .buffer = buffer + 2, .bit_index = 0 };
+    uplink_codec_sensors_t quantized;
+    uint8_t                len;
+
+    quantized                 = *sensors;
+    quantized.accelerometer_x = uplink_codec_quantize_acc( sensors->accelerometer_x );
+    quantized.accelerometer_y = uplink_codec_quantize_acc( sensors->accelerometer_y );
+    quantized.accelerometer_z = uplink_codec_quantize_acc( sensors->accelerometer_z );
+
+    uplink_codec_put_bits( &bits, quantized.move_history, 8 );
+    uplink_codec_put_delta( &bits, quantized.accelerometer_x - uplink_codec_reference.accelerometer_x );
+    uplink_codec_put_delta( &bits, quantized.accelerometer_y - uplink_codec_reference.accelerometer_y );
+    uplink_codec_put_delta( &bits, quantized.accelerometer_z - uplink_codec_reference.accelerometer_z );
+    uplink_codec_put_delta( &bits, quantized.temperature - uplink_codec_reference.temperature );
+    uplink_codec_put_delta( &bits, ( int32_t )( quantized.charge - uplink_codec_reference.charge ) );
+    uplink_codec_put_delta( &bits, quantized.voltage - uplink_codec_reference.voltage );
+
+    uplink_codec_reference = quantized;
+
+    len       = 2 + ( ( bits.bit_index + 7 ) >> 3 );
+    buffer[0] = TAG_SENSORS_PACKED;
+    buffer[1] = len - 2;
+
+    uplink_codec_stats.raw_bytes += UPLINK_CODEC_RAW_SENSORS_LEN;
+    uplink_codec_stats.encoded_bytes += len;
+
+    return len;
+}
+
+void uplink_codec_force_key( void ) { uplink_codec_key_needed = true; }
+
+void uplink_codec_get_stats( uplink_codec_stats_t* stats ) { *stats = uplink_codec_stats; }
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void uplink_codec_put_bits( uplink_codec_bits_t* bits, const uint32_t value, const uint8_t nb_bits )
+{
+    for( int8_t i = nb_bits - 1; i >= 0; i-- )
+    {
+        uint8_t* byte = &bits->buffer[bits->bit_index >> 3];
+
+        if( ( bits->bit_index & 0x07 ) == 0 )
+        {
+            *byte = 0;
+        }
+        if( ( ( value >> i ) & 0x01 ) != 0 )
+        {
+            *byte |= 0x80 >> ( bits->bit_index & 0x07 );
+        }
+        bits->bit_index++;
+    }
+}
+
+static void uplink_codec_put_delta( uplink_codec_bits_t* bits, const int32_t delta )
+{
+    const uint32_t zigzag = ( ( uint32_t ) delta << 1 ) ^ ( ( delta < 0 ) ? 0xFFFFFFFF : 0 );
+
+    if( zigzag == 0 )
+    {
+        uplink_codec_put_bits( bits, 0, 2 );
+    }
+    else if( zigzag < ( 1 << 4 ) )
+    {
+        uplink_codec_put_bits( bits, 1, 2 );
+        uplink_codec_put_bits( bits, zigzag, 4 );
+    }
+    else if( zigzag < ( 1 << 16 ) )
+    {
+        uplink_codec_put_bits( bits, 2, 2 );
+        uplink_codec_put_bits( bits, zigzag, 16 );
+    }
+    else
+    {
+        uplink_codec_put_bits( bits, 3, 2 );
+        uplink_codec_put_bits( bits, zigzag, 32 );
+    }
+}
+
+static int16_t uplink_codec_quantize_acc( const int16_t acceleration_mg )
+{
+    const int32_t half_step = UPLINK_CODEC_ACC_RESOLUTION_MG / 2;
+
+    if( acceleration_mg >= 0 )
+    {
+        return ( acceleration_mg + half_step ) / UPLINK_CODEC_ACC_RESOLUTION_MG;
+    }
+    return -( ( -acceleration_mg + half_step ) / UPLINK_CODEC_ACC_RESOLUTION_MG );
+}
+
+static bool uplink_codec_dict_lookup( const uint8_t* mac, uint8_t* index )
+{
+    uint8_t oldest = 0;
+
+    uplink_codec_tick++;
+
+    for( uint8_t i = 0; i < UPLINK_CODEC_DICT_SIZE; i++ )
+    {
+        if( ( uplink_codec_dict[i].last_use != 0 ) && ( memcmp( uplink_codec_dict[i].mac, mac, 6 ) == 0 ) )
+        {
+            uplink_codec_dict[i].last_use = uplink_codec_tick;
+            *index                        = i;
+            return true;
+        }
+        if( uplink_codec_dict[i].last_use < uplink_codec_dict[oldest].last_use )
+        {
+            oldest = i;
+        }
+    }
+
+    /* Free entries have the smallest tick, the first one is taken */
+    memcpy( uplink_codec_dict[oldest].mac, mac, 6 );
+    uplink_codec_dict[oldest].last_use = uplink_codec_tick;
+    *index                             = oldest;
+
+    return false;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
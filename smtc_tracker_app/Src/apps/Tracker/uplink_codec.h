@@ -0,0 +1,176 @@
+/*!
+ * \file      uplink_codec.h
+ *
+ * \brief     Compressed uplink payload codec definition
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __UPLINK_CODEC_H__
+#define __UPLINK_CODEC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "wifi_scan.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * \brief Version of the codec, sent in the header of each cycle
+ */
+#define UPLINK_CODEC_VERSION 1
+
+/*!
+ * \brief Flags of the cycle header
+ */
+#define UPLINK_CODEC_FLAG_KEY 0x01  // The state is reset, the cycle decodes without the previous ones
+
+/*!
+ * \brief A key cycle is sent at least every UPLINK_CODEC_KEY_PERIOD cycles, a decoder which lost a record resyncs on it
+ */
+#define UPLINK_CODEC_KEY_PERIOD 16
+
+/*!
+ * \brief Rolling MAC dictionary, least recently used entry replaced
+ */
+#define UPLINK_CODEC_DICT_INDEX_BITS 5
+#define UPLINK_CODEC_DICT_SIZE ( 1 << UPLINK_CODEC_DICT_INDEX_BITS )
+
+/*!
+ * \brief Longest TLVs written by the codec
+ */
+#define UPLINK_CODEC_HEADER_LEN 4
+#define UPLINK_CODEC_WIFI_MAX_LEN ( 2 + ( ( 6 + ( WIFI_MAX_RESULT_TOTAL * 56 ) + 7 ) / 8 ) )
+#define UPLINK_CODEC_SENSORS_MAX_LEN ( 2 + 22 )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief Sensor values of a cycle
+ */
+typedef struct
+{
+    uint8_t  move_history;     // Accelerometer movement history
+    int16_t  accelerometer_x;  // mg, sent with the 16 mg resolution of the accelerometer
+    int16_t  accelerometer_y;  // mg
+    int16_t  accelerometer_z;  // mg
+    int16_t  temperature;      // Accelerometer temperature
+    uint32_t charge;           // Accumulated charge
+    uint16_t voltage;          // Board voltage in mV
+} uplink_codec_sensors_t;
+
+/*!
+ * \brief Codec statistics
+ */
+typedef struct
+{
+    uint32_t nb_cycles;      // Cycles encoded
+    uint32_t nb_key_cycles;  // Cycles encoded from a reset state
+    uint32_t nb_dict_hits;   // MACs sent as a dictionary index
+    uint32_t nb_dict_miss;   // MACs sent in full and added to the dictionary
+    uint32_t raw_bytes;      // Length of the Wi-Fi and sensors TLVs without compression
+    uint32_t encoded_bytes;  // Length of the same TLVs compressed, cycle headers included
+} uplink_codec_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief Starts a cycle and writes its header TLV, TAG_CODEC
+ *
+ * \remark The Wi-Fi and sensors TLVs are delta encoded against the previous cycle. The state is reset on a key cycle:
+ *         the first one, every UPLINK_CODEC_KEY_PERIOD cycles and after uplink_codec_force_key
+ *
+ * \param [out] buffer Buffer of UPLINK_CODEC_HEADER_LEN bytes
+ *
+ * \return Length written
+ */
+uint8_t uplink_codec_begin_cycle( uint8_t* buffer );
+
+/*!
+ * \brief Encodes a Wi-Fi scan in a TAG_WIFI_SCAN_DICT TLV
+ *
+ * \remark Each AP takes 7 bits of RSSI and either a dictionary index or its full MAC, added to the dictionary
+ *
+ * \param [in] results Wi-Fi scan results
+ * \param [out] buffer Buffer of UPLINK_CODEC_WIFI_MAX_LEN bytes
+ *
+ * \return Length written
+ */
+uint8_t uplink_codec_encode_wifi( const wifi_scan_all_result_t* results, uint8_t* buffer );
+
+/*!
+ * \brief Encodes the sensor values in a bit packed TAG_SENSORS_PACKED TLV
+ *
+ * \remark Each value but the movement history is a zigzag delta on 0, 4, 16 or 32 bits after a 2 bits prefix
+ *
+ * \param [in] sensors Sensor values \ref uplink_codec_sensors_t
+ * \param [out] buffer Buffer of UPLINK_CODEC_SENSORS_MAX_LEN bytes
+ *
+ * \return Length written
+ */
+uint8_t uplink_codec_encode_sensors( const uplink_codec_sensors_t* sensors, uint8_t* buffer );
+
+/*!
+ * \brief Resets the state on the next cycle, to be called when an encoded cycle is not sent
+ */
+void uplink_codec_force_key( void );
+
+/*!
+ * \brief Returns the codec statistics
+ *
+ * \param [out] stats Statistics \ref uplink_codec_stats_t
+ */
+void uplink_codec_get_stats( uplink_codec_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __UPLINK_CODEC_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,281 @@
+/*!
+ * \file      uplink_queue.c
+ *
+ * \brief     Priority queue of the uplink stream records implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "uplink_queue.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * \brief No record returned by uplink_queue_peek
+ */
+#define UPLINK_QUEUE_NO_RECORD 0xFF
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*!
+ * \brief Queued records, an entry is free when its length is 0
+ */
+static uplink_queue_record_t uplink_queue_records[UPLINK_QUEUE_NB_RECORDS];
+
+/*!
+ * \brief Push counter giving the order of the records
+ */
+static uint32_t uplink_queue_order = 0;
+
+/*!
+ * \brief Record returned by uplink_queue_peek
+ */
+static uint8_t uplink_queue_next = UPLINK_QUEUE_NO_RECORD;
+
+/*!
+ * \brief Called for each record dropped without being sent
+ */
+static uplink_queue_drop_callback_t uplink_queue_drop_callback = NULL;
+
+/*!
+ * \brief Queue statistics
+ */
+static uplink_queue_stats_t uplink_queue_stats;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief Frees an entry and reports its record as dropped
+ *
+ * \param [in] index Index of the entry
+ */
+static void uplink_queue_drop( const uint8_t index );
+
+/*!
+ * \brief Drops the records past their deadline
+ *
+ * \param [in] now Current time in seconds
+ */
+static void uplink_queue_evict_expired( const uint32_t now );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void uplink_queue_init( uplink_queue_drop_callback_t drop_callback )
+{
+    memset( uplink_queue_records, 0, sizeof( uplink_queue_records ) );
+    memset( &uplink_queue_stats, 0, sizeof( uplink_queue_stats ) );
+
+    uplink_queue_order         = 0;
+    uplink_queue_next          = UPLINK_QUEUE_NO_RECORD;
+    uplink_queue_drop_callback = drop_callback;
+}
+
+bool uplink_queue_push( const uint8_t* record, const uint8_t len, const uplink_queue_priority_t priority,
+                        const bool supersedable, const uint32_t deadline, const uint32_t now )
+{
+    uint8_t index = UPLINK_QUEUE_NO_RECORD;
+
+    if( ( len == 0 ) || ( len > UPLINK_AGGREGATOR_RECORD_MAX ) )
+    {
+        return false;
+    }
+
+    uplink_queue_stats.nb_pushed++;
+    uplink_queue_next = UPLINK_QUEUE_NO_RECORD;
+
+    uplink_queue_evict_expired( now );
+
+    /* A newer position report makes the queued ones of the same priority useless */
+    for( uint8_t i = 0; ( supersedable == true ) && ( i < UPLINK_QUEUE_NB_RECORDS ); i++ )
+    {
+        if( ( uplink_queue_records[i].len != 0 ) && ( uplink_queue_records[i].supersedable == true ) &&
+            ( uplink_queue_records[i].priority == priority ) )
+        {
+            uplink_queue_stats.nb_superseded++;
+            uplink_queue_drop( i );
+        }
+    }
+
+    for( uint8_t i = 0; i < UPLINK_QUEUE_NB_RECORDS; i++ )
+    {
+        if( uplink_queue_records[i].len == 0 )
+        {
+            index = i;
+            break;
+        }
+    }
+
+    if( index == UPLINK_QUEUE_NO_RECORD )
+    {
+        /* Full queue, the lowest priority and oldest record goes */
+        index = 0;
+        for( uint8_t i = 1; i < UPLINK_QUEUE_NB_RECORDS; i++ )
+        {
+            if( ( uplink_queue_records[i].priority < uplink_queue_records[index].priority ) ||
+                ( ( uplink_queue_records[i].priority == uplink_queue_records[index].priority ) &&
+                  ( uplink_queue_records[i].order < uplink_queue_records[index].order ) ) )
+            {
+                index = i;
+            }
+        }
+
+        uplink_queue_stats.nb_overflow++;
+        if( uplink_queue_records[index].priority > priority )
+        {
+            if( uplink_queue_drop_callback != NULL )
+            {
+                uplink_queue_drop_callback( record, len );
+            }
+            return false;
+        }
+        uplink_queue_drop( index );
+    }
+
+    memcpy( uplink_queue_records[index].record, record, len );
+    uplink_queue_records[index].len          = len;
+    uplink_queue_records[index].priority     = priority;
+    uplink_queue_records[index].supersedable = supersedable;
+    uplink_queue_records[index].deadline     = deadline;
+    uplink_queue_records[index].order        = uplink_queue_order++;
+
+    uplink_queue_stats.nb_queued++;
+    if( uplink_queue_stats.nb_queued > uplink_queue_stats.max_queued )
+    {
+        uplink_queue_stats.max_queued = uplink_queue_stats.nb_queued;
+    }
+
+    return true;
+}
+
+const uplink_queue_record_t* uplink_queue_peek( const uint32_t now )
+{
+    uplink_queue_evict_expired( now );
+
+    uplink_queue_next = UPLINK_QUEUE_NO_RECORD;
+    for( uint8_t i = 0; i < UPLINK_QUEUE_NB_RECORDS; i++ )
+    {
+        const uplink_queue_record_t* candidate = &uplink_queue_records[i];
+        const uplink_queue_record_t* best;
+
+        if( candidate->len == 0 )
+        {
+            continue;
+        }
+
+        if( uplink_queue_next == UPLINK_QUEUE_NO_RECORD )
+        {
+            uplink_queue_next = i;
+            continue;
+        }
+
+        best = &uplink_queue_records[uplink_queue_next];
+        if( ( candidate->priority > best->priority ) ||
+            ( ( candidate->priority == best->priority ) &&
+              ( ( candidate->deadline < best->deadline ) ||
+                ( ( candidate->deadline == best->deadline ) && ( candidate->order < best->order ) ) ) ) )
+        {
+            uplink_queue_next = i;
+        }
+    }
+
+    return ( uplink_queue_next == UPLINK_QUEUE_NO_RECORD ) ? NULL : &uplink_queue_records[uplink_queue_next];
+}
+
+void uplink_queue_pop( void )
+{
+    if( uplink_queue_next == UPLINK_QUEUE_NO_RECORD )
+    {
+        return;
+    }
+
+    uplink_queue_records[uplink_queue_next].len = 0;
+    uplink_queue_next                           = UPLINK_QUEUE_NO_RECORD;
+
+    uplink_queue_stats.nb_queued--;
+    uplink_queue_stats.nb_sent++;
+}
+
+uint8_t uplink_queue_get_nb_records( void ) { return uplink_queue_stats.nb_queued; }
+
+void uplink_queue_get_stats( uplink_queue_stats_t* stats ) { *stats = uplink_queue_stats; }
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void uplink_queue_drop( const uint8_t index )
+{
+    if( uplink_queue_drop_callback != NULL )
+    {
+        uplink_queue_drop_callback( uplink_queue_records[index].record, uplink_queue_records[index].len );
+    }
+
+    uplink_queue_records[index].len = 0;
+    uplink_queue_stats.nb_queued--;
+}
+
+static void uplink_queue_evict_expired( const uint32_t now )
+{
+    for( uint8_t i = 0; i < UPLINK_QUEUE_NB_RECORDS; i++ )
+    {
+        if( ( uplink_queue_records[i].len != 0 ) && ( now > uplink_queue_records[i].deadline ) )
+        {
+            uplink_queue_stats.nb_expired++;
+            uplink_queue_drop( i );
+        }
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,184 @@
+/*!
+ * \file      uplink_queue.h
+ *
+ * \brief     Priority queue of the uplink stream records definition
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __UPLINK_QUEUE_H__
+#define __UPLINK_QUEUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "uplink_aggregator.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * \brief Records waiting for room in the modem stream at most
+ */
+#define UPLINK_QUEUE_NB_RECORDS 4
+
+/*!
+ * \brief Time a record waits in the queue before being dropped
+ */
+#define UPLINK_QUEUE_POSITION_LIFETIME_S 900
+#define UPLINK_QUEUE_EVENT_LIFETIME_S 3600
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief Priority of a record, the higher ones are streamed first
+ */
+typedef enum
+{
+    UPLINK_QUEUE_PRIORITY_LOW = 0,
+    UPLINK_QUEUE_PRIORITY_NORMAL,
+    UPLINK_QUEUE_PRIORITY_HIGH,
+} uplink_queue_priority_t;
+
+/*!
+ * \brief Queued record
+ */
+typedef struct
+{
+    uint8_t                 record[UPLINK_AGGREGATOR_RECORD_MAX];
+    uint8_t                 len;           // 0 for a free entry
+    uplink_queue_priority_t priority;
+    bool                    supersedable;  // Position report replaced by a newer one of the same priority
+    uint32_t                deadline;      // Time in seconds after which the record is dropped
+    uint32_t                order;         // Push order, the oldest record goes first among equals
+} uplink_queue_record_t;
+
+/*!
+ * \brief Queue statistics
+ */
+typedef struct
+{
+    uint32_t nb_pushed;      // Records pushed
+    uint32_t nb_sent;        // Records handed to the stream
+    uint32_t nb_superseded;  // Position reports replaced by a newer one
+    uint32_t nb_expired;     // Records dropped after their deadline
+    uint32_t nb_overflow;    // Records dropped on a full queue, the lowest priority and oldest one goes
+    uint8_t  nb_queued;      // Records waiting
+    uint8_t  max_queued;     // Highest number of records waiting
+} uplink_queue_stats_t;
+
+/*!
+ * \brief Called for each record dropped without being sent
+ *
+ * \param [in] record Record
+ * \param [in] len Length of the record
+ */
+typedef void ( *uplink_queue_drop_callback_t )( const uint8_t* record, const uint8_t len );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief Empties the queue
+ *
+ * \param [in] drop_callback Called for each record dropped without being sent, can be NULL
+ */
+void uplink_queue_init( uplink_queue_drop_callback_t drop_callback );
+
+/*!
+ * \brief Pushes a record, the expired and superseded ones are dropped first
+ *
+ * \remark On a full queue the record of lowest priority, the oldest first, is dropped. The pushed record itself is
+ *         dropped when all the queued ones have a higher priority
+ *
+ * \param [in] record Record, copied
+ * \param [in] len Length of the record, up to UPLINK_AGGREGATOR_RECORD_MAX
+ * \param [in] priority Priority \ref uplink_queue_priority_t
+ * \param [in] supersedable The queued supersedable records of the same priority are dropped, replaced by this one
+ * \param [in] deadline Time in seconds after which the record is dropped
+ * \param [in] now Current time in seconds
+ *
+ * \return true if the record is queued
+ */
+bool uplink_queue_push( const uint8_t* record, const uint8_t len, const uplink_queue_priority_t priority,
+                        const bool supersedable, const uint32_t deadline, const uint32_t now );
+
+/*!
+ * \brief Returns the next record to stream, the expired ones are dropped first
+ *
+ * \remark The highest priority goes first, then the earliest deadline, then the oldest record
+ *
+ * \param [in] now Current time in seconds
+ *
+ * \return Next record \ref uplink_queue_record_t, NULL if the queue is empty
+ */
+const uplink_queue_record_t* uplink_queue_peek( const uint32_t now );
+
+/*!
+ * \brief Removes the record returned by uplink_queue_peek once handed to the stream
+ */
+void uplink_queue_pop( void );
+
+/*!
+ * \brief Returns the number of records waiting
+ *
+ * \return Number of records
+ */
+uint8_t uplink_queue_get_nb_records( void );
+
+/*!
+ * \brief Returns the queue statistics
+ *
+ * \param [out] stats Statistics \ref uplink_queue_stats_t
+ */
+void uplink_queue_get_stats( uplink_queue_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __UPLINK_QUEUE_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -108,14 +108,16 @@ int main( void )
     HAL_DBG_TRACE_PRINTF( "BOOTLOADER  : %#02X\r\n\r\n", modem.bootloader );
 
     // Wi-Fi Parameters
-    wifi_settings.enabled       = true;
-    wifi_settings.channels      = 0x3FFF;  // by default enable all channels
-    wifi_settings.types         = LR1110_MODEM_WIFI_TYPE_SCAN_B;
-    wifi_settings.scan_mode     = LR1110_MODEM_WIFI_SCAN_MODE_BEACON_AND_PACKET;
-    wifi_settings.nbr_retrials  = WIFI_NBR_RETRIALS_DEFAULT;
-    wifi_settings.max_results   = WIFI_MAX_RESULTS_DEFAULT;
-    wifi_settings.timeout       = WIFI_TIMEOUT_IN_MS_DEFAULT;
-    wifi_settings.result_format = LR1110_MODEM_WIFI_RESULT_FORMAT_BASIC_MAC_TYPE_CHANNEL;
+    wifi_settings.enabled               = true;
+    wifi_settings.channels              = 0x3FFF;  // by default enable all channels
+    wifi_settings.types                 = LR1110_MODEM_WIFI_TYPE_SCAN_B;
+    wifi_settings.scan_mode             = LR1110_MODEM_WIFI_SCAN_MODE_BEACON_AND_PACKET;
+    wifi_settings.nbr_retrials          = WIFI_NBR_RETRIALS_DEFAULT;
+    wifi_settings.max_results           = WIFI_MAX_RESULTS_DEFAULT;
+    wifi_settings.timeout               = WIFI_TIMEOUT_IN_MS_DEFAULT;
+    wifi_settings.result_format         = LR1110_MODEM_WIFI_RESULT_FORMAT_BASIC_MAC_TYPE_CHANNEL;
+    wifi_settings.early_stop_nb_aps     = 0;  // Full passive scan
+    wifi_settings.early_stop_rssi_floor = WIFI_EARLY_STOP_RSSI_FLOOR_DEFAULT;
 
     while( 1 )
     {
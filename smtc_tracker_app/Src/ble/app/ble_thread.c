@@ -64,6 +64,11 @@
  */
 #define CONNECTION_TIMEOUT 120000
 
+/*!
+ * \brief Delay the advertisement and connection timeouts may be served late by to share a wakeup, value in [ms]
+ */
+#define BLE_TIMEOUT_SLACK 1000
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -99,6 +104,11 @@ bool connection_timeout = false;
  */
 bool ble_is_initialized = false;
 
+/*!
+ * \brief BLE thread running flag
+ */
+static bool ble_thread_running = false;
+
 /*!
  * \brief Tracker context structure
  */
@@ -137,10 +147,18 @@ static void on_connection_timeout_event( void* context );
 void start_ble_thread( uint32_t adv_timeout )
 {
     HAL_DBG_TRACE_INFO( "###### ===== START BLE THREAD ==== ######\r\n\r\n" );
+
+    ble_thread_running = true;
+
+    /* The tracker tasks using the radios wait for the end of the BLE thread */
+    UTIL_SEQ_PauseTask( CFG_TASK_TRACKER_BLE_PAUSED_MASK );
     
     /* Stop Hall Effect sensors while the tracker is in BLE mode */
     lr1110_modem_board_hall_effect_enable( false );
 
+    /* The RF needs the voltage range 1, the BLE workloads run at the nominal clock */
+    hal_mcu_set_clock_profile( HAL_MCU_CLOCK_PROFILE_NOMINAL );
+
     Reset_Device( );
     Config_HSE( );
 
@@ -172,10 +190,12 @@ void start_ble_thread( uint32_t adv_timeout )
     {
         timer_init( &advertisement_timeout_timer, on_advertisement_timeout_event );
         timer_set_value( &advertisement_timeout_timer, adv_timeout );
+        timer_set_slack( &advertisement_timeout_timer, BLE_TIMEOUT_SLACK );
         timer_start( &advertisement_timeout_timer );
 
         timer_init( &connection_timeout_timer, on_connection_timeout_event );
         timer_set_value( &connection_timeout_timer, CONNECTION_TIMEOUT );
+        timer_set_slack( &connection_timeout_timer, BLE_TIMEOUT_SLACK );
         
         /* change the value of the watchog to BLE operation */
         hal_mcu_set_software_watchdog_value( CONNECTION_TIMEOUT + tracker_ctx.app_scan_interval);
@@ -186,6 +206,8 @@ void start_ble_thread( uint32_t adv_timeout )
     spdt_2g4_on( );
     set_ble_antenna( );
 
+    hal_energy_set_state( HAL_ENERGY_BLE, HAL_ENERGY_BLE_CURRENT_UA );
+
     while( ( tracker_ctx.ble_disconnected == false ) &&
            ( tracker_ctx.ble_connected == true || advertisement_timeout == false ) )
     {
@@ -227,8 +249,13 @@ void start_ble_thread( uint32_t adv_timeout )
         UTIL_SEQ_Run( UTIL_SEQ_DEFAULT );
     }
 
+    hal_energy_set_state( HAL_ENERGY_BLE, 0 );
+
     leds_off( LED_TX_MASK );
 
+    /* Write the almanac fragments still queued, the update date is stored below */
+    tracker_almanac_update_flush( );
+
     /* Store the new values here only if a reset board is asked */
     if( ( tracker_ctx.new_value_to_set ) == true )
     {
@@ -267,8 +294,14 @@ void start_ble_thread( uint32_t adv_timeout )
     
     /* Start Hall Effect sensors when the tracker leaves the BLE mode */
     lr1110_modem_board_hall_effect_enable( true );
+
+    UTIL_SEQ_ResumeTask( CFG_TASK_TRACKER_BLE_PAUSED_MASK );
+
+    ble_thread_running = false;
 }
 
+bool ble_thread_is_running( void ) { return ble_thread_running; }
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
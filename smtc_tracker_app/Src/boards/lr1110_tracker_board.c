@@ -70,6 +70,11 @@
  */
 static bool modem_is_ready = false;
 
+/*!
+ * \brief Hall effect sensor and sensors supply state
+ */
+static bool hall_effect_enabled = false;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
@@ -200,6 +205,13 @@ void lr1110_modem_board_lna_off( void ) { lna_off( ); }
 
 void lr1110_modem_board_hall_effect_enable( bool enable )
 {
+    /* Called on each cycle, the supply init drives the sensors rail low and would power cycle the sensors */
+    if( enable == hall_effect_enabled )
+    {
+        return;
+    }
+    hall_effect_enabled = enable;
+
     if(enable == true)
     {
         external_supply_init( VCC_SENSORS_SUPPLY_MASK );
@@ -0,0 +1,330 @@
+/*!
+ * \file      gnss_almanac.c
+ *
+ * \brief     GNSS almanac update engine implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "gnss_almanac.h"
+#include "lr1110_tracker_board.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * \brief Almanac header, date on 2 bytes then global CRC on 4 bytes, little endian
+ */
+#define GNSS_ALMANAC_HEADER_DATE_POS ( 1 )
+#define GNSS_ALMANAC_HEADER_CRC_POS ( 3 )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * \brief Fragment waiting to be written
+ */
+typedef struct
+{
+    uint8_t first_chunk;
+    uint8_t nb_chunks;
+    uint8_t chunks[GNSS_ALMANAC_FRAGMENT_MAX_CHUNKS][LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE];
+} gnss_almanac_fragment_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*!
+ * \brief Fragments waiting to be written, circular buffer
+ */
+static gnss_almanac_fragment_t gnss_almanac_queue[GNSS_ALMANAC_QUEUE_SIZE];
+static uint8_t                 gnss_almanac_queue_first = 0;
+static uint8_t                 gnss_almanac_queue_size  = 0;
+
+/*!
+ * \brief State of the update
+ */
+static gnss_almanac_update_state_t gnss_almanac_state = { .status = GNSS_ALMANAC_UPDATE_IDLE };
+
+/*!
+ * \brief The update completed and gnss_almanac_update_get_completion was not called since
+ */
+static bool gnss_almanac_completion_pending = false;
+
+/*!
+ * \brief Almanac requests, the daily budget restarts GNSS_ALMANAC_CHECK_PERIOD_S after the first request of the day
+ */
+static bool     gnss_almanac_request_sent       = false;
+static uint32_t gnss_almanac_request_last_time  = 0;
+static uint32_t gnss_almanac_request_day_start  = 0;
+static uint8_t  gnss_almanac_request_day_count  = 0;
+static uint8_t  gnss_almanac_request_last_chunk = 0;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief Tells if the global almanac CRC of the LR1110 matches the one of the header
+ *
+ * \param [in] context Radio abstraction
+ *
+ * \return true if the CRC matches
+ */
+static bool gnss_almanac_crc_matches( const void* context );
+
+/*!
+ * \brief Ends the update
+ *
+ * \param [in] status Final status of the update \ref gnss_almanac_update_status_t
+ */
+static void gnss_almanac_complete( const gnss_almanac_update_status_t status );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+bool gnss_almanac_update_push( const void* context, const uint16_t first_chunk, const uint8_t nb_chunks,
+                               const uint8_t* chunks )
+{
+    gnss_almanac_fragment_t* fragment;
+
+    if( ( nb_chunks == 0 ) || ( nb_chunks > GNSS_ALMANAC_FRAGMENT_MAX_CHUNKS ) ||
+        ( ( first_chunk + nb_chunks ) > GNSS_ALMANAC_NB_CHUNKS ) )
+    {
+        return false;
+    }
+
+    if( first_chunk == 0 )
+    {
+        // A new update drops the fragments of the previous one
+        gnss_almanac_queue_size  = 0;
+        gnss_almanac_queue_first = 0;
+
+        gnss_almanac_state.status             = GNSS_ALMANAC_UPDATE_ONGOING;
+        gnss_almanac_state.nb_chunks_received = 0;
+        gnss_almanac_state.nb_chunks_written  = 0;
+
+        gnss_almanac_state.date =
+            chunks[GNSS_ALMANAC_HEADER_DATE_POS] + ( ( uint16_t ) chunks[GNSS_ALMANAC_HEADER_DATE_POS + 1] << 8 );
+        gnss_almanac_state.crc = chunks[GNSS_ALMANAC_HEADER_CRC_POS] +
+                                 ( ( uint32_t ) chunks[GNSS_ALMANAC_HEADER_CRC_POS + 1] << 8 ) +
+                                 ( ( uint32_t ) chunks[GNSS_ALMANAC_HEADER_CRC_POS + 2] << 16 ) +
+                                 ( ( uint32_t ) chunks[GNSS_ALMANAC_HEADER_CRC_POS + 3] << 24 );
+
+        if( gnss_almanac_crc_matches( context ) == true )
+        {
+            gnss_almanac_complete( GNSS_ALMANAC_UPDATE_SKIPPED );
+        }
+    }
+    else if( first_chunk != gnss_almanac_state.nb_chunks_received )
+    {
+        return false;
+    }
+
+    if( gnss_almanac_state.status == GNSS_ALMANAC_UPDATE_SKIPPED )
+    {
+        // Nothing to write, the fragments are only acknowledged
+        gnss_almanac_state.nb_chunks_received += nb_chunks;
+        return true;
+    }
+    if( ( gnss_almanac_state.status != GNSS_ALMANAC_UPDATE_ONGOING ) ||
+        ( gnss_almanac_queue_size == GNSS_ALMANAC_QUEUE_SIZE ) )
+    {
+        return false;
+    }
+
+    fragment = &gnss_almanac_queue[( gnss_almanac_queue_first + gnss_almanac_queue_size ) % GNSS_ALMANAC_QUEUE_SIZE];
+    fragment->first_chunk = first_chunk;
+    fragment->nb_chunks   = nb_chunks;
+    memcpy( fragment->chunks, chunks, nb_chunks * LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE );
+    gnss_almanac_queue_size++;
+
+    gnss_almanac_state.nb_chunks_received += nb_chunks;
+    return true;
+}
+
+bool gnss_almanac_update_process( const void* context )
+{
+    const gnss_almanac_fragment_t* fragment;
+
+    if( gnss_almanac_queue_size == 0 )
+    {
+        return false;
+    }
+
+    fragment = &gnss_almanac_queue[gnss_almanac_queue_first];
+
+    for( uint8_t i = 0; ( i < fragment->nb_chunks ) && ( gnss_almanac_state.status == GNSS_ALMANAC_UPDATE_ONGOING );
+         i++ )
+    {
+        if( lr1110_modem_gnss_one_chunk_almanac_update( context, fragment->chunks[i] ) !=
+            LR1110_MODEM_RESPONSE_CODE_OK )
+        {
+            HAL_DBG_TRACE_PRINTF( "Almanac chunk %d write error\r\n", fragment->first_chunk + i );
+            gnss_almanac_complete( GNSS_ALMANAC_UPDATE_FAILED );
+        }
+        else
+        {
+            gnss_almanac_state.nb_chunks_written++;
+        }
+    }
+
+    gnss_almanac_queue_first = ( gnss_almanac_queue_first + 1 ) % GNSS_ALMANAC_QUEUE_SIZE;
+    gnss_almanac_queue_size--;
+
+    if( ( gnss_almanac_state.status == GNSS_ALMANAC_UPDATE_ONGOING ) &&
+        ( gnss_almanac_state.nb_chunks_written == GNSS_ALMANAC_NB_CHUNKS ) )
+    {
+        // The last write returned once the LR1110 was ready, its global CRC tells if the update is complete
+        gnss_almanac_complete( ( gnss_almanac_crc_matches( context ) == true ) ? GNSS_ALMANAC_UPDATE_DONE
+                                                                                : GNSS_ALMANAC_UPDATE_FAILED );
+    }
+
+    if( gnss_almanac_state.status != GNSS_ALMANAC_UPDATE_ONGOING )
+    {
+        gnss_almanac_queue_size = 0;
+    }
+    return gnss_almanac_queue_size != 0;
+}
+
+bool gnss_almanac_update_is_queue_full( void ) { return gnss_almanac_queue_size == GNSS_ALMANAC_QUEUE_SIZE; }
+
+void gnss_almanac_update_get_state( gnss_almanac_update_state_t* state ) { *state = gnss_almanac_state; }
+
+bool gnss_almanac_update_get_completion( gnss_almanac_update_state_t* state )
+{
+    bool completed = gnss_almanac_completion_pending;
+
+    gnss_almanac_completion_pending = false;
+    *state                          = gnss_almanac_state;
+
+    return completed;
+}
+
+bool gnss_almanac_request_get( const void* context, const uint32_t now, const uint32_t almanac_age,
+                               gnss_almanac_request_t* request )
+{
+    lr1110_modem_gnss_context_t gnss_context;
+    bool                        ongoing = gnss_almanac_state.status == GNSS_ALMANAC_UPDATE_ONGOING;
+    uint32_t                    period  = GNSS_ALMANAC_CHECK_PERIOD_S;
+
+    if( ( ongoing == false ) && ( almanac_age <= GNSS_ALMANAC_MAX_AGE_S ) )
+    {
+        return false;
+    }
+
+    if( ongoing == true )
+    {
+        /* The next segment is requested as soon as the previous one is received, the downlink may also be lost */
+        period = ( gnss_almanac_state.nb_chunks_received != gnss_almanac_request_last_chunk )
+                     ? 0
+                     : GNSS_ALMANAC_RETRY_PERIOD_S;
+    }
+    if( ( gnss_almanac_request_sent == true ) && ( ( now - gnss_almanac_request_last_time ) < period ) )
+    {
+        return false;
+    }
+
+    if( ( gnss_almanac_request_sent == false ) ||
+        ( ( now - gnss_almanac_request_day_start ) >= GNSS_ALMANAC_CHECK_PERIOD_S ) )
+    {
+        gnss_almanac_request_day_start = now;
+        gnss_almanac_request_day_count = 0;
+    }
+    if( gnss_almanac_request_day_count >= GNSS_ALMANAC_MAX_REQUESTS_PER_DAY )
+    {
+        return false;
+    }
+
+    if( lr1110_modem_gnss_get_context( context, &gnss_context ) != LR1110_MODEM_RESPONSE_CODE_OK )
+    {
+        return false;
+    }
+
+    request->crc        = gnss_context.global_almanac_crc;
+    request->next_chunk = ( ongoing == true ) ? gnss_almanac_state.nb_chunks_received : 0;
+
+    gnss_almanac_request_sent       = true;
+    gnss_almanac_request_last_time  = now;
+    gnss_almanac_request_last_chunk = gnss_almanac_state.nb_chunks_received;
+    gnss_almanac_request_day_count++;
+
+    HAL_DBG_TRACE_PRINTF( "Almanac request %d/%d, age %d days, CRC 0x%08X, next chunk %d\r\n",
+                          gnss_almanac_request_day_count, GNSS_ALMANAC_MAX_REQUESTS_PER_DAY,
+                          almanac_age / ( 24 * 3600 ), request->crc, request->next_chunk );
+
+    return true;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool gnss_almanac_crc_matches( const void* context )
+{
+    lr1110_modem_gnss_context_t gnss_context;
+
+    if( lr1110_modem_gnss_get_context( context, &gnss_context ) != LR1110_MODEM_RESPONSE_CODE_OK )
+    {
+        return false;
+    }
+    return gnss_context.global_almanac_crc == gnss_almanac_state.crc;
+}
+
+static void gnss_almanac_complete( const gnss_almanac_update_status_t status )
+{
+    gnss_almanac_state.status       = status;
+    gnss_almanac_completion_pending = true;
+
+    HAL_DBG_TRACE_PRINTF( "Almanac update %s, CRC 0x%08X, %d chunks written\r\n",
+                          ( status == GNSS_ALMANAC_UPDATE_DONE )
+                              ? "done"
+                              : ( ( status == GNSS_ALMANAC_UPDATE_SKIPPED ) ? "skipped" : "failed" ),
+                          gnss_almanac_state.crc, gnss_almanac_state.nb_chunks_written );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
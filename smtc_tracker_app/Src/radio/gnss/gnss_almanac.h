@@ -0,0 +1,213 @@
+/*!
+ * \file      gnss_almanac.h
+ *
+ * \brief     GNSS almanac update engine definition
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GNSS_ALMANAC_H__
+#define __GNSS_ALMANAC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1110_modem_gnss.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * \brief Number of chunks of an almanac update, the header then one chunk per satellite
+ */
+#define GNSS_ALMANAC_NB_CHUNKS ( LR1110_MODEM_GNSS_FULL_UPDATE_N_ALMANACS + 1 )
+
+/*!
+ * \brief Number of chunks a fragment carries at most, fits one BLE write with the 156 bytes ATT MTU
+ */
+#define GNSS_ALMANAC_FRAGMENT_MAX_CHUNKS 7
+
+/*!
+ * \brief Number of fragments waiting to be written
+ */
+#define GNSS_ALMANAC_QUEUE_SIZE 4
+
+/*!
+ * \brief Age from which the almanac is refreshed over LoRaWAN, the LR1110 flags almanacs older than one month
+ */
+#define GNSS_ALMANAC_MAX_AGE_S ( 30 * 24 * 3600 )
+
+/*!
+ * \brief Period of the requests while the almanac is too old and no segment is received
+ */
+#define GNSS_ALMANAC_CHECK_PERIOD_S ( 24 * 3600 )
+
+/*!
+ * \brief Period of the requests while an update is ongoing and the last segment requested is not received
+ */
+#define GNSS_ALMANAC_RETRY_PERIOD_S ( 3600 )
+
+/*!
+ * \brief Number of requests a day at most, each one is answered by at most one downlink
+ */
+#define GNSS_ALMANAC_MAX_REQUESTS_PER_DAY 48
+
+/*!
+ * \brief Size of the almanac request added to an uplink, global CRC then next chunk
+ */
+#define GNSS_ALMANAC_REQUEST_LEN 5
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief Almanac update status
+ */
+typedef enum
+{
+    GNSS_ALMANAC_UPDATE_IDLE,
+    GNSS_ALMANAC_UPDATE_ONGOING,
+    GNSS_ALMANAC_UPDATE_SKIPPED,  // The almanac of the LR1110 already has the CRC of the header
+    GNSS_ALMANAC_UPDATE_DONE,     // All the chunks written and the CRC verified
+    GNSS_ALMANAC_UPDATE_FAILED,
+} gnss_almanac_update_status_t;
+
+/*!
+ * \brief Almanac update state
+ */
+typedef struct
+{
+    gnss_almanac_update_status_t status;
+    uint16_t                     date;                // Almanac date from the header, days since the GPS epoch
+    uint32_t                     crc;                 // Global almanac CRC from the header
+    uint8_t                      nb_chunks_received;  // Chunks received in sequence
+    uint8_t                      nb_chunks_written;   // Chunks written to the LR1110
+} gnss_almanac_update_state_t;
+
+/*!
+ * \brief Almanac request, the application server answers with the segment starting at next_chunk
+ */
+typedef struct
+{
+    uint32_t crc;         // Global almanac CRC of the LR1110
+    uint8_t  next_chunk;  // First chunk of the segment to send, 0 to restart the update with the header
+} gnss_almanac_request_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief Queues a fragment of the almanac update
+ *
+ * \remark A fragment starting with the header restarts the update. The global CRC of the LR1110 is read then, and
+ *         the update is skipped if it already matches the header
+ *
+ * \param [in] context Radio abstraction
+ * \param [in] first_chunk Index of the first chunk of the fragment, 0 for the header
+ * \param [in] nb_chunks Number of chunks of the fragment
+ * \param [in] chunks Chunks of LR1110_MODEM_GNSS_SINGLE_ALMANAC_WRITE_SIZE bytes
+ *
+ * \return false if the fragment is out of sequence or the queue is full
+ */
+bool gnss_almanac_update_push( const void* context, const uint16_t first_chunk, const uint8_t nb_chunks,
+                               const uint8_t* chunks );
+
+/*!
+ * \brief Writes the oldest queued fragment, the CRC is verified once the last chunk is written
+ *
+ * \remark Each chunk is written as soon as the LR1110 is ready, the driver waiting on its busy line
+ *
+ * \param [in] context Radio abstraction
+ *
+ * \return true if fragments are left in the queue
+ */
+bool gnss_almanac_update_process( const void* context );
+
+/*!
+ * \brief Tells if the queue is full
+ *
+ * \return true if no fragment can be queued
+ */
+bool gnss_almanac_update_is_queue_full( void );
+
+/*!
+ * \brief Returns the state of the update
+ *
+ * \param [out] state State of the update \ref gnss_almanac_update_state_t
+ */
+void gnss_almanac_update_get_state( gnss_almanac_update_state_t* state );
+
+/*!
+ * \brief Returns the state of the update once when it completes
+ *
+ * \param [out] state State of the update \ref gnss_almanac_update_state_t
+ *
+ * \return true if the update completed since the last call
+ */
+bool gnss_almanac_update_get_completion( gnss_almanac_update_state_t* state );
+
+/*!
+ * \brief Tells if the almanac is to be requested over LoRaWAN and gives the request
+ *
+ * \remark While an update is ongoing the next segment is requested, otherwise the almanac is checked once every
+ *         GNSS_ALMANAC_CHECK_PERIOD_S when older than GNSS_ALMANAC_MAX_AGE_S. The requests are limited to
+ *         GNSS_ALMANAC_MAX_REQUESTS_PER_DAY, a returned request is counted as sent
+ *
+ * \param [in] context Radio abstraction
+ * \param [in] now Current time in seconds
+ * \param [in] almanac_age Age of the almanac in seconds
+ * \param [out] request Request to add to the next uplink
+ *
+ * \return true if the request is to be sent
+ */
+bool gnss_almanac_request_get( const void* context, const uint32_t now, const uint32_t almanac_age,
+                               gnss_almanac_request_t* request );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __GNSS_ALMANAC_H__
+
+/* --- EOF ------------------------------------------------------------------ */
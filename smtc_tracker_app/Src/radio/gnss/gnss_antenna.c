@@ -0,0 +1,266 @@
+/*!
+ * \file      gnss_antenna.c
+ *
+ * \brief     Learned GNSS antenna selection implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "gnss_antenna.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * \brief Number of antennas
+ */
+#define GNSS_ANTENNA_NB ( 2 )
+
+/*!
+ * \brief An axis gives the orientation when it measures at least this part of the gravity, value in [mg]
+ */
+#define GNSS_ANTENNA_GRAVITY_MIN_MG ( 700 )
+
+/*!
+ * \brief Both antennas are scanned until each has this number of scans in the window
+ */
+#define GNSS_ANTENNA_LEARNING_SCANS ( 3 )
+
+/*!
+ * \brief Both antennas are scanned again every GNSS_ANTENNA_EXPLORE_PERIOD selections in an orientation
+ */
+#define GNSS_ANTENNA_EXPLORE_PERIOD ( 16 )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * \brief Last scans of an antenna in an orientation
+ */
+typedef struct
+{
+    uint8_t nb_satellites[GNSS_ANTENNA_WINDOW];  // Satellites detected, circular buffer
+    uint8_t nb_scans;                             // Scans in the window
+    uint8_t next;                                 // Next slot written
+} gnss_antenna_window_t;
+
+/*!
+ * \brief Statistics learned in an orientation
+ */
+typedef struct
+{
+    gnss_antenna_window_t windows[GNSS_ANTENNA_NB];
+    uint8_t               selections_since_explore;
+} gnss_antenna_orientation_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*!
+ * \brief Statistics per orientation
+ */
+static gnss_antenna_orientation_stats_t gnss_antenna_orientations[GNSS_ANTENNA_ORIENTATION_NB];
+
+/*!
+ * \brief Antenna selection statistics
+ */
+static gnss_antenna_stats_t gnss_antenna_stats;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief Returns the score of an antenna over its window, the number of solvable scans then the number of satellites
+ *
+ * \param [in] window Window of the antenna
+ *
+ * \return Score of the antenna
+ */
+static uint16_t gnss_antenna_get_score( const gnss_antenna_window_t* window );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+gnss_antenna_orientation_t gnss_antenna_get_orientation( const int16_t x_mg, const int16_t y_mg, const int16_t z_mg )
+{
+    const int16_t axes[3] = { x_mg, y_mg, z_mg };
+    uint8_t       axis    = 0;
+
+    for( uint8_t i = 1; i < 3; i++ )
+    {
+        if( abs( axes[i] ) > abs( axes[axis] ) )
+        {
+            axis = i;
+        }
+    }
+
+    if( abs( axes[axis] ) < GNSS_ANTENNA_GRAVITY_MIN_MG )
+    {
+        return GNSS_ANTENNA_ORIENTATION_UNKNOWN;
+    }
+    // The orientations are ordered by axis, the up one first
+    return ( gnss_antenna_orientation_t )( ( axis * 2 ) + ( ( axes[axis] > 0 ) ? 0 : 1 ) );
+}
+
+void gnss_antenna_select( const gnss_antenna_orientation_t orientation, const uint8_t allowed,
+                          gnss_antenna_selection_t* selection )
+{
+    gnss_antenna_orientation_stats_t* stats = &gnss_antenna_orientations[orientation];
+    uint16_t                          score_patch;
+    uint16_t                          score_pcb;
+
+    selection->has_second = false;
+    selection->scan_both  = false;
+
+    if( ( allowed & GNSS_PCB_ANTENNA ) == 0 )
+    {
+        selection->first = GNSS_PATCH_ANTENNA;
+        return;
+    }
+    if( ( allowed & GNSS_PATCH_ANTENNA ) == 0 )
+    {
+        selection->first = GNSS_PCB_ANTENNA;
+        return;
+    }
+
+    gnss_antenna_stats.nb_selections++;
+
+    score_patch = gnss_antenna_get_score( &stats->windows[GNSS_PATCH_ANTENNA - 1] );
+    score_pcb   = gnss_antenna_get_score( &stats->windows[GNSS_PCB_ANTENNA - 1] );
+
+    // The patch antenna wins a tie, it was the one scanned first
+    selection->has_second = true;
+    if( score_pcb > score_patch )
+    {
+        selection->first  = GNSS_PCB_ANTENNA;
+        selection->second = GNSS_PATCH_ANTENNA;
+        gnss_antenna_stats.nb_pcb_first++;
+    }
+    else
+    {
+        selection->first  = GNSS_PATCH_ANTENNA;
+        selection->second = GNSS_PCB_ANTENNA;
+        gnss_antenna_stats.nb_patch_first++;
+    }
+
+    if( ( stats->windows[GNSS_PATCH_ANTENNA - 1].nb_scans < GNSS_ANTENNA_LEARNING_SCANS ) ||
+        ( stats->windows[GNSS_PCB_ANTENNA - 1].nb_scans < GNSS_ANTENNA_LEARNING_SCANS ) ||
+        ( stats->selections_since_explore >= GNSS_ANTENNA_EXPLORE_PERIOD ) )
+    {
+        selection->scan_both            = true;
+        stats->selections_since_explore = 0;
+        gnss_antenna_stats.nb_explorations++;
+    }
+    else
+    {
+        stats->selections_since_explore++;
+    }
+}
+
+void gnss_antenna_add_result( const gnss_antenna_orientation_t orientation, const antenna_t antenna,
+                              const uint8_t nb_satellites )
+{
+    gnss_antenna_window_t* window = &gnss_antenna_orientations[orientation].windows[antenna - 1];
+
+    window->nb_satellites[window->next] = nb_satellites;
+    window->next                        = ( window->next + 1 ) % GNSS_ANTENNA_WINDOW;
+    if( window->nb_scans < GNSS_ANTENNA_WINDOW )
+    {
+        window->nb_scans++;
+    }
+}
+
+void gnss_antenna_count_second( const gnss_antenna_selection_t* selection, const bool second_scanned )
+{
+    if( selection->has_second == false )
+    {
+        return;
+    }
+
+    if( second_scanned == false )
+    {
+        gnss_antenna_stats.nb_scans_saved++;
+    }
+    else if( selection->scan_both == false )
+    {
+        gnss_antenna_stats.nb_fallbacks++;
+    }
+}
+
+void gnss_antenna_get_stats( gnss_antenna_stats_t* stats ) { *stats = gnss_antenna_stats; }
+
+void gnss_antenna_reset( void )
+{
+    memset( gnss_antenna_orientations, 0, sizeof( gnss_antenna_orientations ) );
+    memset( &gnss_antenna_stats, 0, sizeof( gnss_antenna_stats ) );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint16_t gnss_antenna_get_score( const gnss_antenna_window_t* window )
+{
+    uint16_t nb_solvable   = 0;
+    uint16_t nb_satellites = 0;
+
+    for( uint8_t i = 0; i < window->nb_scans; i++ )
+    {
+        if( window->nb_satellites[i] > GNSS_ANTENNA_FALLBACK_NB_SAT )
+        {
+            nb_solvable++;
+        }
+        nb_satellites += window->nb_satellites[i];
+    }
+
+    // The solvable scans count first, the number of satellites breaks the ties
+    return ( nb_solvable << 8 ) + ( ( nb_satellites > 0xFF ) ? 0xFF : nb_satellites );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
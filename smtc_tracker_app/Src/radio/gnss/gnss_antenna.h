@@ -0,0 +1,177 @@
+/*!
+ * \file      gnss_antenna.h
+ *
+ * \brief     Learned GNSS antenna selection definition
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GNSS_ANTENNA_H__
+#define __GNSS_ANTENNA_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include "gnss_scan.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * \brief Number of scans per antenna and orientation the selection is learned over
+ */
+#define GNSS_ANTENNA_WINDOW 8
+
+/*!
+ * \brief The second antenna is scanned when the first one detects this number of satellites or fewer
+ */
+#define GNSS_ANTENNA_FALLBACK_NB_SAT 2
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief Orientation of the tracker, axis of the accelerometer pointing up
+ */
+typedef enum
+{
+    GNSS_ANTENNA_ORIENTATION_X_UP,
+    GNSS_ANTENNA_ORIENTATION_X_DOWN,
+    GNSS_ANTENNA_ORIENTATION_Y_UP,
+    GNSS_ANTENNA_ORIENTATION_Y_DOWN,
+    GNSS_ANTENNA_ORIENTATION_Z_UP,
+    GNSS_ANTENNA_ORIENTATION_Z_DOWN,
+    GNSS_ANTENNA_ORIENTATION_UNKNOWN,  // No axis dominates, the tracker is moved or tilted
+    GNSS_ANTENNA_ORIENTATION_NB,
+} gnss_antenna_orientation_t;
+
+/*!
+ * \brief Antennas to scan
+ */
+typedef struct
+{
+    antenna_t first;       // Antenna expected to detect the most satellites
+    bool      has_second;  // The other antenna is allowed too
+    antenna_t second;      // Other antenna, scanned on fallback
+    bool      scan_both;   // Both antennas are scanned to learn their statistics
+} gnss_antenna_selection_t;
+
+/*!
+ * \brief Antenna selection statistics
+ */
+typedef struct
+{
+    uint32_t nb_selections;    // Selections between both antennas
+    uint32_t nb_patch_first;   // Selections of the patch antenna first
+    uint32_t nb_pcb_first;     // Selections of the PCB antenna first
+    uint32_t nb_explorations;  // Both antennas scanned to learn
+    uint32_t nb_fallbacks;     // Second antenna scanned as the first one detected too few satellites
+    uint32_t nb_scans_saved;   // Second antenna not scanned
+} gnss_antenna_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief Returns the orientation of the tracker from the gravity measured by the accelerometer
+ *
+ * \param [in] x_mg Acceleration on the X axis in mg
+ * \param [in] y_mg Acceleration on the Y axis in mg
+ * \param [in] z_mg Acceleration on the Z axis in mg
+ *
+ * \return Orientation \ref gnss_antenna_orientation_t
+ */
+gnss_antenna_orientation_t gnss_antenna_get_orientation( const int16_t x_mg, const int16_t y_mg, const int16_t z_mg );
+
+/*!
+ * \brief Selects the antennas to scan
+ *
+ * \remark Both antennas are scanned while their statistics in this orientation are learned and periodically
+ *         afterwards. Otherwise the antenna with the most solvable scans, then the most satellites, over the
+ *         window is scanned first
+ *
+ * \param [in] orientation Orientation of the tracker \ref gnss_antenna_orientation_t
+ * \param [in] allowed Antennas allowed, GNSS_PATCH_ANTENNA and / or GNSS_PCB_ANTENNA
+ * \param [out] selection Antennas to scan \ref gnss_antenna_selection_t
+ */
+void gnss_antenna_select( const gnss_antenna_orientation_t orientation, const uint8_t allowed,
+                          gnss_antenna_selection_t* selection );
+
+/*!
+ * \brief Adds the result of a scan to the statistics of the antenna in this orientation
+ *
+ * \param [in] orientation Orientation of the tracker during the scan \ref gnss_antenna_orientation_t
+ * \param [in] antenna Antenna scanned \ref antenna_t
+ * \param [in] nb_satellites Number of satellites detected, 0 if the scan failed
+ */
+void gnss_antenna_add_result( const gnss_antenna_orientation_t orientation, const antenna_t antenna,
+                              const uint8_t nb_satellites );
+
+/*!
+ * \brief Counts the scan of the second antenna, or the scan saved
+ *
+ * \param [in] selection Antennas selected \ref gnss_antenna_selection_t
+ * \param [in] second_scanned The second antenna was scanned
+ */
+void gnss_antenna_count_second( const gnss_antenna_selection_t* selection, const bool second_scanned );
+
+/*!
+ * \brief Returns the antenna selection statistics
+ *
+ * \param [out] stats Statistics \ref gnss_antenna_stats_t
+ */
+void gnss_antenna_get_stats( gnss_antenna_stats_t* stats );
+
+/*!
+ * \brief Forgets the learned statistics
+ */
+void gnss_antenna_reset( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __GNSS_ANTENNA_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -159,7 +159,10 @@ gnss_scan_result_t gnss_scan_execute( const void* context )
     lr1110_modem_response_code_t modem_response_code = LR1110_MODEM_RESPONSE_CODE_OK;
     uint8_t                      nb_detected_satellites = 0;
     gnss_scan_result_t           scan_result            = GNSS_SCAN_SUCCESS;
+    hal_mcu_clock_profile_t      clock_profile;
 
+    // The MCU only waits for the radio during the capture
+    clock_profile     = hal_mcu_set_clock_profile( HAL_MCU_CLOCK_PROFILE_LOW );
     gnss_scan_timeout = false;
 
     timer_start( &gnss_scan_timeout_timer );
@@ -178,6 +181,7 @@ gnss_scan_result_t gnss_scan_execute( const void* context )
 
             /* Switch on the LNA */
             lr1110_modem_board_lna_on( );
+            hal_energy_set_state( HAL_ENERGY_GNSS, HAL_ENERGY_GNSS_CURRENT_UA );
 
             if( scan_type == AUTONOMOUS_MODE )
             {
@@ -207,11 +211,15 @@ gnss_scan_result_t gnss_scan_execute( const void* context )
 
         case GNSS_GET_RESULTS:
 
+            HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_GNSS_RESULTS );
+
             modem_response_code = lr1110_modem_gnss_get_nb_detected_satellites( context, &nb_detected_satellites );
             gnss.capture_result.nb_detected_satellites = nb_detected_satellites;
             modem_response_code = lr1110_modem_gnss_get_detected_satellites( context, nb_detected_satellites,
                                                                              gnss.capture_result.detected_satellites );
 
+            HAL_PROF_ZONE_END( HAL_PROF_ZONE_GNSS_RESULTS );
+
             gnss.state = GNSS_TERMINATED;
 
             break;
@@ -230,6 +238,7 @@ gnss_scan_result_t gnss_scan_execute( const void* context )
 
     /* Switch off the LNA */
     lr1110_modem_board_lna_off( );
+    hal_energy_set_state( HAL_ENERGY_GNSS, 0 );
 
     timer_stop( &gnss_scan_timeout_timer );
 
@@ -238,6 +247,8 @@ gnss_scan_result_t gnss_scan_execute( const void* context )
         scan_result = GNSS_SCAN_FAIL;
     }
 
+    hal_mcu_set_clock_profile( clock_profile );
+
     return scan_result;
 }
 
@@ -0,0 +1,448 @@
+/*!
+ * \file      wifi_channel_plan.c
+ *
+ * \brief     Learned Wi-Fi channel plan per site implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include "wifi_channel_plan.h"
+#include "lr1110_tracker_board.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * \brief Version of the serialized channel plan, erased flash reads as an invalid version
+ */
+#define WIFI_CHANNEL_PLAN_VERSION ( 0x01 )
+
+/*!
+ * \brief Number of scans of a new site during which all the channels are scanned
+ */
+#define WIFI_CHANNEL_PLAN_LEARNING_SCANS ( 4 )
+
+/*!
+ * \brief A known site is fully scanned again every WIFI_CHANNEL_PLAN_EXPLORE_PERIOD scans
+ */
+#define WIFI_CHANNEL_PLAN_EXPLORE_PERIOD ( 8 )
+
+/*!
+ * \brief Hit rates, 255 when the channel always has results. The channels under WIFI_CHANNEL_PLAN_HIT_RATE_MIN are
+ *        only scanned when exploring
+ */
+#define WIFI_CHANNEL_PLAN_HIT_RATE_MAX ( 255 )
+#define WIFI_CHANNEL_PLAN_HIT_RATE_INIT ( 128 )
+#define WIFI_CHANNEL_PLAN_HIT_RATE_MIN ( 48 )
+
+/*!
+ * \brief Hit rates are averaged over about 2^WIFI_CHANNEL_PLAN_HIT_RATE_SHIFT scans
+ */
+#define WIFI_CHANNEL_PLAN_HIT_RATE_SHIFT ( 2 )
+
+/*!
+ * \brief Number of AP hashes identifying a site
+ */
+#define WIFI_CHANNEL_PLAN_NB_SIGNATURES ( 2 )
+
+/*!
+ * \brief Saturation of the scan counters serialized on 4 bits
+ */
+#define WIFI_CHANNEL_PLAN_COUNTER_MAX ( 15 )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * \brief Statistics learned at a site
+ */
+typedef struct
+{
+    uint16_t signature[WIFI_CHANNEL_PLAN_NB_SIGNATURES];  // Hashes of the strongest fixed APs of the last scan
+    uint8_t  hit_rate[WIFI_CHANNEL_PLAN_NB_CHANNELS];     // Rate of the scans with results on each channel
+    uint8_t  nb_scans;                                     // Scans at the site, 0 for an empty slot
+    uint8_t  scans_since_explore;                          // Scans since all the channels were scanned
+} wifi_channel_plan_site_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*!
+ * \brief Learned sites, the most recently recognized first
+ */
+static wifi_channel_plan_site_t wifi_sites[WIFI_CHANNEL_PLAN_NB_SITES];
+
+/*!
+ * \brief The last scan recognized wifi_sites[0]
+ */
+static bool wifi_site_current = false;
+
+/*!
+ * \brief The last plan scanned all the channels allowed
+ */
+static bool wifi_plan_exploring = true;
+
+/*!
+ * \brief Order used without statistics, the non-overlapping channels most APs are set on come first
+ */
+static const lr1110_modem_wifi_channel_t wifi_default_order[WIFI_CHANNEL_PLAN_NB_CHANNELS] = { 1, 6, 11, 3, 9,  2,  4,
+                                                                                             5, 7, 8,  10, 12, 13, 14 };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief Returns a 16-bit hash of a MAC address
+ *
+ * \param [in] mac_address MAC address
+ *
+ * \return Hash of the MAC address
+ */
+static uint16_t wifi_channel_plan_hash( const lr1110_modem_wifi_mac_address_t mac_address );
+
+/*!
+ * \brief Looks for the learned site one of the results belongs to
+ *
+ * \param [in] results Results of the scan \ref wifi_scan_all_result_t
+ *
+ * \return Index of the site, WIFI_CHANNEL_PLAN_NB_SITES if the site is not known
+ */
+static uint8_t wifi_channel_plan_find_site( const wifi_scan_all_result_t* results );
+
+/*!
+ * \brief Sets the signature of a site to the strongest APs of the results, the fixed ones first
+ *
+ * \param [out] site Site to update
+ * \param [in] results Results of the scan \ref wifi_scan_all_result_t
+ */
+static void wifi_channel_plan_set_signature( wifi_channel_plan_site_t* site, const wifi_scan_all_result_t* results );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void wifi_channel_plan_get( const lr1110_modem_wifi_channel_mask_t allowed, wifi_channel_plan_t* plan )
+{
+    const wifi_channel_plan_site_t* site = ( wifi_site_current == true ) ? &wifi_sites[0] : NULL;
+
+    memcpy( plan->order, wifi_default_order, sizeof( plan->order ) );
+
+    if( site == NULL )
+    {
+        wifi_plan_exploring = true;
+        plan->mask          = allowed;
+        plan->fallback      = 0;
+        return;
+    }
+
+    // Insertion sort on the hit rates, stable so that the default order breaks the ties
+    for( uint8_t i = 1; i < WIFI_CHANNEL_PLAN_NB_CHANNELS; i++ )
+    {
+        lr1110_modem_wifi_channel_t channel = plan->order[i];
+        uint8_t                     j       = i;
+
+        while( ( j > 0 ) && ( site->hit_rate[plan->order[j - 1] - 1] < site->hit_rate[channel - 1] ) )
+        {
+            plan->order[j] = plan->order[j - 1];
+            j--;
+        }
+        plan->order[j] = channel;
+    }
+
+    wifi_plan_exploring = ( site->nb_scans < WIFI_CHANNEL_PLAN_LEARNING_SCANS ) ||
+                          ( site->scans_since_explore >= WIFI_CHANNEL_PLAN_EXPLORE_PERIOD );
+
+    plan->mask = 0;
+    if( wifi_plan_exploring == false )
+    {
+        for( uint8_t i = 0; i < WIFI_CHANNEL_PLAN_NB_CHANNELS; i++ )
+        {
+            if( site->hit_rate[i] >= WIFI_CHANNEL_PLAN_HIT_RATE_MIN )
+            {
+                plan->mask |= 1 << i;
+            }
+        }
+        plan->mask &= allowed;
+    }
+
+    if( plan->mask == 0 )
+    {
+        wifi_plan_exploring = true;
+        plan->mask          = allowed;
+    }
+    plan->fallback = allowed & ~plan->mask;
+}
+
+void wifi_channel_plan_update( const wifi_scan_all_result_t* results, const lr1110_modem_wifi_channel_mask_t scanned )
+{
+    wifi_channel_plan_site_t         site;
+    lr1110_modem_wifi_channel_mask_t hits = 0;
+    uint8_t                          index;
+
+    if( results->nbr_results == 0 )
+    {
+        // Nothing tells where the tracker is
+        wifi_site_current = false;
+        return;
+    }
+
+    for( uint8_t i = 0; i < results->nbr_results; i++ )
+    {
+        if( ( results->results[i].channel >= 1 ) && ( results->results[i].channel <= WIFI_CHANNEL_PLAN_NB_CHANNELS ) )
+        {
+            hits |= 1 << ( results->results[i].channel - 1 );
+        }
+    }
+
+    index = wifi_channel_plan_find_site( results );
+    if( index < WIFI_CHANNEL_PLAN_NB_SITES )
+    {
+        site = wifi_sites[index];
+    }
+    else
+    {
+        // New site, it replaces the least recently recognized one
+        index = WIFI_CHANNEL_PLAN_NB_SITES - 1;
+        memset( &site, 0, sizeof( site ) );
+        memset( site.hit_rate, WIFI_CHANNEL_PLAN_HIT_RATE_INIT, sizeof( site.hit_rate ) );
+        wifi_plan_exploring = true;
+    }
+
+    for( uint8_t i = 0; i < WIFI_CHANNEL_PLAN_NB_CHANNELS; i++ )
+    {
+        if( ( scanned & ( 1 << i ) ) != 0 )
+        {
+            int16_t target = ( ( hits & ( 1 << i ) ) != 0 ) ? WIFI_CHANNEL_PLAN_HIT_RATE_MAX : 0;
+
+            site.hit_rate[i] += ( target - site.hit_rate[i] ) / ( 1 << WIFI_CHANNEL_PLAN_HIT_RATE_SHIFT );
+        }
+    }
+
+    if( site.nb_scans < WIFI_CHANNEL_PLAN_COUNTER_MAX )
+    {
+        site.nb_scans++;
+    }
+    if( wifi_plan_exploring == true )
+    {
+        site.scans_since_explore = 0;
+    }
+    else if( site.scans_since_explore < WIFI_CHANNEL_PLAN_COUNTER_MAX )
+    {
+        site.scans_since_explore++;
+    }
+    wifi_channel_plan_set_signature( &site, results );
+
+    // Most recently recognized first
+    memmove( &wifi_sites[1], &wifi_sites[0], index * sizeof( wifi_channel_plan_site_t ) );
+    wifi_sites[0]     = site;
+    wifi_site_current = true;
+}
+
+void wifi_channel_plan_save( uint8_t* buffer )
+{
+    *buffer++ = WIFI_CHANNEL_PLAN_VERSION;
+
+    for( uint8_t s = 0; s < WIFI_CHANNEL_PLAN_NB_SITES; s++ )
+    {
+        const wifi_channel_plan_site_t* site = &wifi_sites[s];
+
+        for( uint8_t i = 0; i < WIFI_CHANNEL_PLAN_NB_SIGNATURES; i++ )
+        {
+            *buffer++ = site->signature[i] >> 8;
+            *buffer++ = site->signature[i];
+        }
+        for( uint8_t i = 0; i < WIFI_CHANNEL_PLAN_NB_CHANNELS; i += 2 )
+        {
+            *buffer++ = ( site->hit_rate[i] & 0xF0 ) | ( site->hit_rate[i + 1] >> 4 );
+        }
+        *buffer++ = ( site->nb_scans << 4 ) | site->scans_since_explore;
+    }
+}
+
+void wifi_channel_plan_restore( const uint8_t* buffer )
+{
+    wifi_channel_plan_reset( );
+
+    if( *buffer++ != WIFI_CHANNEL_PLAN_VERSION )
+    {
+        return;
+    }
+
+    for( uint8_t s = 0; s < WIFI_CHANNEL_PLAN_NB_SITES; s++ )
+    {
+        wifi_channel_plan_site_t* site = &wifi_sites[s];
+
+        for( uint8_t i = 0; i < WIFI_CHANNEL_PLAN_NB_SIGNATURES; i++ )
+        {
+            site->signature[i] = ( ( uint16_t ) buffer[0] << 8 ) | buffer[1];
+            buffer += 2;
+        }
+        for( uint8_t i = 0; i < WIFI_CHANNEL_PLAN_NB_CHANNELS; i += 2 )
+        {
+            // Middle of the 4-bit quantization step
+            site->hit_rate[i]     = ( *buffer & 0xF0 ) | 0x08;
+            site->hit_rate[i + 1] = ( *buffer << 4 ) | 0x08;
+            buffer++;
+        }
+        site->nb_scans            = *buffer >> 4;
+        site->scans_since_explore = *buffer & 0x0F;
+        buffer++;
+    }
+}
+
+void wifi_channel_plan_reset( void )
+{
+    memset( wifi_sites, 0, sizeof( wifi_sites ) );
+    wifi_site_current   = false;
+    wifi_plan_exploring = true;
+}
+
+void wifi_channel_plan_print( void )
+{
+    for( uint8_t s = 0; s < WIFI_CHANNEL_PLAN_NB_SITES; s++ )
+    {
+        if( wifi_sites[s].nb_scans == 0 )
+        {
+            continue;
+        }
+        HAL_DBG_TRACE_PRINTF( "Wi-Fi site %04X%s (%d scans) hit rates %%:", wifi_sites[s].signature[0],
+                              ( ( s == 0 ) && ( wifi_site_current == true ) ) ? " current" : "",
+                              wifi_sites[s].nb_scans );
+        for( uint8_t i = 0; i < WIFI_CHANNEL_PLAN_NB_CHANNELS; i++ )
+        {
+            HAL_DBG_TRACE_PRINTF( " %d", ( wifi_sites[s].hit_rate[i] * 100 ) / WIFI_CHANNEL_PLAN_HIT_RATE_MAX );
+        }
+        HAL_DBG_TRACE_PRINTF( "\r\n" );
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint16_t wifi_channel_plan_hash( const lr1110_modem_wifi_mac_address_t mac_address )
+{
+    uint16_t hash = 0;
+
+    for( uint8_t i = 0; i < LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH; i++ )
+    {
+        hash = ( hash * 31 ) + mac_address[i];
+    }
+    return hash;
+}
+
+static uint8_t wifi_channel_plan_find_site( const wifi_scan_all_result_t* results )
+{
+    for( uint8_t s = 0; s < WIFI_CHANNEL_PLAN_NB_SITES; s++ )
+    {
+        if( wifi_sites[s].nb_scans == 0 )
+        {
+            continue;
+        }
+        for( uint8_t i = 0; i < results->nbr_results; i++ )
+        {
+            uint16_t hash = wifi_channel_plan_hash( results->results[i].mac_address );
+
+            for( uint8_t k = 0; k < WIFI_CHANNEL_PLAN_NB_SIGNATURES; k++ )
+            {
+                if( hash == wifi_sites[s].signature[k] )
+                {
+                    return s;
+                }
+            }
+        }
+    }
+    return WIFI_CHANNEL_PLAN_NB_SITES;
+}
+
+static void wifi_channel_plan_set_signature( wifi_channel_plan_site_t* site, const wifi_scan_all_result_t* results )
+{
+    int8_t best_rssi[WIFI_CHANNEL_PLAN_NB_SIGNATURES];
+    bool   best_fixed[WIFI_CHANNEL_PLAN_NB_SIGNATURES];
+
+    for( uint8_t k = 0; k < WIFI_CHANNEL_PLAN_NB_SIGNATURES; k++ )
+    {
+        best_rssi[k]       = INT8_MIN;
+        best_fixed[k]      = false;
+        site->signature[k] = 0;
+    }
+
+    for( uint8_t i = 0; i < results->nbr_results; i++ )
+    {
+        bool   fixed = wifi_scan_is_fixed_ap( &results->results[i] );
+        int8_t rssi  = results->results[i].rssi;
+
+        for( uint8_t k = 0; k < WIFI_CHANNEL_PLAN_NB_SIGNATURES; k++ )
+        {
+            if( ( ( fixed == true ) && ( best_fixed[k] == false ) ) ||
+                ( ( fixed == best_fixed[k] ) && ( rssi > best_rssi[k] ) ) )
+            {
+                // Shift the weaker ones down
+                for( uint8_t m = WIFI_CHANNEL_PLAN_NB_SIGNATURES - 1; m > k; m-- )
+                {
+                    best_rssi[m]       = best_rssi[m - 1];
+                    best_fixed[m]      = best_fixed[m - 1];
+                    site->signature[m] = site->signature[m - 1];
+                }
+                best_rssi[k]       = rssi;
+                best_fixed[k]      = fixed;
+                site->signature[k] = wifi_channel_plan_hash( results->results[i].mac_address );
+                break;
+            }
+        }
+    }
+
+    // A single AP heard, no hash left unset
+    for( uint8_t k = 1; k < WIFI_CHANNEL_PLAN_NB_SIGNATURES; k++ )
+    {
+        if( best_rssi[k] == INT8_MIN )
+        {
+            site->signature[k] = site->signature[0];
+        }
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,140 @@
+/*!
+ * \file      wifi_channel_plan.h
+ *
+ * \brief     Learned Wi-Fi channel plan per site definition
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __WIFI_CHANNEL_PLAN_H__
+#define __WIFI_CHANNEL_PLAN_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include "wifi_scan.h"
+#include <stdint.h>
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * \brief Number of 2.4 GHz channels
+ */
+#define WIFI_CHANNEL_PLAN_NB_CHANNELS 14
+
+/*!
+ * \brief Number of sites whose channel statistics are learned
+ */
+#define WIFI_CHANNEL_PLAN_NB_SITES 4
+
+/*!
+ * \brief Size of the channel plan saved in the application context
+ */
+#define WIFI_CHANNEL_PLAN_CTX_SIZE ( 1 + ( WIFI_CHANNEL_PLAN_NB_SITES * 12 ) )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief Channels to scan for the next Wi-Fi scan
+ */
+typedef struct
+{
+    lr1110_modem_wifi_channel_mask_t mask;      // Channels expected to be heard at the current site
+    lr1110_modem_wifi_channel_mask_t fallback;  // Channels scanned only if the mask channels give no result
+    lr1110_modem_wifi_channel_t      order[WIFI_CHANNEL_PLAN_NB_CHANNELS];  // All the channels, best hit rate first
+} wifi_channel_plan_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief Plans the channels of the next scan from the statistics of the current site
+ *
+ * \remark The current site is the one recognized by the last scan. All the channels allowed are scanned while the
+ *         site is learned and periodically afterwards, to re-explore the channels with a low hit rate
+ *
+ * \param [in] allowed Channels allowed by the Wi-Fi settings
+ * \param [out] plan Channels to scan \ref wifi_channel_plan_t
+ */
+void wifi_channel_plan_get( const lr1110_modem_wifi_channel_mask_t allowed, wifi_channel_plan_t* plan );
+
+/*!
+ * \brief Recognizes the site from the results of a scan and updates its per channel hit statistics
+ *
+ * \param [in] results Results of the scan \ref wifi_scan_all_result_t
+ * \param [in] scanned Channels actually scanned, the hit rate of the others is left unchanged
+ */
+void wifi_channel_plan_update( const wifi_scan_all_result_t* results, const lr1110_modem_wifi_channel_mask_t scanned );
+
+/*!
+ * \brief Serializes the learned statistics, 4 bits per channel hit rate
+ *
+ * \param [out] buffer Buffer of WIFI_CHANNEL_PLAN_CTX_SIZE bytes
+ */
+void wifi_channel_plan_save( uint8_t* buffer );
+
+/*!
+ * \brief Restores the statistics serialized by wifi_channel_plan_save, they are reset if the buffer is not valid
+ *
+ * \param [in] buffer Buffer of WIFI_CHANNEL_PLAN_CTX_SIZE bytes
+ */
+void wifi_channel_plan_restore( const uint8_t* buffer );
+
+/*!
+ * \brief Forgets the learned sites
+ */
+void wifi_channel_plan_reset( void );
+
+/*!
+ * \brief Prints the per channel hit rates of the learned sites
+ */
+void wifi_channel_plan_print( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __WIFI_CHANNEL_PLAN_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,291 @@
+/*!
+ * \file      wifi_filter.c
+ *
+ * \brief     Wi-Fi scan results filtering and ranking implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>
+#include "wifi_filter.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * \brief BSSIDs of a multi-SSID radio only differ by the low nibble of their last byte
+ */
+#define WIFI_FILTER_RADIO_MASK ( 0xF0 )
+
+/*!
+ * \brief Ranking bonus per consecutive previous scan an AP was heard in, saturated to WIFI_FILTER_SEEN_MAX scans
+ */
+#define WIFI_FILTER_SEEN_BONUS_DB ( 4 )
+#define WIFI_FILTER_SEEN_MAX ( 3 )
+
+/*!
+ * \brief RSSI variation from the previous scan taken into account in the ranking, in dB
+ */
+#define WIFI_FILTER_RSSI_DELTA_MAX ( 20 )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * \brief AP heard by the previous scan
+ */
+typedef struct
+{
+    lr1110_modem_wifi_mac_address_t mac_address;
+    int8_t                          rssi;
+    uint8_t                         nb_seen;  // Consecutive scans before the previous one which heard the AP
+} wifi_filter_history_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*!
+ * \brief APs left by the filtering of the previous scan, before the K best were kept
+ */
+static wifi_filter_history_t wifi_filter_history[WIFI_MAX_RESULT_TOTAL];
+static uint8_t               wifi_filter_history_size = 0;
+
+/*!
+ * \brief Results kept, sorted before being copied back
+ */
+static wifi_scan_single_result_t wifi_filter_kept[WIFI_MAX_RESULT_TOTAL];
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief Tells if two BSSIDs belong to the same multi-SSID radio
+ *
+ * \param [in] a First MAC address
+ * \param [in] b Second MAC address
+ *
+ * \return true if the BSSIDs belong to the same radio
+ */
+static bool wifi_filter_is_same_radio( const lr1110_modem_wifi_mac_address_t a, const lr1110_modem_wifi_mac_address_t b );
+
+/*!
+ * \brief Returns the number of consecutive previous scans which heard an AP
+ *
+ * \param [in] result Scan result \ref wifi_scan_single_result_t
+ * \param [out] rssi_delta RSSI variation from the previous scan, 0 for an AP not heard by the previous scan
+ *
+ * \return Number of scans, saturated to WIFI_FILTER_SEEN_MAX
+ */
+static uint8_t wifi_filter_get_seen( const wifi_scan_single_result_t* result, uint8_t* rssi_delta );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void wifi_filter_apply( const wifi_filter_settings_t* settings, const uint8_t budget_aps,
+                        wifi_scan_all_result_t* results, wifi_filter_stats_t* stats )
+{
+    uint8_t candidates[WIFI_MAX_RESULT_TOTAL];
+    int16_t scores[WIFI_MAX_RESULT_TOTAL];
+    uint8_t nb_seen[WIFI_MAX_RESULT_TOTAL];
+    uint8_t nb_candidates = 0;
+    uint8_t nb_kept       = 0;
+
+    memset( stats, 0, sizeof( wifi_filter_stats_t ) );
+    stats->nb_in = results->nbr_results;
+
+    for( uint8_t i = 0; i < results->nbr_results; i++ )
+    {
+        const wifi_scan_single_result_t* result = &results->results[i];
+        bool                             duplicate = false;
+
+        if( ( ( settings->flags & WIFI_FILTER_DROP_LOCALLY_ADMINISTERED ) != 0 ) &&
+            ( ( result->mac_address[0] & WIFI_MAC_LOCALLY_ADMINISTERED ) != 0 ) )
+        {
+            stats->nb_locally_administered++;
+            continue;
+        }
+        if( ( ( settings->flags & WIFI_FILTER_DROP_MOBILE_AP ) != 0 ) &&
+            ( result->mac_origin == WIFI_MAC_ORIGIN_MOBILE_AP ) )
+        {
+            stats->nb_mobile++;
+            continue;
+        }
+        if( result->rssi < settings->rssi_floor )
+        {
+            stats->nb_weak++;
+            continue;
+        }
+
+        if( ( settings->flags & WIFI_FILTER_DEDUPE_RADIOS ) != 0 )
+        {
+            for( uint8_t j = 0; j < nb_candidates; j++ )
+            {
+                if( wifi_filter_is_same_radio( results->results[candidates[j]].mac_address, result->mac_address ) ==
+                    true )
+                {
+                    // The strongest BSSID stands for the radio
+                    if( result->rssi > results->results[candidates[j]].rssi )
+                    {
+                        candidates[j] = i;
+                    }
+                    stats->nb_duplicates++;
+                    duplicate = true;
+                    break;
+                }
+            }
+        }
+        if( duplicate == false )
+        {
+            candidates[nb_candidates++] = i;
+        }
+    }
+
+    // Rank the candidates, the strongest and steadiest first
+    for( uint8_t i = 0; i < nb_candidates; i++ )
+    {
+        const wifi_scan_single_result_t* result = &results->results[candidates[i]];
+        uint8_t                          rssi_delta;
+        uint8_t                          candidate;
+        int16_t                          score;
+        uint8_t                          seen;
+        uint8_t                          pos = i;
+
+        seen  = wifi_filter_get_seen( result, &rssi_delta );
+        score = result->rssi + ( WIFI_FILTER_SEEN_BONUS_DB * seen ) - ( rssi_delta / 2 );
+
+        candidate = candidates[i];
+        while( ( pos > 0 ) && ( scores[pos - 1] < score ) )
+        {
+            candidates[pos] = candidates[pos - 1];
+            scores[pos]     = scores[pos - 1];
+            nb_seen[pos]    = nb_seen[pos - 1];
+            pos--;
+        }
+        candidates[pos] = candidate;
+        scores[pos]     = score;
+        nb_seen[pos]    = seen;
+    }
+
+    // The whole candidate set is remembered, an AP over the budget may rank higher on the next scan
+    for( uint8_t i = 0; i < nb_candidates; i++ )
+    {
+        memcpy( wifi_filter_history[i].mac_address, results->results[candidates[i]].mac_address,
+                LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH );
+        wifi_filter_history[i].rssi    = results->results[candidates[i]].rssi;
+        wifi_filter_history[i].nb_seen = nb_seen[i];
+    }
+    wifi_filter_history_size = nb_candidates;
+
+    nb_kept = budget_aps;
+    if( ( settings->max_aps != 0 ) && ( settings->max_aps < nb_kept ) )
+    {
+        nb_kept = settings->max_aps;
+    }
+    if( nb_kept < WIFI_FILTER_MIN_APS )
+    {
+        nb_kept = WIFI_FILTER_MIN_APS;
+    }
+    if( nb_kept > nb_candidates )
+    {
+        nb_kept = nb_candidates;
+    }
+
+    for( uint8_t i = 0; i < nb_kept; i++ )
+    {
+        wifi_filter_kept[i] = results->results[candidates[i]];
+    }
+    memcpy( results->results, wifi_filter_kept, nb_kept * sizeof( wifi_scan_single_result_t ) );
+    results->nbr_results = nb_kept;
+
+    stats->nb_over_budget = nb_candidates - nb_kept;
+    stats->nb_out         = nb_kept;
+}
+
+bool wifi_filter_settings_are_valid( const wifi_filter_settings_t* settings )
+{
+    return ( ( settings->flags & ~WIFI_FILTER_ALL ) == 0 ) && ( settings->max_aps <= WIFI_MAX_RESULT_TOTAL ) &&
+           ( ( settings->max_aps == 0 ) || ( settings->max_aps >= WIFI_FILTER_MIN_APS ) );
+}
+
+void wifi_filter_reset( void ) { wifi_filter_history_size = 0; }
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool wifi_filter_is_same_radio( const lr1110_modem_wifi_mac_address_t a, const lr1110_modem_wifi_mac_address_t b )
+{
+    return ( memcmp( a, b, LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH - 1 ) == 0 ) &&
+           ( ( a[LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH - 1] & WIFI_FILTER_RADIO_MASK ) ==
+             ( b[LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH - 1] & WIFI_FILTER_RADIO_MASK ) );
+}
+
+static uint8_t wifi_filter_get_seen( const wifi_scan_single_result_t* result, uint8_t* rssi_delta )
+{
+    *rssi_delta = 0;
+
+    for( uint8_t i = 0; i < wifi_filter_history_size; i++ )
+    {
+        if( memcmp( wifi_filter_history[i].mac_address, result->mac_address, LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH ) ==
+            0 )
+        {
+            int16_t delta = result->rssi - wifi_filter_history[i].rssi;
+
+            if( delta < 0 )
+            {
+                delta = -delta;
+            }
+            *rssi_delta = ( delta > WIFI_FILTER_RSSI_DELTA_MAX ) ? WIFI_FILTER_RSSI_DELTA_MAX : delta;
+
+            return ( wifi_filter_history[i].nb_seen < WIFI_FILTER_SEEN_MAX ) ? wifi_filter_history[i].nb_seen + 1
+                                                                              : WIFI_FILTER_SEEN_MAX;
+        }
+    }
+    return 0;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
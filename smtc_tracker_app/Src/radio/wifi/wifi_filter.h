@@ -0,0 +1,147 @@
+/*!
+ * \file      wifi_filter.h
+ *
+ * \brief     Wi-Fi scan results filtering and ranking definition
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __WIFI_FILTER_H__
+#define __WIFI_FILTER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include "wifi_scan.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * \brief Filtering stages enabled in wifi_filter_settings_t.flags
+ */
+#define WIFI_FILTER_DROP_LOCALLY_ADMINISTERED 0x01  // Randomized addresses and hotspots
+#define WIFI_FILTER_DROP_MOBILE_AP 0x02             // APs flagged as mobile by the LR1110
+#define WIFI_FILTER_DEDUPE_RADIOS 0x04              // Keep a single BSSID per multi-SSID radio
+#define WIFI_FILTER_ALL 0x07
+
+/*!
+ * \brief Default filter settings
+ */
+#define WIFI_FILTER_FLAGS_DEFAULT WIFI_FILTER_ALL
+#define WIFI_FILTER_MAX_APS_DEFAULT 12
+#define WIFI_FILTER_RSSI_FLOOR_DEFAULT -90
+
+/*!
+ * \brief Minimum number of APs kept whatever the uplink budget, fewer can not be solved
+ */
+#define WIFI_FILTER_MIN_APS 3
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief Filter settings
+ */
+typedef struct
+{
+    uint8_t flags;       // Filtering stages, WIFI_FILTER_xxx
+    uint8_t max_aps;     // Number of APs kept at most, 0 to only bound it by the uplink budget
+    int8_t  rssi_floor;  // APs under this RSSI are dropped
+} wifi_filter_settings_t;
+
+/*!
+ * \brief Number of results dropped by each stage of the last filtering
+ */
+typedef struct
+{
+    uint8_t nb_in;                    // Results of the scan
+    uint8_t nb_locally_administered;  // Locally administered BSSIDs dropped
+    uint8_t nb_mobile;                // Mobile APs dropped
+    uint8_t nb_weak;                  // APs under the RSSI floor dropped
+    uint8_t nb_duplicates;            // Other BSSIDs of a radio already kept
+    uint8_t nb_over_budget;           // APs ranked after the K kept
+    uint8_t nb_out;                   // Results kept
+} wifi_filter_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief Filters the results of a scan and keeps the best K APs, the most stable first
+ *
+ * \remark An AP ranks higher the stronger it is and the more consecutive filtered scans heard it with a steady RSSI.
+ *         K is the smallest of settings->max_aps and budget_aps, but at least WIFI_FILTER_MIN_APS
+ *
+ * \remark The module has no hardware dependency, recorded scans can be replayed through it on a host
+ *
+ * \param [in] settings Filter settings \ref wifi_filter_settings_t
+ * \param [in] budget_aps Number of APs fitting in the uplink budget
+ * \param [in,out] results Results of the scan, filtered and sorted in place \ref wifi_scan_all_result_t
+ * \param [out] stats Number of results dropped by each stage \ref wifi_filter_stats_t
+ */
+void wifi_filter_apply( const wifi_filter_settings_t* settings, const uint8_t budget_aps,
+                        wifi_scan_all_result_t* results, wifi_filter_stats_t* stats );
+
+/*!
+ * \brief Tells if the filter settings are valid
+ *
+ * \param [in] settings Filter settings \ref wifi_filter_settings_t
+ *
+ * \return true if the settings are valid
+ */
+bool wifi_filter_settings_are_valid( const wifi_filter_settings_t* settings );
+
+/*!
+ * \brief Forgets the APs heard by the previous scans
+ */
+void wifi_filter_reset( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __WIFI_FILTER_H__
+
+/* --- EOF ------------------------------------------------------------------ */
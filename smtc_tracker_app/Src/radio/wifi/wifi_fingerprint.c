@@ -0,0 +1,296 @@
+/*!
+ * \file      wifi_fingerprint.c
+ *
+ * \brief     Wi-Fi scan fingerprint cache implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include "wifi_fingerprint.h"
+#include "lr1110_tracker_board.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * \brief Cached fingerprint
+ */
+typedef struct
+{
+    lr1110_modem_wifi_mac_address_t mac_address[WIFI_FINGERPRINT_NB_MACS];  // Strongest fixed APs of the full scan
+    uint8_t                         nb_macs;                                 // 0 for an empty slot
+    uint8_t                         id;                                      // Id sent with the full scan
+    uint8_t                         nb_matches;                              // Matches since the full scan was sent
+} wifi_fingerprint_entry_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/*!
+ * \brief Cached fingerprints, the most recently matched first
+ */
+static wifi_fingerprint_entry_t wifi_fingerprints[WIFI_FINGERPRINT_NB_ENTRIES];
+
+/*!
+ * \brief Id of the next fingerprint added to the cache
+ */
+static uint8_t wifi_fingerprint_next_id = 0;
+
+/*!
+ * \brief Fingerprint cache statistics
+ */
+static wifi_fingerprint_stats_t wifi_fingerprint_stats;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief Builds the fingerprint of a scan from its strongest fixed APs
+ *
+ * \param [in] results Results of the scan \ref wifi_scan_all_result_t
+ * \param [out] entry Fingerprint, only the MAC addresses are set
+ */
+static void wifi_fingerprint_build( const wifi_scan_all_result_t* results, wifi_fingerprint_entry_t* entry );
+
+/*!
+ * \brief Returns the Jaccard similarity of the MAC addresses of two fingerprints
+ *
+ * \param [in] a First fingerprint
+ * \param [in] b Second fingerprint
+ *
+ * \return Size of the intersection over the size of the union, in percent
+ */
+static uint8_t wifi_fingerprint_similarity( const wifi_fingerprint_entry_t* a, const wifi_fingerprint_entry_t* b );
+
+/*!
+ * \brief Moves a cached fingerprint in front of the cache
+ *
+ * \param [in] index Index of the fingerprint
+ */
+static void wifi_fingerprint_move_to_front( const uint8_t index );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void wifi_fingerprint_match( const wifi_scan_all_result_t* results, wifi_fingerprint_t* fingerprint )
+{
+    wifi_fingerprint_entry_t scan;
+    uint8_t                  best_index      = WIFI_FINGERPRINT_NB_ENTRIES;
+    uint8_t                  best_similarity = 0;
+
+    fingerprint->valid          = false;
+    fingerprint->same_place     = false;
+    fingerprint->id             = 0;
+    fingerprint->similarity_pct = 0;
+
+    wifi_fingerprint_build( results, &scan );
+    if( scan.nb_macs < WIFI_FINGERPRINT_MIN_MACS )
+    {
+        return;
+    }
+
+    wifi_fingerprint_stats.nb_scans++;
+    fingerprint->valid = true;
+
+    for( uint8_t i = 0; i < WIFI_FINGERPRINT_NB_ENTRIES; i++ )
+    {
+        uint8_t similarity = wifi_fingerprint_similarity( &scan, &wifi_fingerprints[i] );
+
+        if( similarity > best_similarity )
+        {
+            best_similarity = similarity;
+            best_index      = i;
+        }
+    }
+
+    if( best_similarity >= WIFI_FINGERPRINT_SIMILARITY_PCT )
+    {
+        wifi_fingerprint_entry_t* entry = &wifi_fingerprints[best_index];
+
+        fingerprint->id             = entry->id;
+        fingerprint->similarity_pct = best_similarity;
+
+        entry->nb_matches++;
+        if( entry->nb_matches < WIFI_FINGERPRINT_REFRESH_PERIOD )
+        {
+            fingerprint->same_place = true;
+            wifi_fingerprint_stats.nb_matches++;
+        }
+        else
+        {
+            // The full scan is sent again under the same id, in case the previous one was lost
+            memcpy( entry->mac_address, scan.mac_address, sizeof( entry->mac_address ) );
+            entry->nb_macs    = scan.nb_macs;
+            entry->nb_matches = 0;
+        }
+    }
+    else
+    {
+        // Replace the least recently matched fingerprint
+        best_index = WIFI_FINGERPRINT_NB_ENTRIES - 1;
+
+        scan.id         = wifi_fingerprint_next_id++;
+        scan.nb_matches = 0;
+        wifi_fingerprints[best_index] = scan;
+
+        fingerprint->id = scan.id;
+        wifi_fingerprint_stats.nb_new++;
+    }
+
+    wifi_fingerprint_move_to_front( best_index );
+
+    HAL_DBG_TRACE_PRINTF( "Wi-Fi fingerprint #%d, %s, similarity %d %%\r\n", fingerprint->id,
+                          ( fingerprint->same_place == true ) ? "same place" : "full scan sent",
+                          fingerprint->similarity_pct );
+}
+
+void wifi_fingerprint_invalidate( const uint8_t id )
+{
+    for( uint8_t i = 0; i < WIFI_FINGERPRINT_NB_ENTRIES; i++ )
+    {
+        if( ( wifi_fingerprints[i].nb_macs != 0 ) && ( wifi_fingerprints[i].id == id ) )
+        {
+            wifi_fingerprints[i].nb_macs = 0;
+        }
+    }
+}
+
+void wifi_fingerprint_reset( void )
+{
+    memset( wifi_fingerprints, 0, sizeof( wifi_fingerprints ) );
+    memset( &wifi_fingerprint_stats, 0, sizeof( wifi_fingerprint_stats ) );
+}
+
+void wifi_fingerprint_get_stats( wifi_fingerprint_stats_t* stats ) { *stats = wifi_fingerprint_stats; }
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void wifi_fingerprint_build( const wifi_scan_all_result_t* results, wifi_fingerprint_entry_t* entry )
+{
+    int8_t rssi[WIFI_FINGERPRINT_NB_MACS];
+
+    entry->nb_macs = 0;
+
+    for( uint8_t i = 0; i < results->nbr_results; i++ )
+    {
+        const wifi_scan_single_result_t* result = &results->results[i];
+        uint8_t                          pos;
+
+        // Mobile hotspots and randomized addresses do not tell the place
+        if( wifi_scan_is_fixed_ap( result ) == false )
+        {
+            continue;
+        }
+
+        // Insertion by decreasing RSSI, the weakest AP is dropped when the fingerprint is full
+        pos = entry->nb_macs;
+        if( pos == WIFI_FINGERPRINT_NB_MACS )
+        {
+            if( result->rssi <= rssi[pos - 1] )
+            {
+                continue;
+            }
+            pos--;
+        }
+        else
+        {
+            entry->nb_macs++;
+        }
+        while( ( pos > 0 ) && ( rssi[pos - 1] < result->rssi ) )
+        {
+            rssi[pos] = rssi[pos - 1];
+            memcpy( entry->mac_address[pos], entry->mac_address[pos - 1], LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH );
+            pos--;
+        }
+        rssi[pos] = result->rssi;
+        memcpy( entry->mac_address[pos], result->mac_address, LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH );
+    }
+}
+
+static uint8_t wifi_fingerprint_similarity( const wifi_fingerprint_entry_t* a, const wifi_fingerprint_entry_t* b )
+{
+    uint8_t nb_common = 0;
+    uint8_t nb_union  = 0;
+
+    if( ( a->nb_macs == 0 ) || ( b->nb_macs == 0 ) )
+    {
+        return 0;
+    }
+
+    for( uint8_t i = 0; i < a->nb_macs; i++ )
+    {
+        for( uint8_t j = 0; j < b->nb_macs; j++ )
+        {
+            if( memcmp( a->mac_address[i], b->mac_address[j], LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH ) == 0 )
+            {
+                nb_common++;
+                break;
+            }
+        }
+    }
+    nb_union = a->nb_macs + b->nb_macs - nb_common;
+
+    return ( ( uint16_t ) nb_common * 100 ) / nb_union;
+}
+
+static void wifi_fingerprint_move_to_front( const uint8_t index )
+{
+    wifi_fingerprint_entry_t entry = wifi_fingerprints[index];
+
+    for( uint8_t i = index; i > 0; i-- )
+    {
+        wifi_fingerprints[i] = wifi_fingerprints[i - 1];
+    }
+    wifi_fingerprints[0] = entry;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,149 @@
+/*!
+ * \file      wifi_fingerprint.h
+ *
+ * \brief     Wi-Fi scan fingerprint cache definition
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __WIFI_FINGERPRINT_H__
+#define __WIFI_FINGERPRINT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include "wifi_scan.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * \brief Number of fingerprints cached
+ */
+#define WIFI_FINGERPRINT_NB_ENTRIES 8
+
+/*!
+ * \brief Number of fixed APs kept in a fingerprint, the strongest ones
+ */
+#define WIFI_FINGERPRINT_NB_MACS 16
+
+/*!
+ * \brief Minimum number of fixed APs for a scan to be fingerprinted
+ */
+#define WIFI_FINGERPRINT_MIN_MACS 3
+
+/*!
+ * \brief Jaccard similarity in percent from which two scans are the same place
+ */
+#define WIFI_FINGERPRINT_SIMILARITY_PCT 60
+
+/*!
+ * \brief The full scan is uplinked again after WIFI_FINGERPRINT_REFRESH_PERIOD matches of a fingerprint
+ */
+#define WIFI_FINGERPRINT_REFRESH_PERIOD 16
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief Fingerprint of a scan
+ */
+typedef struct
+{
+    bool    valid;           // Enough fixed APs heard to fingerprint the scan
+    bool    same_place;      // The scan matches a fingerprint already uplinked, only its id has to be sent
+    uint8_t id;              // Id of the fingerprint, the one of the matching scan when same_place is set
+    uint8_t similarity_pct;  // Jaccard similarity with the matching fingerprint
+} wifi_fingerprint_t;
+
+/*!
+ * \brief Fingerprint cache statistics
+ */
+typedef struct
+{
+    uint32_t nb_scans;    // Scans fingerprinted
+    uint32_t nb_matches;  // Scans sent as a fingerprint id
+    uint32_t nb_new;      // Fingerprints added to the cache
+} wifi_fingerprint_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief Compares the fixed APs of a scan with the cached fingerprints
+ *
+ * \remark A scan which does not match any fingerprint replaces the least recently matched one under a new id, the
+ *         full scan has to be uplinked along with this id for the later matches to be resolved
+ *
+ * \param [in] results Results of the scan \ref wifi_scan_all_result_t
+ * \param [out] fingerprint Fingerprint of the scan \ref wifi_fingerprint_t
+ */
+void wifi_fingerprint_match( const wifi_scan_all_result_t* results, wifi_fingerprint_t* fingerprint );
+
+/*!
+ * \brief Removes a fingerprint from the cache, to be called when its full scan could not be uplinked
+ *
+ * \param [in] id Id of the fingerprint
+ */
+void wifi_fingerprint_invalidate( const uint8_t id );
+
+/*!
+ * \brief Empties the cache
+ */
+void wifi_fingerprint_reset( void );
+
+/*!
+ * \brief Returns the fingerprint cache statistics
+ *
+ * \param [out] stats Statistics \ref wifi_fingerprint_stats_t
+ */
+void wifi_fingerprint_get_stats( wifi_fingerprint_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __WIFI_FINGERPRINT_H__
+
+/* --- EOF ------------------------------------------------------------------ */
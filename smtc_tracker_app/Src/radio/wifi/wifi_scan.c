@@ -35,6 +35,7 @@
  */
 
 #include "wifi_scan.h"
+#include "wifi_channel_plan.h"
 #include "lr1110_tracker_board.h"
 
 /*
@@ -60,6 +61,12 @@
  */
 #define WIFI_SCAN_TIMEOUT ( 10000 )
 
+/*!
+ * \brief MAC origin field of the channel info byte
+ */
+#define WIFI_MAC_ORIGIN_POS ( 4 )
+#define WIFI_MAC_ORIGIN_MASK ( 0x03 )
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -85,6 +92,16 @@ static bool wifi_scan_timeout = false;
  */
 static timer_event_t wifi_scan_timeout_timer;
 
+/*!
+ * \brief Channels planned for the scan from the statistics of the site
+ */
+static wifi_channel_plan_t wifi_plan;
+
+/*!
+ * \brief Channels scanned so far
+ */
+static lr1110_modem_wifi_channel_mask_t wifi_channels_scanned;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
@@ -148,6 +165,52 @@ void wifi_add_basic_mac_to_results( lr1110_modem_system_reg_mode_t reg_mode, wif
  */
 static void on_wifi_scan_timeout_event( void* context );
 
+/*!
+ * \brief Starts the time-bounded scan of the next channel left
+ *
+ * \param [in] context Radio abstraction
+ *
+ * \return Modem response code
+ */
+static lr1110_modem_response_code_t wifi_scan_next_channel( const void* context );
+
+/*!
+ * \brief Checks if the results of the scan meet the quality target
+ *
+ * \param [in] results Results gathered so far \ref wifi_scan_all_result_t
+ *
+ * \return true if early_stop_nb_aps distinct non-mobile APs are above early_stop_rssi_floor
+ */
+static bool wifi_quality_target_met( const wifi_scan_all_result_t* results );
+
+/*!
+ * \brief Appends a result to the Wi-Fi result structure, skipping the MAC addresses already there
+ *
+ * \param [out] results structure containing the results \ref wifi_scan_all_result_t
+ *
+ * \return Result to fill, NULL if the MAC address is already known or the structure is full
+ */
+static wifi_scan_single_result_t* wifi_new_result( wifi_scan_all_result_t*               results,
+                                                   const lr1110_modem_wifi_mac_address_t mac_address );
+
+/*!
+ * \brief Adds the cumulative timings of a scan to the results, they are reset before each scan
+ *
+ * \param [out] results structure containing the results \ref wifi_scan_all_result_t
+ *
+ * \param [in] timing scan timing
+ */
+static void wifi_add_timings( wifi_scan_all_result_t* results, const lr1110_modem_wifi_cumulative_timings_t timing );
+
+/*!
+ * \brief Returns the number of channels of a mask
+ *
+ * \param [in] channels Channel mask
+ *
+ * \return Number of channels
+ */
+static uint8_t wifi_count_channels( lr1110_modem_wifi_channel_mask_t channels );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -166,11 +229,20 @@ void wifi_init( const void* context, wifi_settings_t wifi_settings )
     wifi.state                          = WIFI_INIT;
     wifi.results.nbr_results            = 0;
     wifi.results.global_consumption_uas = 0;
+    wifi.results.nb_channels_scanned    = 0;
+    wifi.results.nb_channels_skipped    = 0;
+    wifi.results.saved_time_us          = 0;
+    wifi.results.saved_uas              = 0;
+    memset( &wifi.results.timings, 0, sizeof( wifi.results.timings ) );
 
     timer_init( &wifi_scan_timeout_timer, on_wifi_scan_timeout_event );
     timer_set_value( &wifi_scan_timeout_timer, WIFI_SCAN_TIMEOUT );
 
     wifi_configure( wifi_settings );
+
+    wifi_channel_plan_get( wifi.settings.channels, &wifi_plan );
+    wifi.channels_left    = wifi_plan.mask;
+    wifi_channels_scanned = 0;
 }
 
 wifi_scan_result_t wifi_execute_scan( const void* context )
@@ -178,7 +250,12 @@ wifi_scan_result_t wifi_execute_scan( const void* context )
     bool                         wifi_scan_done = false;
     lr1110_modem_response_code_t modem_response_code = LR1110_MODEM_RESPONSE_CODE_OK;
     wifi_scan_result_t           scan_result = WIFI_SCAN_SUCCESS;
-    
+    hal_mcu_clock_profile_t      clock_profile;
+
+    HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_WIFI_SCAN );
+
+    // The MCU only waits for the radio during the scan
+    clock_profile     = hal_mcu_set_clock_profile( HAL_MCU_CLOCK_PROFILE_LOW );
     wifi_scan_timeout = false;
 
     timer_start( &wifi_scan_timeout_timer );
@@ -203,10 +280,19 @@ wifi_scan_result_t wifi_execute_scan( const void* context )
             case WIFI_SCAN:
             {
                 modem_response_code = lr1110_modem_wifi_cfg_hardware_debarker( context, true );
-                modem_response_code = lr1110_modem_wifi_passive_scan(
-                    context, wifi.settings.types, wifi.settings.channels, wifi.settings.scan_mode,
-                    wifi.settings.max_results, wifi.settings.nbr_retrials, wifi.settings.timeout,
-                    WIFI_SCAN_ABORT_ON_TIMEOUT, wifi.settings.result_format );
+                if( wifi.settings.early_stop_nb_aps == 0 )
+                {
+                    modem_response_code = lr1110_modem_wifi_passive_scan(
+                        context, wifi.settings.types, wifi.channels_left, wifi.settings.scan_mode,
+                        wifi.settings.max_results, wifi.settings.nbr_retrials, wifi.settings.timeout,
+                        WIFI_SCAN_ABORT_ON_TIMEOUT, wifi.settings.result_format );
+                    wifi_channels_scanned |= wifi.channels_left;
+                    wifi.channels_left = 0;
+                }
+                else
+                {
+                    modem_response_code = wifi_scan_next_channel( context );
+                }
 
                 // If response code different than RESPONSE_CODE_OK leave
                 if( modem_response_code != LR1110_MODEM_RESPONSE_CODE_OK )
@@ -246,9 +332,43 @@ wifi_scan_result_t wifi_execute_scan( const void* context )
                                                       wifi_results_mac_addr, nb_result, wifi_results_timings );
                 }
 
-                wifi_scan_done = true;
                 wifi.state = WIFI_INIT;
 
+                if( ( wifi.settings.early_stop_nb_aps != 0 ) && ( wifi.channels_left != 0 ) &&
+                    ( wifi.results.nbr_results < wifi.settings.max_results ) &&
+                    ( wifi_quality_target_met( &wifi.results ) == false ) )
+                {
+                    // Next channel, the cumulative timings are reset in WIFI_INIT
+                    break;
+                }
+
+                if( ( wifi.channels_left == 0 ) && ( wifi.results.nbr_results == 0 ) && ( wifi_plan.fallback != 0 ) )
+                {
+                    // Nothing on the channels expected at the site, the tracker may have moved
+                    wifi.channels_left = wifi_plan.fallback;
+                    wifi_plan.fallback = 0;
+                    break;
+                }
+
+                wifi.results.nb_channels_scanned = wifi_count_channels( wifi_channels_scanned );
+                wifi.results.nb_channels_skipped =
+                    wifi_count_channels( wifi.settings.channels & ~wifi_channels_scanned );
+                if( wifi.results.nb_channels_scanned != 0 )
+                {
+                    // The channels skipped are estimated to cost as much as the ones scanned
+                    wifi.results.saved_time_us =
+                        ( ( wifi.results.timings.rx_detection_us + wifi.results.timings.rx_correlation_us +
+                            wifi.results.timings.rx_capture_us + wifi.results.timings.demodulation_us ) /
+                          wifi.results.nb_channels_scanned ) *
+                        wifi.results.nb_channels_skipped;
+                    wifi.results.saved_uas = ( wifi.results.global_consumption_uas / wifi.results.nb_channels_scanned ) *
+                                             wifi.results.nb_channels_skipped;
+                }
+
+                hal_energy_add_charge( HAL_ENERGY_WIFI, wifi.results.global_consumption_uas );
+
+                wifi_scan_done = true;
+
                 break;
             }
 
@@ -268,6 +388,19 @@ wifi_scan_result_t wifi_execute_scan( const void* context )
         scan_result = WIFI_SCAN_FAIL;
     }
 
+    if( scan_result == WIFI_SCAN_SUCCESS )
+    {
+        wifi_channel_plan_update( &wifi.results, wifi_channels_scanned );
+    }
+
+    HAL_DBG_TRACE_PRINTF( "Wi-Fi channels scanned : %d, skipped : %d, saved %d ms / %d uAs\r\n",
+                          wifi.results.nb_channels_scanned, wifi.results.nb_channels_skipped,
+                          wifi.results.saved_time_us / 1000, wifi.results.saved_uas );
+
+    hal_mcu_set_clock_profile( clock_profile );
+
+    HAL_PROF_ZONE_END( HAL_PROF_ZONE_WIFI_SCAN );
+
     return scan_result;
 }
 
@@ -295,6 +428,12 @@ void lr1110_display_wifi_scan_results( void )
     }
 }
 
+bool wifi_scan_is_fixed_ap( const wifi_scan_single_result_t* result )
+{
+    return ( result->mac_origin != WIFI_MAC_ORIGIN_MOBILE_AP ) &&
+           ( ( result->mac_address[0] & WIFI_MAC_LOCALLY_ADMINISTERED ) == 0 );
+}
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
@@ -312,6 +451,9 @@ void wifi_configure( wifi_settings_t wifi_settings )
     wifi.settings.result_format = wifi_settings.result_format;
     wifi.settings.timeout       = wifi_settings.timeout;
 
+    wifi.settings.early_stop_nb_aps     = wifi_settings.early_stop_nb_aps;
+    wifi.settings.early_stop_rssi_floor = wifi_settings.early_stop_rssi_floor;
+
     // if format is LR1110_WIFI_RESULT_FORMAT_BASIC_COMPLETE max result available is 12 otherwise it's 32.
     if( ( wifi.settings.result_format == LR1110_MODEM_WIFI_RESULT_FORMAT_BASIC_COMPLETE ) &&
         ( wifi_settings.max_results > 12 ) )
@@ -332,13 +474,13 @@ uint32_t wifi_compute_consumption( const lr1110_modem_system_reg_mode_t
     switch( reg_mode )
     {
     case LR1110_MODEM_SYSTEM_REG_MODE_DCDC:
-        consumption_uas = ( ( timing.rx_correlation_us + timing.rx_capture_us ) * WIFI_CONSUMPTION_LDO_CORRELATION_MA +
-                            timing.demodulation_us * WIFI_CONSUMPTION_LDO_DEMODULATION_MA ) /
+        consumption_uas = ( ( timing.rx_correlation_us + timing.rx_capture_us ) * WIFI_CONSUMPTION_DCDC_CORRELATION_MA +
+                            timing.demodulation_us * WIFI_CONSUMPTION_DCDC_DEMODULATION_MA ) /
                           1000;
         break;
     case LR1110_MODEM_SYSTEM_REG_MODE_LDO:
-        consumption_uas = ( ( timing.rx_correlation_us + timing.rx_capture_us ) * WIFI_CONSUMPTION_DCDC_CORRELATION_MA +
-                            timing.demodulation_us * WIFI_CONSUMPTION_DCDC_DEMODULATION_MA ) /
+        consumption_uas = ( ( timing.rx_correlation_us + timing.rx_capture_us ) * WIFI_CONSUMPTION_LDO_CORRELATION_MA +
+                            timing.demodulation_us * WIFI_CONSUMPTION_LDO_DEMODULATION_MA ) /
                           1000;
         break;
     }
@@ -351,18 +493,20 @@ void wifi_add_basic_mac_to_results( lr1110_modem_system_reg_mode_t reg_mode, wif
 {
     for( uint8_t index = 0; index < nbr_results; index++ )
     {
-        results->results[index].channel =
-            lr1110_modem_extract_channel_from_info_byte( scan_result[index].channel_info_byte );
-        results->results[index].type =
-            lr1110_modem_extract_signal_type_from_data_rate_info( scan_result[index].data_rate_info_byte );
-        memcpy( results->results[index].mac_address, scan_result[index].mac_address,
-                LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH );
-        results->results[index].rssi = scan_result[index].rssi;
+        wifi_scan_single_result_t* result = wifi_new_result( results, scan_result[index].mac_address );
+
+        if( result == NULL )
+        {
+            continue;
+        }
+        result->channel = lr1110_modem_extract_channel_from_info_byte( scan_result[index].channel_info_byte );
+        result->type = lr1110_modem_extract_signal_type_from_data_rate_info( scan_result[index].data_rate_info_byte );
+        result->rssi = scan_result[index].rssi;
+        result->mac_origin = ( scan_result[index].channel_info_byte >> WIFI_MAC_ORIGIN_POS ) & WIFI_MAC_ORIGIN_MASK;
     }
 
-    results->timings = timing;
+    wifi_add_timings( results, timing );
     results->global_consumption_uas += wifi_compute_consumption( reg_mode, timing );
-    results->nbr_results = nbr_results;
 }
 
 void wifi_add_complete_mac_to_results( lr1110_modem_system_reg_mode_t reg_mode, wifi_scan_all_result_t* results,
@@ -371,20 +515,112 @@ void wifi_add_complete_mac_to_results( lr1110_modem_system_reg_mode_t reg_mode,
 {
     for( uint8_t index = 0; index < nbr_results; index++ )
     {
-        results->results[index].channel =
-            lr1110_modem_extract_channel_from_info_byte( scan_result[index].channel_info_byte );
-        results->results[index].type =
-            lr1110_modem_extract_signal_type_from_data_rate_info( scan_result[index].data_rate_info_byte );
-        memcpy( results->results[index].mac_address, scan_result[index].mac_address,
-                LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH );
-        results->results[index].rssi         = scan_result[index].rssi;
-        results->results[index].phi_offset   = scan_result[index].phi_offset;
-        results->results[index].timestamp_us = scan_result[index].timestamp_us;
+        wifi_scan_single_result_t* result = wifi_new_result( results, scan_result[index].mac_address );
+
+        if( result == NULL )
+        {
+            continue;
+        }
+        result->channel = lr1110_modem_extract_channel_from_info_byte( scan_result[index].channel_info_byte );
+        result->type = lr1110_modem_extract_signal_type_from_data_rate_info( scan_result[index].data_rate_info_byte );
+        result->rssi         = scan_result[index].rssi;
+        result->phi_offset   = scan_result[index].phi_offset;
+        result->timestamp_us = scan_result[index].timestamp_us;
+        result->mac_origin   = ( scan_result[index].channel_info_byte >> WIFI_MAC_ORIGIN_POS ) & WIFI_MAC_ORIGIN_MASK;
     }
 
-    results->timings = timing;
+    wifi_add_timings( results, timing );
     results->global_consumption_uas += wifi_compute_consumption( reg_mode, timing );
-    results->nbr_results = nbr_results;
+}
+
+static lr1110_modem_response_code_t wifi_scan_next_channel( const void* context )
+{
+    lr1110_modem_wifi_channel_mask_t channel_mask    = 0;
+    uint32_t                         channel_timeout = wifi.settings.timeout * wifi.settings.nbr_retrials;
+
+    for( uint8_t i = 0; i < WIFI_CHANNEL_PLAN_NB_CHANNELS; i++ )
+    {
+        if( ( wifi.channels_left & ( 1 << ( wifi_plan.order[i] - 1 ) ) ) != 0 )
+        {
+            channel_mask = 1 << ( wifi_plan.order[i] - 1 );
+            break;
+        }
+    }
+    if( channel_mask == 0 )
+    {
+        return LR1110_MODEM_RESPONSE_CODE_INVALID;
+    }
+    wifi.channels_left &= ~channel_mask;
+    wifi_channels_scanned |= channel_mask;
+
+    // Same worst case per channel as the passive scan, the preamble searches are bounded by the timeout
+    if( channel_timeout > UINT16_MAX )
+    {
+        channel_timeout = UINT16_MAX;
+    }
+    return lr1110_modem_wifi_passive_scan_time_limit( context, wifi.settings.types, channel_mask, wifi.settings.scan_mode,
+                                                      wifi.settings.max_results - wifi.results.nbr_results,
+                                                      channel_timeout, wifi.settings.timeout,
+                                                      wifi.settings.result_format );
+}
+
+static bool wifi_quality_target_met( const wifi_scan_all_result_t* results )
+{
+    uint8_t nb_aps = 0;
+
+    for( uint8_t i = 0; i < results->nbr_results; i++ )
+    {
+        if( ( results->results[i].rssi >= wifi.settings.early_stop_rssi_floor ) &&
+            ( wifi_scan_is_fixed_ap( &results->results[i] ) == true ) )
+        {
+            nb_aps++;
+        }
+    }
+    return nb_aps >= wifi.settings.early_stop_nb_aps;
+}
+
+static wifi_scan_single_result_t* wifi_new_result( wifi_scan_all_result_t*               results,
+                                                   const lr1110_modem_wifi_mac_address_t mac_address )
+{
+    wifi_scan_single_result_t* result;
+
+    for( uint8_t i = 0; i < results->nbr_results; i++ )
+    {
+        if( memcmp( results->results[i].mac_address, mac_address, LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH ) == 0 )
+        {
+            return NULL;
+        }
+    }
+    if( results->nbr_results >= WIFI_MAX_RESULT_TOTAL )
+    {
+        return NULL;
+    }
+
+    result = &results->results[results->nbr_results++];
+    memset( result, 0, sizeof( wifi_scan_single_result_t ) );
+    memcpy( result->mac_address, mac_address, LR1110_MODEM_WIFI_MAC_ADDRESS_LENGTH );
+
+    return result;
+}
+
+static void wifi_add_timings( wifi_scan_all_result_t* results, const lr1110_modem_wifi_cumulative_timings_t timing )
+{
+    results->timings.rx_detection_us += timing.rx_detection_us;
+    results->timings.rx_correlation_us += timing.rx_correlation_us;
+    results->timings.rx_capture_us += timing.rx_capture_us;
+    results->timings.demodulation_us += timing.demodulation_us;
+}
+
+static uint8_t wifi_count_channels( lr1110_modem_wifi_channel_mask_t channels )
+{
+    uint8_t nb_channels = 0;
+
+    while( channels != 0 )
+    {
+        channels &= channels - 1;
+        nb_channels++;
+    }
+    return nb_channels;
 }
 
 /* --- EOF ------------------------------------------------------------------ */
@@ -59,6 +59,22 @@ extern "C" {
 #define WIFI_TIMEOUT_IN_MS_DEFAULT 110
 #define WIFI_MAX_RESULT_TOTAL 32
 
+/*!
+ * \brief Default quality target of the time-bounded scan, number of distinct non-mobile APs and their RSSI floor
+ */
+#define WIFI_EARLY_STOP_NB_APS_DEFAULT 6
+#define WIFI_EARLY_STOP_RSSI_FLOOR_DEFAULT -85
+
+/*!
+ * \brief MAC origin of the APs the LR1110 flags as mobile, see wifi_scan_single_result_t
+ */
+#define WIFI_MAC_ORIGIN_MOBILE_AP 0x02
+
+/*!
+ * \brief Locally administered bit of the first MAC address byte, set by hotspots and randomized addresses
+ */
+#define WIFI_MAC_LOCALLY_ADMINISTERED 0x02
+
 #define WIFI_SCAN_SUCCESS 1
 #define WIFI_SCAN_FAIL 0
 
@@ -96,6 +112,7 @@ typedef struct
     uint64_t                               timestamp_us;
     uint16_t                               beacon_period_tu;
     uint8_t                                country_code[LR1110_MODEM_WIFI_STR_COUNTRY_CODE_SIZE];
+    uint8_t                                mac_origin;  // Fixed AP, mobile AP or undetermined, from the channel info
 } wifi_scan_single_result_t;
 
 /*!
@@ -110,6 +127,10 @@ typedef struct
     uint8_t                                raw_buffer[288];
     uint16_t                               raw_buffer_size;
     bool                                   error;
+    uint8_t                                nb_channels_scanned;  // Channels scanned by the time-bounded scan
+    uint8_t                                nb_channels_skipped;  // Channels left once the quality target was met
+    uint32_t                               saved_time_us;        // Estimated radio time saved by the early stop
+    uint32_t                               saved_uas;            // Estimated charge saved by the early stop
 } wifi_scan_all_result_t;
 
 /*!
@@ -125,6 +146,8 @@ typedef struct
     uint8_t                              max_results;
     uint32_t                             timeout;
     lr1110_modem_wifi_result_format_t    result_format;
+    uint8_t                              early_stop_nb_aps;      // Quality target, 0 for a single passive scan
+    int8_t                               early_stop_rssi_floor;  // RSSI floor of the APs counted for the target
 } wifi_settings_t;
 
 /*!
@@ -132,10 +155,11 @@ typedef struct
  */
 typedef struct
 {
-    lr1110_modem_system_reg_mode_t reg_mode;
-    wifi_scan_all_result_t         results;
-    wifi_settings_t                settings;
-    wifi_state_t                   state;
+    lr1110_modem_system_reg_mode_t   reg_mode;
+    wifi_scan_all_result_t           results;
+    wifi_settings_t                  settings;
+    wifi_state_t                     state;
+    lr1110_modem_wifi_channel_mask_t channels_left;  // Channels not scanned yet by the time-bounded scan
 } wifi_t;
 
 /*
@@ -160,10 +184,23 @@ void lr1110_display_wifi_scan_results( void );
 /*!
  * \brief execute the wifi scan state machine
  *
+ * \remark When early_stop_nb_aps is set, the channels are scanned one by one with a time limit and the scan stops
+ *         once early_stop_nb_aps distinct non-mobile APs are heard above early_stop_rssi_floor
+ *
  * \param [in] context Radio abstraction
  */
 wifi_scan_result_t wifi_execute_scan( const void* context );
 
+/*!
+ * \brief Tells if a result is a fixed AP, neither flagged as a mobile AP by the LR1110 nor using a locally
+ *        administered MAC address like hotspots and randomized addresses do
+ *
+ * \param [in] result Scan result \ref wifi_scan_single_result_t
+ *
+ * \return true for a fixed AP
+ */
+bool wifi_scan_is_fixed_ap( const wifi_scan_single_result_t* result );
+
 /*!
  * \brief init the wifi scan state machine
  *
@@ -0,0 +1,316 @@
+/*!
+ * \file      smtc_hal_energy.c
+ *
+ * \brief     Board specific package energy accounting API implementation.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>
+
+#include "smtc_hal_energy.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * \brief Number of RTC ticks per second is 2^RTC_TICKS_PER_SECOND_SHIFT
+ */
+#define RTC_TICKS_PER_SECOND_SHIFT 10U
+
+/*!
+ * \brief Number of uAs in one uAh and in one mAh
+ */
+#define UAS_PER_UAH 3600U
+#define UAS_PER_MAH 3600000U
+
+#if( UAS_PER_MAH != HAL_ENERGY_LORA_TX_RESOLUTION_UAS )
+#error "The LoRa TX charge resolution is the mAh of the modem charge counter"
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * \brief Energy accounting context
+ *
+ * \remark Charges of the ongoing cycle are kept in uA.tick to avoid rounding at each transition
+ */
+typedef struct hal_energy_ctx_s
+{
+    uint32_t current_ua[HAL_ENERGY_SUBSYSTEM_NB];
+    uint32_t state_timestamp[HAL_ENERGY_SUBSYSTEM_NB];
+    uint64_t cycle_charge[HAL_ENERGY_SUBSYSTEM_NB];
+    uint32_t cycle_timestamp;
+    uint32_t total_remainder_uas[HAL_ENERGY_SUBSYSTEM_NB];
+    uint64_t modem_modelled_charge;
+    uint32_t previous_modem_charge_mah;
+    bool     previous_modem_charge_valid;
+    uint8_t  transition_index;
+    uint8_t  nb_transitions;
+} hal_energy_ctx_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static hal_energy_ctx_t energy_ctx;
+
+static hal_energy_report_t energy_report;
+
+static hal_energy_transition_t energy_transitions[HAL_ENERGY_TRANSITION_HISTORY_LEN];
+
+static const char* subsystem_names[HAL_ENERGY_SUBSYSTEM_NB] = { "MCU", "Wi-Fi", "GNSS", "LoRa TX", "Flash", "BLE" };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief Integrates the charge drawn by a subsystem since its last transition
+ *
+ * \param [in] subsystem Subsystem to integrate \ref hal_energy_subsystem_t
+ * \param [in] now       Current RTC timestamp in ticks
+ */
+static void hal_energy_integrate( const hal_energy_subsystem_t subsystem, const uint32_t now );
+
+/*!
+ * \brief Adds a charge in uA.tick to the ongoing cycle of a subsystem
+ *
+ * \param [in] subsystem Subsystem to charge \ref hal_energy_subsystem_t
+ * \param [in] charge    Charge in uA.tick
+ */
+static void hal_energy_add_cycle_charge( const hal_energy_subsystem_t subsystem, const uint64_t charge );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hal_energy_init( void )
+{
+    uint32_t now = hal_rtc_get_timer_value( );
+
+    memset( &energy_ctx, 0, sizeof( energy_ctx ) );
+    memset( &energy_report, 0, sizeof( energy_report ) );
+
+    for( uint8_t i = 0; i < HAL_ENERGY_SUBSYSTEM_NB; i++ )
+    {
+        energy_ctx.state_timestamp[i] = now;
+    }
+    energy_ctx.cycle_timestamp = now;
+
+    hal_energy_set_state( HAL_ENERGY_MCU, HAL_ENERGY_MCU_RUN_CURRENT_UA );
+}
+
+void hal_energy_set_state( const hal_energy_subsystem_t subsystem, const uint32_t current_ua )
+{
+    uint32_t now = hal_rtc_get_timer_value( );
+
+    if( subsystem >= HAL_ENERGY_SUBSYSTEM_NB )
+    {
+        return;
+    }
+
+    hal_energy_integrate( subsystem, now );
+    energy_ctx.current_ua[subsystem] = current_ua;
+
+    energy_transitions[energy_ctx.transition_index].timestamp  = now;
+    energy_transitions[energy_ctx.transition_index].subsystem  = subsystem;
+    energy_transitions[energy_ctx.transition_index].current_ua = current_ua;
+
+    energy_ctx.transition_index = ( energy_ctx.transition_index + 1 ) % HAL_ENERGY_TRANSITION_HISTORY_LEN;
+    if( energy_ctx.nb_transitions < HAL_ENERGY_TRANSITION_HISTORY_LEN )
+    {
+        energy_ctx.nb_transitions++;
+    }
+}
+
+void hal_energy_add_charge( const hal_energy_subsystem_t subsystem, const uint32_t charge_uas )
+{
+    if( subsystem >= HAL_ENERGY_SUBSYSTEM_NB )
+    {
+        return;
+    }
+
+    hal_energy_add_cycle_charge( subsystem, ( ( uint64_t ) charge_uas ) << RTC_TICKS_PER_SECOND_SHIFT );
+}
+
+void hal_energy_update_modem_charge( const uint32_t modem_charge_mah )
+{
+    uint64_t modem_charge = 0;
+
+    /* The first reading and a reset of the modem counter only give a new reference */
+    if( ( energy_ctx.previous_modem_charge_valid == false ) ||
+        ( modem_charge_mah < energy_ctx.previous_modem_charge_mah ) )
+    {
+        energy_ctx.previous_modem_charge_mah   = modem_charge_mah;
+        energy_ctx.previous_modem_charge_valid = true;
+        energy_ctx.modem_modelled_charge       = 0;
+        return;
+    }
+
+    modem_charge = ( ( uint64_t )( modem_charge_mah - energy_ctx.previous_modem_charge_mah ) * UAS_PER_MAH )
+                   << RTC_TICKS_PER_SECOND_SHIFT;
+    energy_ctx.previous_modem_charge_mah = modem_charge_mah;
+
+    /* What the Wi-Fi and GNSS models do not explain is attributed to the LoRa transmissions, in whole mAh steps */
+    if( modem_charge > energy_ctx.modem_modelled_charge )
+    {
+        energy_ctx.cycle_charge[HAL_ENERGY_LORA_TX] += modem_charge - energy_ctx.modem_modelled_charge;
+        energy_ctx.modem_modelled_charge = 0;
+    }
+    else
+    {
+        energy_ctx.modem_modelled_charge -= modem_charge;
+    }
+}
+
+void hal_energy_close_cycle( void )
+{
+    uint32_t now = hal_rtc_get_timer_value( );
+
+    for( uint8_t i = 0; i < HAL_ENERGY_SUBSYSTEM_NB; i++ )
+    {
+        uint32_t cycle_charge_uas = 0;
+
+        hal_energy_integrate( ( hal_energy_subsystem_t ) i, now );
+
+        cycle_charge_uas = ( uint32_t )( energy_ctx.cycle_charge[i] >> RTC_TICKS_PER_SECOND_SHIFT );
+        energy_ctx.cycle_charge[i] -= ( ( uint64_t ) cycle_charge_uas ) << RTC_TICKS_PER_SECOND_SHIFT;
+
+        energy_report.cycle_charge_uas[i] = cycle_charge_uas;
+
+        energy_ctx.total_remainder_uas[i] += cycle_charge_uas % UAS_PER_UAH;
+        energy_report.total_charge_uah[i] +=
+            ( cycle_charge_uas / UAS_PER_UAH ) + ( energy_ctx.total_remainder_uas[i] / UAS_PER_UAH );
+        energy_ctx.total_remainder_uas[i] %= UAS_PER_UAH;
+    }
+
+    energy_report.cycle_duration_ms = hal_rtc_tick_2_ms( now - energy_ctx.cycle_timestamp );
+    energy_report.nb_cycles++;
+    energy_ctx.cycle_timestamp = now;
+}
+
+void hal_energy_get_report( hal_energy_report_t* report ) { memcpy( report, &energy_report, sizeof( energy_report ) ); }
+
+uint32_t hal_energy_get_total_charge( void )
+{
+    uint32_t total_charge_uah = 0;
+
+    for( uint8_t i = 0; i < HAL_ENERGY_SUBSYSTEM_NB; i++ )
+    {
+        total_charge_uah += energy_report.total_charge_uah[i];
+    }
+
+    return total_charge_uah;
+}
+
+void hal_energy_set_total_charge( const uint32_t* total_charge_uah )
+{
+    memcpy( energy_report.total_charge_uah, total_charge_uah, sizeof( energy_report.total_charge_uah ) );
+}
+
+void hal_energy_reset_total_charge( void )
+{
+    memset( energy_report.total_charge_uah, 0, sizeof( energy_report.total_charge_uah ) );
+    memset( energy_ctx.total_remainder_uas, 0, sizeof( energy_ctx.total_remainder_uas ) );
+    energy_report.nb_cycles = 0;
+}
+
+uint8_t hal_energy_get_transitions( hal_energy_transition_t* transitions )
+{
+    uint8_t first = ( energy_ctx.transition_index + HAL_ENERGY_TRANSITION_HISTORY_LEN - energy_ctx.nb_transitions ) %
+                    HAL_ENERGY_TRANSITION_HISTORY_LEN;
+
+    for( uint8_t i = 0; i < energy_ctx.nb_transitions; i++ )
+    {
+        transitions[i] = energy_transitions[( first + i ) % HAL_ENERGY_TRANSITION_HISTORY_LEN];
+    }
+
+    return energy_ctx.nb_transitions;
+}
+
+void hal_energy_print_report( void )
+{
+    HAL_DBG_TRACE_PRINTF( "Energy cycle %d, duration %d ms\r\n", energy_report.nb_cycles,
+                          energy_report.cycle_duration_ms );
+    for( uint8_t i = 0; i < HAL_ENERGY_SUBSYSTEM_NB; i++ )
+    {
+        HAL_DBG_TRACE_PRINTF( " - %-7s : cycle %7d uAs | total %7d uAh\r\n", subsystem_names[i],
+                              energy_report.cycle_charge_uas[i], energy_report.total_charge_uah[i] );
+    }
+    HAL_DBG_TRACE_MSG( "   LoRa TX is counted by the modem in 1 mAh steps\r\n" );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void hal_energy_integrate( const hal_energy_subsystem_t subsystem, const uint32_t now )
+{
+    uint32_t elapsed_ticks = now - energy_ctx.state_timestamp[subsystem];
+
+    if( energy_ctx.current_ua[subsystem] != 0 )
+    {
+        hal_energy_add_cycle_charge( subsystem, ( uint64_t ) energy_ctx.current_ua[subsystem] * elapsed_ticks );
+    }
+    energy_ctx.state_timestamp[subsystem] = now;
+}
+
+static void hal_energy_add_cycle_charge( const hal_energy_subsystem_t subsystem, const uint64_t charge )
+{
+    energy_ctx.cycle_charge[subsystem] += charge;
+
+    /* Wi-Fi and GNSS are also counted by the modem charge counter */
+    if( ( subsystem == HAL_ENERGY_WIFI ) || ( subsystem == HAL_ENERGY_GNSS ) )
+    {
+        energy_ctx.modem_modelled_charge += charge;
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -39,6 +39,7 @@
 #include <stdio.h>
 #include "stm32wbxx_hal.h"
 #include "smtc_hal_flash.h"
+#include "smtc_hal_energy.h"
 #include "utilities.h"
 
 /*
@@ -188,6 +189,8 @@ uint8_t flash_erase_page( uint32_t addr, uint8_t nb_page )
     to protect the FLASH memory against possible unwanted operation) *********/
     HAL_FLASH_Lock( );
 
+    hal_energy_add_charge( HAL_ENERGY_FLASH, nb_page * HAL_ENERGY_FLASH_PAGE_ERASE_UAS );
+
     return status;
 }
 
@@ -250,6 +253,8 @@ uint8_t flash_force_erase_page( uint32_t addr, uint8_t nb_page )
     to protect the FLASH memory against possible unwanted operation) *********/
     HAL_FLASH_Lock( );
 
+    hal_energy_add_charge( HAL_ENERGY_FLASH, nb_page * HAL_ENERGY_FLASH_PAGE_ERASE_UAS );
+
     return status;
 }
 
@@ -327,6 +332,8 @@ uint32_t flash_write_buffer( uint32_t addr, uint8_t* buffer, uint32_t size )
     to protect the FLASH memory against possible unwanted operation) *********/
     HAL_FLASH_Lock( );
 
+    hal_energy_add_charge( HAL_ENERGY_FLASH, ( ( real_size / 8 ) * HAL_ENERGY_FLASH_DOUBLE_WORD_PROGRAM_NAS ) / 1000 );
+
     return real_size;
 }
 
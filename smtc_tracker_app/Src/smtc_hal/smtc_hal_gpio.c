@@ -40,6 +40,8 @@
 #include "stm32wbxx_hal.h"
 #include "smtc_hal_mcu.h"
 #include "smtc_hal_gpio.h"
+#include "smtc_hal_residency.h"
+#include "board-config.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -51,6 +53,15 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+/*!
+ * \brief Fields of a packed pin configuration, see hal_gpio_save_config
+ */
+#define GPIO_CONFIG_MODE_POS 0
+#define GPIO_CONFIG_OTYPE_POS 2
+#define GPIO_CONFIG_OSPEED_POS 3
+#define GPIO_CONFIG_PUPD_POS 5
+#define GPIO_CONFIG_AF_POS 7
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -81,6 +92,22 @@ static hal_gpio_irq_t const* gpio_irq[16];
  */
 static void hal_gpio_init( const hal_gpio_t* gpio, const uint32_t value, const hal_gpio_irq_t* irq );
 
+/*!
+ * \brief Enables the clock of a gpio port
+ *
+ * \param [in] gpio_port Port of the pin
+ */
+static void hal_gpio_enable_clock( const GPIO_TypeDef* gpio_port );
+
+/*!
+ * \brief Returns the wake source accounted for an interrupt pin of the board
+ *
+ * \param [in] pin Interrupt pin
+ *
+ * \retval source Wake source \ref hal_residency_wake_source_t
+ */
+static hal_residency_wake_source_t hal_gpio_get_wake_source( const hal_gpio_pin_names_t pin );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -178,6 +205,40 @@ uint32_t hal_gpio_get_value( const hal_gpio_pin_names_t pin )
     return ( HAL_GPIO_ReadPin( gpio_port, ( ( 1 << ( pin & 0x0F ) ) ) ) != GPIO_PIN_RESET ) ? 1 : 0;
 }
 
+uint32_t hal_gpio_save_config( const hal_gpio_pin_names_t pin )
+{
+    GPIO_TypeDef* gpio_port = ( GPIO_TypeDef* ) ( AHB2PERIPH_BASE + ( ( pin & 0xF0 ) << 6 ) );
+    uint32_t      index     = pin & 0x0F;
+
+    return ( ( ( gpio_port->MODER >> ( 2 * index ) ) & 0x03 ) << GPIO_CONFIG_MODE_POS ) |
+           ( ( ( gpio_port->OTYPER >> index ) & 0x01 ) << GPIO_CONFIG_OTYPE_POS ) |
+           ( ( ( gpio_port->OSPEEDR >> ( 2 * index ) ) & 0x03 ) << GPIO_CONFIG_OSPEED_POS ) |
+           ( ( ( gpio_port->PUPDR >> ( 2 * index ) ) & 0x03 ) << GPIO_CONFIG_PUPD_POS ) |
+           ( ( ( gpio_port->AFR[index >> 3] >> ( 4 * ( index & 0x07 ) ) ) & 0x0F ) << GPIO_CONFIG_AF_POS );
+}
+
+void hal_gpio_restore_config( const hal_gpio_pin_names_t pin, const uint32_t config )
+{
+    GPIO_TypeDef* gpio_port = ( GPIO_TypeDef* ) ( AHB2PERIPH_BASE + ( ( pin & 0xF0 ) << 6 ) );
+    uint32_t      index     = pin & 0x0F;
+
+    CRITICAL_SECTION_BEGIN( );
+
+    // The port clock may have been gated by hal_mcu_deinit_periph
+    hal_gpio_enable_clock( gpio_port );
+
+    // The mode is written last so the pin switches to its function fully configured
+    MODIFY_REG( gpio_port->AFR[index >> 3], 0x0F << ( 4 * ( index & 0x07 ) ),
+                ( ( config >> GPIO_CONFIG_AF_POS ) & 0x0F ) << ( 4 * ( index & 0x07 ) ) );
+    MODIFY_REG( gpio_port->PUPDR, 0x03 << ( 2 * index ), ( ( config >> GPIO_CONFIG_PUPD_POS ) & 0x03 ) << ( 2 * index ) );
+    MODIFY_REG( gpio_port->OSPEEDR, 0x03 << ( 2 * index ),
+                ( ( config >> GPIO_CONFIG_OSPEED_POS ) & 0x03 ) << ( 2 * index ) );
+    MODIFY_REG( gpio_port->OTYPER, 0x01 << index, ( ( config >> GPIO_CONFIG_OTYPE_POS ) & 0x01 ) << index );
+    MODIFY_REG( gpio_port->MODER, 0x03 << ( 2 * index ), ( ( config >> GPIO_CONFIG_MODE_POS ) & 0x03 ) << ( 2 * index ) );
+
+    CRITICAL_SECTION_END( );
+}
+
 bool hal_gpio_is_pending_irq( void )
 {
     return ( ( NVIC_GetPendingIRQ( EXTI0_IRQn ) == 1 ) || ( NVIC_GetPendingIRQ( EXTI2_IRQn ) == 1 ) ||
@@ -206,10 +267,14 @@ void HAL_GPIO_EXTI_Callback( uint16_t gpio_pin )
 
     if( ( gpio_irq[callback_index] != NULL ) && ( gpio_irq[callback_index]->callback != NULL ) )
     {
+        hal_residency_notify_wake( hal_gpio_get_wake_source( gpio_irq[callback_index]->pin ) );
         gpio_irq[callback_index]->callback( gpio_irq[callback_index]->context );
+        hal_gpio_irq_notify( gpio_irq[callback_index]->pin );
     }
 }
 
+__weak void hal_gpio_irq_notify( const hal_gpio_pin_names_t pin ) {}
+
 /******************************************************************************/
 /* STM32L4xx Peripheral Interrupt Handlers                                    */
 /* Add here the Interrupt Handlers for the used peripherals.                  */
@@ -340,30 +405,7 @@ static void hal_gpio_init( const hal_gpio_t* gpio, const uint32_t value, const h
     gpio_local.Speed     = gpio->speed;
     gpio_local.Alternate = gpio->alternate;
 
-    if( gpio_port == GPIOA )
-    {
-        __HAL_RCC_GPIOA_CLK_ENABLE( );
-    }
-    else if( gpio_port == GPIOB )
-    {
-        __HAL_RCC_GPIOB_CLK_ENABLE( );
-    }
-    else if( gpio_port == GPIOC )
-    {
-        __HAL_RCC_GPIOC_CLK_ENABLE( );
-    }
-    else if( gpio_port == GPIOD )
-    {
-        __HAL_RCC_GPIOD_CLK_ENABLE( );
-    }
-    else if( gpio_port == GPIOE )
-    {
-        __HAL_RCC_GPIOE_CLK_ENABLE( );
-    }
-    else if( gpio_port == GPIOH )
-    {
-        __HAL_RCC_GPIOH_CLK_ENABLE( );
-    }
+    hal_gpio_enable_clock( gpio_port );
 
     HAL_GPIO_WritePin( gpio_port, gpio_local.Pin, ( GPIO_PinState ) value );
     HAL_GPIO_Init( gpio_port, &gpio_local );
@@ -410,4 +452,49 @@ static void hal_gpio_init( const hal_gpio_t* gpio, const uint32_t value, const h
     }
 }
 
+static void hal_gpio_enable_clock( const GPIO_TypeDef* gpio_port )
+{
+    if( gpio_port == GPIOA )
+    {
+        __HAL_RCC_GPIOA_CLK_ENABLE( );
+    }
+    else if( gpio_port == GPIOB )
+    {
+        __HAL_RCC_GPIOB_CLK_ENABLE( );
+    }
+    else if( gpio_port == GPIOC )
+    {
+        __HAL_RCC_GPIOC_CLK_ENABLE( );
+    }
+    else if( gpio_port == GPIOD )
+    {
+        __HAL_RCC_GPIOD_CLK_ENABLE( );
+    }
+    else if( gpio_port == GPIOE )
+    {
+        __HAL_RCC_GPIOE_CLK_ENABLE( );
+    }
+    else if( gpio_port == GPIOH )
+    {
+        __HAL_RCC_GPIOH_CLK_ENABLE( );
+    }
+}
+
+static hal_residency_wake_source_t hal_gpio_get_wake_source( const hal_gpio_pin_names_t pin )
+{
+    switch( pin )
+    {
+    case RADIO_EVENT:
+        return HAL_RESIDENCY_WAKE_RADIO_EVENT;
+    case ACC_INT1:
+        return HAL_RESIDENCY_WAKE_ACCELEROMETER;
+    case EFFECT_HALL_OUT:
+        return HAL_RESIDENCY_WAKE_HALL_EFFECT;
+    case USER_BUTTON:
+        return HAL_RESIDENCY_WAKE_USER_BUTTON;
+    default:
+        return HAL_RESIDENCY_WAKE_OTHER;
+    }
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -35,8 +35,11 @@
  */
 #include "stm32wbxx_hal.h"
 #include "smtc_hal_gpio_pin_names.h"
+#include "smtc_hal_gpio.h"
 #include "smtc_hal_i2c.h"
 #include "smtc_hal_mcu.h"
+#include "smtc_hal_profiling.h"
+#include "smtc_hal_rtc.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -48,11 +51,38 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+/*!
+ * \brief Timing register without its prescaler, SCL low/high and data times for a 16 MHz prescaled clock
+ */
+#define I2C_TIMING_16MHZ 0x00909CEC
+
+/*!
+ * \brief Prescaled I2C clock the timings are computed for
+ */
+#define I2C_TIMING_CLOCK_HZ 16000000UL
+
+/*!
+ * \brief Reads shorter than this are run with the interrupts, setting up the DMA costs more than it saves
+ */
+#define I2C_DMA_MIN_SIZE 4
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
  */
 
+/*!
+ * \brief Transaction queue of an I2C interface
+ */
+typedef struct
+{
+    hal_i2c_transaction_t* queue[HAL_I2C_QUEUE_LEN];  // Transactions in order, the first one in progress
+    uint8_t                head;                      // Index of the first transaction
+    uint8_t                count;                     // Number of queued transactions
+    uint8_t                transfer_index;            // Transfer in progress of the first transaction
+    DMA_HandleTypeDef      hdma_rx;                   // Reads DMA
+} i2c_async_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
@@ -82,6 +112,8 @@ static hal_i2c_t hal_i2c[] = {
 
 static i2c_addr_size i2c_internal_addr_size;
 
+static i2c_async_t i2c_async[3];
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
@@ -114,6 +146,77 @@ static uint8_t i2c_write_buffer( const uint32_t id, uint8_t device_addr, uint16_
  */
 static uint8_t i2c_read_buffer( const uint32_t id, uint8_t device_addr, uint16_t addr, uint8_t* buffer, uint16_t size );
 
+/*!
+ * \brief Returns the timing register value for the given I2C kernel clock
+ *
+ * \param [in] pclk_hz I2C kernel clock frequency in Hz
+ *
+ * \retval timing I2C_TIMINGR value
+ */
+static uint32_t i2c_get_timing( const uint32_t pclk_hz );
+
+/*!
+ * \brief Returns the HAL size of the internal device address
+ *
+ * \retval size I2C_MEMADD_SIZE_8BIT or I2C_MEMADD_SIZE_16BIT
+ */
+static uint16_t i2c_get_mem_add_size( void );
+
+/*!
+ * \brief Returns the interface index of a HAL handle
+ *
+ * \param [in] handle I2C HAL handle
+ *
+ * \retval local_id Index in hal_i2c, 0 for an unknown handle
+ */
+static uint32_t i2c_get_local_id( const I2C_HandleTypeDef* handle );
+
+/*!
+ * \brief Starts the transfer in progress of the first queued transaction, the transactions which can not be started
+ *        are completed with FAIL
+ *
+ * \param [in] local_id I2C interface index
+ */
+static void i2c_async_start( const uint32_t local_id );
+
+/*!
+ * \brief Ends a transfer from the interrupts, starts the next transfer or completes the transaction
+ *
+ * \param [in] handle I2C HAL handle
+ * \param [in] status Transfer status [SUCCESS, FAIL]
+ */
+static void i2c_async_transfer_done( I2C_HandleTypeDef* handle, const uint8_t status );
+
+/*!
+ * \brief Removes the first transaction from the queue and calls its callback
+ *
+ * \param [in] local_id I2C interface index
+ * \param [in] status Transaction status [SUCCESS, FAIL]
+ */
+static void i2c_async_complete( const uint32_t local_id, const uint8_t status );
+
+/*!
+ * \brief Waits for a transaction, or for the whole queue, the core sleeps meanwhile
+ *
+ * \param [in] local_id I2C interface index
+ * \param [in] transaction Transaction waited for, NULL for the whole queue
+ */
+static void i2c_async_wait( const uint32_t local_id, const hal_i2c_transaction_t* transaction );
+
+/*!
+ * \brief Resets the interface of a stuck transfer and completes the queued transactions with FAIL
+ *
+ * \param [in] local_id I2C interface index
+ */
+static void i2c_async_abort( const uint32_t local_id );
+
+/*!
+ * \brief I2C1 interrupt handlers
+ */
+void I2C1_EV_IRQHandler( void );
+void I2C1_ER_IRQHandler( void );
+void DMA1_Channel3_IRQHandler( void );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -125,7 +228,7 @@ void hal_i2c_init( const uint32_t id, const hal_gpio_pin_names_t sda, const hal_
     uint32_t local_id = id - 1;
 
     hal_i2c[local_id].handle.Instance              = hal_i2c[local_id].interface;
-    hal_i2c[local_id].handle.Init.Timing           = 0x10909CEC;
+    hal_i2c[local_id].handle.Init.Timing           = i2c_get_timing( HAL_RCC_GetPCLK1Freq( ) );
     hal_i2c[local_id].handle.Init.OwnAddress1      = 0;
     hal_i2c[local_id].handle.Init.AddressingMode   = I2C_ADDRESSINGMODE_7BIT;
     hal_i2c[local_id].handle.Init.DualAddressMode  = I2C_DUALADDRESS_DISABLE;
@@ -165,6 +268,54 @@ void hal_i2c_deinit( const uint32_t id )
     HAL_I2C_DeInit( &hal_i2c[local_id].handle );
 }
 
+void hal_i2c_suspend( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_i2c ) ) );
+    uint32_t local_id = id - 1;
+
+    hal_i2c[local_id].pins_config.sda = hal_gpio_save_config( hal_i2c[local_id].pins.sda );
+    hal_i2c[local_id].pins_config.scl = hal_gpio_save_config( hal_i2c[local_id].pins.scl );
+    hal_gpio_deinit( hal_i2c[local_id].pins.sda );
+    hal_gpio_deinit( hal_i2c[local_id].pins.scl );
+    hal_i2c[local_id].is_suspended = true;
+}
+
+void hal_i2c_resume( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_i2c ) ) );
+    uint32_t local_id = id - 1;
+
+    if( hal_i2c[local_id].is_suspended == true )
+    {
+        // Counted in the wake-to-ready time, masked as the zone could be entered again from an interrupt
+        CRITICAL_SECTION_BEGIN( );
+        HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_BUS_RESUME );
+        hal_gpio_restore_config( hal_i2c[local_id].pins.sda, hal_i2c[local_id].pins_config.sda );
+        hal_gpio_restore_config( hal_i2c[local_id].pins.scl, hal_i2c[local_id].pins_config.scl );
+        HAL_PROF_ZONE_END( HAL_PROF_ZONE_BUS_RESUME );
+        CRITICAL_SECTION_END( );
+        hal_i2c[local_id].is_suspended = false;
+    }
+}
+
+void hal_i2c_retime( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_i2c ) ) );
+    uint32_t local_id = id - 1;
+    uint32_t timing   = i2c_get_timing( HAL_RCC_GetPCLK1Freq( ) );
+
+    if( ( hal_i2c[local_id].handle.State == HAL_I2C_STATE_RESET ) || ( timing == hal_i2c[local_id].handle.Init.Timing ) )
+    {
+        return;
+    }
+
+    // TIMINGR can only be written while the I2C is disabled
+    __HAL_I2C_DISABLE( &hal_i2c[local_id].handle );
+    WRITE_REG( hal_i2c[local_id].interface->TIMINGR, timing & 0xF0FFFFFF );
+    hal_i2c[local_id].handle.Init.Timing = timing;
+    __HAL_I2C_ENABLE( &hal_i2c[local_id].handle );
+}
+
 void HAL_I2C_MspInit( I2C_HandleTypeDef* i2cHandle )
 {
     if( i2cHandle->Instance == hal_i2c[0].interface )
@@ -180,6 +331,32 @@ void HAL_I2C_MspInit( I2C_HandleTypeDef* i2cHandle )
         HAL_GPIO_Init( gpio_port, &gpio );
 
         __HAL_RCC_I2C1_CLK_ENABLE( );
+
+        /* I2C1 RX DMA, DMA1_Channel1 is used by the ADC and DMA1_Channel2 by the USART1 TX */
+        __HAL_RCC_DMAMUX1_CLK_ENABLE( );
+        __HAL_RCC_DMA1_CLK_ENABLE( );
+
+        i2c_async[0].hdma_rx.Instance                 = DMA1_Channel3;
+        i2c_async[0].hdma_rx.Init.Request             = DMA_REQUEST_I2C1_RX;
+        i2c_async[0].hdma_rx.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+        i2c_async[0].hdma_rx.Init.PeriphInc           = DMA_PINC_DISABLE;
+        i2c_async[0].hdma_rx.Init.MemInc              = DMA_MINC_ENABLE;
+        i2c_async[0].hdma_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        i2c_async[0].hdma_rx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+        i2c_async[0].hdma_rx.Init.Mode                = DMA_NORMAL;
+        i2c_async[0].hdma_rx.Init.Priority            = DMA_PRIORITY_LOW;
+        if( HAL_DMA_Init( &i2c_async[0].hdma_rx ) != HAL_OK )
+        {
+            hal_mcu_panic( );
+        }
+        __HAL_LINKDMA( i2cHandle, hdmarx, i2c_async[0].hdma_rx );
+
+        HAL_NVIC_SetPriority( DMA1_Channel3_IRQn, 0, 1 );
+        HAL_NVIC_EnableIRQ( DMA1_Channel3_IRQn );
+        HAL_NVIC_SetPriority( I2C1_EV_IRQn, 0, 1 );
+        HAL_NVIC_EnableIRQ( I2C1_EV_IRQn );
+        HAL_NVIC_SetPriority( I2C1_ER_IRQn, 0, 1 );
+        HAL_NVIC_EnableIRQ( I2C1_ER_IRQn );
     }
     else if( i2cHandle->Instance == hal_i2c[2].interface )
     {
@@ -207,6 +384,11 @@ void HAL_I2C_MspDeInit( I2C_HandleTypeDef* i2cHandle )
     if( i2cHandle->Instance == hal_i2c[0].interface )
     {
         local_id = 0;
+        HAL_NVIC_DisableIRQ( I2C1_EV_IRQn );
+        HAL_NVIC_DisableIRQ( I2C1_ER_IRQn );
+        HAL_NVIC_DisableIRQ( DMA1_Channel3_IRQn );
+        // DMA1 clock is left on, it is shared with the ADC and the UART
+        HAL_DMA_DeInit( i2cHandle->hdmarx );
         __HAL_RCC_I2C1_FORCE_RESET( );
         __HAL_RCC_I2C1_RELEASE_RESET( );
         __HAL_RCC_I2C1_CLK_DISABLE( );
@@ -279,6 +461,88 @@ uint8_t hal_i2c_read_buffer( const uint32_t id, uint8_t device_addr, uint16_t ad
 
 void i2c_set_addr_size( i2c_addr_size addr_size ) { i2c_internal_addr_size = addr_size; }
 
+uint8_t hal_i2c_submit( const uint32_t id, hal_i2c_transaction_t* transaction )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_i2c ) ) );
+    uint32_t local_id = id - 1;
+
+    // Only I2C1 has its interrupts and DMA set up
+    if( ( local_id != 0 ) || ( transaction->nb_transfers == 0 ) )
+    {
+        return FAIL;
+    }
+
+    if( hal_i2c[local_id].is_suspended == true )
+    {
+        hal_i2c_resume( id );
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    if( i2c_async[local_id].count >= HAL_I2C_QUEUE_LEN )
+    {
+        CRITICAL_SECTION_END( );
+        return FAIL;
+    }
+    transaction->status = HAL_I2C_TRANSACTION_PENDING;
+    i2c_async[local_id].queue[( i2c_async[local_id].head + i2c_async[local_id].count ) % HAL_I2C_QUEUE_LEN] =
+        transaction;
+    i2c_async[local_id].count++;
+    if( i2c_async[local_id].count == 1 )
+    {
+        i2c_async[local_id].transfer_index = 0;
+        i2c_async_start( local_id );
+    }
+    CRITICAL_SECTION_END( );
+
+    return SUCCESS;
+}
+
+uint8_t hal_i2c_transact( const uint32_t id, hal_i2c_transfer_t* transfers, const uint8_t nb_transfers )
+{
+    hal_i2c_transaction_t transaction = {
+        .transfers    = transfers,
+        .nb_transfers = nb_transfers,
+        .callback     = NULL,
+        .context      = NULL,
+    };
+
+    if( hal_i2c_submit( id, &transaction ) == FAIL )
+    {
+        return FAIL;
+    }
+    i2c_async_wait( id - 1, &transaction );
+
+    return transaction.status;
+}
+
+void hal_i2c_flush( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_i2c ) ) );
+
+    i2c_async_wait( id - 1, NULL );
+}
+
+void HAL_I2C_MemRxCpltCallback( I2C_HandleTypeDef* hi2c ) { i2c_async_transfer_done( hi2c, SUCCESS ); }
+
+void HAL_I2C_MemTxCpltCallback( I2C_HandleTypeDef* hi2c ) { i2c_async_transfer_done( hi2c, SUCCESS ); }
+
+void HAL_I2C_ErrorCallback( I2C_HandleTypeDef* hi2c ) { i2c_async_transfer_done( hi2c, FAIL ); }
+
+/*!
+ * \brief This function handles I2C1 event interrupt.
+ */
+void I2C1_EV_IRQHandler( void ) { HAL_I2C_EV_IRQHandler( &hal_i2c[0].handle ); }
+
+/*!
+ * \brief This function handles I2C1 error interrupt.
+ */
+void I2C1_ER_IRQHandler( void ) { HAL_I2C_ER_IRQHandler( &hal_i2c[0].handle ); }
+
+/*!
+ * \brief This function handles DMA1 channel3 interrupt request (I2C1 RX).
+ */
+void DMA1_Channel3_IRQHandler( void ) { HAL_DMA_IRQHandler( &i2c_async[0].hdma_rx ); }
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
@@ -292,6 +556,14 @@ static uint8_t i2c_write_buffer( const uint32_t id, uint8_t device_addr, uint16_
     assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_i2c ) ) );
     uint32_t local_id = id - 1;
 
+    if( hal_i2c[local_id].is_suspended == true )
+    {
+        hal_i2c_resume( id );
+    }
+
+    // The blocking transfers can not start while a queued one is in progress
+    i2c_async_wait( local_id, NULL );
+
     if( i2c_internal_addr_size == I2C_ADDR_SIZE_8 )
     {
         memAddSize = I2C_MEMADD_SIZE_8BIT;
@@ -315,6 +587,14 @@ static uint8_t i2c_read_buffer( const uint32_t id, uint8_t device_addr, uint16_t
     assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_i2c ) ) );
     uint32_t local_id = id - 1;
 
+    if( hal_i2c[local_id].is_suspended == true )
+    {
+        hal_i2c_resume( id );
+    }
+
+    // The blocking transfers can not start while a queued one is in progress
+    i2c_async_wait( local_id, NULL );
+
     if( i2c_internal_addr_size == I2C_ADDR_SIZE_8 )
     {
         memAddSize = I2C_MEMADD_SIZE_8BIT;
@@ -330,3 +610,155 @@ static uint8_t i2c_read_buffer( const uint32_t id, uint8_t device_addr, uint16_t
 
     return readStatus;
 }
+
+static uint32_t i2c_get_timing( const uint32_t pclk_hz )
+{
+    uint32_t presc = ( pclk_hz + I2C_TIMING_CLOCK_HZ - 1 ) / I2C_TIMING_CLOCK_HZ;
+
+    if( presc > 0 )
+    {
+        presc--;
+    }
+    if( presc > ( I2C_TIMINGR_PRESC >> I2C_TIMINGR_PRESC_Pos ) )
+    {
+        presc = I2C_TIMINGR_PRESC >> I2C_TIMINGR_PRESC_Pos;
+    }
+    return I2C_TIMING_16MHZ | ( presc << I2C_TIMINGR_PRESC_Pos );
+}
+
+static uint16_t i2c_get_mem_add_size( void )
+{
+    return ( i2c_internal_addr_size == I2C_ADDR_SIZE_8 ) ? I2C_MEMADD_SIZE_8BIT : I2C_MEMADD_SIZE_16BIT;
+}
+
+static uint32_t i2c_get_local_id( const I2C_HandleTypeDef* handle )
+{
+    for( uint32_t local_id = 0; local_id < ( sizeof( hal_i2c ) / sizeof( hal_i2c[0] ) ); local_id++ )
+    {
+        if( handle == &hal_i2c[local_id].handle )
+        {
+            return local_id;
+        }
+    }
+    return 0;
+}
+
+static void i2c_async_start( const uint32_t local_id )
+{
+    while( i2c_async[local_id].count > 0 )
+    {
+        hal_i2c_transaction_t* transaction = i2c_async[local_id].queue[i2c_async[local_id].head];
+        hal_i2c_transfer_t*    transfer    = &transaction->transfers[i2c_async[local_id].transfer_index];
+        HAL_StatusTypeDef      status;
+
+        if( transfer->is_read == false )
+        {
+            status = HAL_I2C_Mem_Write_IT( &hal_i2c[local_id].handle, transfer->device_addr, transfer->addr,
+                                           i2c_get_mem_add_size( ), transfer->buffer, transfer->size );
+        }
+        else if( transfer->size >= I2C_DMA_MIN_SIZE )
+        {
+            status = HAL_I2C_Mem_Read_DMA( &hal_i2c[local_id].handle, transfer->device_addr, transfer->addr,
+                                           i2c_get_mem_add_size( ), transfer->buffer, transfer->size );
+        }
+        else
+        {
+            status = HAL_I2C_Mem_Read_IT( &hal_i2c[local_id].handle, transfer->device_addr, transfer->addr,
+                                          i2c_get_mem_add_size( ), transfer->buffer, transfer->size );
+        }
+
+        if( status == HAL_OK )
+        {
+            return;
+        }
+        i2c_async_complete( local_id, FAIL );
+    }
+}
+
+static void i2c_async_transfer_done( I2C_HandleTypeDef* handle, const uint8_t status )
+{
+    uint32_t local_id = i2c_get_local_id( handle );
+
+    if( i2c_async[local_id].count == 0 )
+    {
+        return;
+    }
+
+    i2c_async[local_id].transfer_index++;
+    if( ( status == SUCCESS ) &&
+        ( i2c_async[local_id].transfer_index < i2c_async[local_id].queue[i2c_async[local_id].head]->nb_transfers ) )
+    {
+        i2c_async_start( local_id );
+        return;
+    }
+
+    i2c_async_complete( local_id, status );
+    i2c_async_start( local_id );
+}
+
+static void i2c_async_complete( const uint32_t local_id, const uint8_t status )
+{
+    hal_i2c_transaction_t* transaction = i2c_async[local_id].queue[i2c_async[local_id].head];
+
+    i2c_async[local_id].head           = ( i2c_async[local_id].head + 1 ) % HAL_I2C_QUEUE_LEN;
+    i2c_async[local_id].count          = i2c_async[local_id].count - 1;
+    i2c_async[local_id].transfer_index = 0;
+
+    transaction->status = status;
+    if( transaction->callback != NULL )
+    {
+        transaction->callback( transaction->context, status );
+    }
+}
+
+static void i2c_async_wait( const uint32_t local_id, const hal_i2c_transaction_t* transaction )
+{
+    // The RTC runs with the interrupts masked, SysTick does not: hal_i2c_flush is called from the idle critical section
+    uint32_t tickstart = hal_rtc_get_timer_value( );
+    uint32_t timeout   = hal_rtc_ms_2_tick( HAL_I2C_TRANSACTION_TIMEOUT_MS );
+
+    while( ( ( transaction != NULL ) && ( transaction->status == HAL_I2C_TRANSACTION_PENDING ) ) ||
+           ( ( transaction == NULL ) && ( i2c_async[local_id].count > 0 ) ) )
+    {
+        if( ( hal_rtc_get_timer_value( ) - tickstart ) > timeout )
+        {
+            i2c_async_abort( local_id );
+            return;
+        }
+
+        if( __get_PRIMASK( ) != 0 )
+        {
+            // Interrupts are masked (panic, reset): service the transfer by polling
+            HAL_DMA_IRQHandler( &i2c_async[local_id].hdma_rx );
+            HAL_I2C_EV_IRQHandler( &hal_i2c[local_id].handle );
+            HAL_I2C_ER_IRQHandler( &hal_i2c[local_id].handle );
+        }
+        else
+        {
+            // Sleep until the next interrupt, one raised after the check is kept pending and wakes up the core
+            __disable_irq( );
+            if( i2c_async[local_id].count > 0 )
+            {
+                __WFI( );
+            }
+            __enable_irq( );
+        }
+    }
+}
+
+static void i2c_async_abort( const uint32_t local_id )
+{
+    // A stuck bus never completes the transfer, the peripheral is reset and its DMA set up again
+    HAL_I2C_DeInit( &hal_i2c[local_id].handle );
+    if( HAL_I2C_Init( &hal_i2c[local_id].handle ) != HAL_OK )
+    {
+        hal_mcu_panic( );
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    while( i2c_async[local_id].count > 0 )
+    {
+        i2c_async_complete( local_id, FAIL );
+    }
+    CRITICAL_SECTION_END( );
+}
@@ -39,6 +39,9 @@
 
 #include "stm32wbxx_hal.h"
 #include "stm32wbxx_ll_utils.h"
+#include "stm32wbxx_ll_rcc.h"
+#include "stm32wbxx_ll_hsem.h"
+#include "hw_conf.h"
 #include "lr1110_tracker_board.h"
 #include "smtc_hal.h"
 
@@ -58,6 +61,26 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+/*!
+ * \brief The software watchdog may expire 1/2^SOFT_WATCHDOG_SLACK_SHIFT of its period late to share a wakeup
+ */
+#define SOFT_WATCHDOG_SLACK_SHIFT 3
+
+/*!
+ * \brief CPU cycles of one iteration of the hal_mcu_wait_us loop
+ */
+#define WAIT_US_LOOP_CYCLES 18
+
+/*!
+ * \brief Number of RTC ticks per second is 2^RTC_TICKS_PER_SECOND_SHIFT
+ */
+#define RTC_TICKS_PER_SECOND_SHIFT 10U
+
+/*!
+ * \brief Current drawn on the HSI16 STOP2 wakeup clock, the 16 MHz run current is the closest in the energy model
+ */
+#define WAKEUP_CLOCK_CURRENT_UA HAL_ENERGY_MCU_RUN_LOW_CURRENT_UA
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -97,6 +120,32 @@ static bool                      partial_sleep_enable = false;
  */
 static timer_event_t soft_watchdog;
 
+/*!
+ * \brief Clock profile in use, restored after STOP2
+ */
+static hal_mcu_clock_profile_t clock_profile = HAL_MCU_CLOCK_PROFILE_NOMINAL;
+
+/*!
+ * \brief Run mode time accounting of the clock profiles
+ */
+static struct
+{
+    uint32_t timestamp;                             //!< RTC timestamp of the last integration in ticks
+    uint64_t ticks[HAL_MCU_CLOCK_PROFILE_NB];       //!< Run mode time in RTC ticks
+    uint32_t switches[HAL_MCU_CLOCK_PROFILE_NB];    //!< Number of switches to the profile
+} clock_profile_ctx;
+
+/*!
+ * \brief Current drawn by the MCU in run mode in each clock profile
+ */
+static const uint32_t clock_profile_current_ua[HAL_MCU_CLOCK_PROFILE_NB] = {
+    HAL_ENERGY_MCU_RUN_LOW_CURRENT_UA,
+    HAL_ENERGY_MCU_RUN_CURRENT_UA,
+    HAL_ENERGY_MCU_RUN_BOOST_CURRENT_UA,
+};
+
+static const char* clock_profile_names[HAL_MCU_CLOCK_PROFILE_NB] = { "LOW", "NOMINAL", "BOOST" };
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
@@ -128,7 +177,7 @@ static void hal_mcu_gpio_deinit( void );
 static void hal_mcu_pvd_config( void );
 
 /*!
- * \brief Deinit the MCU
+ * \brief Prepares the MCU buses for STOP2, see hal_mcu_reinit
  */
 static void hal_mcu_deinit( void );
 
@@ -147,6 +196,26 @@ static void hal_mcu_deinit_periph( void );
  * \brief printf
  */
 static void vprint( const char* fmt, va_list argp );
+
+/*!
+ * \brief Writes the header of a binary trace record
+ *
+ * \param [out] record Record buffer
+ * \param [in] type Record type
+ * \param [in] fmt Format string, only its address is used
+ * \param [in] payload_len Length of the payload following the header
+ *
+ * \returns Header length
+ */
+static uint8_t trace_bin_header( uint8_t* record, uint8_t type, const char* fmt, uint8_t payload_len );
+
+/*!
+ * \brief Sends a binary trace record on the trace UART
+ *
+ * \param [in] record Record buffer
+ * \param [in] len Record length
+ */
+static void trace_bin_send( const uint8_t* record, uint16_t len );
 #endif
 
 /*!
@@ -159,6 +228,22 @@ static void on_soft_watchdog_event( void* context );
  */
 static void hal_mcu_smps_config( void );
 
+/*!
+ * \brief Configures the oscillators, the bus clocks, the flash latency and the voltage range of a clock profile
+ *
+ * \remark Shall be called with interrupts disabled, the peripherals are not retimed
+ *
+ * \param [in] profile Clock profile to apply
+ */
+static void hal_mcu_clock_profile_apply( const hal_mcu_clock_profile_t profile );
+
+/*!
+ * \brief Adds the time elapsed since the last call to the current clock profile
+ *
+ * \param [in] running false when the MCU was in STOP2 since the last call, the time is then discarded
+ */
+static void hal_mcu_clock_profile_integrate( const bool running );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -187,7 +272,7 @@ void hal_mcu_init_periph( void )
     pe4259_wifi_ble_init( );
 
     // LIS2DE12 accelerometer
-    accelerometer_init( INT_1 );
+    accelerometer_init( INT_1 | INT_1_FIFO );
 
     // Effect Hall sensor
     lr1110_modem_board_hall_effect_enable( true );
@@ -233,6 +318,9 @@ void hal_mcu_init( void )
     // Initialize clocks
     hal_mcu_system_clock_config( );
 
+    // Initialize the profiling cycle counter
+    HAL_PROF_INIT( );
+
     // Initialize GPIOs
     hal_mcu_gpio_init( );
 
@@ -258,6 +346,11 @@ void hal_mcu_init( void )
 
     // Initialize RTC
     hal_rtc_init( );
+
+    // Initialize the energy accounting, time-stamped with the RTC
+    hal_energy_init( );
+    hal_residency_init( );
+    clock_profile_ctx.timestamp = hal_rtc_get_timer_value( );
     
     // Initialize ADC
     hal_adc_init( );
@@ -274,6 +367,11 @@ void hal_mcu_reset( void )
 {
     __disable_irq( );
 
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+    // Send the last traces (panic, watchdog) before the reset, the transfer is polled
+    hal_uart_flush( HAL_PRINTF_UART_ID );
+#endif
+
     // Restart system
     NVIC_SystemReset( );
 }
@@ -291,23 +389,154 @@ void hal_mcu_panic( void )
 
 void hal_mcu_wait_us( const int32_t microseconds )
 {
-    const uint32_t nb_nop = microseconds * 1000 / 561;
+    // The loop length follows the clock profile
+    const uint32_t nb_nop = microseconds * ( SystemCoreClock / 1000000 ) / WAIT_US_LOOP_CYCLES;
     for( uint32_t i = 0; i < nb_nop; i++ )
     {
         __NOP( );
     }
 }
 
+hal_mcu_clock_profile_t hal_mcu_set_clock_profile( const hal_mcu_clock_profile_t profile )
+{
+    hal_mcu_clock_profile_t previous = clock_profile;
+
+    if( ( profile >= HAL_MCU_CLOCK_PROFILE_NB ) || ( profile == clock_profile ) )
+    {
+        return previous;
+    }
+
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+    // The traces queued before the switch are sent at the current baud rate divider
+    hal_uart_flush( HAL_PRINTF_UART_ID );
+#endif
+
+    CRITICAL_SECTION_BEGIN( );
+
+    hal_mcu_clock_profile_integrate( true );
+    hal_mcu_clock_profile_apply( profile );
+    clock_profile = profile;
+    clock_profile_ctx.switches[profile]++;
+
+    // Keep the bus clocks of the radio, the sensors and the traces
+    hal_spi_retime( HAL_RADIO_SPI_ID );
+    hal_i2c_retime( HAL_I2C_ID );
+#if( HAL_USE_PRINTF_UART == HAL_FEATURE_ON )
+    hal_uart_retime( HAL_PRINTF_UART_ID );
+#endif
+
+    hal_energy_set_state( HAL_ENERGY_MCU, clock_profile_current_ua[profile] );
+
+    CRITICAL_SECTION_END( );
+
+    return previous;
+}
+
+hal_mcu_clock_profile_t hal_mcu_get_clock_profile( void ) { return clock_profile; }
+
+void hal_mcu_get_clock_profile_stats( hal_mcu_clock_profile_stats_t* stats )
+{
+    CRITICAL_SECTION_BEGIN( );
+
+    hal_mcu_clock_profile_integrate( true );
+    for( uint8_t i = 0; i < HAL_MCU_CLOCK_PROFILE_NB; i++ )
+    {
+        uint32_t time_ms = ( uint32_t )( ( clock_profile_ctx.ticks[i] * 1000 ) >> RTC_TICKS_PER_SECOND_SHIFT );
+
+        stats->time_ms[i]    = time_ms;
+        stats->charge_uas[i] = ( uint32_t )( ( ( uint64_t ) time_ms * clock_profile_current_ua[i] ) / 1000 );
+        stats->saving_uas[i] = ( int32_t )( ( ( int64_t ) time_ms * ( ( int32_t ) HAL_ENERGY_MCU_RUN_CURRENT_UA -
+                                                                      ( int32_t ) clock_profile_current_ua[i] ) ) /
+                                            1000 );
+        stats->switches[i] = clock_profile_ctx.switches[i];
+    }
+
+    CRITICAL_SECTION_END( );
+}
+
+void hal_mcu_reset_clock_profile_stats( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+
+    memset( clock_profile_ctx.ticks, 0, sizeof( clock_profile_ctx.ticks ) );
+    memset( clock_profile_ctx.switches, 0, sizeof( clock_profile_ctx.switches ) );
+    clock_profile_ctx.timestamp = hal_rtc_get_timer_value( );
+
+    CRITICAL_SECTION_END( );
+}
+
+void hal_mcu_print_clock_profile_stats( void )
+{
+    hal_mcu_clock_profile_stats_t stats;
+
+    hal_mcu_get_clock_profile_stats( &stats );
+
+    for( uint8_t i = 0; i < HAL_MCU_CLOCK_PROFILE_NB; i++ )
+    {
+        HAL_DBG_TRACE_PRINTF( "Clock %-7s : %d ms, %d uAs, saved %d uAs, %d switches\r\n", clock_profile_names[i],
+                              stats.time_ms[i], stats.charge_uas[i], stats.saving_uas[i], stats.switches[i] );
+    }
+}
+
+#if( HAL_PROFILING == HAL_FEATURE_ON )
+void hal_mcu_get_wake_stats( hal_mcu_wake_stats_t* stats )
+{
+    hal_prof_zone_stats_t resume;
+    hal_prof_zone_stats_t clocks;
+    hal_prof_zone_stats_t bus;
+    uint64_t              clocks_ns;
+    uint64_t              run_ns;
+
+    memset( stats, 0, sizeof( hal_mcu_wake_stats_t ) );
+
+    hal_prof_get_zone_stats( HAL_PROF_ZONE_STOP2_RESUME, &resume );
+    hal_prof_get_zone_stats( HAL_PROF_ZONE_STOP2_CLOCKS, &clocks );
+    hal_prof_get_zone_stats( HAL_PROF_ZONE_BUS_RESUME, &bus );
+    if( resume.count == 0 )
+    {
+        return;
+    }
+
+    stats->nb_wakes      = resume.count;
+    stats->clocks_cycles = clocks.mean;
+    stats->resume_cycles = ( resume.mean > clocks.mean ) ? ( resume.mean - clocks.mean ) : 0;
+    // A bus is restored at most once per wakeup, and not at all when it is not used
+    stats->bus_resume_cycles = ( uint32_t )( ( ( uint64_t ) bus.mean * bus.count ) / resume.count );
+
+    // The clock tree is restored on HSI16 until HSE is selected, the rest runs at the core clock
+    clocks_ns = ( ( uint64_t ) stats->clocks_cycles * 1000000000 ) / HSI_VALUE;
+    run_ns    = ( ( uint64_t )( stats->resume_cycles + stats->bus_resume_cycles ) * 1000000000 ) / SystemCoreClock;
+
+    stats->ready_us   = ( uint32_t )( ( clocks_ns + run_ns ) / 1000 );
+    stats->charge_nas = ( uint32_t )( ( clocks_ns * WAKEUP_CLOCK_CURRENT_UA +
+                                        run_ns * clock_profile_current_ua[clock_profile] ) / 1000000 );
+}
+
+void hal_mcu_print_wake_stats( void )
+{
+    hal_mcu_wake_stats_t stats;
+
+    hal_mcu_get_wake_stats( &stats );
+
+    HAL_DBG_TRACE_PRINTF( "STOP2 wake-to-ready : %d wakes, %d us, %d nAs per wake\r\n", stats.nb_wakes, stats.ready_us,
+                          stats.charge_nas );
+    HAL_DBG_TRACE_PRINTF( " - cycles clocks %d | reinit %d | buses %d\r\n", stats.clocks_cycles, stats.resume_cycles,
+                          stats.bus_resume_cycles );
+}
+#endif
+
 void hal_mcu_init_software_watchdog( uint32_t value )
 {
     timer_init( &soft_watchdog, on_soft_watchdog_event );
     timer_set_value( &soft_watchdog, value );
+    timer_set_slack( &soft_watchdog, value >> SOFT_WATCHDOG_SLACK_SHIFT );
     timer_start( &soft_watchdog );
 }
 
 void hal_mcu_set_software_watchdog_value( uint32_t value )
 {
     timer_set_value( &soft_watchdog, value );
+    timer_set_slack( &soft_watchdog, value >> SOFT_WATCHDOG_SLACK_SHIFT );
 }
 
 void hal_mcu_start_software_watchdog( void )
@@ -359,6 +588,57 @@ void hal_mcu_trace_print( const char* fmt, ... )
 #endif
 }
 
+void hal_mcu_trace_bin( uint8_t type, const char* fmt, uint32_t nb_args, ... )
+{
+#if( HAL_DBG_TRACE == HAL_FEATURE_ON )
+    uint8_t record[HAL_DBG_TRACE_BIN_HEADER_SIZE + ( 4 * HAL_DBG_TRACE_BIN_MAX_ARGS )];
+    uint8_t index;
+    va_list argp;
+
+    if( nb_args > HAL_DBG_TRACE_BIN_MAX_ARGS )
+    {
+        nb_args = HAL_DBG_TRACE_BIN_MAX_ARGS;
+    }
+
+    index = trace_bin_header( record, type, fmt, 4 * nb_args );
+
+    va_start( argp, nb_args );
+    for( uint32_t i = 0; i < nb_args; i++ )
+    {
+        uint32_t arg = va_arg( argp, uint32_t );
+
+        record[index++] = ( uint8_t ) arg;
+        record[index++] = ( uint8_t ) ( arg >> 8 );
+        record[index++] = ( uint8_t ) ( arg >> 16 );
+        record[index++] = ( uint8_t ) ( arg >> 24 );
+    }
+    va_end( argp );
+
+    trace_bin_send( record, index );
+#endif
+}
+
+void hal_mcu_trace_bin_array( uint8_t type, const char* msg, const uint8_t* array, uint32_t len )
+{
+#if( HAL_DBG_TRACE == HAL_FEATURE_ON )
+    uint8_t record[HAL_DBG_TRACE_BIN_HEADER_SIZE + HAL_DBG_TRACE_BIN_MAX_ARRAY_CHUNK];
+
+    // An empty array still sends its header
+    do
+    {
+        uint8_t chunk = ( len > HAL_DBG_TRACE_BIN_MAX_ARRAY_CHUNK ) ? HAL_DBG_TRACE_BIN_MAX_ARRAY_CHUNK : len;
+        uint8_t index = trace_bin_header( record, type, msg, chunk );
+
+        memcpy( &record[index], array, chunk );
+        trace_bin_send( record, index + chunk );
+
+        type |= HAL_DBG_TRACE_BIN_RECORD_CONTINUED;
+        array += chunk;
+        len -= chunk;
+    } while( len > 0 );
+#endif
+}
+
 #ifdef USE_FULL_ASSERT
 /*
  * Function Name  : assert_failed
@@ -603,8 +883,9 @@ static void hal_mcu_lpm_enter_stop_mode( void )
     }
     else
     {
-        hal_mcu_deinit_periph( );
+        // The pins are saved by hal_mcu_deinit before hal_mcu_deinit_periph gates the port clocks
         hal_mcu_deinit( );
+        hal_mcu_deinit_periph( );
     }
 
     CRITICAL_SECTION_END( );
@@ -649,14 +930,34 @@ static void hal_mcu_lpm_exit_stop_mode( void )
 void hal_mcu_low_power_handler( void )
 {
 #if( HAL_LOW_POWER_MODE == HAL_FEATURE_ON )
+    // Timers already due are served by this wakeup, the caller checks its events again before going to sleep
+    if( timer_serve_due( ) == true )
+    {
+        return;
+    }
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+    // Pending traces would be lost when the UART is switched off
+    hal_uart_flush( HAL_PRINTF_UART_ID );
+#endif
+    // A queued I2C transaction would be cut when the I2C pins are parked
+    hal_i2c_flush( HAL_I2C_ID );
     __disable_irq( );
     /*!
      * If an interrupt has occurred after __disable_irq( ), it is kept pending
      * and cortex will not enter low power anyway
      */
 
+    hal_mcu_clock_profile_integrate( true );
+    hal_energy_set_state( HAL_ENERGY_MCU, HAL_ENERGY_MCU_STOP2_CURRENT_UA );
+    hal_residency_set_mode( HAL_RESIDENCY_STOP2 );
     hal_mcu_lpm_enter_stop_mode( );
+    // The resume is run mode, see hal_mcu_get_wake_stats for its share
+    hal_mcu_clock_profile_integrate( false );
+    hal_energy_set_state( HAL_ENERGY_MCU, clock_profile_current_ua[clock_profile] );
+    hal_residency_set_mode( HAL_RESIDENCY_RUN );
+    HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_STOP2_RESUME );
     hal_mcu_lpm_exit_stop_mode( );
+    HAL_PROF_ZONE_END( HAL_PROF_ZONE_STOP2_RESUME );
 
     __enable_irq( );
 #endif
@@ -664,31 +965,26 @@ void hal_mcu_low_power_handler( void )
 
 static void hal_mcu_deinit( void )
 {
-    hal_spi_deinit( HAL_RADIO_SPI_ID );
+    // STOP2 retains the peripherals registers, only the pins are saved and parked
+    hal_spi_suspend( HAL_RADIO_SPI_ID );
     lr1110_modem_board_deinit_io( &lr1110 );
-    // Disable I2C
-    hal_i2c_deinit( HAL_I2C_ID );
-    // Disable UART
+    // Suspend I2C
+    hal_i2c_suspend( HAL_I2C_ID );
+    // Suspend UART
 #if( HAL_USE_PRINTF_UART == HAL_FEATURE_ON )
-    hal_uart_deinit( HAL_PRINTF_UART_ID );
+    hal_uart_suspend( HAL_PRINTF_UART_ID );
 #endif
 }
 
 void hal_mcu_reinit( void )
 {
     // Reconfig needed OSC and PLL
+    HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_STOP2_CLOCKS );
     hal_mcu_system_clock_re_config_after_stop( );
+    HAL_PROF_ZONE_END( HAL_PROF_ZONE_STOP2_CLOCKS );
 
-    // Initialize I2C
-    hal_i2c_init( HAL_I2C_ID, I2C_SDA, I2C_SCL );
+    // SPI, I2C and UART pins are restored on their first transfer, see hal_mcu_deinit
 
-    // Initialize UART
-#if( HAL_USE_PRINTF_UART == HAL_FEATURE_ON )
-    hal_uart_init( HAL_PRINTF_UART_ID, BOARD_DBG_PIN_TX, BOARD_DBG_PIN_RX );
-#endif
-
-    // Initialize SPI
-    hal_spi_init( HAL_RADIO_SPI_ID, RADIO_MOSI, RADIO_MISO, RADIO_SCLK );
     // Init LR1110 IO
     lr1110_modem_board_init_io( &lr1110 );
 }
@@ -717,28 +1013,176 @@ static void hal_mcu_system_clock_re_config_after_stop( void )
     {
     }
 
-    // Select HSE as system clock source
-    __HAL_RCC_SYSCLK_CONFIG( RCC_SYSCLKSOURCE_HSE );
-
-    // Wait till HSE is used as system clock source
-    while( __HAL_RCC_GET_SYSCLK_SOURCE( ) != RCC_SYSCLKSOURCE_STATUS_HSE )
+    if( clock_profile == HAL_MCU_CLOCK_PROFILE_LOW )
+    {
+        // Range 2 is kept through STOP2 and allows 16 MHz at most, back to MSI without going through HSE
+        hal_mcu_clock_profile_apply( clock_profile );
+    }
+    else
     {
+        // HSE at 32 MHz needs range 1, raised before the clock
+        if( HAL_PWREx_ControlVoltageScaling( PWR_REGULATOR_VOLTAGE_SCALE1 ) != HAL_OK )
+        {
+            hal_mcu_panic( );
+        }
+
+        // Select HSE as system clock source
+        __HAL_RCC_SYSCLK_CONFIG( RCC_SYSCLKSOURCE_HSE );
+
+        // Wait till HSE is used as system clock source
+        while( __HAL_RCC_GET_SYSCLK_SOURCE( ) != RCC_SYSCLKSOURCE_STATUS_HSE )
+        {
+        }
+
+        // The peripherals kept the timings of the profile in use before STOP2
+        if( clock_profile == HAL_MCU_CLOCK_PROFILE_BOOST )
+        {
+            hal_mcu_clock_profile_apply( clock_profile );
+        }
     }
 
     CRITICAL_SECTION_END( );
 }
 
+static void hal_mcu_clock_profile_apply( const hal_mcu_clock_profile_t profile )
+{
+    RCC_OscInitTypeDef osc     = { 0 };
+    RCC_ClkInitTypeDef clk     = { 0 };
+    uint32_t           latency = FLASH_LATENCY_1;
+
+    clk.ClockType = RCC_CLOCKTYPE_HCLK4 | RCC_CLOCKTYPE_HCLK2 | RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK |
+                    RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+    clk.AHBCLKDivider  = RCC_SYSCLK_DIV1;
+    clk.APB1CLKDivider = RCC_HCLK_DIV1;
+    clk.APB2CLKDivider = RCC_HCLK_DIV1;
+    clk.AHBCLK2Divider = RCC_SYSCLK_DIV1;
+    clk.AHBCLK4Divider = RCC_SYSCLK_DIV1;
+
+    // HSE stays on in every profile, it clocks the SMPS and the RF
+    switch( profile )
+    {
+    case HAL_MCU_CLOCK_PROFILE_LOW:
+        osc.OscillatorType      = RCC_OSCILLATORTYPE_MSI;
+        osc.MSIState            = RCC_MSI_ON;
+        osc.MSICalibrationValue = RCC_MSICALIBRATION_DEFAULT;
+        osc.MSIClockRange       = RCC_MSIRANGE_8;  // 16 MHz
+        osc.PLL.PLLState        = RCC_PLL_NONE;
+        clk.SYSCLKSource        = RCC_SYSCLKSOURCE_MSI;
+        latency                 = FLASH_LATENCY_2;  // Range 2 above 12 MHz
+        break;
+    case HAL_MCU_CLOCK_PROFILE_BOOST:
+        osc.OscillatorType = RCC_OSCILLATORTYPE_HSE;
+        osc.HSEState       = RCC_HSE_ON;
+        osc.PLL.PLLState   = RCC_PLL_ON;
+        osc.PLL.PLLSource  = RCC_PLLSOURCE_HSE;
+        osc.PLL.PLLM       = RCC_PLLM_DIV4;  // 8 MHz VCO input
+        osc.PLL.PLLN       = 16;             // 128 MHz VCO
+        osc.PLL.PLLP       = RCC_PLLP_DIV2;
+        osc.PLL.PLLQ       = RCC_PLLQ_DIV2;
+        osc.PLL.PLLR       = RCC_PLLR_DIV2;  // 64 MHz SYSCLK
+        clk.SYSCLKSource   = RCC_SYSCLKSOURCE_PLLCLK;
+        clk.AHBCLK2Divider = RCC_SYSCLK_DIV2;  // CPU2 is limited to 32 MHz
+        latency            = FLASH_LATENCY_3;
+        break;
+    default:
+        osc.OscillatorType = RCC_OSCILLATORTYPE_HSE;
+        osc.HSEState       = RCC_HSE_ON;
+        osc.PLL.PLLState   = RCC_PLL_NONE;
+        clk.SYSCLKSource   = RCC_SYSCLKSOURCE_HSE;
+        break;
+    }
+
+    // CPU2 may change the RCC configuration as well
+    while( LL_HSEM_1StepLock( HSEM, CFG_HW_RCC_SEMID ) )
+    {
+    }
+
+    if( profile != HAL_MCU_CLOCK_PROFILE_LOW )
+    {
+        // The voltage is raised before the clock
+        HAL_PWREx_ControlVoltageScaling( PWR_REGULATOR_VOLTAGE_SCALE1 );
+    }
+
+    if( ( HAL_RCC_OscConfig( &osc ) != HAL_OK ) || ( HAL_RCC_ClockConfig( &clk, latency ) != HAL_OK ) )
+    {
+        LL_HSEM_ReleaseLock( HSEM, CFG_HW_RCC_SEMID, 0 );
+        hal_mcu_panic( );
+    }
+
+    if( profile == HAL_MCU_CLOCK_PROFILE_LOW )
+    {
+        // And lowered after it
+        HAL_PWREx_ControlVoltageScaling( PWR_REGULATOR_VOLTAGE_SCALE2 );
+    }
+    else
+    {
+        LL_RCC_MSI_Disable( );
+    }
+    if( profile != HAL_MCU_CLOCK_PROFILE_BOOST )
+    {
+        LL_RCC_PLL_Disable( );
+    }
+
+    LL_HSEM_ReleaseLock( HSEM, CFG_HW_RCC_SEMID, 0 );
+}
+
+static void hal_mcu_clock_profile_integrate( const bool running )
+{
+    uint32_t now = hal_rtc_get_timer_value( );
+
+    if( running == true )
+    {
+        clock_profile_ctx.ticks[clock_profile] += now - clock_profile_ctx.timestamp;
+    }
+    clock_profile_ctx.timestamp = now;
+}
+
 #if( HAL_DBG_TRACE == HAL_FEATURE_ON )
 static void vprint( const char* fmt, va_list argp )
 {
     char string[HAL_PRINT_BUFFER_SIZE];
     if( 0 < vsprintf( string, fmt, argp ) )  // build string
     {
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+        hal_uart_tx_async( HAL_PRINTF_UART_ID, ( uint8_t* ) string, strlen( string ) );
+#else
         hal_uart_tx( 1, ( uint8_t* ) string, strlen( string ) );
+#endif
     }
 }
 #endif
 
+#if( HAL_DBG_TRACE == HAL_FEATURE_ON )
+static uint8_t trace_bin_header( uint8_t* record, uint8_t type, const char* fmt, uint8_t payload_len )
+{
+    uint32_t timestamp = hal_rtc_get_timer_value( );
+    uint32_t id        = ( uint32_t ) fmt;
+
+    record[0]  = HAL_DBG_TRACE_BIN_SYNC;
+    record[1]  = type;
+    record[2]  = payload_len;
+    record[3]  = ( uint8_t ) timestamp;
+    record[4]  = ( uint8_t ) ( timestamp >> 8 );
+    record[5]  = ( uint8_t ) ( timestamp >> 16 );
+    record[6]  = ( uint8_t ) ( timestamp >> 24 );
+    record[7]  = ( uint8_t ) id;
+    record[8]  = ( uint8_t ) ( id >> 8 );
+    record[9]  = ( uint8_t ) ( id >> 16 );
+    record[10] = ( uint8_t ) ( id >> 24 );
+
+    return HAL_DBG_TRACE_BIN_HEADER_SIZE;
+}
+
+static void trace_bin_send( const uint8_t* record, uint16_t len )
+{
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+    hal_uart_tx_async( HAL_PRINTF_UART_ID, record, len );
+#else
+    hal_uart_tx( HAL_PRINTF_UART_ID, ( uint8_t* ) record, len );
+#endif
+}
+#endif
+
 static void on_soft_watchdog_event( void* context )
 {
     HAL_DBG_TRACE_INFO( "###### ===== WATCHDOG RESET ==== ######\r\n\r\n" );
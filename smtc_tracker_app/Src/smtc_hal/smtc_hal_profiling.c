@@ -0,0 +1,183 @@
+/*!
+ * \file      smtc_hal_profiling.c
+ *
+ * \brief     Board specific package DWT cycle counter profiling API implementation.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>
+
+#include "stm32wbxx_hal.h"
+#include "smtc_hal_profiling.h"
+#include "smtc_hal_dbg_trace.h"
+
+#if( HAL_PROFILING == HAL_FEATURE_ON )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * \brief Profiled zone context
+ */
+typedef struct hal_prof_zone_ctx_s
+{
+    uint32_t start;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} hal_prof_zone_ctx_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static hal_prof_zone_ctx_t prof_zones[HAL_PROF_ZONE_NB];
+
+static const char* prof_zone_names[HAL_PROF_ZONE_NB] = {
+    "build_and_stream_payload", "tracker_store_internal_log", "tracker_parse_cmd",
+    "wifi_execute_scan",        "gnss_scan_get_results",      "stop2_resume",
+    "timer_start",              "timer_stop",                 "uplink_codec_encode_wifi",
+    "uplink_codec_encode_sensors", "stop2_clocks", "bus_resume",
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hal_prof_init( void )
+{
+    // Enable the trace block and start the cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    hal_prof_reset( );
+}
+
+void hal_prof_zone_begin( const hal_prof_zone_t zone )
+{
+    if( zone < HAL_PROF_ZONE_NB )
+    {
+        prof_zones[zone].start = DWT->CYCCNT;
+    }
+}
+
+void hal_prof_zone_end( const hal_prof_zone_t zone )
+{
+    uint32_t cycles = DWT->CYCCNT;
+
+    if( zone >= HAL_PROF_ZONE_NB )
+    {
+        return;
+    }
+
+    cycles -= prof_zones[zone].start;
+
+    if( cycles < prof_zones[zone].min )
+    {
+        prof_zones[zone].min = cycles;
+    }
+    if( cycles > prof_zones[zone].max )
+    {
+        prof_zones[zone].max = cycles;
+    }
+    prof_zones[zone].sum += cycles;
+    prof_zones[zone].count++;
+}
+
+void hal_prof_get_zone_stats( const hal_prof_zone_t zone, hal_prof_zone_stats_t* stats )
+{
+    memset( stats, 0, sizeof( hal_prof_zone_stats_t ) );
+
+    if( ( zone < HAL_PROF_ZONE_NB ) && ( prof_zones[zone].count != 0 ) )
+    {
+        stats->count = prof_zones[zone].count;
+        stats->min   = prof_zones[zone].min;
+        stats->max   = prof_zones[zone].max;
+        stats->mean  = ( uint32_t )( prof_zones[zone].sum / prof_zones[zone].count );
+    }
+}
+
+void hal_prof_reset( void )
+{
+    memset( prof_zones, 0, sizeof( prof_zones ) );
+
+    for( uint8_t i = 0; i < HAL_PROF_ZONE_NB; i++ )
+    {
+        prof_zones[i].min = UINT32_MAX;
+    }
+}
+
+void hal_prof_dump( void )
+{
+    hal_prof_zone_stats_t stats;
+    uint32_t              cycles_per_us = SystemCoreClock / 1000000;
+
+    HAL_DBG_TRACE_PRINTF( "Profiling zones, CPU cycles @ %d MHz\r\n", cycles_per_us );
+    for( uint8_t i = 0; i < HAL_PROF_ZONE_NB; i++ )
+    {
+        hal_prof_get_zone_stats( ( hal_prof_zone_t ) i, &stats );
+        HAL_DBG_TRACE_PRINTF( " - %-26s : count %6d | min %9d | max %9d | mean %9d\r\n", prof_zone_names[i],
+                              stats.count, stats.min, stats.max, stats.mean );
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+#endif  // HAL_PROFILING == HAL_FEATURE_ON
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,238 @@
+/*!
+ * \file      smtc_hal_residency.c
+ *
+ * \brief     Board specific package low power residency and wake source accounting API implementation.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>
+
+#include "smtc_hal_residency.h"
+#include "smtc_hal_mcu.h"
+#include "smtc_hal_rtc.h"
+#include "smtc_hal_dbg_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * \brief Number of RTC ticks per second is 2^RTC_TICKS_PER_SECOND_SHIFT
+ */
+#define RTC_TICKS_PER_SECOND_SHIFT 10U
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * \brief Residency accounting context
+ *
+ * \remark Times are kept in RTC ticks on 64 bits, they only are converted when reported
+ */
+typedef struct hal_residency_ctx_s
+{
+    uint64_t ticks[HAL_RESIDENCY_APP_STATE_NB][HAL_RESIDENCY_MODE_NB];
+    uint32_t wakeups[HAL_RESIDENCY_WAKE_SOURCE_NB];
+    uint32_t timestamp;
+    uint8_t  mode;
+    uint8_t  app_state;
+    bool     wake_pending;
+} hal_residency_ctx_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static hal_residency_ctx_t residency_ctx;
+
+static const char* mode_names[HAL_RESIDENCY_MODE_NB] = { "RUN", "SLEEP", "STOP2" };
+
+static const char* wake_source_names[HAL_RESIDENCY_WAKE_SOURCE_NB] = {
+    "RTC alarm", "Radio event", "Accelerometer", "Hall effect", "User button", "IPCC", "Other"
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief Adds the time elapsed since the last transition to the current application state and mode
+ *
+ * \param [in] now Current RTC timestamp in ticks
+ */
+static void hal_residency_integrate( const uint32_t now );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hal_residency_init( void )
+{
+    memset( &residency_ctx, 0, sizeof( residency_ctx ) );
+
+    residency_ctx.timestamp = hal_rtc_get_timer_value( );
+    residency_ctx.mode      = HAL_RESIDENCY_RUN;
+}
+
+void hal_residency_set_mode( const hal_residency_mode_t mode )
+{
+    if( mode >= HAL_RESIDENCY_MODE_NB )
+    {
+        return;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+
+    hal_residency_integrate( hal_rtc_get_timer_value( ) );
+
+    if( mode == HAL_RESIDENCY_RUN )
+    {
+        if( residency_ctx.mode != HAL_RESIDENCY_RUN )
+        {
+            residency_ctx.wake_pending = true;
+        }
+    }
+    else if( residency_ctx.wake_pending == true )
+    {
+        // Nothing known has been served since the previous wakeup
+        residency_ctx.wakeups[HAL_RESIDENCY_WAKE_OTHER]++;
+        residency_ctx.wake_pending = false;
+    }
+    residency_ctx.mode = mode;
+
+    CRITICAL_SECTION_END( );
+}
+
+void hal_residency_set_app_state( const uint8_t app_state )
+{
+    CRITICAL_SECTION_BEGIN( );
+
+    hal_residency_integrate( hal_rtc_get_timer_value( ) );
+    residency_ctx.app_state =
+        ( app_state < HAL_RESIDENCY_APP_STATE_NB ) ? app_state : ( HAL_RESIDENCY_APP_STATE_NB - 1 );
+
+    CRITICAL_SECTION_END( );
+}
+
+void hal_residency_notify_wake( const hal_residency_wake_source_t source )
+{
+    if( ( residency_ctx.wake_pending == true ) && ( source < HAL_RESIDENCY_WAKE_SOURCE_NB ) )
+    {
+        residency_ctx.wakeups[source]++;
+        residency_ctx.wake_pending = false;
+    }
+}
+
+void hal_residency_get_report( hal_residency_report_t* report )
+{
+    uint64_t mode_ticks[HAL_RESIDENCY_MODE_NB] = { 0 };
+
+    CRITICAL_SECTION_BEGIN( );
+
+    hal_residency_integrate( hal_rtc_get_timer_value( ) );
+
+    for( uint8_t state = 0; state < HAL_RESIDENCY_APP_STATE_NB; state++ )
+    {
+        for( uint8_t mode = 0; mode < HAL_RESIDENCY_MODE_NB; mode++ )
+        {
+            report->time_s[state][mode] = ( uint32_t )( residency_ctx.ticks[state][mode] >> RTC_TICKS_PER_SECOND_SHIFT );
+            mode_ticks[mode] += residency_ctx.ticks[state][mode];
+        }
+    }
+    for( uint8_t mode = 0; mode < HAL_RESIDENCY_MODE_NB; mode++ )
+    {
+        report->mode_time_s[mode] = ( uint32_t )( mode_ticks[mode] >> RTC_TICKS_PER_SECOND_SHIFT );
+    }
+    memcpy( report->wakeups, residency_ctx.wakeups, sizeof( report->wakeups ) );
+
+    CRITICAL_SECTION_END( );
+}
+
+void hal_residency_reset( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+
+    memset( residency_ctx.ticks, 0, sizeof( residency_ctx.ticks ) );
+    memset( residency_ctx.wakeups, 0, sizeof( residency_ctx.wakeups ) );
+    residency_ctx.timestamp = hal_rtc_get_timer_value( );
+
+    CRITICAL_SECTION_END( );
+}
+
+void hal_residency_print_report( void )
+{
+    hal_residency_report_t report;
+
+    hal_residency_get_report( &report );
+
+    HAL_DBG_TRACE_PRINTF( "Residency RUN %d s | SLEEP %d s | STOP2 %d s\r\n", report.mode_time_s[HAL_RESIDENCY_RUN],
+                          report.mode_time_s[HAL_RESIDENCY_SLEEP], report.mode_time_s[HAL_RESIDENCY_STOP2] );
+    for( uint8_t state = 0; state < HAL_RESIDENCY_APP_STATE_NB; state++ )
+    {
+        HAL_DBG_TRACE_PRINTF( " - state %d :", state );
+        for( uint8_t mode = 0; mode < HAL_RESIDENCY_MODE_NB; mode++ )
+        {
+            HAL_DBG_TRACE_PRINTF( " %s %7d s", mode_names[mode], report.time_s[state][mode] );
+        }
+        HAL_DBG_TRACE_PRINTF( "\r\n" );
+    }
+    for( uint8_t i = 0; i < HAL_RESIDENCY_WAKE_SOURCE_NB; i++ )
+    {
+        HAL_DBG_TRACE_PRINTF( " - wakeups %-13s : %d\r\n", wake_source_names[i], report.wakeups[i] );
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void hal_residency_integrate( const uint32_t now )
+{
+    residency_ctx.ticks[residency_ctx.app_state][residency_ctx.mode] += now - residency_ctx.timestamp;
+    residency_ctx.timestamp = now;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
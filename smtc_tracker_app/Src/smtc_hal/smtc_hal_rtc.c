@@ -39,6 +39,7 @@
 #include "smtc_hal_rtc.h"
 #include "smtc_hal_tmr_list.h"
 #include "smtc_hal_mcu.h"
+#include "smtc_hal_residency.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -491,7 +492,11 @@ void RTC_Alarm_IRQHandler( void )
  *
  * \param [in] hrtc RTC handle
  */
-void HAL_RTC_AlarmAEventCallback( RTC_HandleTypeDef* hrtc ) { timer_irq_handler( ); }
+void HAL_RTC_AlarmAEventCallback( RTC_HandleTypeDef* hrtc )
+{
+    hal_residency_notify_wake( HAL_RESIDENCY_WAKE_RTC_ALARM );
+    timer_irq_handler( );
+}
 
 static uint64_t rtc_get_timestamp_in_ticks( RTC_DateTypeDef* date, RTC_TimeTypeDef* time )
 {
@@ -40,8 +40,10 @@
 #include "stm32wbxx_hal.h"
 #include "stm32wbxx_ll_spi.h"
 #include "smtc_hal_gpio_pin_names.h"
+#include "smtc_hal_gpio.h"
 #include "smtc_hal_spi.h"
 #include "smtc_hal_mcu.h"
+#include "smtc_hal_profiling.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -53,6 +55,11 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+/*!
+ * \brief Highest SPI clock frequency, kept whatever the system clock profile
+ */
+#define SPI_SCK_MAX_HZ 4000000UL
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -85,6 +92,15 @@ static hal_spi_t hal_spi[] = {
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+/*!
+ * \brief Returns the smallest prescaler keeping the SPI clock below SPI_SCK_MAX_HZ
+ *
+ * \param [in] pclk_hz APB clock frequency in Hz
+ *
+ * \retval prescaler SPI_BAUDRATEPRESCALER_x value
+ */
+static uint32_t hal_spi_get_prescaler( const uint32_t pclk_hz );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -103,7 +119,7 @@ void hal_spi_init( const uint32_t id, const hal_gpio_pin_names_t mosi, const hal
     hal_spi[local_id].handle.Init.CLKPolarity       = SPI_POLARITY_LOW;
     hal_spi[local_id].handle.Init.CLKPhase          = SPI_PHASE_1EDGE;
     hal_spi[local_id].handle.Init.NSS               = SPI_NSS_SOFT;
-    hal_spi[local_id].handle.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_8;
+    hal_spi[local_id].handle.Init.BaudRatePrescaler = hal_spi_get_prescaler( HAL_RCC_GetPCLK2Freq( ) );
     hal_spi[local_id].handle.Init.FirstBit          = SPI_FIRSTBIT_MSB;
     hal_spi[local_id].handle.Init.TIMode            = SPI_TIMODE_DISABLE;
     hal_spi[local_id].handle.Init.CRCCalculation    = SPI_CRCCALCULATION_DISABLE;
@@ -133,6 +149,11 @@ uint16_t hal_spi_in_out( const uint32_t id, const uint16_t out_data )
     assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_spi ) ) );
     uint32_t local_id = id - 1;
 
+    if( hal_spi[local_id].is_suspended == true )
+    {
+        hal_spi_resume( id );
+    }
+
     while( LL_SPI_IsActiveFlag_TXE( hal_spi[local_id].interface ) == 0 )
     {
     };
@@ -144,6 +165,58 @@ uint16_t hal_spi_in_out( const uint32_t id, const uint16_t out_data )
     return LL_SPI_ReceiveData8( hal_spi[local_id].interface );
 }
 
+void hal_spi_suspend( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_spi ) ) );
+    uint32_t local_id = id - 1;
+
+    // The pins are driven by lr1110_modem_board_deinit_io while in STOP2
+    hal_spi[local_id].pins_config.mosi = hal_gpio_save_config( hal_spi[local_id].pins.mosi );
+    hal_spi[local_id].pins_config.miso = hal_gpio_save_config( hal_spi[local_id].pins.miso );
+    hal_spi[local_id].pins_config.sclk = hal_gpio_save_config( hal_spi[local_id].pins.sclk );
+    hal_spi[local_id].is_suspended     = true;
+}
+
+void hal_spi_resume( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_spi ) ) );
+    uint32_t local_id = id - 1;
+
+    if( hal_spi[local_id].is_suspended == true )
+    {
+        // Counted in the wake-to-ready time, masked as the zone could be entered again from an interrupt
+        CRITICAL_SECTION_BEGIN( );
+        HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_BUS_RESUME );
+        hal_gpio_restore_config( hal_spi[local_id].pins.mosi, hal_spi[local_id].pins_config.mosi );
+        hal_gpio_restore_config( hal_spi[local_id].pins.miso, hal_spi[local_id].pins_config.miso );
+        hal_gpio_restore_config( hal_spi[local_id].pins.sclk, hal_spi[local_id].pins_config.sclk );
+        HAL_PROF_ZONE_END( HAL_PROF_ZONE_BUS_RESUME );
+        CRITICAL_SECTION_END( );
+        hal_spi[local_id].is_suspended = false;
+    }
+}
+
+void hal_spi_retime( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_spi ) ) );
+    uint32_t local_id  = id - 1;
+    uint32_t prescaler = hal_spi_get_prescaler( HAL_RCC_GetPCLK2Freq( ) );
+
+    if( prescaler == hal_spi[local_id].handle.Init.BaudRatePrescaler )
+    {
+        return;
+    }
+
+    // The baud rate can only be changed while no transfer is ongoing and the SPI disabled
+    while( LL_SPI_IsActiveFlag_BSY( hal_spi[local_id].interface ) != 0 )
+    {
+    };
+    __HAL_SPI_DISABLE( &hal_spi[local_id].handle );
+    MODIFY_REG( hal_spi[local_id].interface->CR1, SPI_CR1_BR, prescaler );
+    hal_spi[local_id].handle.Init.BaudRatePrescaler = prescaler;
+    __HAL_SPI_ENABLE( &hal_spi[local_id].handle );
+}
+
 void HAL_SPI_MspInit( SPI_HandleTypeDef* spiHandle )
 {
     if( spiHandle->Instance == hal_spi[0].interface )
@@ -183,3 +256,23 @@ void HAL_SPI_MspDeInit( SPI_HandleTypeDef* spiHandle )
                      ( 1 << ( hal_spi[local_id].pins.mosi & 0x0F ) ) | ( 1 << ( hal_spi[local_id].pins.miso & 0x0F ) ) |
                          ( 1 << ( hal_spi[local_id].pins.sclk & 0x0F ) ) );
 }
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint32_t hal_spi_get_prescaler( const uint32_t pclk_hz )
+{
+    uint32_t prescaler = SPI_BAUDRATEPRESCALER_2;
+    uint32_t sck_hz    = pclk_hz >> 1;
+
+    while( ( sck_hz > SPI_SCK_MAX_HZ ) && ( prescaler != SPI_BAUDRATEPRESCALER_256 ) )
+    {
+        prescaler += SPI_BAUDRATEPRESCALER_4 - SPI_BAUDRATEPRESCALER_2;
+        sck_hz >>= 1;
+    }
+    return prescaler;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
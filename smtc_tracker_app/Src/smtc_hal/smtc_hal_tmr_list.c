@@ -1,7 +1,7 @@
 /*!
  * \file      smtc_hal_tmr_list.c
  *
- * \brief     Timer list API implementation.
+ * \brief     Timer list API implementation, binary min-heaps of absolute deadlines.
  *
  * Revised BSD License
  * Copyright Semtech Corporation 2020. All rights reserved.
@@ -38,9 +38,11 @@
 #include <stdbool.h>  // bool type
 
 #include "stm32wbxx_hal.h"
+#include "hw_conf.h"
 #include "smtc_hal_mcu.h"
 #include "smtc_hal_tmr_list.h"
 #include "smtc_hal_rtc.h"
+#include "smtc_hal_profiling.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -64,25 +66,112 @@
         }                                       \
     } while( 0 );
 
+/*!
+ * Deadlines are absolute RTC ticks, compared through their signed difference to survive the counter wrap around
+ */
+#define timer_is_before( a, b ) ( ( int32_t )( ( a ) - ( b ) ) < 0 )
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+/*!
+ * \brief Application timers which may run at the same time: software watchdog, BLE advertisement and connection
+ *        timeouts, TX and RX LEDs, Wi-Fi and GNSS scan timeouts, and modem reset timeout
+ */
+#define TIMER_APP_MAX_NBR_CONCURRENT_TIMER 8
+
+/*!
+ * \brief Maximum number of timers running at the same time, the application and BLE timer server ones. Can be
+ *        overridden by the host benchmark
+ */
+#ifndef TIMER_HEAP_SIZE
+#define TIMER_HEAP_SIZE ( TIMER_APP_MAX_NBR_CONCURRENT_TIMER + CFG_HW_TS_MAX_NBR_CONCURRENT_TIMER )
+#endif
+
+/*!
+ * \brief heap_index of a timer which is not in the heap
+ */
+#define TIMER_NOT_IN_HEAP 0xFF
+
+#if( TIMER_HEAP_SIZE < ( TIMER_APP_MAX_NBR_CONCURRENT_TIMER + CFG_HW_TS_MAX_NBR_CONCURRENT_TIMER ) )
+#error "TIMER_HEAP_SIZE can't hold the application and BLE timer server timers"
+#endif
+#if( TIMER_HEAP_SIZE >= TIMER_NOT_IN_HEAP )
+#error "TIMER_HEAP_SIZE doesn't fit in heap_index"
+#endif
+
+/*!
+ * \brief Timers expiring within this window after a wakeup are served by it, in RTC ticks
+ */
+#define TIMER_COALESCE_WINDOW 16
+
+/*!
+ * \brief A timer is never served earlier than 1/2^TIMER_COALESCE_SHIFT of its delay. Short periodic timers restarted
+ *        from their callback are then not served again by the same wakeup
+ */
+#define TIMER_COALESCE_SHIFT 3
+
+/*!
+ * \brief Length of the wakeups per hour statistics period, in ms
+ */
+#define TIMER_STATS_PERIOD_MS ( 3600UL * 1000UL )
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
  */
 
+/*!
+ * \brief Heaps of the running timers, both hold the same timers
+ */
+typedef enum timer_heap_e
+{
+    TIMER_HEAP_TIMEOUT = 0,  // Ordered by timeout, the root is the next timer to serve
+    TIMER_HEAP_WAKEUP,       // Ordered by timeout plus slack, the root sets the RTC alarm
+    TIMER_HEAP_NB,
+} timer_heap_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
 /*!
- * \brief Timers list head pointer
+ * \brief Running timers, timer_heap[TIMER_HEAP_TIMEOUT][0] is the next timer to expire
+ */
+static timer_event_t* timer_heap[TIMER_HEAP_NB][TIMER_HEAP_SIZE];
+
+/*!
+ * \brief Number of running timers
+ */
+static uint8_t timer_heap_count = 0;
+
+/*!
+ * \brief Is the RTC alarm programmed
  */
-static timer_event_t* timer_list_head = NULL;
+static bool timer_alarm_running = false;
+
+/*!
+ * \brief Wakeup time the RTC alarm is programmed for, in RTC ticks
+ */
+static uint32_t timer_alarm_timestamp = 0;
+
+/*!
+ * \brief Wakeup and coalescing counters
+ */
+static timer_stats_t timer_stats = { 0 };
+
+/*!
+ * \brief Start of the current wakeups per hour statistics period, in RTC ticks
+ */
+static uint32_t timer_stats_period_start = 0;
+
+/*!
+ * \brief RTC alarm interrupts since timer_stats_period_start
+ */
+static uint32_t timer_stats_period_wakeups = 0;
 
 /*
  * -----------------------------------------------------------------------------
@@ -90,41 +179,85 @@ static timer_event_t* timer_list_head = NULL;
  */
 
 /*!
- * \brief Adds or replace the head timer of the list.
+ * \brief Adds a timer to the heaps
+ *
+ * \param [in]  obj Timer object to be added to the heaps
+ */
+static void timer_heap_insert( timer_event_t* obj );
+
+/*!
+ * \brief Removes a timer from the heaps
  *
- * \remark The list is automatically sorted. The list head always contains the
- *         next timer to expire.
+ * \param [in]  obj Timer object to be removed, it shall be in the heaps
+ */
+static void timer_heap_remove( timer_event_t* obj );
+
+/*!
+ * \brief Returns the time a timer is ordered by in a heap
+ *
+ * \param [in] obj  Timer object
+ * \param [in] heap Heap \ref timer_heap_t
+ *
+ * \retval key Timeout, or timeout plus slack, in RTC ticks
+ */
+static uint32_t timer_heap_key( const timer_event_t* obj, const timer_heap_t heap );
+
+/*!
+ * \brief Moves the timer at index up until its parent expires before it
  *
- * \param [in]  obj Timer object to be become the new head
- * \param [in]  remainingTime Remaining time of the previous head to be replaced
+ * \param [in] heap  Heap \ref timer_heap_t
+ * \param [in] index Index of the timer in the heap
  */
-static void timer_insert_new_head_timer( timer_event_t* obj );
+static void timer_heap_sift_up( const timer_heap_t heap, uint8_t index );
 
 /*!
- * \brief Adds a timer to the list.
+ * \brief Moves the timer at index down until its children expire after it
  *
- * \remark The list is automatically sorted. The list head always contains the
- *         next timer to expire.
+ * \param [in] heap  Heap \ref timer_heap_t
+ * \param [in] index Index of the timer in the heap
+ */
+static void timer_heap_sift_down( const timer_heap_t heap, uint8_t index );
+
+/*!
+ * \brief Programs the RTC alarm on the heap root, or stops it if the heap is empty
+ */
+static void timer_set_timeout( void );
+
+/*!
+ * \brief Returns the latest wakeup time meeting the slack of every running timer, the root of the wakeup heap
  *
- * \param [in]  obj Timer object to be added to the list
- * \param [in]  remainingTime Remaining time of the running head after which the object may be added
+ * \remark The heaps shall not be empty
+ *
+ * \retval wakeup Earliest timeout plus slack of the running timers, in RTC ticks
  */
-static void timer_insert_timer( timer_event_t* obj );
+static uint32_t timer_get_next_wakeup( void );
 
 /*!
- * \brief Sets a timeout with the duration "timestamp"
+ * \brief Calls the callbacks of the timers due at the given time
+ *
+ * \param [in] now Current RTC time in ticks
  *
- * \param [in] timestamp Delay duration
+ * \retval served Number of timer callbacks called
  */
-static void timer_set_timeout( timer_event_t* obj );
+static uint8_t timer_serve( uint32_t now );
 
 /*!
- * \brief Check if the Object to be added is not already in the list
+ * \brief Closes the wakeups per hour statistics periods elapsed at the given time
  *
- * \param [in] timestamp Delay duration
- * \retval true (the object is already in the list) or false
+ * \param [in] now Current RTC time in ticks
  */
-static bool timer_exists( timer_event_t* obj );
+static void timer_stats_update_period( uint32_t now );
+
+/*!
+ * \brief Checks if the heap root can be served by the current wakeup
+ *
+ * \param [in] now Current RTC time in ticks
+ *
+ * \remark An exact timer not expired yet also holds back the timers behind it in the timeout heap
+ *
+ * \retval [true : expired or within the coalescing window, false : a later wakeup is needed]
+ */
+static bool timer_root_is_due( uint32_t now );
 
 /*
  * -----------------------------------------------------------------------------
@@ -133,59 +266,56 @@ static bool timer_exists( timer_event_t* obj );
 
 void timer_init( timer_event_t* obj, void ( *callback )( void* context ) )
 {
-    obj->timestamp        = 0;
-    obj->reload_value     = 0;
-    obj->is_started       = false;
-    obj->is_next_2_expire = false;
-    obj->callback         = callback;
-    obj->context          = NULL;
-    obj->next             = NULL;
+    obj->timestamp    = 0;
+    obj->reload_value = 0;
+    obj->slack        = 0;
+    obj->is_started   = false;
+    obj->is_exact     = false;
+    obj->callback     = callback;
+    obj->context      = NULL;
+
+    obj->heap_index[TIMER_HEAP_TIMEOUT] = TIMER_NOT_IN_HEAP;
+    obj->heap_index[TIMER_HEAP_WAKEUP]  = TIMER_NOT_IN_HEAP;
 }
 
 void timer_set_context( timer_event_t* obj, void* context ) { obj->context = context; }
 
+void timer_set_slack( timer_event_t* obj, uint32_t slack ) { obj->slack = hal_rtc_ms_2_tick( slack ); }
+
+void timer_set_exact( timer_event_t* obj, bool is_exact ) { obj->is_exact = is_exact; }
+
 void timer_start( timer_event_t* obj )
 {
-    uint32_t elapsed_time = 0;
-
     CRITICAL_SECTION_BEGIN( );
 
-    if( ( obj == NULL ) || ( timer_exists( obj ) == true ) )
+    if( ( obj == NULL ) || ( obj->heap_index[TIMER_HEAP_TIMEOUT] != TIMER_NOT_IN_HEAP ) )
     {
         CRITICAL_SECTION_END( );
         return;
     }
 
-    obj->timestamp        = obj->reload_value;
-    obj->is_started       = true;
-    obj->is_next_2_expire = false;
+    HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_TIMER_START );
+
+    obj->timestamp  = hal_rtc_get_timer_value( ) + obj->reload_value;
+    obj->is_started = true;
 
-    if( timer_list_head == NULL )
+    timer_heap_insert( obj );
+
+    // The alarm only has to move when the new timer cannot wait for the programmed wakeup
+    if( ( timer_alarm_running == false ) ||
+        timer_is_before( obj->timestamp + obj->slack, timer_alarm_timestamp ) )
     {
-        hal_rtc_set_time_ref_in_ticks( );
-        // Inserts a timer at time now + obj->timestamp
-        timer_insert_new_head_timer( obj );
+        timer_set_timeout( );
     }
-    else
-    {
-        elapsed_time = hal_rtc_get_timer_elapsed_value( );
-        obj->timestamp += elapsed_time;
 
-        if( obj->timestamp < timer_list_head->timestamp )
-        {
-            timer_insert_new_head_timer( obj );
-        }
-        else
-        {
-            timer_insert_timer( obj );
-        }
-    }
+    HAL_PROF_ZONE_END( HAL_PROF_ZONE_TIMER_START );
+
     CRITICAL_SECTION_END( );
 }
 
 bool is_timer_running( void )
 {
-    if( timer_list_head == NULL )
+    if( timer_heap_count == 0 )
     {
         return false;
     }
@@ -195,106 +325,58 @@ bool is_timer_running( void )
     }
 }
 
-static void timer_insert_timer( timer_event_t* obj )
+bool timer_is_started( timer_event_t* obj ) { return obj->is_started; }
+
+void timer_irq_handler( void )
 {
-    timer_event_t* cur  = timer_list_head;
-    timer_event_t* next = timer_list_head->next;
+    uint32_t now = hal_rtc_get_timer_value( );
+    uint8_t  served;
+
+    timer_stats_update_period( now );
+    timer_stats.wakeups++;
+    timer_stats_period_wakeups++;
 
-    while( cur->next != NULL )
+    // The timers the alarm was programmed for are served even if the counter is read slightly before the alarm time
+    if( ( timer_alarm_running == true ) && timer_is_before( now, timer_alarm_timestamp ) )
     {
-        if( obj->timestamp > next->timestamp )
-        {
-            cur  = next;
-            next = next->next;
-        }
-        else
-        {
-            cur->next = obj;
-            obj->next = next;
-            return;
-        }
+        now = timer_alarm_timestamp;
     }
-    cur->next = obj;
-    obj->next = NULL;
-}
-
-static void timer_insert_new_head_timer( timer_event_t* obj )
-{
-    timer_event_t* cur = timer_list_head;
+    timer_alarm_running = false;
 
-    if( cur != NULL )
+    // Remove all the expired object from the heap, and the ones close enough to share this wakeup
+    served = timer_serve( now );
+    if( served > 1 )
     {
-        cur->is_next_2_expire = false;
+        timer_stats.wakeups_saved += served - 1;
     }
 
-    obj->next       = cur;
-    timer_list_head = obj;
-    timer_set_timeout( timer_list_head );
+    timer_set_timeout( );
 }
 
-bool timer_is_started( timer_event_t* obj ) { return obj->is_started; }
-
-void timer_irq_handler( void )
+bool timer_serve_due( void )
 {
-    timer_event_t* cur;
-    timer_event_t* next;
+    uint8_t served = 0;
 
-    uint32_t old           = hal_rtc_get_time_ref_in_ticks( );
-    uint32_t now           = hal_rtc_set_time_ref_in_ticks( );
-    uint32_t delta_context = now - old;  // intentional wrap around
-
-    // Update timeStamp based upon new Time Reference
-    // because delta context should never exceed 2^32
-    if( timer_list_head != NULL )
-    {
-        for( cur = timer_list_head; cur->next != NULL; cur = cur->next )
-        {
-            next = cur->next;
-            if( next->timestamp > delta_context )
-            {
-                next->timestamp -= delta_context;
-            }
-            else
-            {
-                next->timestamp = 0;
-            }
-        }
-    }
+    CRITICAL_SECTION_BEGIN( );
 
-    // Execute immediately the alarm callback
-    if( timer_list_head != NULL )
+    if( ( timer_heap_count != 0 ) && ( timer_root_is_due( hal_rtc_get_timer_value( ) ) == true ) )
     {
-        cur             = timer_list_head;
-        timer_list_head = timer_list_head->next;
-        cur->is_started = false;
-        execute_callback( cur->callback, cur->context );
+        served = timer_serve( hal_rtc_get_timer_value( ) );
+        timer_stats.wakeups_saved += served;
+        timer_set_timeout( );
     }
 
-    // Remove all the expired object from the list
-    while( ( timer_list_head != NULL ) && ( timer_list_head->timestamp < hal_rtc_get_timer_elapsed_value( ) ) )
-    {
-        cur             = timer_list_head;
-        timer_list_head = timer_list_head->next;
-        cur->is_started = false;
-        execute_callback( cur->callback, cur->context );
-    }
+    CRITICAL_SECTION_END( );
 
-    // Start the next timer_list_head if it exists AND NOT running
-    if( ( timer_list_head != NULL ) && ( timer_list_head->is_next_2_expire == false ) )
-    {
-        timer_set_timeout( timer_list_head );
-    }
+    return ( served != 0 ) ? true : false;
 }
 
 void timer_stop( timer_event_t* obj )
 {
     CRITICAL_SECTION_BEGIN( );
 
-    timer_event_t* prev = timer_list_head;
-    timer_event_t* cur  = timer_list_head;
-
-    // List is empty or the obj to stop does not exist
-    if( ( timer_list_head == NULL ) || ( obj == NULL ) )
+    // The obj to stop does not exist
+    if( obj == NULL )
     {
         CRITICAL_SECTION_END( );
         return;
@@ -302,75 +384,25 @@ void timer_stop( timer_event_t* obj )
 
     obj->is_started = false;
 
-    if( timer_list_head == obj )  // Stop the Head
+    if( obj->heap_index[TIMER_HEAP_TIMEOUT] == TIMER_NOT_IN_HEAP )
     {
-        if( timer_list_head->is_next_2_expire == true )  // The head is already running
-        {
-            timer_list_head->is_next_2_expire = false;
-            if( timer_list_head->next != NULL )
-            {
-                timer_list_head = timer_list_head->next;
-                timer_set_timeout( timer_list_head );
-            }
-            else
-            {
-                hal_rtc_stop_alarm( );
-                timer_list_head = NULL;
-            }
-        }
-        else  // Stop the head before it is started
-        {
-            if( timer_list_head->next != NULL )
-            {
-                timer_list_head = timer_list_head->next;
-            }
-            else
-            {
-                timer_list_head = NULL;
-            }
-        }
-    }
-    else  // Stop an object within the list
-    {
-        while( cur != NULL )
-        {
-            if( cur == obj )
-            {
-                if( cur->next != NULL )
-                {
-                    cur        = cur->next;
-                    prev->next = cur;
-                }
-                else
-                {
-                    cur        = NULL;
-                    prev->next = cur;
-                }
-                break;
-            }
-            else
-            {
-                prev = cur;
-                cur  = cur->next;
-            }
-        }
+        CRITICAL_SECTION_END( );
+        return;
     }
-    CRITICAL_SECTION_END( );
-}
 
-static bool timer_exists( timer_event_t* obj )
-{
-    timer_event_t* cur = timer_list_head;
+    HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_TIMER_STOP );
 
-    while( cur != NULL )
+    timer_heap_remove( obj );
+
+    // The alarm only has to move when the stopped timer was the one setting the wakeup time
+    if( ( timer_alarm_running == true ) && ( obj->timestamp + obj->slack == timer_alarm_timestamp ) )
     {
-        if( cur == obj )
-        {
-            return true;
-        }
-        cur = cur->next;
+        timer_set_timeout( );
     }
-    return false;
+
+    HAL_PROF_ZONE_END( HAL_PROF_ZONE_TIMER_STOP );
+
+    CRITICAL_SECTION_END( );
 }
 
 void timer_reset( timer_event_t* obj )
@@ -410,22 +442,35 @@ timer_time_t timer_get_elapsed_time( timer_time_t past )
     return hal_rtc_tick_2_ms( nowInTicks - pastInTicks );
 }
 
-static void timer_set_timeout( timer_event_t* obj )
+timer_time_t timer_temp_compensation( timer_time_t period, float temperature )
 {
-    int32_t min_ticks     = hal_rtc_get_minimum_timeout( );
-    obj->is_next_2_expire = true;
+    return hal_rtc_temp_compensation( period, temperature );
+}
 
-    // In case deadline too soon
-    if( obj->timestamp < ( hal_rtc_get_timer_elapsed_value( ) + min_ticks ) )
+timer_time_t timer_get_remaining_time( void )
+{
+    timer_time_t remaining = TIMERTIME_T_MAX;
+
+    CRITICAL_SECTION_BEGIN( );
+
+    if( timer_heap_count != 0 )
     {
-        obj->timestamp = hal_rtc_get_timer_elapsed_value( ) + min_ticks;
+        int32_t ticks = ( int32_t )( timer_heap[TIMER_HEAP_TIMEOUT][0]->timestamp - hal_rtc_get_timer_value( ) );
+
+        remaining = ( ticks > 0 ) ? hal_rtc_tick_2_ms( ticks ) : 0;
     }
-    hal_rtc_start_alarm( obj->timestamp );
+
+    CRITICAL_SECTION_END( );
+
+    return remaining;
 }
 
-timer_time_t timer_temp_compensation( timer_time_t period, float temperature )
+void timer_get_stats( timer_stats_t* stats )
 {
-    return hal_rtc_temp_compensation( period, temperature );
+    CRITICAL_SECTION_BEGIN( );
+    timer_stats_update_period( hal_rtc_get_timer_value( ) );
+    *stats = timer_stats;
+    CRITICAL_SECTION_END( );
 }
 
 /*
@@ -433,4 +478,217 @@ timer_time_t timer_temp_compensation( timer_time_t period, float temperature )
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+static void timer_heap_insert( timer_event_t* obj )
+{
+    if( timer_heap_count >= TIMER_HEAP_SIZE )
+    {
+        // More timers than TIMER_HEAP_SIZE are running, increase it
+        hal_mcu_panic( );
+    }
+
+    for( uint8_t heap = 0; heap < TIMER_HEAP_NB; heap++ )
+    {
+        obj->heap_index[heap]              = timer_heap_count;
+        timer_heap[heap][timer_heap_count] = obj;
+    }
+    timer_heap_count++;
+
+    for( uint8_t heap = 0; heap < TIMER_HEAP_NB; heap++ )
+    {
+        timer_heap_sift_up( ( timer_heap_t ) heap, obj->heap_index[heap] );
+    }
+}
+
+static void timer_heap_remove( timer_event_t* obj )
+{
+    timer_heap_count--;
+
+    for( uint8_t heap = 0; heap < TIMER_HEAP_NB; heap++ )
+    {
+        uint8_t        index = obj->heap_index[heap];
+        timer_event_t* last;
+
+        obj->heap_index[heap] = TIMER_NOT_IN_HEAP;
+        if( index == timer_heap_count )
+        {
+            continue;
+        }
+
+        // The last timer fills the hole, then goes up or down to its place
+        last                    = timer_heap[heap][timer_heap_count];
+        last->heap_index[heap]  = index;
+        timer_heap[heap][index] = last;
+
+        if( ( index > 0 ) && timer_is_before( timer_heap_key( last, ( timer_heap_t ) heap ),
+                                              timer_heap_key( timer_heap[heap][( index - 1 ) >> 1],
+                                                              ( timer_heap_t ) heap ) ) )
+        {
+            timer_heap_sift_up( ( timer_heap_t ) heap, index );
+        }
+        else
+        {
+            timer_heap_sift_down( ( timer_heap_t ) heap, index );
+        }
+    }
+}
+
+static uint32_t timer_heap_key( const timer_event_t* obj, const timer_heap_t heap )
+{
+    return ( heap == TIMER_HEAP_WAKEUP ) ? obj->timestamp + obj->slack : obj->timestamp;
+}
+
+static void timer_heap_sift_up( const timer_heap_t heap, uint8_t index )
+{
+    timer_event_t* obj = timer_heap[heap][index];
+    uint32_t       key = timer_heap_key( obj, heap );
+
+    while( index > 0 )
+    {
+        uint8_t parent = ( index - 1 ) >> 1;
+
+        if( !timer_is_before( key, timer_heap_key( timer_heap[heap][parent], heap ) ) )
+        {
+            break;
+        }
+        timer_heap[heap][index]                   = timer_heap[heap][parent];
+        timer_heap[heap][index]->heap_index[heap] = index;
+        index                                     = parent;
+    }
+    timer_heap[heap][index] = obj;
+    obj->heap_index[heap]   = index;
+}
+
+static void timer_heap_sift_down( const timer_heap_t heap, uint8_t index )
+{
+    timer_event_t* obj = timer_heap[heap][index];
+    uint32_t       key = timer_heap_key( obj, heap );
+
+    while( true )
+    {
+        uint8_t child = ( index << 1 ) + 1;
+
+        if( child >= timer_heap_count )
+        {
+            break;
+        }
+        if( ( ( child + 1 ) < timer_heap_count ) &&
+            timer_is_before( timer_heap_key( timer_heap[heap][child + 1], heap ),
+                             timer_heap_key( timer_heap[heap][child], heap ) ) )
+        {
+            child++;
+        }
+        if( !timer_is_before( timer_heap_key( timer_heap[heap][child], heap ), key ) )
+        {
+            break;
+        }
+        timer_heap[heap][index]                   = timer_heap[heap][child];
+        timer_heap[heap][index]->heap_index[heap] = index;
+        index                                     = child;
+    }
+    timer_heap[heap][index] = obj;
+    obj->heap_index[heap]   = index;
+}
+
+static void timer_set_timeout( void )
+{
+    uint32_t min_ticks = hal_rtc_get_minimum_timeout( );
+    uint32_t now;
+    uint32_t timeout;
+
+    uint32_t wakeup;
+
+    if( timer_heap_count == 0 )
+    {
+        hal_rtc_stop_alarm( );
+        timer_alarm_running = false;
+        return;
+    }
+
+    wakeup = timer_get_next_wakeup( );
+    if( ( timer_alarm_running == true ) && ( wakeup == timer_alarm_timestamp ) )
+    {
+        return;
+    }
+    timer_alarm_running   = true;
+    timer_alarm_timestamp = wakeup;
+
+    // The alarm is programmed relatively to the time reference, taken now
+    now     = hal_rtc_set_time_ref_in_ticks( );
+    timeout = wakeup - now;
+
+    // In case deadline too soon
+    if( timer_is_before( wakeup, now + min_ticks ) )
+    {
+        timeout = min_ticks;
+    }
+    hal_rtc_start_alarm( timeout );
+}
+
+static uint32_t timer_get_next_wakeup( void )
+{
+    return timer_heap_key( timer_heap[TIMER_HEAP_WAKEUP][0], TIMER_HEAP_WAKEUP );
+}
+
+static uint8_t timer_serve( uint32_t now )
+{
+    timer_event_t* cur;
+    uint32_t       rtc;
+    uint8_t        served = 0;
+
+    while( ( timer_heap_count != 0 ) && ( timer_root_is_due( now ) == true ) )
+    {
+        cur = timer_heap[TIMER_HEAP_TIMEOUT][0];
+        timer_heap_remove( cur );
+        cur->is_started = false;
+        timer_stats.expiries++;
+        served++;
+        execute_callback( cur->callback, cur->context );
+
+        // Timers started by the callback are compared to the actual time
+        rtc = hal_rtc_get_timer_value( );
+        if( timer_is_before( now, rtc ) )
+        {
+            now = rtc;
+        }
+    }
+    return served;
+}
+
+static void timer_stats_update_period( uint32_t now )
+{
+    uint32_t period  = hal_rtc_ms_2_tick( TIMER_STATS_PERIOD_MS );
+    uint32_t elapsed = now - timer_stats_period_start;
+
+    if( elapsed < period )
+    {
+        return;
+    }
+
+    // Hours without any wakeup in between are not worth a loop
+    timer_stats.wakeups_last_hour = ( elapsed < ( 2 * period ) ) ? timer_stats_period_wakeups : 0;
+    if( timer_stats_period_wakeups > timer_stats.wakeups_max_per_hour )
+    {
+        timer_stats.wakeups_max_per_hour = timer_stats_period_wakeups;
+    }
+    timer_stats_period_wakeups = 0;
+    timer_stats_period_start += ( elapsed / period ) * period;
+}
+
+static bool timer_root_is_due( uint32_t now )
+{
+    timer_event_t* root   = timer_heap[TIMER_HEAP_TIMEOUT][0];
+    uint32_t       window = root->reload_value >> TIMER_COALESCE_SHIFT;
+
+    if( root->is_exact == true )
+    {
+        window = 0;
+    }
+    else if( window > TIMER_COALESCE_WINDOW )
+    {
+        window = TIMER_COALESCE_WINDOW;
+    }
+
+    return !timer_is_before( now + window, root->timestamp );
+}
+
 /* --- EOF ------------------------------------------------------------------ */
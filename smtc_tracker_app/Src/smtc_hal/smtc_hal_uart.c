@@ -36,11 +36,15 @@
 
 #include <stdint.h>   // C99 types
 #include <stdbool.h>  // bool type
+#include <string.h>   // memcpy
 
 #include "stm32wbxx_hal.h"
+#include "smtc_hal_options.h"
 #include "smtc_hal_gpio_pin_names.h"
+#include "smtc_hal_gpio.h"
 #include "smtc_hal_uart.h"
 #include "smtc_hal_mcu.h"
+#include "smtc_hal_profiling.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -52,6 +56,14 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+#if( ( HAL_DBG_TRACE_RING_SIZE & ( HAL_DBG_TRACE_RING_SIZE - 1 ) ) != 0 )
+#error "HAL_DBG_TRACE_RING_SIZE shall be a power of 2"
+#endif
+
+#define HAL_UART_TX_RING_MASK ( HAL_DBG_TRACE_RING_SIZE - 1 )
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -64,11 +76,20 @@ typedef struct hal_uart_s
 {
     USART_TypeDef*     interface;
     UART_HandleTypeDef handle;
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+    DMA_HandleTypeDef  hdma_tx;
+#endif
     struct
     {
         hal_gpio_pin_names_t tx;
         hal_gpio_pin_names_t rx;
     } pins;
+    struct
+    {
+        uint32_t tx;
+        uint32_t rx;
+    } pins_config;               // Pins configuration saved by hal_uart_suspend
+    volatile bool is_suspended;  // Pins to be restored before the next transfer
 } hal_uart_t;
 
 static hal_uart_t hal_uart[] = {
@@ -91,6 +112,27 @@ static hal_uart_t hal_uart[] = {
 
 uint8_t uart_rx_done = false;
 
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+/*!
+ * \brief TX ring of the printf UART
+ *
+ * Indexes are free running and masked on access. Producers first register in writers, then reserve room by moving
+ * reserve forward with LDREX/STREX. The last producer to leave publishes reserve into head, so the DMA never sees a
+ * partially copied message: on a single core a preempting producer always completes before the preempted one
+ * resumes. head only moves forward, a preempted producer never publishes a reserve older than a nested one.
+ */
+static struct
+{
+    uint8_t             buffer[HAL_DBG_TRACE_RING_SIZE];
+    volatile uint32_t   writers;  // producers currently copying into the ring
+    volatile uint32_t   reserve;  // end of the reserved area
+    volatile uint32_t   head;     // end of the published area, visible to the DMA
+    volatile uint32_t   tail;     // start of the data not sent yet
+    volatile uint32_t   dma_len;  // length of the transfer in flight, 0 when the DMA is idle
+    hal_uart_tx_stats_t stats;
+} hal_uart_tx_ring;
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
@@ -98,6 +140,32 @@ uint8_t uart_rx_done = false;
 
 void USART1_IRQHandler( void );
 
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+void DMA1_Channel2_IRQHandler( void );
+
+/*!
+ * \brief Atomically adds a signed value to a word
+ *
+ * \param [in] value word to update
+ * \param [in] delta value to add
+ *
+ * \returns new value of the word
+ */
+static uint32_t hal_uart_atomic_add( volatile uint32_t* value, int32_t delta );
+
+/*!
+ * \brief Atomically moves head forward to a reserve end, an older one is ignored
+ *
+ * \param [in] reserve end of the reserved area to publish
+ */
+static void hal_uart_tx_ring_publish( uint32_t reserve );
+
+/*!
+ * \brief Starts the DMA on the next contiguous chunk of the TX ring if it is idle
+ */
+static void hal_uart_tx_ring_kick( void );
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -127,6 +195,12 @@ void hal_uart_init( const uint32_t id, const hal_gpio_pin_names_t uart_tx, const
         hal_mcu_panic( );
     }
     __HAL_UART_ENABLE( &hal_uart[local_id].handle );
+
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+    // Resume the transfer of traces queued while the UART was off
+    hal_uart_tx_ring.dma_len = 0;
+    hal_uart_tx_ring_kick( );
+#endif
 }
 
 void hal_uart_deinit( const uint32_t id )
@@ -137,19 +211,173 @@ void hal_uart_deinit( const uint32_t id )
     HAL_UART_DeInit( &hal_uart[local_id].handle );
 }
 
+void hal_uart_suspend( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_uart ) ) );
+    uint32_t local_id = id - 1;
+
+    hal_uart[local_id].pins_config.tx = hal_gpio_save_config( hal_uart[local_id].pins.tx );
+    hal_uart[local_id].pins_config.rx = hal_gpio_save_config( hal_uart[local_id].pins.rx );
+    hal_gpio_deinit( hal_uart[local_id].pins.tx );
+    hal_gpio_deinit( hal_uart[local_id].pins.rx );
+    hal_uart[local_id].is_suspended = true;
+}
+
+void hal_uart_resume( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_uart ) ) );
+    uint32_t local_id = id - 1;
+
+    if( hal_uart[local_id].is_suspended == true )
+    {
+        // Counted in the wake-to-ready time, masked as the zone could be entered again from an interrupt
+        CRITICAL_SECTION_BEGIN( );
+        HAL_PROF_ZONE_BEGIN( HAL_PROF_ZONE_BUS_RESUME );
+        hal_gpio_restore_config( hal_uart[local_id].pins.tx, hal_uart[local_id].pins_config.tx );
+        hal_gpio_restore_config( hal_uart[local_id].pins.rx, hal_uart[local_id].pins_config.rx );
+        HAL_PROF_ZONE_END( HAL_PROF_ZONE_BUS_RESUME );
+        CRITICAL_SECTION_END( );
+        hal_uart[local_id].is_suspended = false;
+    }
+}
+
+void hal_uart_retime( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_uart ) ) );
+    uint32_t local_id = id - 1;
+
+    if( hal_uart[local_id].handle.gState == HAL_UART_STATE_RESET )
+    {
+        // Not initialized, hal_uart_init will use the new clock
+        return;
+    }
+
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+    hal_uart_flush( id );
+#endif
+
+    if( HAL_RCC_GetPCLK2Freq( ) < ( 32 * hal_uart[local_id].handle.Init.BaudRate ) )
+    {
+        hal_uart[local_id].handle.Init.OverSampling = UART_OVERSAMPLING_8;
+    }
+    else
+    {
+        hal_uart[local_id].handle.Init.OverSampling = UART_OVERSAMPLING_16;
+    }
+
+    // The MSP is already initialized, HAL_UART_Init only rewrites the UART registers
+    if( HAL_UART_Init( &hal_uart[local_id].handle ) != HAL_OK )
+    {
+        hal_mcu_panic( );
+    }
+    __HAL_UART_ENABLE( &hal_uart[local_id].handle );
+}
+
 void hal_uart_tx( const uint32_t id, uint8_t* buff, uint16_t len )
 {
     assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_uart ) ) );
     uint32_t local_id = id - 1;
 
+    if( hal_uart[local_id].is_suspended == true )
+    {
+        hal_uart_resume( id );
+    }
+
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+    // The UART can not take a blocking transfer while the DMA is busy
+    hal_uart_flush( id );
+#endif
     HAL_UART_Transmit( &hal_uart[local_id].handle, ( uint8_t* ) buff, len, 0xffffff );
 }
 
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+void hal_uart_tx_async( const uint32_t id, const uint8_t* buff, uint16_t len )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_uart ) ) );
+    uint32_t start;
+    uint32_t used;
+    bool     reserved = true;
+
+    hal_uart_atomic_add( &hal_uart_tx_ring.writers, 1 );
+
+    do
+    {
+        start = __LDREXW( &hal_uart_tx_ring.reserve );
+        used  = start - hal_uart_tx_ring.tail;
+        if( ( used + len ) > HAL_DBG_TRACE_RING_SIZE )
+        {
+            __CLREX( );
+            reserved = false;
+            break;
+        }
+    } while( __STREXW( start + len, &hal_uart_tx_ring.reserve ) != 0 );
+
+    if( reserved == true )
+    {
+        uint32_t offset = start & HAL_UART_TX_RING_MASK;
+        uint32_t first  = HAL_DBG_TRACE_RING_SIZE - offset;
+
+        if( first > len )
+        {
+            first = len;
+        }
+        memcpy( &hal_uart_tx_ring.buffer[offset], buff, first );
+        memcpy( &hal_uart_tx_ring.buffer[0], buff + first, len - first );
+
+        if( ( used + len ) > hal_uart_tx_ring.stats.high_water )
+        {
+            hal_uart_tx_ring.stats.high_water = used + len;
+        }
+    }
+    else
+    {
+        hal_uart_atomic_add( &hal_uart_tx_ring.stats.dropped_msgs, 1 );
+        hal_uart_atomic_add( &hal_uart_tx_ring.stats.dropped_bytes, len );
+    }
+
+    if( hal_uart_atomic_add( &hal_uart_tx_ring.writers, -1 ) == 0 )
+    {
+        hal_uart_tx_ring_publish( hal_uart_tx_ring.reserve );
+        hal_uart_tx_ring_kick( );
+    }
+}
+
+void hal_uart_flush( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_uart ) ) );
+    uint32_t local_id = id - 1;
+
+    while( ( hal_uart_tx_ring.head != hal_uart_tx_ring.tail ) &&
+           ( hal_uart[local_id].handle.gState != HAL_UART_STATE_RESET ) )
+    {
+        if( __get_PRIMASK( ) != 0 )
+        {
+            // Interrupts are masked (panic, reset): service the transfer by polling
+            HAL_DMA_IRQHandler( &hal_uart[local_id].hdma_tx );
+            HAL_UART_IRQHandler( &hal_uart[local_id].handle );
+        }
+        hal_uart_tx_ring_kick( );
+    }
+}
+
+void hal_uart_get_tx_stats( const uint32_t id, hal_uart_tx_stats_t* stats )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_uart ) ) );
+
+    *stats = hal_uart_tx_ring.stats;
+}
+#endif
+
 void hal_uart_rx( const uint32_t id, uint8_t* rx_buffer, uint8_t len )
 {
     assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( hal_uart ) ) );
     uint32_t local_id = id - 1;
 
+    if( hal_uart[local_id].is_suspended == true )
+    {
+        hal_uart_resume( id );
+    }
+
     HAL_UART_Receive_IT( &hal_uart[local_id].handle, rx_buffer, len );
 
     while( uart_rx_done != true )
@@ -177,6 +405,30 @@ void HAL_UART_MspInit( UART_HandleTypeDef* huart )
         HAL_NVIC_EnableIRQ( USART1_IRQn );
 
         __HAL_RCC_USART1_CLK_ENABLE( );
+
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+        /* USART1 TX DMA, DMA1_Channel1 is used by the ADC */
+        __HAL_RCC_DMAMUX1_CLK_ENABLE( );
+        __HAL_RCC_DMA1_CLK_ENABLE( );
+
+        hal_uart[0].hdma_tx.Instance                 = DMA1_Channel2;
+        hal_uart[0].hdma_tx.Init.Request             = DMA_REQUEST_USART1_TX;
+        hal_uart[0].hdma_tx.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+        hal_uart[0].hdma_tx.Init.PeriphInc           = DMA_PINC_DISABLE;
+        hal_uart[0].hdma_tx.Init.MemInc              = DMA_MINC_ENABLE;
+        hal_uart[0].hdma_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hal_uart[0].hdma_tx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+        hal_uart[0].hdma_tx.Init.Mode                = DMA_NORMAL;
+        hal_uart[0].hdma_tx.Init.Priority            = DMA_PRIORITY_LOW;
+        if( HAL_DMA_Init( &hal_uart[0].hdma_tx ) != HAL_OK )
+        {
+            hal_mcu_panic( );
+        }
+        __HAL_LINKDMA( huart, hdmatx, hal_uart[0].hdma_tx );
+
+        HAL_NVIC_SetPriority( DMA1_Channel2_IRQn, 0, 1 );
+        HAL_NVIC_EnableIRQ( DMA1_Channel2_IRQn );
+#endif
     }
     else
     {
@@ -190,6 +442,11 @@ void HAL_UART_MspDeInit( UART_HandleTypeDef* huart )
     if( huart->Instance == hal_uart[0].interface )
     {
         __HAL_RCC_USART1_CLK_DISABLE( );
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+        // DMA1 clock is left on, it is shared with the ADC
+        HAL_NVIC_DisableIRQ( DMA1_Channel2_IRQn );
+        HAL_DMA_DeInit( huart->hdmatx );
+#endif
     }
     else
     {
@@ -219,4 +476,100 @@ void USART1_IRQHandler( void ) { HAL_UART_IRQHandler( &hal_uart[0].handle ); }
  */
 void HAL_UART_RxCpltCallback( UART_HandleTypeDef* UartHandle ) { uart_rx_done = true; }
 
+#if( HAL_DBG_TRACE_ASYNC == HAL_FEATURE_ON )
+/**
+ * @brief  This function handles DMA1 channel2 interrupt request (USART1 TX).
+ */
+void DMA1_Channel2_IRQHandler( void ) { HAL_DMA_IRQHandler( &hal_uart[0].hdma_tx ); }
+
+/**
+ * @brief  Tx Transfer completed callback, releases the chunk and starts the next one
+ * @param  UartHandle: UART handle
+ */
+void HAL_UART_TxCpltCallback( UART_HandleTypeDef* UartHandle )
+{
+    if( UartHandle == &hal_uart[0].handle )
+    {
+        hal_uart_tx_ring.tail += hal_uart_tx_ring.dma_len;
+        hal_uart_tx_ring.dma_len = 0;
+        hal_uart_tx_ring_kick( );
+    }
+}
+
+/**
+ * @brief  UART error callback, a failed trace chunk is released so the ring can not stall
+ * @param  UartHandle: UART handle
+ */
+void HAL_UART_ErrorCallback( UART_HandleTypeDef* UartHandle )
+{
+    if( ( UartHandle == &hal_uart[0].handle ) && ( UartHandle->gState == HAL_UART_STATE_READY ) &&
+        ( hal_uart_tx_ring.dma_len != 0 ) )
+    {
+        hal_uart_tx_ring.stats.dropped_bytes += hal_uart_tx_ring.dma_len;
+        hal_uart_tx_ring.tail += hal_uart_tx_ring.dma_len;
+        hal_uart_tx_ring.dma_len = 0;
+        hal_uart_tx_ring_kick( );
+    }
+}
+
+static uint32_t hal_uart_atomic_add( volatile uint32_t* value, int32_t delta )
+{
+    uint32_t new_value;
+
+    do
+    {
+        new_value = __LDREXW( value ) + delta;
+    } while( __STREXW( new_value, value ) != 0 );
+
+    return new_value;
+}
+
+static void hal_uart_tx_ring_publish( uint32_t reserve )
+{
+    uint32_t head;
+
+    do
+    {
+        head = __LDREXW( &hal_uart_tx_ring.head );
+
+        // A nested producer already published this reserve or a newer one, the indexes are free running
+        if( ( int32_t )( reserve - head ) <= 0 )
+        {
+            __CLREX( );
+            return;
+        }
+    } while( __STREXW( reserve, &hal_uart_tx_ring.head ) != 0 );
+}
+
+static void hal_uart_tx_ring_kick( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+
+    if( ( hal_uart_tx_ring.dma_len == 0 ) && ( hal_uart_tx_ring.head != hal_uart_tx_ring.tail ) )
+    {
+        if( hal_uart[0].is_suspended == true )
+        {
+            hal_uart_resume( HAL_PRINTF_UART_ID );
+        }
+
+        uint32_t offset = hal_uart_tx_ring.tail & HAL_UART_TX_RING_MASK;
+        uint32_t len    = hal_uart_tx_ring.head - hal_uart_tx_ring.tail;
+
+        // Stop at the end of the buffer, the wrapped part goes with the next transfer
+        if( len > ( HAL_DBG_TRACE_RING_SIZE - offset ) )
+        {
+            len = HAL_DBG_TRACE_RING_SIZE - offset;
+        }
+
+        // Busy when the UART is not initialized (low power), the data stays queued
+        if( HAL_UART_Transmit_DMA( &hal_uart[0].handle, &hal_uart_tx_ring.buffer[offset], len ) == HAL_OK )
+        {
+            hal_uart_tx_ring.dma_len = len;
+        }
+    }
+
+    CRITICAL_SECTION_END( );
+}
+#endif
+
 /* --- EOF ------------------------------------------------------------------ */
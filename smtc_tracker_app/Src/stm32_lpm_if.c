@@ -137,6 +137,8 @@ void PWR_EnterStopMode( void )
    */
   HAL_SuspendTick();
 
+  hal_residency_set_mode( HAL_RESIDENCY_STOP2 );
+
   /**
    * This function is called from CRITICAL SECTION
    */
@@ -227,6 +229,8 @@ void PWR_ExitStopMode( void )
 
   HAL_ResumeTick();
 
+  hal_residency_set_mode( HAL_RESIDENCY_RUN );
+
 /* USER CODE END PWR_ExitStopMode */
 }
 
@@ -240,6 +244,8 @@ void PWR_EnterSleepMode( void )
 {
 /* USER CODE BEGIN PWR_EnterSleepMode */
 
+  hal_residency_set_mode( HAL_RESIDENCY_SLEEP );
+
   HAL_SuspendTick();
 
   /************************************************************************************
@@ -270,6 +276,8 @@ void PWR_ExitSleepMode( void )
 
   HAL_ResumeTick();
 
+  hal_residency_set_mode( HAL_RESIDENCY_RUN );
+
 /* USER CODE END PWR_ExitSleepMode */
 }
 
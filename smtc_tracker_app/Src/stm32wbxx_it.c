@@ -22,6 +22,7 @@
 #include "stm32wbxx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "smtc_hal_residency.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -177,6 +178,7 @@ void PendSV_Handler(void)
 
 void IPCC_C1_TX_IRQHandler(void)
 {
+  hal_residency_notify_wake( HAL_RESIDENCY_WAKE_IPCC );
   HW_IPCC_Tx_Handler();
 
   return;
@@ -184,6 +186,7 @@ void IPCC_C1_TX_IRQHandler(void)
 
 void IPCC_C1_RX_IRQHandler(void)
 {
+  hal_residency_notify_wake( HAL_RESIDENCY_WAKE_IPCC );
   HW_IPCC_Rx_Handler();
   return;
 }